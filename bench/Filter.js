@@ -0,0 +1,60 @@
+/**
+ * Filter.js
+ *
+ * This benchmark compares the native streaming FIR filter with a JavaScript loop.
+ */
+
+"use strict";
+
+const libtiepie = require('../lib/index.js');
+
+const length = 1 << 22; // 4 MS
+const chunkLength = 1 << 16;
+const taps = 32;
+const decimation = 4;
+
+const input = new Float32Array(length);
+for(let i = 0; i < length; i++)
+{
+  input[i] = Math.sin(2 * Math.PI * i / 1000);
+}
+const coefficients = new Float32Array(taps).fill(1 / taps);
+
+function milliseconds(start)
+{
+  const diff = process.hrtime(start);
+  return diff[0] * 1e3 + diff[1] / 1e6;
+}
+
+function report(name, ms)
+{
+  console.log(name + ': ' + ms.toFixed(1) + ' ms, ' + (length / ms / 1e3).toFixed(0) + ' MS/s');
+}
+
+// JavaScript, keeping the last taps - 1 samples between chunks:
+let start = process.hrtime();
+const history = new Float32Array(taps - 1 + chunkLength);
+const output = new Float32Array(chunkLength / decimation);
+for(let offset = 0; offset < length; offset += chunkLength)
+{
+  history.copyWithin(0, chunkLength);
+  history.set(input.subarray(offset, offset + chunkLength), taps - 1);
+  for(let j = 0, o = 0; j < chunkLength; j += decimation, o++)
+  {
+    let sum = 0;
+    for(let k = 0; k < taps; k++)
+    {
+      sum += coefficients[taps - 1 - k] * history[j + k];
+    }
+    output[o] = sum;
+  }
+}
+report('JavaScript', milliseconds(start));
+
+const filter = new libtiepie.Filter(1, {type: 'fir', coefficients: coefficients, decimation: decimation});
+start = process.hrtime();
+for(let offset = 0; offset < length; offset += chunkLength)
+{
+  filter.process([input.subarray(offset, offset + chunkLength)]);
+}
+report('Native', milliseconds(start));
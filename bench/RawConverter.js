@@ -0,0 +1,50 @@
+/**
+ * RawConverter.js
+ *
+ * This benchmark compares the native raw to volts conversion with a JavaScript loop.
+ */
+
+"use strict";
+
+const libtiepie = require('../lib/index.js');
+
+const length = 1 << 24; // 16 MS
+const iterations = 10;
+
+const raw = new Int16Array(length);
+for(let i = 0; i < length; i++)
+{
+  raw[i] = Math.round(32767 * Math.sin(2 * Math.PI * i / 1000));
+}
+const volts = new Float32Array(length);
+const gain = 8 / 65535;
+const offset = 0;
+
+function milliseconds(start)
+{
+  const diff = process.hrtime(start);
+  return diff[0] * 1e3 + diff[1] / 1e6;
+}
+
+function report(name, ms)
+{
+  console.log(name + ': ' + ms.toFixed(1) + ' ms per record, ' + (length / ms / 1e3).toFixed(0) + ' MS/s');
+}
+
+let start = process.hrtime();
+for(let n = 0; n < iterations; n++)
+{
+  for(let i = 0; i < length; i++)
+  {
+    volts[i] = raw[i] * gain + offset;
+  }
+}
+report('JavaScript', milliseconds(start) / iterations);
+
+const converter = new libtiepie.RawConverter([{gain: gain, offset: offset}]);
+start = process.hrtime();
+for(let n = 0; n < iterations; n++)
+{
+  converter.convert(0, raw, volts);
+}
+report('Native    ', milliseconds(start) / iterations);
@@ -0,0 +1,35 @@
+/**
+ * Resampler.js
+ *
+ * This benchmark resamples a 10 MS record to a rate with a small and with a large denominator.
+ */
+
+"use strict";
+
+const libtiepie = require('../lib/index.js');
+
+const length = 10000000; // 10 MS
+const iterations = 5;
+
+const input = new Float32Array(length);
+for(let i = 0; i < length; i++)
+{
+  input[i] = Math.sin(2 * Math.PI * i / 1000);
+}
+
+function milliseconds(start)
+{
+  const diff = process.hrtime(start);
+  return diff[0] * 1e3 + diff[1] / 1e6;
+}
+
+[[1e7, 1.3e7], [1e7, 0.9999e7], [1e8, 2.4e7]].forEach(function(rates)
+{
+  const resampler = new libtiepie.Resampler(rates[0], rates[1]);
+  const start = process.hrtime();
+  for(let n = 0; n < iterations; n++)
+  {
+    resampler.resample(input);
+  }
+  console.log(rates[0] + ' -> ' + rates[1] + ' S/s: ' + (milliseconds(start) / iterations).toFixed(1) + ' ms per record');
+});
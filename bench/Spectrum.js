@@ -0,0 +1,112 @@
+/**
+ * Spectrum.js
+ *
+ * This benchmark compares the native spectrum with a JavaScript radix-2 FFT.
+ */
+
+"use strict";
+
+const libtiepie = require('../lib/index.js');
+
+const length = 1 << 20; // 1 MS
+const iterations = 10;
+
+// Test signal, sine plus noise:
+const data = new Float32Array(length);
+for(let i = 0; i < length; i++)
+{
+  data[i] = Math.sin(2 * Math.PI * 1000 * i / length) + 1e-3 * (Math.random() - 0.5);
+}
+
+// JavaScript baseline, iterative radix-2 FFT with Hann window:
+function jsMagnitude(input)
+{
+  const n = input.length;
+  const re = new Float64Array(n);
+  const im = new Float64Array(n);
+
+  for(let i = 0; i < n; i++)
+  {
+    re[i] = input[i] * (0.5 - 0.5 * Math.cos(2 * Math.PI * i / n));
+  }
+
+  for(let i = 1, j = 0; i < n; i++)
+  {
+    let bit = n >> 1;
+    for(; j & bit; bit >>= 1)
+    {
+      j ^= bit;
+    }
+    j ^= bit;
+    if(i < j)
+    {
+      const t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+    }
+  }
+
+  for(let size = 2; size <= n; size <<= 1)
+  {
+    const angle = -2 * Math.PI / size;
+    const wRe = Math.cos(angle);
+    const wIm = Math.sin(angle);
+    for(let start = 0; start < n; start += size)
+    {
+      let cRe = 1;
+      let cIm = 0;
+      for(let k = 0; k < size / 2; k++)
+      {
+        const a = start + k;
+        const b = a + size / 2;
+        const tRe = re[b] * cRe - im[b] * cIm;
+        const tIm = re[b] * cIm + im[b] * cRe;
+        re[b] = re[a] - tRe;
+        im[b] = im[a] - tIm;
+        re[a] += tRe;
+        im[a] += tIm;
+        const nRe = cRe * wRe - cIm * wIm;
+        cIm = cRe * wIm + cIm * wRe;
+        cRe = nRe;
+      }
+    }
+  }
+
+  const result = new Float64Array(n / 2 + 1);
+  for(let k = 0; k <= n / 2; k++)
+  {
+    result[k] = Math.sqrt(re[k] * re[k] + im[k] * im[k]) * 4 / n;
+  }
+  return result;
+}
+
+function milliseconds(start)
+{
+  const diff = process.hrtime(start);
+  return diff[0] * 1e3 + diff[1] / 1e6;
+}
+
+let start = process.hrtime();
+for(let i = 0; i < iterations; i++)
+{
+  jsMagnitude(data);
+}
+console.log('JavaScript: ' + (milliseconds(start) / iterations).toFixed(1) + ' ms per record');
+
+const spectrum = new libtiepie.Spectrum(length, libtiepie.Spectrum.WINDOW_HANN);
+let pending = iterations;
+start = process.hrtime();
+for(let i = 0; i < iterations; i++)
+{
+  spectrum.process(data, function(err)
+  {
+    if(err)
+      throw err;
+
+    if(--pending === 0)
+    {
+      spectrum.getMagnitude();
+      console.log('Native    : ' + (milliseconds(start) / iterations).toFixed(1) + ' ms per record (' + spectrum.getAverageCount() + ' averages)');
+    }
+  });
+}
@@ -5,7 +5,35 @@
       'target_name': 'node_libtiepie',
       'sources':
       [
-        'src/libtiepie.cc'
+        'src/libtiepie.cc',
+        'src/fft.cc',
+        'src/spectrum.cc',
+        'src/eventsearch.cc',
+        'src/mappedfile.cc',
+        'src/capturefile.cc',
+        'src/recorder.cc',
+        'src/numberformat.cc',
+        'src/csv.cc',
+        'src/devicelist.cc',
+        'src/scopeconfig.cc',
+        'src/capabilitycache.cc',
+        'src/object.cc',
+        'src/oscilloscope.cc',
+        'src/generator.cc',
+        'src/i2chost.cc',
+        'src/server.cc',
+        'src/instance.cc',
+        'src/streamring.cc',
+        'src/captureloop.cc',
+        'src/averager.cc',
+        'src/persistence.cc',
+        'src/masktest.cc',
+        'src/rawconverter.cc',
+        'src/rawcapture.cc',
+        'src/virtualrecord.cc',
+        'src/pyramid.cc',
+        'src/filter.cc',
+        'src/resampler.cc'
       ],
       'include_dirs':
       [
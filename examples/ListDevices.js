@@ -16,34 +16,34 @@ libtiepie.api.NetSetAutoDetectEnabled(true);
 // Update device list:
 libtiepie.api.LstUpdate();
 
-// Get the number of connected devices:
-var connectedDevices = libtiepie.api.LstGetCount();
+// Get a snapshot of the device list:
+var devices = libtiepie.api.LstGetSnapshot();
 
-if(connectedDevices != 0)
+if(devices.length != 0)
 {
   console.log();
   console.log('Available devices:');
 
-  for(let index = 0; index < connectedDevices; index++)
+  for(let index = 0; index < devices.length; index++)
   {
+    const device = devices[index];
     try
     {
-      console.log('  Name: ' + libtiepie.api.LstDevGetName(libtiepie.const.IDKIND_INDEX, index));
-      console.log('    Serial number  : ' + libtiepie.api.LstDevGetSerialNumber(libtiepie.const.IDKIND_INDEX, index));
+      console.log('  Name: ' + device.name);
+      console.log('    Serial number  : ' + device.serialNumber);
 
       var deviceTypes = [];
-      var value = libtiepie.api.LstDevGetTypes(libtiepie.const.IDKIND_INDEX, index);
-      if(value & libtiepie.const.DEVICETYPE_OSCILLOSCOPE)
+      if(device.types & libtiepie.const.DEVICETYPE_OSCILLOSCOPE)
         deviceTypes.push('Oscilloscope');
-      if(value & libtiepie.const.DEVICETYPE_GENERATOR)
+      if(device.types & libtiepie.const.DEVICETYPE_GENERATOR)
         deviceTypes.push('Generator');
-      if(value & libtiepie.const.DEVICETYPE_I2CHOST)
+      if(device.types & libtiepie.const.DEVICETYPE_I2CHOST)
         deviceTypes.push('I2C Host');
       console.log('    Available types: ' + deviceTypes.join(', '));
 
-      if(libtiepie.api.LstDevHasServer(libtiepie.const.IDKIND_INDEX, index))
+      if(device.hasServer)
       {
-        var server = libtiepie.api.LstDevGetServer(libtiepie.const.IDKIND_INDEX, index);
+        var server = libtiepie.api.LstDevGetServer(libtiepie.const.IDKIND_SERIALNUMBER, device.serialNumber);
         try
         {
           console.log('    Server         : ' + libtiepie.api.SrvGetURL(server) + ' (' + libtiepie.api.SrvGetName(server) + ')');
@@ -10,7 +10,6 @@
 
 const libtiepie = require('libtiepie');
 const sleep = require('sleep');
-const fs = require('fs');
 const EOL = require('os').EOL;
 
 // Enable network search:
@@ -113,46 +112,26 @@ if(scp != libtiepie.const.TPDEVICEHANDLE_INVALID)
     // Get the data from the scope:
     const channelData = libtiepie.api.ScpGetData(scp, channelCount, 0, recordLength);
 
-    let fd = undefined;
-    try
-    {
-      const filename = 'OscilloscopeBlock.csv';
-
-      // Open file with write permissions:
-      fd = fs.openSync(filename, 'w');
+    const filename = 'OscilloscopeBlock.csv';
 
-      // Write csv header:
-      fs.writeSync(fd, 'Sample');
-      for(let ch = 0; ch < channelCount; ch++)
-      {
-        fs.writeSync(fd, ';Ch' + ch.toString());
-      }
-      fs.writeSync(fd, EOL);
-
-      // Write the data to csv:
-      for(let i = 0; i < recordLength; i++)
-      {
-        fs.writeSync(fd, i.toString());
-        for(let ch = 0; ch < channelCount; ch++)
-        {
-          fs.writeSync(fd, ';' + channelData[ch][i].toString());
-        }
-        fs.writeSync(fd, EOL);
-      }
-
-      console.log('Data written to: ' + filename);
-    }
-    catch(err)
+    // Csv header:
+    const header = ['Sample'];
+    for(let ch = 0; ch < channelCount; ch++)
     {
-      console.error(err);
-      process.exitCode = 1;
+      header.push('Ch' + ch.toString());
     }
-    finally
+
+    // Write the data to csv, formatting is done on background threads:
+    libtiepie.Csv.write(filename, channelData, {separator: ';', eol: EOL, index: true, header: header}, function(err)
     {
-      // Close file:
-      if(fd !== undefined)
-        fs.closeSync(fd);
-    }
+      if(err)
+      {
+        console.error(err);
+        process.exitCode = 1;
+      }
+      else
+        console.log('Data written to: ' + filename);
+    });
   }
 
   // Close oscilloscope:
@@ -0,0 +1,96 @@
+/**
+ * OscilloscopeStreamRecorder.js - for LibTiePie 0.7+
+ *
+ * This example performs a stream mode measurement and records the data to OscilloscopeStreamRecorder.bin for 10 seconds.
+ *
+ * Find more information on http://www.tiepie.com/LibTiePie .
+ */
+
+"use strict";
+
+const libtiepie = require('libtiepie');
+
+// Enable network search:
+libtiepie.api.NetSetAutoDetectEnabled(true);
+
+// Update device list:
+libtiepie.api.LstUpdate();
+
+// Try to open an oscilloscope with stream measurement support:
+var scp = libtiepie.const.TPDEVICEHANDLE_INVALID;
+
+for(let index = 0; index < libtiepie.api.LstGetCount(); index++)
+{
+  if(libtiepie.api.LstDevCanOpen(libtiepie.const.IDKIND_INDEX, index, libtiepie.const.DEVICETYPE_OSCILLOSCOPE))
+  {
+    scp = libtiepie.api.LstOpenOscilloscope(libtiepie.const.IDKIND_INDEX, index);
+
+    // Check for valid handle and stream measurement support:
+    if(scp != libtiepie.const.TPDEVICEHANDLE_INVALID && (libtiepie.api.ScpGetMeasureModes(scp) & libtiepie.const.MM_STREAM))
+    {
+      break;
+    }
+    else
+    {
+      scp = libtiepie.const.TPDEVICEHANDLE_INVALID;
+    }
+  }
+}
+
+if(scp != libtiepie.const.TPDEVICEHANDLE_INVALID)
+{
+  // Get the number of channels:
+  const channelCount = libtiepie.api.ScpGetChannelCount(scp);
+
+  // Set measure mode:
+  libtiepie.api.ScpSetMeasureMode(scp, libtiepie.const.MM_STREAM);
+
+  // Set sample frequency:
+  libtiepie.api.ScpSetSampleFrequency(scp, 1e6); // 1 MHz
+
+  // Set record length, the size of each chunk:
+  libtiepie.api.ScpSetRecordLength(scp, 65536); // 64 kS
+
+  // For all channels:
+  for(let ch = 0; ch < channelCount; ch++)
+  {
+    // Enable channel to measure it:
+    libtiepie.api.ScpChSetEnabled(scp, ch, true);
+
+    // Set range:
+    libtiepie.api.ScpChSetRange(scp, ch, 8); // 8 V
+
+    // Set coupling:
+    libtiepie.api.ScpChSetCoupling(scp, ch, libtiepie.const.CK_DCV); // DC Volt
+  }
+
+  const filename = 'OscilloscopeStreamRecorder.bin';
+  const recorder = new libtiepie.Recorder(scp);
+
+  // Start recording, the data is written to disk on background threads:
+  recorder.start(filename, function(status)
+  {
+    console.log(status.sampleCount + ' samples, ' + status.bytesWritten + ' bytes written, ' + status.overflowCount + ' overflows');
+  },
+  function(err, status)
+  {
+    if(err)
+    {
+      console.error(err);
+      process.exitCode = 1;
+    }
+    else
+      console.log('Data written to: ' + filename);
+
+    // Close oscilloscope:
+    libtiepie.api.ObjClose(scp);
+  });
+
+  // Stop after 10 seconds:
+  setTimeout(function() { recorder.stop(); }, 10000);
+}
+else
+{
+  console.error('No oscilloscope available with stream measurement support!');
+  process.exitCode = 1;
+}
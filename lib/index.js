@@ -12,4 +12,50 @@ if(process.platform === 'win32')
   }
 }
 
+// Update the device list on a worker thread, resolves to a snapshot of the list:
+const lstUpdateAsync = libtiepie.api.LstUpdateAsync;
+libtiepie.api.LstUpdateAsync = function()
+{
+  return new Promise(function(resolve, reject)
+  {
+    lstUpdateAsync(function(err, list)
+    {
+      if(err)
+        reject(err);
+      else
+        resolve(list);
+    });
+  });
+};
+
+if(typeof SharedArrayBuffer === 'function')
+  libtiepie.StreamRingReader = require(__dirname + '/streamring.js');
+
+// ArrayBuffers backing the typed arrays in value (an array, possibly nested, or object of typed arrays), for use as
+// the transfer list of postMessage(). Transferring hands the sample data to the receiving thread without a copy, the
+// arrays of the sender are detached. SharedArrayBuffers are shared rather than transferred and are left out.
+libtiepie.transferList = function(value)
+{
+  const list = [];
+  const visit = function(item)
+  {
+    if(ArrayBuffer.isView(item))
+    {
+      if(item.buffer instanceof ArrayBuffer && list.indexOf(item.buffer) < 0)
+        list.push(item.buffer);
+    }
+    else if(item instanceof ArrayBuffer)
+    {
+      if(list.indexOf(item) < 0)
+        list.push(item);
+    }
+    else if(item !== null && typeof item === 'object')
+    {
+      Object.keys(item).forEach(function(key) { visit(item[key]); });
+    }
+  };
+  visit(value);
+  return list;
+};
+
 module.exports = libtiepie;
@@ -0,0 +1,139 @@
+'use strict';
+
+// Layout of a StreamRing buffer, see src/streamring.h:
+const HEAD = 0;
+const STATE = 1;
+const OVERFLOWS = 2;
+const CHUNKCOUNT = 3;
+const CHUNKSAMPLECOUNT = 4;
+const CHANNELCOUNT = 5;
+const CONSUMERCOUNT = 6;
+const DATAOFFSET = 7;
+const HEADERSIZE = 16;
+const CONSUMERSIZE = 4;
+const CONSUMER_ACTIVE = 0;
+const CONSUMER_TAIL = 1;
+const CONSUMER_LAG = 2;
+
+// Reads the chunks a StreamRing writes to buffer (a SharedArrayBuffer), in any thread. Every reader takes one of the
+// consumer slots of the ring until close() is called.
+//
+//     const reader = new StreamRingReader(buffer);
+//     for(;;)
+//     {
+//       const chunk = reader.next(1000); // Blocks, only allowed in worker threads. Use 0 in the main thread.
+//       if(chunk)
+//       {
+//         process(chunk.data);          // One Float32Array per channel, views on the ring.
+//         if(!reader.release())
+//           ...                         // The chunk was overwritten while it was processed.
+//       }
+//       else if(!reader.running)
+//         break;
+//     }
+//     reader.close();
+function StreamRingReader(buffer)
+{
+  if(!(buffer instanceof SharedArrayBuffer))
+    throw new TypeError('Invalid buffer');
+
+  this._header = new Int32Array(buffer, 0, HEADERSIZE);
+  this._buffer = buffer;
+  this.chunkCount = this._header[CHUNKCOUNT];
+  this.chunkSampleCount = this._header[CHUNKSAMPLECOUNT];
+  this.channels = Array.from(new Int32Array(buffer, (HEADERSIZE + CONSUMERSIZE * this._header[CONSUMERCOUNT]) * 4, this._header[CHANNELCOUNT]));
+  this._dataOffset = this._header[DATAOFFSET];
+  this._views = [];
+
+  const consumers = new Int32Array(buffer, HEADERSIZE * 4, CONSUMERSIZE * this._header[CONSUMERCOUNT]);
+  for(let i = 0; i < this._header[CONSUMERCOUNT]; i++)
+  {
+    const base = i * CONSUMERSIZE;
+    if(Atomics.compareExchange(consumers, base + CONSUMER_ACTIVE, 0, 1) === 0)
+    {
+      Atomics.store(consumers, base + CONSUMER_LAG, 0);
+      this._tail = Atomics.load(this._header, HEAD);
+      Atomics.store(consumers, base + CONSUMER_TAIL, this._tail);
+      this.index = i;
+      this._consumer = consumers.subarray(base, base + CONSUMERSIZE);
+      return;
+    }
+  }
+  throw new Error('No free consumer slot');
+}
+
+// Number of chunks written but not yet released by this reader.
+Object.defineProperty(StreamRingReader.prototype, 'available', {get: function()
+{
+  return (Atomics.load(this._header, HEAD) - this._tail) >>> 0;
+}});
+
+// Number of chunks this reader lost because it fell behind more than the ring length.
+Object.defineProperty(StreamRingReader.prototype, 'lag', {get: function()
+{
+  return Atomics.load(this._consumer, CONSUMER_LAG) >>> 0;
+}});
+
+Object.defineProperty(StreamRingReader.prototype, 'running', {get: function()
+{
+  return Atomics.load(this._header, STATE) !== 0;
+}});
+
+Object.defineProperty(StreamRingReader.prototype, 'overflowCount', {get: function()
+{
+  return Atomics.load(this._header, OVERFLOWS);
+}});
+
+// The oldest unreleased chunk as {sequence, data}, null if none is available within timeout ms. A reader that fell
+// behind more than the ring length skips to the oldest chunk still in the ring.
+StreamRingReader.prototype.next = function(timeout)
+{
+  let head = Atomics.load(this._header, HEAD);
+  if(head === this._tail && timeout > 0 && this.running)
+  {
+    Atomics.wait(this._header, HEAD, head, timeout);
+    head = Atomics.load(this._header, HEAD);
+  }
+  if(head === this._tail)
+    return null;
+
+  // The slot of chunk head may be written right now, so at most chunkCount - 1 chunks are readable:
+  if(((head - this._tail) >>> 0) >= this.chunkCount)
+  {
+    this._tail = (head - this.chunkCount + 1) | 0;
+    Atomics.store(this._consumer, CONSUMER_TAIL, this._tail);
+  }
+
+  return {sequence: this._tail >>> 0, data: this._chunk((this._tail >>> 0) % this.chunkCount)};
+};
+
+// Release the chunk returned by next(), returns false if it was overwritten before it was released.
+StreamRingReader.prototype.release = function()
+{
+  const valid = ((Atomics.load(this._header, HEAD) - this._tail) >>> 0) < this.chunkCount;
+  this._tail = (this._tail + 1) | 0;
+  Atomics.store(this._consumer, CONSUMER_TAIL, this._tail);
+  return valid;
+};
+
+StreamRingReader.prototype.close = function()
+{
+  if(this._consumer)
+    Atomics.store(this._consumer, CONSUMER_ACTIVE, 0);
+  this._consumer = null;
+};
+
+StreamRingReader.prototype._chunk = function(slot)
+{
+  if(!this._views[slot])
+  {
+    const data = [];
+    const offset = this._dataOffset + slot * this.channels.length * this.chunkSampleCount * 4;
+    for(let i = 0; i < this.channels.length; i++)
+      data.push(new Float32Array(this._buffer, offset + i * this.chunkSampleCount * 4, this.chunkSampleCount));
+    this._views[slot] = data;
+  }
+  return this._views[slot];
+};
+
+module.exports = StreamRingReader;
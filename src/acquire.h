@@ -0,0 +1,109 @@
+/**
+ * \file acquire.h
+ * \brief Repeated block mode measurements, for workers that process every record.
+ */
+
+#ifndef _ACQUIRE_H_
+#define _ACQUIRE_H_
+
+#include "common.h"
+#include <thread>
+#include <chrono>
+#include <cmath>
+
+#define ACQUIRE_DEFAULT_TIMEOUT  10.0 //!< Seconds to wait for a record when acquire() gets no timeout.
+
+/**
+ * Measure \p count block mode records of \p length samples. \p process is called as process(data) for every record,
+ * data holds a pointer per channel up to \p channelCount, null for disabled channels. The oscilloscope is re-armed
+ * before \p process is called, so processing overlaps the next measurement. Waiting for a record ends when the
+ * measurement is stopped, or after \p timeout seconds, the measurement is stopped then. An infinite timeout waits
+ * until the oscilloscope triggers.
+ * \return \c false on failure, \p error is set.
+ */
+template<class Process>
+bool acquireRecords(LibTiePieHandle_t device, uint16_t channelCount, size_t length, uint32_t count, double timeout, Process process, std::string& error)
+{
+  const uint16_t deviceChannelCount = ScpGetChannelCount(device);
+  const uint64_t recordLength = ScpGetRecordLength(device);
+  if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+  {
+    error = LibGetLastStatusStr();
+    return false;
+  }
+  if(recordLength < length)
+  {
+    error = "Record length is too short";
+    return false;
+  }
+
+  std::vector<std::vector<float> > buffers(std::min(deviceChannelCount, channelCount));
+  std::vector<float*> pointers(deviceChannelCount, (float*)0);
+  std::vector<const float*> data(channelCount, (const float*)0);
+  for(uint16_t ch = 0; ch < buffers.size(); ++ch)
+  {
+    if(ScpChGetEnabled(device, ch) != BOOL8_TRUE)
+      continue;
+    buffers[ch].resize(length);
+    data[ch] = pointers[ch] = &buffers[ch][0];
+  }
+
+  ScpStart(device);
+  for(uint32_t n = 0; n < count; ++n)
+  {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while(LibGetLastStatus() >= LIBTIEPIESTATUS_SUCCESS && ScpIsDataReady(device) != BOOL8_TRUE)
+    {
+      // Data may have become ready just before the measurement ended:
+      if(ScpIsRunning(device) != BOOL8_TRUE && ScpIsDataReady(device) != BOOL8_TRUE)
+      {
+        if(LibGetLastStatus() >= LIBTIEPIESTATUS_SUCCESS)
+        {
+          error = "Measurement stopped";
+          return false;
+        }
+        break;
+      }
+
+      if(std::isfinite(timeout) && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > timeout)
+      {
+        ScpStop(device);
+        error = "Timeout waiting for data";
+        return false;
+      }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+    {
+      error = LibGetLastStatusStr();
+      return false;
+    }
+
+    ScpGetData(device, &pointers[0], deviceChannelCount, 0, length);
+    if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+    {
+      error = LibGetLastStatusStr();
+      return false;
+    }
+
+    if(n + 1 < count)
+      ScpStart(device);
+
+    process(data);
+  }
+
+  return true;
+}
+
+/**
+ * Read the optional timeout of acquire(handle, count[, timeout], callback), in seconds, it must be positive.
+ * \return \c false if the timeout is invalid.
+ */
+inline bool getAcquireTimeout(const Nan::FunctionCallbackInfo<v8::Value>& info, double& timeout)
+{
+  timeout = info.Length() > 3 ? Nan::To<double>(info[2]).FromJust() : ACQUIRE_DEFAULT_TIMEOUT;
+  return timeout > 0; // Also false for NaN.
+}
+
+#endif
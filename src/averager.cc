@@ -0,0 +1,269 @@
+/**
+ * \file averager.cc
+ * \brief Coherent averaging of repeated records.
+ */
+
+#include "averager.h"
+#include "simd.h"
+#include "acquire.h"
+#include <cmath>
+
+class AveragerProcessWorker : public Nan::AsyncWorker
+{
+  public:
+    AveragerProcessWorker(Nan::Callback* callback, Averager* averager, v8::Local<v8::Object> self, v8::Local<v8::Array> data) :
+      Nan::AsyncWorker(callback),
+      m_averager(averager),
+      m_data(data->Length()),
+      m_count(0)
+    {
+      SaveToPersistent("self", self);
+      SaveToPersistent("data", data);
+      for(uint32_t i = 0; i < data->Length(); ++i)
+      {
+        v8::Local<v8::Value> item = Nan::Get(data, i).ToLocalChecked();
+        if(!item->IsNullOrUndefined())
+          m_data[i].assign(item);
+      }
+    }
+
+    void Execute()
+    {
+      std::vector<const float*> data(m_data.size());
+      for(size_t i = 0; i < m_data.size(); ++i)
+        data[i] = m_data[i].data();
+      m_count = m_averager->add(data);
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), Nan::New<v8::Uint32>(m_count)};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    Averager* m_averager;
+    std::vector<FloatArrayArgument> m_data;
+    uint32_t m_count;
+};
+
+class AveragerAcquireWorker : public Nan::AsyncWorker
+{
+  public:
+    AveragerAcquireWorker(Nan::Callback* callback, Averager* averager, v8::Local<v8::Object> self, LibTiePieHandle_t device, uint32_t count, double timeout) :
+      Nan::AsyncWorker(callback),
+      m_averager(averager),
+      m_device(device),
+      m_count(count),
+      m_timeout(timeout),
+      m_averageCount(0)
+    {
+      SaveToPersistent("self", self);
+    }
+
+    void Execute()
+    {
+      std::string error;
+      if(!acquireRecords(m_device, m_averager->channelCount(), m_averager->length(), m_count, m_timeout, [this](const std::vector<const float*>& data) { m_averageCount = m_averager->add(data); }, error))
+        SetErrorMessage(error.c_str());
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), Nan::New<v8::Uint32>(m_averageCount)};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    Averager* m_averager;
+    LibTiePieHandle_t m_device;
+    uint32_t m_count;
+    double m_timeout;
+    uint32_t m_averageCount;
+};
+
+NAN_MODULE_INIT(Averager::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("Averager").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "process", Process);
+  Nan::SetPrototypeMethod(tpl, "acquire", Acquire);
+  Nan::SetPrototypeMethod(tpl, "getMean", GetMean);
+  Nan::SetPrototypeMethod(tpl, "getAverageCount", GetAverageCount);
+  Nan::SetPrototypeMethod(tpl, "reset", Reset);
+
+  Nan::Set(target, Nan::New<v8::String>("Averager").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+Averager::Averager(uint16_t channelCount, size_t length, double weight) :
+  m_length(length),
+  m_weight(weight),
+  m_sums(channelCount, std::vector<double>(length, 0.0)),
+  m_counts(channelCount, 0),
+  m_count(0)
+{
+}
+
+uint32_t Averager::add(const std::vector<const float*>& data)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const size_t count = std::min(data.size(), m_sums.size());
+  for(size_t ch = 0; ch < count; ++ch)
+  {
+    if(!data[ch])
+      continue;
+
+    double* sum = &m_sums[ch][0];
+    if(m_weight == 0)
+      accumulate(sum, data[ch], m_length);
+    else if(m_counts[ch] == 0)
+      std::copy(data[ch], data[ch] + m_length, sum);
+    else
+      accumulateExponential(sum, data[ch], m_length, m_weight);
+    m_counts[ch]++;
+  }
+  return ++m_count;
+}
+
+/**
+ * new Averager(channelCount, length[, weight]), without weight or a weight of 0 all records count equally, otherwise
+ * each new record is added to an exponential average with the given weight.
+ */
+NAN_METHOD(Averager::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowTypeError("Averager must be called with new");
+  if(info.Length() < 2 || info.Length() > 3)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+
+  const uint32_t channelCount = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(channelCount, 1, std::numeric_limits<uint16_t>::max());
+  const uint32_t length = Nan::To<uint32_t>(info[1]).FromJust();
+  CHECK_RANGE(length, 1, std::numeric_limits<uint32_t>::max());
+  const double weight = (info.Length() > 2 && !info[2]->IsUndefined()) ? Nan::To<double>(info[2]).FromJust() : 0.0;
+  if(std::isnan(weight))
+    return Nan::ThrowRangeError("Value out of range");
+  CHECK_RANGE(weight, 0.0, 1.0);
+
+  Averager* averager = new Averager((uint16_t)channelCount, length, weight);
+  averager->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
+
+/**
+ * process(data, callback), data has an array per channel or null, arrays longer than the average are truncated.
+ */
+NAN_METHOD(Averager::Process)
+{
+  CHECK_PARAMETER_COUNT(2);
+  if(!info[0]->IsArray())
+    return Nan::ThrowTypeError("Invalid data, expected an array");
+  if(!info[1]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  Averager* averager = Nan::ObjectWrap::Unwrap<Averager>(info.Holder());
+  v8::Local<v8::Array> data = info[0].As<v8::Array>();
+  for(uint32_t i = 0; i < data->Length(); ++i)
+  {
+    v8::Local<v8::Value> item = Nan::Get(data, i).ToLocalChecked();
+    if(item->IsNullOrUndefined())
+      continue;
+    if(!item->IsArray() && !item->IsTypedArray())
+      return Nan::ThrowTypeError("Invalid data, expected an array");
+    const uint32_t length = Nan::To<uint32_t>(Nan::Get(item.As<v8::Object>(), Nan::New<v8::String>("length").ToLocalChecked()).ToLocalChecked()).FromJust();
+    if(length < averager->m_length)
+      return Nan::ThrowRangeError("Record is shorter than the average");
+  }
+
+  Nan::Callback* callback = new Nan::Callback(info[1].As<v8::Function>());
+  Nan::AsyncQueueWorker(new AveragerProcessWorker(callback, averager, info.Holder(), data));
+
+  info.GetReturnValue().SetUndefined();
+}
+
+/**
+ * acquire(handle, count[, timeout], callback), measures count records in block mode and adds them to the average.
+ */
+NAN_METHOD(Averager::Acquire)
+{
+  if(info.Length() < 3 || info.Length() > 4)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+  const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
+  const uint32_t count = Nan::To<uint32_t>(info[1]).FromJust();
+  double timeout;
+  if(!getAcquireTimeout(info, timeout))
+    return Nan::ThrowRangeError("Value out of range");
+  const v8::Local<v8::Value> function = info[info.Length() - 1];
+  if(!function->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  if(ScpGetMeasureMode(device) != MM_BLOCK)
+  {
+    CHECK_LAST_STATUS();
+    return Nan::ThrowError("Oscilloscope is not in block mode");
+  }
+
+  Averager* averager = Nan::ObjectWrap::Unwrap<Averager>(info.Holder());
+  Nan::Callback* callback = new Nan::Callback(function.As<v8::Function>());
+  Nan::AsyncQueueWorker(new AveragerAcquireWorker(callback, averager, info.Holder(), device, count, timeout));
+
+  info.GetReturnValue().SetUndefined();
+}
+
+/**
+ * getMean(), returns a Float64Array per channel, null for channels without records.
+ */
+NAN_METHOD(Averager::GetMean)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Averager* averager = Nan::ObjectWrap::Unwrap<Averager>(info.Holder());
+
+  std::lock_guard<std::mutex> lock(averager->m_mutex);
+  v8::Local<v8::Array> result = Nan::New<v8::Array>(averager->m_sums.size());
+  for(size_t ch = 0; ch < averager->m_sums.size(); ++ch)
+  {
+    const uint32_t count = averager->m_counts[ch];
+    if(count == 0)
+    {
+      Nan::Set(result, ch, Nan::Null());
+      continue;
+    }
+
+    double* data;
+    Nan::Set(result, ch, NewFloat64Array(averager->m_length, data));
+    const double* sum = &averager->m_sums[ch][0];
+    const double scale = averager->m_weight == 0 ? 1.0 / count : 1.0;
+    for(size_t i = 0; i < averager->m_length; ++i)
+      data[i] = sum[i] * scale;
+  }
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(Averager::GetAverageCount)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Averager* averager = Nan::ObjectWrap::Unwrap<Averager>(info.Holder());
+
+  std::lock_guard<std::mutex> lock(averager->m_mutex);
+  info.GetReturnValue().Set(averager->m_count);
+}
+
+NAN_METHOD(Averager::Reset)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Averager* averager = Nan::ObjectWrap::Unwrap<Averager>(info.Holder());
+
+  std::lock_guard<std::mutex> lock(averager->m_mutex);
+  for(size_t ch = 0; ch < averager->m_sums.size(); ++ch)
+    averager->m_sums[ch].assign(averager->m_length, 0.0);
+  averager->m_counts.assign(averager->m_counts.size(), 0);
+  averager->m_count = 0;
+
+  info.GetReturnValue().SetUndefined();
+}
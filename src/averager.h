@@ -0,0 +1,51 @@
+/**
+ * \file averager.h
+ * \brief Coherent averaging of repeated records.
+ */
+
+#ifndef _AVERAGER_H_
+#define _AVERAGER_H_
+
+#include "common.h"
+#include <mutex>
+
+class Averager : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+    /**
+     * Add a record to the average, \p data holds a pointer per channel, null skips a channel. Thread safe.
+     */
+    uint32_t add(const std::vector<const float*>& data);
+
+    uint16_t channelCount() const
+    {
+      return (uint16_t)m_sums.size();
+    }
+
+    size_t length() const
+    {
+      return m_length;
+    }
+
+  private:
+    Averager(uint16_t channelCount, size_t length, double weight);
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Process);
+    static NAN_METHOD(Acquire);
+    static NAN_METHOD(GetMean);
+    static NAN_METHOD(GetAverageCount);
+    static NAN_METHOD(Reset);
+
+    size_t m_length;
+    double m_weight; //!< 0 for a linear average, else the weight of a new record in the exponential average.
+
+    std::mutex m_mutex;
+    std::vector<std::vector<double> > m_sums; //!< Sums, or averages when exponential.
+    std::vector<uint32_t> m_counts;
+    uint32_t m_count;
+};
+
+#endif
@@ -0,0 +1,407 @@
+/**
+ * \file capabilitycache.cc
+ * \brief Per handle cache of device capabilities that only change when specific settings change.
+ */
+
+#include "capabilitycache.h"
+#include "instance.h"
+#include <map>
+#include <mutex>
+
+// Keys of the typed arrays kept per instance, channel lists add the channel number:
+#define ARRAY_RESOLUTIONS       0x00000
+#define ARRAY_AMPLITUDERANGES   0x00001
+#define ARRAY_CHRANGES          0x10000
+#define ARRAY_CHBANDWIDTHS      0x20000
+
+template<class T>
+struct Cached
+{
+  Cached() :
+    valid(false),
+    value()
+  {
+  }
+
+  bool valid;
+  T value;
+};
+
+struct ChannelCapabilities
+{
+  Cached<std::vector<double> > ranges;
+  Cached<std::vector<double> > bandwidths;
+  Cached<uint64_t> triggerKinds;
+};
+
+struct DeviceCapabilities
+{
+  uint64_t id; //!< Unique for every entry, ties the JavaScript values an instance keeps to it.
+  Cached<std::vector<uint8_t> > resolutions;
+  Cached<double> sampleFrequencyMax;
+  Cached<std::vector<double> > amplitudeRanges;
+  std::map<uint16_t, ChannelCapabilities> channels;
+};
+
+static std::mutex g_mutex;
+static std::map<LibTiePieHandle_t, DeviceCapabilities> g_cache;
+static uint64_t g_generation = 0; //!< Incremented on every invalidation, a read that raced with one is not stored.
+static uint64_t g_lastId = 0;
+static uint64_t g_hits = 0;
+static uint64_t g_misses = 0;
+static uint64_t g_invalidations = 0;
+
+// Call with g_mutex locked:
+static DeviceCapabilities& entry(LibTiePieHandle_t handle)
+{
+  std::map<LibTiePieHandle_t, DeviceCapabilities>::iterator it = g_cache.find(handle);
+  if(it == g_cache.end())
+  {
+    it = g_cache.insert(std::make_pair(handle, DeviceCapabilities())).first;
+    it->second.id = ++g_lastId;
+  }
+  return it->second;
+}
+
+/**
+ * JavaScript values of the calling instance for entry \p id of \p handle, null on threads without an instance.
+ */
+static HandleValues* values(LibTiePieHandle_t handle, uint64_t id)
+{
+  Instance* instance = Instance::current();
+  if(!instance)
+    return 0;
+
+  HandleValues& values = instance->handleValues[handle];
+  if(values.id != id)
+  {
+    values = HandleValues();
+    values.id = id;
+  }
+  return &values;
+}
+
+template<class T, class Select, class Read>
+static bool get(LibTiePieHandle_t handle, Select select, Read read, T& value)
+{
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    std::map<LibTiePieHandle_t, DeviceCapabilities>::iterator it = g_cache.find(handle);
+    if(it != g_cache.end())
+    {
+      const Cached<T>& cached = select(it->second);
+      if(cached.valid)
+      {
+        value = cached.value;
+        ++g_hits;
+        return true;
+      }
+    }
+    ++g_misses;
+    generation = g_generation;
+  }
+
+  // Read outside the lock, LibTiePie calls may take a while:
+  if(!read(value))
+    return false;
+
+  std::lock_guard<std::mutex> lock(g_mutex);
+  if(generation == g_generation)
+  {
+    Cached<T>& cached = select(entry(handle));
+    cached.value = value;
+    cached.valid = true;
+  }
+  return true;
+}
+
+template<class T, class Select, class Read>
+static bool getArray(LibTiePieHandle_t handle, uint32_t key, Select select, Read read, v8::Local<v8::TypedArray>& array)
+{
+  std::vector<T> value;
+  if(!get(handle, select, read, value))
+    return false;
+
+  std::lock_guard<std::mutex> lock(g_mutex);
+  std::map<LibTiePieHandle_t, DeviceCapabilities>::iterator it = g_cache.find(handle);
+  HandleValues* v = it != g_cache.end() ? values(handle, it->second.id) : 0;
+  if(v)
+    array = SharedTypedArray(v->arrays[key], value.data(), value.size());
+  else
+    array = NewTypedArrayCopy(value.data(), value.size());
+  return true;
+}
+
+NAN_MODULE_INIT(CapabilityCache::Init)
+{
+  v8::Local<v8::Object> cache = Nan::New<v8::Object>();
+  Nan::SetMethod(cache, "getStats", GetStats);
+  Nan::SetMethod(cache, "clear", Clear);
+
+  Nan::Set(target, Nan::New<v8::String>("CapabilityCache").ToLocalChecked(), cache);
+}
+
+void CapabilityCache::open(LibTiePieHandle_t handle)
+{
+  remove(handle);
+
+  const uint64_t interfaces = ObjGetInterfaces(handle);
+  if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+    return;
+
+  if(interfaces & LIBTIEPIE_INTERFACE_OSCILLOSCOPE)
+  {
+    std::vector<uint8_t> resolutions;
+    getScpResolutions(handle, resolutions);
+    double sampleFrequencyMax;
+    getScpSampleFrequencyMax(handle, sampleFrequencyMax);
+
+    const uint16_t channelCount = ScpGetChannelCount(handle);
+    for(uint16_t ch = 0; ch < channelCount; ++ch)
+    {
+      std::vector<double> list;
+      getScpChRanges(handle, ch, list);
+      getScpChBandwidths(handle, ch, list);
+      uint64_t kinds;
+      getScpChTrKinds(handle, ch, kinds);
+    }
+  }
+
+  if(interfaces & LIBTIEPIE_INTERFACE_GENERATOR)
+  {
+    std::vector<double> ranges;
+    getGenAmplitudeRanges(handle, ranges);
+  }
+
+  // Not all capabilities are supported by every device, don't leave such a status behind for the caller:
+  ObjGetInterfaces(handle);
+}
+
+void CapabilityCache::remove(LibTiePieHandle_t handle)
+{
+  std::lock_guard<std::mutex> lock(g_mutex);
+  ++g_generation;
+  if(g_cache.erase(handle) != 0)
+    ++g_invalidations;
+
+  Instance* instance = Instance::current();
+  if(instance)
+    instance->handleValues.erase(handle);
+}
+
+void CapabilityCache::invalidate(LibTiePieHandle_t handle)
+{
+  std::lock_guard<std::mutex> lock(g_mutex);
+  ++g_generation;
+  std::map<LibTiePieHandle_t, DeviceCapabilities>::iterator it = g_cache.find(handle);
+  if(it != g_cache.end())
+  {
+    // Keep the id, interned strings don't depend on settings:
+    const uint64_t id = it->second.id;
+    it->second = DeviceCapabilities();
+    it->second.id = id;
+    ++g_invalidations;
+  }
+}
+
+void CapabilityCache::clear()
+{
+  std::lock_guard<std::mutex> lock(g_mutex);
+  ++g_generation;
+  g_cache.clear();
+
+  Instance* instance = Instance::current();
+  if(instance)
+    instance->handleValues.clear();
+}
+
+void CapabilityCache::invalidateChannel(LibTiePieHandle_t handle, uint16_t ch)
+{
+  std::lock_guard<std::mutex> lock(g_mutex);
+  ++g_generation;
+  std::map<LibTiePieHandle_t, DeviceCapabilities>::iterator it = g_cache.find(handle);
+  if(it != g_cache.end() && it->second.channels.erase(ch) != 0)
+    ++g_invalidations;
+}
+
+static bool readScpChGetRanges(LibTiePieHandle_t handle, uint16_t ch, std::vector<double>& ranges)
+{
+  ranges.resize(ScpChGetRanges(handle, ch, 0, 0));
+  RETURN_FALSE_ON_ERROR();
+  ScpChGetRanges(handle, ch, ranges.data(), (uint32_t)ranges.size());
+  RETURN_FALSE_ON_ERROR();
+  return true;
+}
+
+bool CapabilityCache::getScpChRanges(LibTiePieHandle_t handle, uint16_t ch, std::vector<double>& ranges)
+{
+  return get(handle,
+    [ch](DeviceCapabilities& c) -> Cached<std::vector<double> >& { return c.channels[ch].ranges; },
+    [handle, ch](std::vector<double>& ranges) { return readScpChGetRanges(handle, ch, ranges); },
+    ranges);
+}
+
+bool CapabilityCache::getScpChRanges(LibTiePieHandle_t handle, uint16_t ch, v8::Local<v8::TypedArray>& ranges)
+{
+  return getArray<double>(handle, ARRAY_CHRANGES + ch,
+    [ch](DeviceCapabilities& c) -> Cached<std::vector<double> >& { return c.channels[ch].ranges; },
+    [handle, ch](std::vector<double>& ranges) { return readScpChGetRanges(handle, ch, ranges); },
+    ranges);
+}
+
+static bool readScpChGetBandwidths(LibTiePieHandle_t handle, uint16_t ch, std::vector<double>& bandwidths)
+{
+  bandwidths.resize(ScpChGetBandwidths(handle, ch, 0, 0));
+  RETURN_FALSE_ON_ERROR();
+  ScpChGetBandwidths(handle, ch, bandwidths.data(), (uint32_t)bandwidths.size());
+  RETURN_FALSE_ON_ERROR();
+  return true;
+}
+
+bool CapabilityCache::getScpChBandwidths(LibTiePieHandle_t handle, uint16_t ch, std::vector<double>& bandwidths)
+{
+  return get(handle,
+    [ch](DeviceCapabilities& c) -> Cached<std::vector<double> >& { return c.channels[ch].bandwidths; },
+    [handle, ch](std::vector<double>& bandwidths) { return readScpChGetBandwidths(handle, ch, bandwidths); },
+    bandwidths);
+}
+
+bool CapabilityCache::getScpChBandwidths(LibTiePieHandle_t handle, uint16_t ch, v8::Local<v8::TypedArray>& bandwidths)
+{
+  return getArray<double>(handle, ARRAY_CHBANDWIDTHS + ch,
+    [ch](DeviceCapabilities& c) -> Cached<std::vector<double> >& { return c.channels[ch].bandwidths; },
+    [handle, ch](std::vector<double>& bandwidths) { return readScpChGetBandwidths(handle, ch, bandwidths); },
+    bandwidths);
+}
+
+bool CapabilityCache::getScpChTrKinds(LibTiePieHandle_t handle, uint16_t ch, uint64_t& kinds)
+{
+  return get(handle,
+    [ch](DeviceCapabilities& c) -> Cached<uint64_t>& { return c.channels[ch].triggerKinds; },
+    [handle, ch](uint64_t& kinds) -> bool
+    {
+      kinds = ScpChTrGetKinds(handle, ch);
+      RETURN_FALSE_ON_ERROR();
+      return true;
+    },
+    kinds);
+}
+
+static bool readScpGetResolutions(LibTiePieHandle_t handle, std::vector<uint8_t>& resolutions)
+{
+  resolutions.resize(ScpGetResolutions(handle, 0, 0));
+  RETURN_FALSE_ON_ERROR();
+  ScpGetResolutions(handle, resolutions.data(), (uint32_t)resolutions.size());
+  RETURN_FALSE_ON_ERROR();
+  return true;
+}
+
+bool CapabilityCache::getScpResolutions(LibTiePieHandle_t handle, std::vector<uint8_t>& resolutions)
+{
+  return get(handle,
+    [](DeviceCapabilities& c) -> Cached<std::vector<uint8_t> >& { return c.resolutions; },
+    [handle](std::vector<uint8_t>& resolutions) { return readScpGetResolutions(handle, resolutions); },
+    resolutions);
+}
+
+bool CapabilityCache::getScpResolutions(LibTiePieHandle_t handle, v8::Local<v8::TypedArray>& resolutions)
+{
+  return getArray<uint8_t>(handle, ARRAY_RESOLUTIONS,
+    [](DeviceCapabilities& c) -> Cached<std::vector<uint8_t> >& { return c.resolutions; },
+    [handle](std::vector<uint8_t>& resolutions) { return readScpGetResolutions(handle, resolutions); },
+    resolutions);
+}
+
+bool CapabilityCache::getScpSampleFrequencyMax(LibTiePieHandle_t handle, double& sampleFrequencyMax)
+{
+  return get(handle,
+    [](DeviceCapabilities& c) -> Cached<double>& { return c.sampleFrequencyMax; },
+    [handle](double& sampleFrequencyMax) -> bool
+    {
+      sampleFrequencyMax = ScpGetSampleFrequencyMax(handle);
+      RETURN_FALSE_ON_ERROR();
+      return true;
+    },
+    sampleFrequencyMax);
+}
+
+static bool readGenGetAmplitudeRanges(LibTiePieHandle_t handle, std::vector<double>& ranges)
+{
+  ranges.resize(GenGetAmplitudeRanges(handle, 0, 0));
+  RETURN_FALSE_ON_ERROR();
+  GenGetAmplitudeRanges(handle, ranges.data(), (uint32_t)ranges.size());
+  RETURN_FALSE_ON_ERROR();
+  return true;
+}
+
+bool CapabilityCache::getGenAmplitudeRanges(LibTiePieHandle_t handle, std::vector<double>& ranges)
+{
+  return get(handle,
+    [](DeviceCapabilities& c) -> Cached<std::vector<double> >& { return c.amplitudeRanges; },
+    [handle](std::vector<double>& ranges) { return readGenGetAmplitudeRanges(handle, ranges); },
+    ranges);
+}
+
+bool CapabilityCache::getGenAmplitudeRanges(LibTiePieHandle_t handle, v8::Local<v8::TypedArray>& ranges)
+{
+  return getArray<double>(handle, ARRAY_AMPLITUDERANGES,
+    [](DeviceCapabilities& c) -> Cached<std::vector<double> >& { return c.amplitudeRanges; },
+    [handle](std::vector<double>& ranges) { return readGenGetAmplitudeRanges(handle, ranges); },
+    ranges);
+}
+
+bool CapabilityCache::findString(LibTiePieHandle_t handle, uint32_t key, v8::Local<v8::String>& s)
+{
+  std::lock_guard<std::mutex> lock(g_mutex);
+  std::map<LibTiePieHandle_t, DeviceCapabilities>::iterator it = g_cache.find(handle);
+  HandleValues* v = it != g_cache.end() ? values(handle, it->second.id) : 0;
+  if(v)
+  {
+    std::map<uint32_t, Nan::Global<v8::String> >::iterator string = v->strings.find(key);
+    if(string != v->strings.end())
+    {
+      s = Nan::New(string->second);
+      ++g_hits;
+      return true;
+    }
+  }
+  ++g_misses;
+  return false;
+}
+
+void CapabilityCache::storeString(LibTiePieHandle_t handle, uint32_t key, v8::Local<v8::String> s)
+{
+  std::lock_guard<std::mutex> lock(g_mutex);
+  HandleValues* v = values(handle, entry(handle).id);
+  if(v)
+    v->strings[key].Reset(s);
+}
+
+NAN_METHOD(CapabilityCache::GetStats)
+{
+  CHECK_PARAMETER_COUNT(0);
+
+  std::lock_guard<std::mutex> lock(g_mutex);
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  Nan::Set(result, Nan::New<v8::String>("handles").ToLocalChecked(), Nan::New<v8::Number>((double)g_cache.size()));
+  Nan::Set(result, Nan::New<v8::String>("hits").ToLocalChecked(), Nan::New<v8::Number>((double)g_hits));
+  Nan::Set(result, Nan::New<v8::String>("misses").ToLocalChecked(), Nan::New<v8::Number>((double)g_misses));
+  Nan::Set(result, Nan::New<v8::String>("invalidations").ToLocalChecked(), Nan::New<v8::Number>((double)g_invalidations));
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(CapabilityCache::Clear)
+{
+  CHECK_PARAMETER_COUNT(0);
+
+  clear();
+
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_hits = 0;
+  g_misses = 0;
+  g_invalidations = 0;
+
+  info.GetReturnValue().SetUndefined();
+}
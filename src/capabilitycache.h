@@ -0,0 +1,93 @@
+/**
+ * \file capabilitycache.h
+ * \brief Per handle cache of device capabilities that only change when specific settings change.
+ *
+ * Entries are filled when a device is opened and on a miss, they are dropped when the handle is closed or the device
+ * is removed. Settings a capability depends on invalidate it:
+ *
+ * - measure mode, resolution, auto resolution mode, clock source and enabled channels: all oscilloscope capabilities.
+ * - coupling, probe gain and probe offset: the capabilities of that channel.
+ *
+ * Strings that never change for a handle, like names, are interned and kept until the handle is closed.
+ *
+ * The capabilities are shared by all addon instances, the typed arrays and strings handed out are kept per instance.
+ */
+
+#ifndef _CAPABILITYCACHE_H_
+#define _CAPABILITYCACHE_H_
+
+#include "common.h"
+
+// Interned string keys, trigger input/output names add the index:
+#define CAPABILITYCACHE_STRING_NAME          0x00000
+#define CAPABILITYCACHE_STRING_NAMESHORT     0x00001
+#define CAPABILITYCACHE_STRING_NAMESHORTEST  0x00002
+#define CAPABILITYCACHE_STRING_URL           0x00003
+#define CAPABILITYCACHE_STRING_ID            0x00004
+#define CAPABILITYCACHE_STRING_TRINNAME      0x10000
+#define CAPABILITYCACHE_STRING_TROUTNAME     0x20000
+
+class CapabilityCache
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+    /**
+     * Drop a stale entry for a reused handle and read the capabilities of a just opened device.
+     */
+    static void open(LibTiePieHandle_t handle);
+
+    /**
+     * Drop the entry of a closed or removed handle.
+     */
+    static void remove(LibTiePieHandle_t handle);
+
+    /**
+     * Drop the capabilities that depend on a setting, call it after the setting changed: capabilities read by another
+     * thread before the change are dropped then too.
+     */
+    static void invalidate(LibTiePieHandle_t handle);
+    static void invalidateChannel(LibTiePieHandle_t handle, uint16_t ch);
+
+    /**
+     * Drop all entries.
+     */
+    static void clear();
+
+    // Getters return false when LibTiePie reported an error, the last status is left as set by LibTiePie then:
+    static bool getScpChRanges(LibTiePieHandle_t handle, uint16_t ch, std::vector<double>& ranges);
+    static bool getScpChBandwidths(LibTiePieHandle_t handle, uint16_t ch, std::vector<double>& bandwidths);
+    static bool getScpChTrKinds(LibTiePieHandle_t handle, uint16_t ch, uint64_t& kinds);
+    static bool getScpResolutions(LibTiePieHandle_t handle, std::vector<uint8_t>& resolutions);
+    static bool getScpSampleFrequencyMax(LibTiePieHandle_t handle, double& sampleFrequencyMax);
+    static bool getGenAmplitudeRanges(LibTiePieHandle_t handle, std::vector<double>& ranges);
+
+    // The lists as typed array, the same instance is returned while the list is unchanged:
+    static bool getScpChRanges(LibTiePieHandle_t handle, uint16_t ch, v8::Local<v8::TypedArray>& ranges);
+    static bool getScpChBandwidths(LibTiePieHandle_t handle, uint16_t ch, v8::Local<v8::TypedArray>& bandwidths);
+    static bool getScpResolutions(LibTiePieHandle_t handle, v8::Local<v8::TypedArray>& resolutions);
+    static bool getGenAmplitudeRanges(LibTiePieHandle_t handle, v8::Local<v8::TypedArray>& ranges);
+
+    /**
+     * Interned string \p key of \p handle, read by \p get as for GetString() on a miss.
+     */
+    template<class Get>
+    static bool getString(LibTiePieHandle_t handle, uint32_t key, Get get, v8::Local<v8::String>& s)
+    {
+      if(findString(handle, key, s))
+        return true;
+      if(!GetString(get, s))
+        return false;
+      storeString(handle, key, s);
+      return true;
+    }
+
+  private:
+    static bool findString(LibTiePieHandle_t handle, uint32_t key, v8::Local<v8::String>& s);
+    static void storeString(LibTiePieHandle_t handle, uint32_t key, v8::Local<v8::String> s);
+
+    static NAN_METHOD(GetStats);
+    static NAN_METHOD(Clear);
+};
+
+#endif
@@ -0,0 +1,502 @@
+/**
+ * \file capturefile.cc
+ * \brief Binary capture file container.
+ */
+
+#include "capturefile.h"
+#include "mappedfile.h"
+#include <cstring>
+#include <algorithm>
+
+static const char magic[8] = {'T', 'P', 'C', 'A', 'P', 'T', 0, 0};
+
+// The container is little endian, as are all platforms LibTiePie runs on:
+template<class T>
+static void put(uint8_t* data, size_t offset, T value)
+{
+  memcpy(data + offset, &value, sizeof(T));
+}
+
+template<class T>
+static T get(const uint8_t* data, size_t offset)
+{
+  T value;
+  memcpy(&value, data + offset, sizeof(T));
+  return value;
+}
+
+bool readScopeCaptureHeader(LibTiePieHandle_t device, bool raw, CaptureHeader& header)
+{
+  const uint16_t channelCount = ScpGetChannelCount(device);
+  RETURN_FALSE_ON_ERROR();
+  header.sampleFrequency = ScpGetSampleFrequency(device);
+  RETURN_FALSE_ON_ERROR();
+  header.sampleCount = ScpGetRecordLength(device);
+  RETURN_FALSE_ON_ERROR();
+  header.measureMode = ScpGetMeasureMode(device);
+  RETURN_FALSE_ON_ERROR();
+  header.resolution = ScpGetResolution(device);
+  RETURN_FALSE_ON_ERROR();
+  header.chunkSampleCount = 0;
+
+  if(header.measureMode == MM_BLOCK)
+  {
+    header.triggerIndex = (uint64_t)(ScpGetPreSampleRatio(device) * (double)header.sampleCount + 0.5);
+    RETURN_FALSE_ON_ERROR();
+    header.validPreSampleCount = ScpGetValidPreSampleCount(device);
+    RETURN_FALSE_ON_ERROR();
+  }
+  else
+  {
+    header.triggerIndex = 0;
+    header.validPreSampleCount = 0;
+  }
+
+  header.channels.clear();
+  for(uint16_t ch = 0; ch < channelCount; ++ch)
+  {
+    const bool8_t enabled = ScpChGetEnabled(device, ch);
+    RETURN_FALSE_ON_ERROR();
+    if(enabled == BOOL8_FALSE)
+      continue;
+
+    CaptureChannel channel;
+    channel.number = ch;
+    channel.dataType = raw ? ScpChGetDataRawType(device, ch) : DATARAWTYPE_FLOAT32;
+    RETURN_FALSE_ON_ERROR();
+    channel.range = ScpChGetRange(device, ch);
+    RETURN_FALSE_ON_ERROR();
+    ScpChGetDataValueRange(device, ch, &channel.dataValueMin, &channel.dataValueMax);
+    RETURN_FALSE_ON_ERROR();
+    ScpChGetDataRawValueRange(device, ch, &channel.rawValueMin, &channel.rawValueZero, &channel.rawValueMax);
+    RETURN_FALSE_ON_ERROR();
+    channel.dataOffset = 0;
+    header.channels.push_back(channel);
+  }
+
+  return true;
+}
+
+uint64_t layoutCaptureFile(CaptureHeader& header)
+{
+  uint64_t size = captureHeaderBlockSize(header);
+
+  if(header.chunkSampleCount != 0)
+  {
+    uint64_t offset = size;
+    for(std::vector<CaptureChannel>::iterator it = header.channels.begin(); it != header.channels.end(); ++it)
+    {
+      it->dataOffset = offset;
+      offset += alignCaptureOffset(header.chunkSampleCount * GetDataRawTypeSize(it->dataType));
+    }
+    return size + captureChunkCount(header) * captureChunkStride(header);
+  }
+
+  for(std::vector<CaptureChannel>::iterator it = header.channels.begin(); it != header.channels.end(); ++it)
+  {
+    it->dataOffset = alignCaptureOffset(size);
+    size = it->dataOffset + header.sampleCount * GetDataRawTypeSize(it->dataType);
+  }
+  return size;
+}
+
+void writeCaptureHeader(uint8_t* data, const CaptureHeader& header)
+{
+  memset(data, 0, (size_t)captureHeaderBlockSize(header));
+
+  memcpy(data, magic, sizeof(magic));
+  put<uint32_t>(data, 8, CAPTUREFILE_VERSION);
+  put<uint32_t>(data, 12, (uint32_t)header.channels.size());
+  put<double>(data, 16, header.sampleFrequency);
+  put<uint64_t>(data, 24, header.sampleCount);
+  put<uint64_t>(data, 32, header.triggerIndex);
+  put<uint64_t>(data, 40, header.validPreSampleCount);
+  put<uint32_t>(data, 48, header.measureMode);
+  put<uint32_t>(data, 52, header.resolution);
+  put<uint64_t>(data, 56, header.chunkSampleCount);
+
+  uint8_t* p = data + CAPTUREFILE_HEADER_SIZE;
+  for(std::vector<CaptureChannel>::const_iterator it = header.channels.begin(); it != header.channels.end(); ++it, p += CAPTUREFILE_CHANNEL_HEADER_SIZE)
+  {
+    put<uint16_t>(p, 0, it->number);
+    put<uint32_t>(p, 4, it->dataType);
+    put<double>(p, 8, it->range);
+    put<double>(p, 16, it->dataValueMin);
+    put<double>(p, 24, it->dataValueMax);
+    put<int64_t>(p, 32, it->rawValueMin);
+    put<int64_t>(p, 40, it->rawValueZero);
+    put<int64_t>(p, 48, it->rawValueMax);
+    put<uint64_t>(p, 56, it->dataOffset);
+  }
+}
+
+bool parseCaptureHeader(const uint8_t* data, uint64_t size, CaptureHeader& header, std::string& error)
+{
+  if(size < CAPTUREFILE_HEADER_SIZE || memcmp(data, magic, sizeof(magic)) != 0)
+  {
+    error = "Not a capture file";
+    return false;
+  }
+
+  if(get<uint32_t>(data, 8) != CAPTUREFILE_VERSION)
+  {
+    error = "Unsupported capture file version";
+    return false;
+  }
+
+  const uint32_t channelCount = get<uint32_t>(data, 12);
+  header.sampleFrequency = get<double>(data, 16);
+  header.sampleCount = get<uint64_t>(data, 24);
+  header.triggerIndex = get<uint64_t>(data, 32);
+  header.validPreSampleCount = get<uint64_t>(data, 40);
+  header.measureMode = get<uint32_t>(data, 48);
+  header.resolution = get<uint32_t>(data, 52);
+  header.chunkSampleCount = get<uint64_t>(data, 56);
+
+  if(size < CAPTUREFILE_HEADER_SIZE + CAPTUREFILE_CHANNEL_HEADER_SIZE * (uint64_t)channelCount)
+  {
+    error = "Truncated capture file";
+    return false;
+  }
+
+  header.channels.resize(channelCount);
+  const uint8_t* p = data + CAPTUREFILE_HEADER_SIZE;
+  for(uint32_t i = 0; i < channelCount; ++i, p += CAPTUREFILE_CHANNEL_HEADER_SIZE)
+  {
+    CaptureChannel& channel = header.channels[i];
+    channel.number = get<uint16_t>(p, 0);
+    channel.dataType = get<uint32_t>(p, 4);
+    channel.range = get<double>(p, 8);
+    channel.dataValueMin = get<double>(p, 16);
+    channel.dataValueMax = get<double>(p, 24);
+    channel.rawValueMin = get<int64_t>(p, 32);
+    channel.rawValueZero = get<int64_t>(p, 40);
+    channel.rawValueMax = get<int64_t>(p, 48);
+    channel.dataOffset = get<uint64_t>(p, 56);
+
+    const uint64_t sampleSize = GetDataRawTypeSize(channel.dataType);
+    if(sampleSize == 0 || channel.dataOffset % sampleSize != 0)
+    {
+      error = "Invalid channel data type";
+      return false;
+    }
+  }
+
+  // Check that the last sample of each channel is inside the file:
+  const uint64_t chunkCount = captureChunkCount(header);
+  if(chunkCount == 0)
+    return true;
+  const uint64_t chunkSamples = header.chunkSampleCount != 0 ? header.chunkSampleCount : header.sampleCount;
+  const uint64_t stride = captureChunkStride(header);
+  const uint64_t lastChunkSamples = header.sampleCount - (chunkCount - 1) * chunkSamples;
+  for(std::vector<CaptureChannel>::const_iterator it = header.channels.begin(); it != header.channels.end(); ++it)
+  {
+    const uint64_t sampleSize = GetDataRawTypeSize(it->dataType);
+    if(it->dataOffset > size ||
+       (chunkCount > 1 && (chunkCount - 1) > (size - it->dataOffset) / stride) ||
+       lastChunkSamples > (size - it->dataOffset - (chunkCount - 1) * stride) / sampleSize)
+    {
+      error = "Truncated capture file";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool saveScopeCapture(LibTiePieHandle_t device, const std::string& filename, bool raw, uint64_t& sampleCount, std::string& error)
+{
+  CaptureHeader header;
+  const uint16_t channelCount = ScpGetChannelCount(device);
+  if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS || !readScopeCaptureHeader(device, raw, header))
+  {
+    error = LibGetLastStatusStr();
+    return false;
+  }
+
+  MappedFile file;
+  if(!file.create(filename, layoutCaptureFile(header)))
+  {
+    error = file.error();
+    return false;
+  }
+
+  std::vector<void*> buffers(channelCount, (void*)0);
+  for(std::vector<CaptureChannel>::const_iterator it = header.channels.begin(); it != header.channels.end(); ++it)
+    buffers[it->number] = file.data() + it->dataOffset;
+
+  if(channelCount > 0)
+  {
+    if(raw)
+      sampleCount = ScpGetDataRaw(device, &buffers[0], channelCount, 0, header.sampleCount);
+    else
+      sampleCount = ScpGetData(device, (float**)&buffers[0], channelCount, 0, header.sampleCount);
+  }
+  else
+    sampleCount = 0;
+
+  if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+  {
+    error = LibGetLastStatusStr();
+    file.close(0);
+    return false;
+  }
+
+  // Keep the layout, a short read leaves unused space between the channels:
+  header.sampleCount = sampleCount;
+  writeCaptureHeader(file.data(), header);
+
+  if(!file.close())
+  {
+    error = "Failed to close file";
+    return false;
+  }
+
+  return true;
+}
+
+class CaptureSaveWorker : public Nan::AsyncWorker
+{
+  public:
+    CaptureSaveWorker(Nan::Callback* callback, LibTiePieHandle_t device, const std::string& filename, bool raw) :
+      Nan::AsyncWorker(callback),
+      m_device(device),
+      m_filename(filename),
+      m_raw(raw),
+      m_sampleCount(0)
+    {
+    }
+
+    void Execute()
+    {
+      std::string error;
+      if(!saveScopeCapture(m_device, m_filename, m_raw, m_sampleCount, error))
+        SetErrorMessage(error.c_str());
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), Nan::New<v8::Number>((double)m_sampleCount)};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    LibTiePieHandle_t m_device;
+    std::string m_filename;
+    bool m_raw;
+    uint64_t m_sampleCount;
+};
+
+class CaptureWriteWorker : public Nan::AsyncWorker
+{
+  public:
+    CaptureWriteWorker(Nan::Callback* callback, const std::string& filename, const CaptureHeader& header, const std::vector<const void*>& data, v8::Local<v8::Object> capture) :
+      Nan::AsyncWorker(callback),
+      m_filename(filename),
+      m_header(header),
+      m_data(data)
+    {
+      SaveToPersistent("capture", capture);
+    }
+
+    void Execute()
+    {
+      MappedFile file;
+      if(!file.create(m_filename, layoutCaptureFile(m_header)))
+        return SetErrorMessage(file.error().c_str());
+
+      writeCaptureHeader(file.data(), m_header);
+      for(size_t i = 0; i < m_header.channels.size(); ++i)
+      {
+        const CaptureChannel& channel = m_header.channels[i];
+        memcpy(file.data() + channel.dataOffset, m_data[i], (size_t)(m_header.sampleCount * GetDataRawTypeSize(channel.dataType)));
+      }
+
+      if(!file.close())
+        SetErrorMessage("Failed to close file");
+    }
+
+  private:
+    std::string m_filename;
+    CaptureHeader m_header;
+    std::vector<const void*> m_data;
+};
+
+static double getNumber(v8::Local<v8::Object> object, const char* name, double defaultValue)
+{
+  v8::Local<v8::Value> value = Nan::Get(object, Nan::New<v8::String>(name).ToLocalChecked()).ToLocalChecked();
+  return value->IsUndefined() ? defaultValue : Nan::To<double>(value).FromJust();
+}
+
+static void setNumber(v8::Local<v8::Object> object, const char* name, double value)
+{
+  Nan::Set(object, Nan::New<v8::String>(name).ToLocalChecked(), Nan::New<v8::Number>(value));
+}
+
+static void unmapBuffer(char* data, void* hint)
+{
+  MappedFile::unmap(data, (uint64_t)(uintptr_t)hint);
+}
+
+NAN_MODULE_INIT(CaptureFile::Init)
+{
+  v8::Local<v8::Object> captureFile = Nan::New<v8::Object>();
+  Nan::SetMethod(captureFile, "save", Save);
+  Nan::SetMethod(captureFile, "write", Write);
+  Nan::SetMethod(captureFile, "read", Read);
+  Nan::DefineOwnProperty(captureFile, Nan::New<v8::String>("VERSION").ToLocalChecked(), Nan::New<v8::Uint32>(CAPTUREFILE_VERSION), v8::ReadOnly);
+
+  Nan::Set(target, Nan::New<v8::String>("CaptureFile").ToLocalChecked(), captureFile);
+}
+
+NAN_METHOD(CaptureFile::Save)
+{
+  CHECK_PARAMETER_COUNT(4);
+  const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
+  const std::string filename(*Nan::Utf8String(info[1]));
+  const bool raw = Nan::To<bool>(info[2]).FromJust();
+  if(!info[3]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  Nan::Callback* callback = new Nan::Callback(info[3].As<v8::Function>());
+  Nan::AsyncQueueWorker(new CaptureSaveWorker(callback, device, filename, raw));
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(CaptureFile::Write)
+{
+  CHECK_PARAMETER_COUNT(3);
+  const std::string filename(*Nan::Utf8String(info[0]));
+  if(!info[1]->IsObject())
+    return Nan::ThrowTypeError("Invalid capture");
+  if(!info[2]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  v8::Local<v8::Object> capture = info[1].As<v8::Object>();
+  v8::Local<v8::Value> channels = Nan::Get(capture, Nan::New<v8::String>("channels").ToLocalChecked()).ToLocalChecked();
+  if(!channels->IsArray())
+    return Nan::ThrowTypeError("Invalid capture channels");
+
+  CaptureHeader header;
+  header.sampleFrequency = getNumber(capture, "sampleFrequency", 0);
+  header.triggerIndex = (uint64_t)getNumber(capture, "triggerIndex", 0);
+  header.validPreSampleCount = (uint64_t)getNumber(capture, "validPreSampleCount", 0);
+  header.measureMode = (uint32_t)getNumber(capture, "measureMode", MM_BLOCK);
+  header.resolution = (uint32_t)getNumber(capture, "resolution", 0);
+  header.chunkSampleCount = 0;
+  header.sampleCount = 0;
+
+  std::vector<const void*> data;
+  v8::Local<v8::Array> array = channels.As<v8::Array>();
+  for(uint32_t i = 0; i < array->Length(); ++i)
+  {
+    v8::Local<v8::Value> item = Nan::Get(array, i).ToLocalChecked();
+    if(!item->IsObject())
+      return Nan::ThrowTypeError("Invalid capture channel");
+    v8::Local<v8::Object> object = item.As<v8::Object>();
+    v8::Local<v8::Value> samples = Nan::Get(object, Nan::New<v8::String>("data").ToLocalChecked()).ToLocalChecked();
+
+    CaptureChannel channel;
+    channel.dataType = GetDataRawType(samples);
+    if(channel.dataType == DATARAWTYPE_UNKNOWN)
+      return Nan::ThrowTypeError("Invalid channel data, expected a typed array");
+
+    channel.number = (uint16_t)getNumber(object, "number", i);
+    channel.range = getNumber(object, "range", 0);
+    channel.dataValueMin = getNumber(object, "dataValueMin", 0);
+    channel.dataValueMax = getNumber(object, "dataValueMax", 0);
+    channel.rawValueMin = (int64_t)getNumber(object, "rawValueMin", 0);
+    channel.rawValueZero = (int64_t)getNumber(object, "rawValueZero", 0);
+    channel.rawValueMax = (int64_t)getNumber(object, "rawValueMax", 0);
+    channel.dataOffset = 0;
+
+    v8::Local<v8::TypedArray> typedArray = samples.As<v8::TypedArray>();
+    if(i == 0)
+      header.sampleCount = typedArray->Length();
+    else if(typedArray->Length() != header.sampleCount)
+      return Nan::ThrowRangeError("Channel data lengths differ");
+
+    Nan::TypedArrayContents<uint8_t> contents(typedArray);
+    data.push_back(*contents);
+    header.channels.push_back(channel);
+  }
+
+  Nan::Callback* callback = new Nan::Callback(info[2].As<v8::Function>());
+  Nan::AsyncQueueWorker(new CaptureWriteWorker(callback, filename, header, data, capture));
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(CaptureFile::Read)
+{
+  CHECK_PARAMETER_COUNT(1);
+  const std::string filename(*Nan::Utf8String(info[0]));
+
+  MappedFile file;
+  if(!file.open(filename))
+    return Nan::ThrowError(file.error().c_str());
+
+  CaptureHeader header;
+  std::string error;
+  if(!parseCaptureHeader(file.data(), file.size(), header, error))
+    return Nan::ThrowError(error.c_str());
+
+  // Nan::NewBuffer() takes a 32 bit length, larger files would get a buffer that ends before the data:
+  const uint64_t maxSize = std::min<uint64_t>(node::Buffer::kMaxLength, std::numeric_limits<uint32_t>::max());
+  if(file.size() > maxSize)
+  {
+    std::stringstream ss;
+    ss << "Capture file too large to read at once, " << file.size() << " bytes, the limit is " << maxSize << " bytes";
+    return Nan::ThrowRangeError(ss.str().c_str());
+  }
+
+  // The mapping is owned by the buffer and unmapped when it is garbage collected:
+  const uint64_t size = file.size();
+  v8::Local<v8::Object> buffer = Nan::NewBuffer((char*)file.release(), (uint32_t)size, unmapBuffer, (void*)(uintptr_t)size).ToLocalChecked();
+  v8::Local<v8::ArrayBuffer> arrayBuffer = buffer.As<v8::Uint8Array>()->Buffer();
+
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  setNumber(result, "sampleFrequency", header.sampleFrequency);
+  setNumber(result, "sampleCount", (double)header.sampleCount);
+  setNumber(result, "triggerIndex", (double)header.triggerIndex);
+  setNumber(result, "validPreSampleCount", (double)header.validPreSampleCount);
+  setNumber(result, "measureMode", header.measureMode);
+  setNumber(result, "resolution", header.resolution);
+  setNumber(result, "chunkSampleCount", (double)header.chunkSampleCount);
+
+  v8::Local<v8::Array> channels = Nan::New<v8::Array>((int)header.channels.size());
+  for(size_t i = 0; i < header.channels.size(); ++i)
+  {
+    const CaptureChannel& channel = header.channels[i];
+    v8::Local<v8::Object> item = Nan::New<v8::Object>();
+    setNumber(item, "number", channel.number);
+    setNumber(item, "dataType", channel.dataType);
+    setNumber(item, "range", channel.range);
+    setNumber(item, "dataValueMin", channel.dataValueMin);
+    setNumber(item, "dataValueMax", channel.dataValueMax);
+    setNumber(item, "rawValueMin", (double)channel.rawValueMin);
+    setNumber(item, "rawValueZero", (double)channel.rawValueZero);
+    setNumber(item, "rawValueMax", (double)channel.rawValueMax);
+    if(header.chunkSampleCount == 0)
+      Nan::Set(item, Nan::New<v8::String>("data").ToLocalChecked(), NewTypedArray(channel.dataType, arrayBuffer, (size_t)channel.dataOffset, (size_t)header.sampleCount));
+    else
+    {
+      // Chunked recordings get a view per chunk:
+      const uint64_t chunkCount = captureChunkCount(header);
+      const uint64_t stride = captureChunkStride(header);
+      v8::Local<v8::Array> chunks = Nan::New<v8::Array>((int)chunkCount);
+      for(uint64_t j = 0; j < chunkCount; ++j)
+      {
+        const uint64_t length = std::min(header.chunkSampleCount, header.sampleCount - j * header.chunkSampleCount);
+        Nan::Set(chunks, (uint32_t)j, NewTypedArray(channel.dataType, arrayBuffer, (size_t)(channel.dataOffset + j * stride), (size_t)length));
+      }
+      Nan::Set(item, Nan::New<v8::String>("data").ToLocalChecked(), chunks);
+    }
+    Nan::Set(channels, (uint32_t)i, item);
+  }
+  Nan::Set(result, Nan::New<v8::String>("channels").ToLocalChecked(), channels);
+
+  info.GetReturnValue().Set(result);
+}
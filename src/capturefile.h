@@ -0,0 +1,142 @@
+/**
+ * \file capturefile.h
+ * \brief Binary capture file container.
+ *
+ * All values are little endian. A file starts with a 64 byte file header:
+ *
+ * | Offset | Type     | Description                                                |
+ * |--------|----------|------------------------------------------------------------|
+ * |      0 | char[8]  | Magic, <tt>"TPCAPT\0\0"</tt>                               |
+ * |      8 | uint32   | Format version, #CAPTUREFILE_VERSION                       |
+ * |     12 | uint32   | Channel count                                              |
+ * |     16 | float64  | Sample frequency in Hz                                     |
+ * |     24 | uint64   | Sample count per channel                                   |
+ * |     32 | uint64   | Trigger index, sample index of the trigger point           |
+ * |     40 | uint64   | Valid pre sample count                                     |
+ * |     48 | uint32   | Measure mode, \ref MM_ "MM_*"                              |
+ * |     52 | uint32   | Resolution in bits                                         |
+ * |     56 | uint64   | Chunk sample count, zero if the samples are not chunked    |
+ *
+ * Followed by a 64 byte channel header for each channel:
+ *
+ * | Offset | Type     | Description                                                |
+ * |--------|----------|------------------------------------------------------------|
+ * |      0 | uint16   | Channel number                                             |
+ * |      2 | uint16   | Reserved, zero                                             |
+ * |      4 | uint32   | Sample data type, \ref DATARAWTYPE_ "DATARAWTYPE_*"        |
+ * |      8 | float64  | Range                                                      |
+ * |     16 | float64  | Data value minimum, see ScpChGetDataValueMin               |
+ * |     24 | float64  | Data value maximum, see ScpChGetDataValueMax               |
+ * |     32 | int64    | Raw value minimum, see ScpChGetDataRawValueMin             |
+ * |     40 | int64    | Raw value zero, see ScpChGetDataRawValueZero               |
+ * |     48 | int64    | Raw value maximum, see ScpChGetDataRawValueMax             |
+ * |     56 | uint64   | File offset of the channel samples                         |
+ *
+ * The samples of each channel are stored contiguously, starting at a multiple of #CAPTUREFILE_ALIGNMENT bytes.
+ * Streamed recordings are chunked instead: the data consists of chunks of chunk sample count samples for all channels,
+ * each channel padded to a multiple of #CAPTUREFILE_ALIGNMENT bytes, and the channel offset points into the first chunk.
+ * Raw samples convert to values as:
+ * <tt>value = dataValueMin + (raw - rawValueMin) * (dataValueMax - dataValueMin) / (rawValueMax - rawValueMin)</tt>.
+ */
+
+#ifndef _CAPTUREFILE_H_
+#define _CAPTUREFILE_H_
+
+#include "common.h"
+
+#define CAPTUREFILE_VERSION               1
+#define CAPTUREFILE_HEADER_SIZE           64
+#define CAPTUREFILE_CHANNEL_HEADER_SIZE   64
+#define CAPTUREFILE_ALIGNMENT             4096
+
+struct CaptureChannel
+{
+  uint16_t number;
+  uint32_t dataType;
+  double range;
+  double dataValueMin;
+  double dataValueMax;
+  int64_t rawValueMin;
+  int64_t rawValueZero;
+  int64_t rawValueMax;
+  uint64_t dataOffset;
+};
+
+struct CaptureHeader
+{
+  double sampleFrequency;
+  uint64_t sampleCount;
+  uint64_t triggerIndex;
+  uint64_t validPreSampleCount;
+  uint32_t measureMode;
+  uint32_t resolution;
+  uint64_t chunkSampleCount;
+  std::vector<CaptureChannel> channels;
+};
+
+inline uint64_t alignCaptureOffset(uint64_t offset)
+{
+  return (offset + CAPTUREFILE_ALIGNMENT - 1) & ~(uint64_t)(CAPTUREFILE_ALIGNMENT - 1);
+}
+
+/**
+ * Size of the file and channel headers, padded to the data alignment.
+ */
+inline uint64_t captureHeaderBlockSize(const CaptureHeader& header)
+{
+  return alignCaptureOffset(CAPTUREFILE_HEADER_SIZE + CAPTUREFILE_CHANNEL_HEADER_SIZE * header.channels.size());
+}
+
+/**
+ * Distance in bytes between the chunks of a chunked file.
+ */
+inline uint64_t captureChunkStride(const CaptureHeader& header)
+{
+  uint64_t stride = 0;
+  for(std::vector<CaptureChannel>::const_iterator it = header.channels.begin(); it != header.channels.end(); ++it)
+    stride += alignCaptureOffset(header.chunkSampleCount * GetDataRawTypeSize(it->dataType));
+  return stride;
+}
+
+inline uint64_t captureChunkCount(const CaptureHeader& header)
+{
+  if(header.chunkSampleCount == 0)
+    return header.sampleCount > 0 ? 1 : 0;
+  return (header.sampleCount + header.chunkSampleCount - 1) / header.chunkSampleCount;
+}
+
+/**
+ * Fill \p header with the settings of the enabled channels of an oscilloscope.
+ * \return \c false if a LibTiePie call failed, see LibGetLastStatus().
+ */
+bool readScopeCaptureHeader(LibTiePieHandle_t device, bool raw, CaptureHeader& header);
+
+/**
+ * Assign the channel data offsets.
+ * \return The file size.
+ */
+uint64_t layoutCaptureFile(CaptureHeader& header);
+
+/**
+ * Write the header block, captureHeaderBlockSize() bytes, the alignment padding is zeroed.
+ */
+void writeCaptureHeader(uint8_t* data, const CaptureHeader& header);
+bool parseCaptureHeader(const uint8_t* data, uint64_t size, CaptureHeader& header, std::string& error);
+
+/**
+ * Save the current measurement of an oscilloscope, reading the data directly into a mapped file.
+ */
+bool saveScopeCapture(LibTiePieHandle_t device, const std::string& filename, bool raw, uint64_t& sampleCount, std::string& error);
+
+class CaptureFile
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    static NAN_METHOD(Save);
+    static NAN_METHOD(Write);
+    static NAN_METHOD(Read);
+};
+
+#endif
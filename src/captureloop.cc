@@ -0,0 +1,368 @@
+/**
+ * \file captureloop.cc
+ * \brief Back to back block mode captures on a background thread.
+ */
+
+#include "captureloop.h"
+
+NAN_MODULE_INIT(CaptureLoop::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("CaptureLoop").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "start", Start);
+  Nan::SetPrototypeMethod(tpl, "stop", Stop);
+  Nan::SetPrototypeMethod(tpl, "read", Read);
+  Nan::SetPrototypeMethod(tpl, "getStatus", GetStatus);
+
+  Nan::Set(target, Nan::New<v8::String>("CaptureLoop").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+CaptureLoop::CaptureLoop(LibTiePieHandle_t device, uint32_t queueLength) :
+  m_device(device),
+  m_queueLength(queueLength),
+  m_channelCount(0),
+  m_recordLength(0),
+  m_dataReady(false),
+  m_captureCount(0),
+  m_droppedCount(0),
+  m_deadTimeMin(0),
+  m_deadTimeMax(0),
+  m_deadTimeSum(0),
+  m_running(false),
+  m_stop(false),
+  m_finished(false),
+  m_async(0),
+  m_record(0),
+  m_done(0),
+  m_resource(0)
+{
+}
+
+/**
+ * new CaptureLoop(handle[, queueLength])
+ */
+NAN_METHOD(CaptureLoop::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowError("Use the new operator");
+  if(info.Length() < 1 || info.Length() > 2)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+
+  const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
+  const uint32_t queueLength = (info.Length() > 1 && !info[1]->IsUndefined()) ? Nan::To<uint32_t>(info[1]).FromJust() : CAPTURELOOP_DEFAULT_QUEUELENGTH;
+  CHECK_RANGE(queueLength, 1, 65536);
+
+  CaptureLoop* loop = new CaptureLoop(device, queueLength);
+  loop->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+/**
+ * start(onRecord, callback), onRecord() is called when records are queued and may be null, callback(err, status)
+ * is called when the loop stopped.
+ */
+NAN_METHOD(CaptureLoop::Start)
+{
+  CHECK_PARAMETER_COUNT(2);
+  CaptureLoop* loop = Nan::ObjectWrap::Unwrap<CaptureLoop>(info.Holder());
+  if(!info[0]->IsFunction() && !info[0]->IsNullOrUndefined())
+    return Nan::ThrowTypeError("Invalid record callback");
+  if(!info[1]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+  if(loop->m_running)
+    return Nan::ThrowError("CaptureLoop is running");
+
+  const LibTiePieHandle_t device = loop->m_device;
+  if(ScpGetMeasureMode(device) != MM_BLOCK)
+  {
+    CHECK_LAST_STATUS();
+    return Nan::ThrowError("Oscilloscope is not in block mode");
+  }
+  loop->m_channelCount = ScpGetChannelCount(device);
+  CHECK_LAST_STATUS();
+  loop->m_recordLength = ScpGetRecordLength(device);
+  CHECK_LAST_STATUS();
+  loop->m_channels.clear();
+  for(uint16_t ch = 0; ch < loop->m_channelCount; ++ch)
+  {
+    if(ScpChGetEnabled(device, ch) == BOOL8_TRUE)
+      loop->m_channels.push_back(ch);
+    CHECK_LAST_STATUS();
+  }
+  if(loop->m_channels.empty())
+    return Nan::ThrowError("No channels enabled");
+
+  // All buffers are allocated up front, the capture thread never allocates:
+  loop->m_queue.clear();
+  loop->m_free.clear();
+  loop->m_buffers.resize(loop->m_queueLength);
+  for(size_t i = 0; i < loop->m_buffers.size(); ++i)
+  {
+    loop->m_buffers[i].resize((size_t)(loop->m_channels.size() * loop->m_recordLength));
+    loop->m_free.push_back(i);
+  }
+
+  loop->m_error.clear();
+  loop->m_dataReady = false;
+  loop->m_stop = false;
+  loop->m_finished = false;
+  loop->m_captureCount = 0;
+  loop->m_droppedCount = 0;
+  loop->m_deadTimeMin = 0;
+  loop->m_deadTimeMax = 0;
+  loop->m_deadTimeSum = 0;
+  loop->m_startTime = std::chrono::steady_clock::now();
+
+  loop->m_record = info[0]->IsFunction() ? new Nan::Callback(info[0].As<v8::Function>()) : 0;
+  loop->m_done = new Nan::Callback(info[1].As<v8::Function>());
+  loop->m_resource = new Nan::AsyncResource("libtiepie:CaptureLoop");
+  loop->m_async = new uv_async_t;
+  uv_async_init(Nan::GetCurrentEventLoop(), loop->m_async, onAsync);
+  loop->m_async->data = loop;
+
+  // Keep the object alive while capturing:
+  loop->Ref();
+  loop->m_running = true;
+  loop->m_thread = std::thread(&CaptureLoop::run, loop);
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(CaptureLoop::Stop)
+{
+  CHECK_PARAMETER_COUNT(0);
+  CaptureLoop* loop = Nan::ObjectWrap::Unwrap<CaptureLoop>(info.Holder());
+  {
+    std::lock_guard<std::mutex> lock(loop->m_mutex);
+    loop->m_stop = true;
+  }
+  loop->m_condition.notify_all();
+  info.GetReturnValue().SetUndefined();
+}
+
+/**
+ * read(), returns the oldest queued record as {sequence, timestamp, data} or null if the queue is empty. data has a
+ * Float32Array per channel, null for disabled channels.
+ */
+NAN_METHOD(CaptureLoop::Read)
+{
+  CHECK_PARAMETER_COUNT(0);
+  CaptureLoop* loop = Nan::ObjectWrap::Unwrap<CaptureLoop>(info.Holder());
+
+  CaptureRecord record;
+  {
+    std::lock_guard<std::mutex> lock(loop->m_mutex);
+    if(loop->m_queue.empty())
+      return info.GetReturnValue().SetNull();
+    record = loop->m_queue.front();
+    loop->m_queue.pop_front();
+  }
+
+  const float* buffer = loop->m_buffers[record.buffer].data();
+  v8::Local<v8::Array> data = Nan::New<v8::Array>(loop->m_channelCount);
+  for(uint16_t ch = 0; ch < loop->m_channelCount; ++ch)
+    Nan::Set(data, ch, Nan::Null());
+  for(size_t i = 0; i < loop->m_channels.size(); ++i)
+  {
+    float* samples;
+    Nan::Set(data, loop->m_channels[i], NewFloat32Array((size_t)record.sampleCount, samples));
+    memcpy(samples, buffer + i * loop->m_recordLength, (size_t)record.sampleCount * sizeof(float));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(loop->m_mutex);
+    loop->m_free.push_back(record.buffer);
+  }
+
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  Nan::Set(result, Nan::New<v8::String>("sequence").ToLocalChecked(), Nan::New<v8::Number>((double)record.sequence));
+  Nan::Set(result, Nan::New<v8::String>("timestamp").ToLocalChecked(), Nan::New<v8::Number>(record.timestamp));
+  Nan::Set(result, Nan::New<v8::String>("data").ToLocalChecked(), data);
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(CaptureLoop::GetStatus)
+{
+  CHECK_PARAMETER_COUNT(0);
+  CaptureLoop* loop = Nan::ObjectWrap::Unwrap<CaptureLoop>(info.Holder());
+  info.GetReturnValue().Set(loop->status());
+}
+
+double CaptureLoop::seconds() const
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+}
+
+v8::Local<v8::Object> CaptureLoop::status()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const double elapsed = m_running ? seconds() : 0;
+
+  v8::Local<v8::Object> deadTime = Nan::New<v8::Object>();
+  Nan::Set(deadTime, Nan::New<v8::String>("min").ToLocalChecked(), Nan::New<v8::Number>(m_deadTimeMin));
+  Nan::Set(deadTime, Nan::New<v8::String>("mean").ToLocalChecked(), Nan::New<v8::Number>(m_captureCount > 0 ? m_deadTimeSum / m_captureCount : 0));
+  Nan::Set(deadTime, Nan::New<v8::String>("max").ToLocalChecked(), Nan::New<v8::Number>(m_deadTimeMax));
+
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  Nan::Set(result, Nan::New<v8::String>("running").ToLocalChecked(), Nan::New<v8::Boolean>(m_running.load()));
+  Nan::Set(result, Nan::New<v8::String>("captureCount").ToLocalChecked(), Nan::New<v8::Number>((double)m_captureCount));
+  Nan::Set(result, Nan::New<v8::String>("droppedCount").ToLocalChecked(), Nan::New<v8::Number>((double)m_droppedCount));
+  Nan::Set(result, Nan::New<v8::String>("queued").ToLocalChecked(), Nan::New<v8::Number>((double)m_queue.size()));
+  Nan::Set(result, Nan::New<v8::String>("capturesPerSecond").ToLocalChecked(), Nan::New<v8::Number>(elapsed > 0 ? m_captureCount / elapsed : 0));
+  Nan::Set(result, Nan::New<v8::String>("deadTime").ToLocalChecked(), deadTime);
+  return result;
+}
+
+void CaptureLoop::onDataReady(void* data)
+{
+  CaptureLoop* loop = (CaptureLoop*)data;
+  {
+    std::lock_guard<std::mutex> lock(loop->m_mutex);
+    loop->m_dataReady = true;
+  }
+  loop->m_condition.notify_all();
+}
+
+void CaptureLoop::run()
+{
+  ScpSetCallbackDataReady(m_device, onDataReady, this);
+  ScpStart(m_device);
+  if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+    fail(LibGetLastStatusStr());
+
+  std::vector<float*> pointers(m_channelCount, (float*)0);
+  uint64_t sequence = 0;
+  while(!m_stop)
+  {
+    if(ScpIsDataReady(m_device) == BOOL8_TRUE)
+    {
+      const std::chrono::steady_clock::time_point ready = std::chrono::steady_clock::now();
+
+      bool haveBuffer;
+      size_t buffer = 0;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        haveBuffer = !m_free.empty();
+        if(haveBuffer)
+        {
+          buffer = m_free.back();
+          m_free.pop_back();
+        }
+      }
+
+      // With a full queue the record isn't read, the next start discards it:
+      uint64_t sampleCount = 0;
+      if(haveBuffer)
+      {
+        for(size_t i = 0; i < m_channels.size(); ++i)
+          pointers[m_channels[i]] = m_buffers[buffer].data() + i * m_recordLength;
+        sampleCount = ScpGetData(m_device, &pointers[0], m_channelCount, 0, m_recordLength);
+        if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+        {
+          fail(LibGetLastStatusStr());
+          break;
+        }
+      }
+
+      ScpStart(m_device);
+      if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+        fail(LibGetLastStatusStr());
+      const double deadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - ready).count();
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_captureCount == 0 || deadTime < m_deadTimeMin)
+          m_deadTimeMin = deadTime;
+        if(deadTime > m_deadTimeMax)
+          m_deadTimeMax = deadTime;
+        m_deadTimeSum += deadTime;
+        ++m_captureCount;
+
+        if(haveBuffer)
+        {
+          CaptureRecord record;
+          record.buffer = buffer;
+          record.sequence = sequence;
+          record.timestamp = std::chrono::duration<double>(ready - m_startTime).count();
+          record.sampleCount = sampleCount;
+          m_queue.push_back(record);
+        }
+        else
+          ++m_droppedCount;
+      }
+      ++sequence;
+      uv_async_send(m_async);
+    }
+    else if(ScpIsRunning(m_device) == BOOL8_FALSE)
+    {
+      ScpStart(m_device);
+      if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+        fail(LibGetLastStatusStr());
+    }
+    else
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if(!m_dataReady && !m_stop)
+        m_condition.wait_for(lock, std::chrono::milliseconds(100));
+      m_dataReady = false;
+    }
+  }
+
+  ScpStop(m_device);
+  ScpSetCallbackDataReady(m_device, 0, 0);
+
+  m_finished = true;
+  uv_async_send(m_async);
+}
+
+void CaptureLoop::fail(const std::string& error)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_error.empty())
+      m_error = error;
+    m_stop = true;
+  }
+  m_condition.notify_all();
+}
+
+void CaptureLoop::onAsync(uv_async_t* handle)
+{
+  Nan::HandleScope scope;
+  CaptureLoop* loop = (CaptureLoop*)handle->data;
+
+  if(loop->m_record)
+    loop->m_record->Call(0, 0, loop->m_resource);
+  if(!loop->m_finished)
+    return;
+
+  loop->m_thread.join();
+  uv_close((uv_handle_t*)handle, onClose);
+  loop->m_async = 0;
+
+  v8::Local<v8::Object> status = loop->status();
+  loop->m_running = false;
+  Nan::Set(status, Nan::New<v8::String>("running").ToLocalChecked(), Nan::False());
+
+  Nan::Callback* record = loop->m_record;
+  Nan::Callback* done = loop->m_done;
+  Nan::AsyncResource* resource = loop->m_resource;
+  loop->m_record = 0;
+  loop->m_done = 0;
+  loop->m_resource = 0;
+
+  v8::Local<v8::Value> argv[] = {loop->m_error.empty() ? v8::Local<v8::Value>(Nan::Null()) : Nan::Error(loop->m_error.c_str()), status};
+  done->Call(2, argv, resource);
+
+  delete record;
+  delete done;
+  delete resource;
+  loop->Unref();
+}
+
+void CaptureLoop::onClose(uv_handle_t* handle)
+{
+  delete (uv_async_t*)handle;
+}
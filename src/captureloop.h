@@ -0,0 +1,87 @@
+/**
+ * \file captureloop.h
+ * \brief Back to back block mode captures on a background thread.
+ *
+ * The loop re-arms the oscilloscope as soon as a record is read, so the dead time between captures doesn't depend on
+ * the event loop. Records go into a bounded queue that JavaScript drains with read(), when the queue is full new
+ * records are dropped and counted.
+ */
+
+#ifndef _CAPTURELOOP_H_
+#define _CAPTURELOOP_H_
+
+#include "common.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <deque>
+
+#define CAPTURELOOP_DEFAULT_QUEUELENGTH  16
+
+struct CaptureRecord
+{
+  size_t buffer; //!< Index in the buffer pool.
+  uint64_t sequence;
+  double timestamp; //!< Seconds since start.
+  uint64_t sampleCount;
+};
+
+class CaptureLoop : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    CaptureLoop(LibTiePieHandle_t device, uint32_t queueLength);
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Start);
+    static NAN_METHOD(Stop);
+    static NAN_METHOD(Read);
+    static NAN_METHOD(GetStatus);
+
+    static void onDataReady(void* data);
+    static void onAsync(uv_async_t* handle);
+    static void onClose(uv_handle_t* handle);
+
+    void run();
+    void fail(const std::string& error);
+    double seconds() const;
+    v8::Local<v8::Object> status();
+
+    LibTiePieHandle_t m_device;
+    uint32_t m_queueLength;
+    uint16_t m_channelCount;
+    std::vector<uint16_t> m_channels;
+    uint64_t m_recordLength;
+    std::vector<std::vector<float> > m_buffers; //!< Per buffer all enabled channels, one after the other.
+    std::vector<size_t> m_free;
+    std::deque<CaptureRecord> m_queue;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_dataReady;
+    std::string m_error;
+
+    // Statistics, protected by m_mutex:
+    uint64_t m_captureCount;
+    uint64_t m_droppedCount;
+    double m_deadTimeMin;
+    double m_deadTimeMax;
+    double m_deadTimeSum;
+
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_stop;
+    std::atomic<bool> m_finished;
+
+    uv_async_t* m_async;
+    Nan::Callback* m_record;
+    Nan::Callback* m_done;
+    Nan::AsyncResource* m_resource;
+};
+
+#endif
@@ -0,0 +1,317 @@
+/**
+ * \file common.h
+ * \brief Includes and helpers shared by all binding sources.
+ */
+
+#ifndef _COMMON_H_
+#define _COMMON_H_
+
+#include <nan.h>
+#include <string>
+#include <sstream>
+#include <limits>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _MSC_VER
+  #include "libtiepieloader.h"
+
+  #ifdef min
+    #undef min
+  #endif
+  #ifdef max
+    #undef max
+  #endif
+#else
+  #include <libtiepie.h>
+#endif
+
+#define CHECK_PARAMETER_COUNT(expected) { const int length = info.Length(); if(length != expected) { std::stringstream ss; ss << "Invalid parameter count, expected " << expected << " got " << length << "."; return Nan::ThrowSyntaxError(ss.str().c_str()); } }
+#define CHECK_RANGE(value, min, max) { if((value < min) || (value > max)) return Nan::ThrowRangeError("Value out of range"); }
+#define CHECK_LAST_STATUS() { LibTiePieStatus_t status = LibGetLastStatus(); if(status < LIBTIEPIESTATUS_SUCCESS) return Nan::ThrowError(LibGetLastStatusStr()); }
+#define RETURN_FALSE_ON_ERROR() { if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS) return false; }
+
+inline std::string tpVersionToStr(TpVersion_t version)
+{
+  std::stringstream ss;
+  ss << TPVERSION_MAJOR(version) << "." << TPVERSION_MINOR(version) << "." << TPVERSION_RELEASE(version) << "." << TPVERSION_BUILD(version);
+  return ss.str();
+}
+
+#define STRING_BUFFER_SIZE 256 //!< Strings shorter than this are read with a single call.
+
+/**
+ * Read a LibTiePie string, \p get is called as get(buffer, bufferLength) and returns the string length. Strings that
+ * fit the stack buffer take a single call, longer ones are read again into a buffer of the right size.
+ * \return \c false on failure, the last status is left as set by LibTiePie.
+ */
+template<class Get>
+inline bool GetString(Get get, std::string& s)
+{
+  char buffer[STRING_BUFFER_SIZE];
+  const uint32_t length = get(buffer, sizeof(buffer));
+  RETURN_FALSE_ON_ERROR();
+  if(length < sizeof(buffer))
+  {
+    s.assign(buffer, length);
+    return true;
+  }
+
+  std::vector<char> large(length + 1);
+  get(&large[0], length + 1);
+  RETURN_FALSE_ON_ERROR();
+  s.assign(&large[0], length);
+  return true;
+}
+
+template<class Get>
+inline bool GetString(Get get, v8::Local<v8::String>& s)
+{
+  char buffer[STRING_BUFFER_SIZE];
+  const uint32_t length = get(buffer, sizeof(buffer));
+  RETURN_FALSE_ON_ERROR();
+  if(length < sizeof(buffer))
+  {
+    s = Nan::New(buffer, length).ToLocalChecked();
+    return true;
+  }
+
+  std::vector<char> large(length + 1);
+  get(&large[0], length + 1);
+  RETURN_FALSE_ON_ERROR();
+  s = Nan::New(&large[0], length).ToLocalChecked();
+  return true;
+}
+
+/**
+ * Sample data passed in from JavaScript.
+ *
+ * A Float32Array is referenced in place, any other array-like value is copied.
+ * The referenced JavaScript value must be kept alive while data() is in use.
+ */
+class FloatArrayArgument
+{
+  public:
+    FloatArrayArgument() :
+      m_data(0),
+      m_length(0)
+    {
+    }
+
+    bool assign(v8::Local<v8::Value> value)
+    {
+      if(value->IsFloat32Array())
+      {
+        Nan::TypedArrayContents<float> contents(value);
+        m_data = *contents;
+        m_length = contents.length();
+        return true;
+      }
+      else if(value->IsArray() || value->IsTypedArray())
+      {
+        v8::Local<v8::Object> object = value.As<v8::Object>();
+        const uint32_t length = Nan::To<uint32_t>(Nan::Get(object, Nan::New<v8::String>("length").ToLocalChecked()).ToLocalChecked()).FromJust();
+        m_copy.resize(length);
+        for(uint32_t i = 0; i < length; ++i)
+          m_copy[i] = (float)Nan::To<double>(Nan::Get(object, i).ToLocalChecked()).FromJust();
+        m_data = m_copy.empty() ? 0 : &m_copy[0];
+        m_length = length;
+        return true;
+      }
+
+      return false;
+    }
+
+    const float* data() const
+    {
+      return m_data;
+    }
+
+    size_t length() const
+    {
+      return m_length;
+    }
+
+  private:
+    std::vector<float> m_copy;
+    const float* m_data;
+    size_t m_length;
+};
+
+/**
+ * Per channel Float32Array buffers passed in from JavaScript, null or undefined skips a channel.
+ *
+ * The arrays are written in place, so they may be backed by a SharedArrayBuffer that other threads read.
+ * \p length receives the length of the shortest array.
+ */
+inline bool FloatArrayList(v8::Local<v8::Value> value, std::vector<float*>& pointers, uint64_t& length)
+{
+  if(!value->IsArray())
+    return false;
+
+  v8::Local<v8::Array> array = value.As<v8::Array>();
+  pointers.assign(array->Length(), (float*)0);
+  length = std::numeric_limits<uint64_t>::max();
+  for(uint32_t i = 0; i < pointers.size(); ++i)
+  {
+    v8::Local<v8::Value> item = Nan::Get(array, i).ToLocalChecked();
+    if(item->IsNullOrUndefined())
+      continue;
+    if(!item->IsFloat32Array())
+      return false;
+
+    Nan::TypedArrayContents<float> contents(item);
+    pointers[i] = *contents;
+    length = std::min<uint64_t>(length, contents.length());
+  }
+
+  if(length == std::numeric_limits<uint64_t>::max())
+    length = 0;
+  return true;
+}
+
+/**
+ * Create a Float32Array of \p length elements, \p data receives a pointer to its storage.
+ */
+inline v8::Local<v8::Float32Array> NewFloat32Array(size_t length, float*& data)
+{
+  v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), length * sizeof(float));
+  v8::Local<v8::Float32Array> result = v8::Float32Array::New(buffer, 0, length);
+  Nan::TypedArrayContents<float> contents(result);
+  data = *contents;
+  return result;
+}
+
+/**
+ * Create a Float64Array of \p length elements, \p data receives a pointer to its storage.
+ */
+inline v8::Local<v8::Float64Array> NewFloat64Array(size_t length, double*& data)
+{
+  v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), length * sizeof(double));
+  v8::Local<v8::Float64Array> result = v8::Float64Array::New(buffer, 0, length);
+  Nan::TypedArrayContents<double> contents(result);
+  data = *contents;
+  return result;
+}
+
+/**
+ * Create a typed array view matching a \ref DATARAWTYPE_ "raw data type", 64 bit integers are viewed as bytes.
+ */
+inline v8::Local<v8::TypedArray> NewTypedArray(uint32_t dataType, v8::Local<v8::ArrayBuffer> buffer, size_t byteOffset, size_t length)
+{
+  switch(dataType)
+  {
+    case DATARAWTYPE_INT8:
+      return v8::Int8Array::New(buffer, byteOffset, length);
+    case DATARAWTYPE_INT16:
+      return v8::Int16Array::New(buffer, byteOffset, length);
+    case DATARAWTYPE_INT32:
+      return v8::Int32Array::New(buffer, byteOffset, length);
+    case DATARAWTYPE_UINT8:
+      return v8::Uint8Array::New(buffer, byteOffset, length);
+    case DATARAWTYPE_UINT16:
+      return v8::Uint16Array::New(buffer, byteOffset, length);
+    case DATARAWTYPE_UINT32:
+      return v8::Uint32Array::New(buffer, byteOffset, length);
+    case DATARAWTYPE_FLOAT32:
+      return v8::Float32Array::New(buffer, byteOffset, length);
+    case DATARAWTYPE_FLOAT64:
+      return v8::Float64Array::New(buffer, byteOffset, length);
+    default:
+      return v8::Uint8Array::New(buffer, byteOffset, length * 8);
+  }
+}
+
+template<class T> struct DataRawTypeOf;
+template<> struct DataRawTypeOf<uint8_t> { static const uint32_t value = DATARAWTYPE_UINT8; };
+template<> struct DataRawTypeOf<uint32_t> { static const uint32_t value = DATARAWTYPE_UINT32; };
+template<> struct DataRawTypeOf<double> { static const uint32_t value = DATARAWTYPE_FLOAT64; };
+
+/**
+ * Create a typed array holding a copy of \p length elements of \p data.
+ */
+template<class T>
+inline v8::Local<v8::TypedArray> NewTypedArrayCopy(const T* data, size_t length)
+{
+  v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), length * sizeof(T));
+  v8::Local<v8::TypedArray> result = NewTypedArray(DataRawTypeOf<T>::value, buffer, 0, length);
+  if(length != 0)
+  {
+    Nan::TypedArrayContents<T> contents(result);
+    memcpy(*contents, data, length * sizeof(T));
+  }
+  return result;
+}
+
+/**
+ * Return the typed array held by \p shared if it still holds the \p length elements of \p data, otherwise a new copy
+ * which is then held by \p shared. Typed arrays can't be frozen, a caller that modified the shared array gets a new one.
+ */
+template<class T>
+inline v8::Local<v8::TypedArray> SharedTypedArray(Nan::Global<v8::TypedArray>& shared, const T* data, size_t length)
+{
+  if(!shared.IsEmpty())
+  {
+    v8::Local<v8::TypedArray> result = Nan::New(shared);
+    Nan::TypedArrayContents<T> contents(result);
+    if(contents.length() == length && (length == 0 || memcmp(*contents, data, length * sizeof(T)) == 0))
+      return result;
+  }
+
+  v8::Local<v8::TypedArray> result = NewTypedArrayCopy(data, length);
+  shared.Reset(result);
+  return result;
+}
+
+/**
+ * Get the \ref DATARAWTYPE_ "raw data type" of a typed array, DATARAWTYPE_UNKNOWN for other values.
+ */
+inline uint32_t GetDataRawType(v8::Local<v8::Value> value)
+{
+  if(value->IsInt8Array())
+    return DATARAWTYPE_INT8;
+  else if(value->IsInt16Array())
+    return DATARAWTYPE_INT16;
+  else if(value->IsInt32Array())
+    return DATARAWTYPE_INT32;
+  else if(value->IsUint8Array())
+    return DATARAWTYPE_UINT8;
+  else if(value->IsUint16Array())
+    return DATARAWTYPE_UINT16;
+  else if(value->IsUint32Array())
+    return DATARAWTYPE_UINT32;
+  else if(value->IsFloat32Array())
+    return DATARAWTYPE_FLOAT32;
+  else if(value->IsFloat64Array())
+    return DATARAWTYPE_FLOAT64;
+  return DATARAWTYPE_UNKNOWN;
+}
+
+/**
+ * Size in bytes of a sample of a \ref DATARAWTYPE_ "raw data type".
+ */
+inline size_t GetDataRawTypeSize(uint32_t dataType)
+{
+  switch(dataType)
+  {
+    case DATARAWTYPE_INT8:
+    case DATARAWTYPE_UINT8:
+      return 1;
+    case DATARAWTYPE_INT16:
+    case DATARAWTYPE_UINT16:
+      return 2;
+    case DATARAWTYPE_INT32:
+    case DATARAWTYPE_UINT32:
+    case DATARAWTYPE_FLOAT32:
+      return 4;
+    case DATARAWTYPE_INT64:
+    case DATARAWTYPE_UINT64:
+    case DATARAWTYPE_FLOAT64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+#endif
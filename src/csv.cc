@@ -0,0 +1,356 @@
+/**
+ * \file csv.cc
+ * \brief CSV export of typed array columns.
+ */
+
+#include "csv.h"
+#include "numberformat.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+
+CsvOptions::CsvOptions() :
+  separator(";"),
+#ifdef _WIN32
+  eol("\r\n"),
+#else
+  eol("\n"),
+#endif
+  precision(-1),
+  index(false),
+  threadCount(std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+static size_t formatValue(const CsvColumn& column, size_t i, int precision, char* buffer)
+{
+  switch(column.dataType)
+  {
+    case DATARAWTYPE_INT8:
+      return formatInteger(((const int8_t*)column.data)[i], buffer);
+    case DATARAWTYPE_INT16:
+      return formatInteger(((const int16_t*)column.data)[i], buffer);
+    case DATARAWTYPE_INT32:
+      return formatInteger(((const int32_t*)column.data)[i], buffer);
+    case DATARAWTYPE_UINT8:
+      return formatUnsigned(((const uint8_t*)column.data)[i], buffer);
+    case DATARAWTYPE_UINT16:
+      return formatUnsigned(((const uint16_t*)column.data)[i], buffer);
+    case DATARAWTYPE_UINT32:
+      return formatUnsigned(((const uint32_t*)column.data)[i], buffer);
+    case DATARAWTYPE_FLOAT32:
+    {
+      const float value = ((const float*)column.data)[i];
+      return precision < 0 ? formatFloatShortest(value, buffer) : formatFixed(value, precision, buffer);
+    }
+    case DATARAWTYPE_FLOAT64:
+    {
+      const double value = ((const double*)column.data)[i];
+      return precision < 0 ? formatDoubleShortest(value, buffer) : formatFixed(value, precision, buffer);
+    }
+    default:
+      return 0;
+  }
+}
+
+void formatCsvRows(const std::vector<CsvColumn>& columns, const CsvOptions& options, size_t begin, size_t end, std::string& text)
+{
+  std::vector<char> line((columns.size() + 1) * (NUMBERFORMAT_BUFFER_SIZE + options.separator.size()) + options.eol.size());
+  text.reserve(text.size() + (end - begin) * columns.size() * 10);
+  for(size_t row = begin; row < end; ++row)
+  {
+    char* p = &line[0];
+
+    if(options.index)
+    {
+      p += formatUnsigned(row, p);
+      if(!columns.empty())
+      {
+        memcpy(p, options.separator.data(), options.separator.size());
+        p += options.separator.size();
+      }
+    }
+
+    for(size_t i = 0; i < columns.size(); ++i)
+    {
+      if(i > 0)
+      {
+        memcpy(p, options.separator.data(), options.separator.size());
+        p += options.separator.size();
+      }
+      if(row < columns[i].length)
+        p += formatValue(columns[i], row, options.precision, p);
+    }
+
+    memcpy(p, options.eol.data(), options.eol.size());
+    p += options.eol.size();
+    text.append(&line[0], p - &line[0]);
+  }
+}
+
+static void appendField(const std::string& field, const std::string& separator, std::string& text)
+{
+  if(field.find_first_of("\"\r\n") == std::string::npos && (separator.empty() || field.find(separator) == std::string::npos))
+  {
+    text += field;
+    return;
+  }
+
+  text += '"';
+  for(std::string::const_iterator it = field.begin(); it != field.end(); ++it)
+  {
+    if(*it == '"')
+      text += '"';
+    text += *it;
+  }
+  text += '"';
+}
+
+void formatCsvHeader(const CsvOptions& options, std::string& text)
+{
+  if(options.header.empty())
+    return;
+
+  for(size_t i = 0; i < options.header.size(); ++i)
+  {
+    if(i > 0)
+      text += options.separator;
+    appendField(options.header[i], options.separator, text);
+  }
+  text += options.eol;
+}
+
+static size_t rowCount(const std::vector<CsvColumn>& columns)
+{
+  size_t count = 0;
+  for(std::vector<CsvColumn>::const_iterator it = columns.begin(); it != columns.end(); ++it)
+    count = std::max(count, it->length);
+  return count;
+}
+
+static bool writeAll(uv_file file, const std::string& text, std::string& error)
+{
+  size_t offset = 0;
+  while(offset < text.size())
+  {
+    uv_fs_t req;
+    uv_buf_t buffer = uv_buf_init((char*)text.data() + offset, (unsigned int)std::min<size_t>(text.size() - offset, 1 << 30));
+    const int result = uv_fs_write(0, &req, file, &buffer, 1, -1, 0);
+    uv_fs_req_cleanup(&req);
+    if(result < 0)
+    {
+      error = std::string("Failed to write file: ") + uv_strerror(result);
+      return false;
+    }
+    offset += result;
+  }
+  return true;
+}
+
+class CsvWriteWorker : public Nan::AsyncWorker
+{
+  public:
+    CsvWriteWorker(Nan::Callback* callback, v8::Local<v8::Value> file, const std::vector<CsvColumn>& columns, const CsvOptions& options, v8::Local<v8::Value> data) :
+      Nan::AsyncWorker(callback),
+      m_file(file->IsNumber() ? Nan::To<int32_t>(file).FromJust() : -1),
+      m_columns(columns),
+      m_options(options),
+      m_bytesWritten(0)
+    {
+      if(!file->IsNumber())
+        m_filename = *Nan::Utf8String(file);
+      SaveToPersistent("data", data);
+    }
+
+    void Execute()
+    {
+      uv_file file = m_file;
+      if(!m_filename.empty())
+      {
+        uv_fs_t req;
+        file = uv_fs_open(0, &req, m_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644, 0);
+        uv_fs_req_cleanup(&req);
+        if(file < 0)
+          return SetErrorMessage((std::string("Failed to create file: ") + uv_strerror(file)).c_str());
+      }
+
+      std::string error;
+      write(file, error);
+
+      if(!m_filename.empty())
+      {
+        uv_fs_t req;
+        uv_fs_close(0, &req, file, 0);
+        uv_fs_req_cleanup(&req);
+      }
+
+      if(!error.empty())
+        SetErrorMessage(error.c_str());
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), Nan::New<v8::Number>((double)m_bytesWritten)};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    void write(uv_file file, std::string& error)
+    {
+      std::string header;
+      formatCsvHeader(m_options, header);
+      if(!writeAll(file, header, error))
+        return;
+      m_bytesWritten += header.size();
+
+      // Format a block per thread, then write them in order:
+      const size_t rows = rowCount(m_columns);
+      std::vector<std::string> blocks(m_options.threadCount);
+      std::vector<std::thread> threads;
+      for(size_t row = 0; row < rows; row += blocks.size() * CSV_BLOCK_ROWS)
+      {
+        for(size_t i = 0; i < blocks.size(); ++i)
+        {
+          const size_t begin = std::min(rows, row + i * CSV_BLOCK_ROWS);
+          const size_t end = std::min(rows, begin + CSV_BLOCK_ROWS);
+          blocks[i].clear();
+          if(i == 0)
+            continue;
+          threads.push_back(std::thread(formatCsvRows, std::cref(m_columns), std::cref(m_options), begin, end, std::ref(blocks[i])));
+        }
+        formatCsvRows(m_columns, m_options, row, std::min(rows, row + CSV_BLOCK_ROWS), blocks[0]);
+        for(std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it)
+          it->join();
+        threads.clear();
+
+        for(size_t i = 0; i < blocks.size(); ++i)
+        {
+          if(!writeAll(file, blocks[i], error))
+            return;
+          m_bytesWritten += blocks[i].size();
+        }
+      }
+    }
+
+    uv_file m_file;
+    std::string m_filename;
+    std::vector<CsvColumn> m_columns;
+    CsvOptions m_options;
+    uint64_t m_bytesWritten;
+};
+
+static bool getColumns(v8::Local<v8::Value> value, std::vector<CsvColumn>& columns)
+{
+  if(!value->IsArray())
+    return false;
+
+  v8::Local<v8::Array> array = value.As<v8::Array>();
+  for(uint32_t i = 0; i < array->Length(); ++i)
+  {
+    v8::Local<v8::Value> item = Nan::Get(array, i).ToLocalChecked();
+    CsvColumn column;
+    column.dataType = GetDataRawType(item);
+    if(column.dataType == DATARAWTYPE_UNKNOWN)
+      return false;
+    Nan::TypedArrayContents<uint8_t> contents(item);
+    column.data = *contents;
+    column.length = item.As<v8::TypedArray>()->Length();
+    columns.push_back(column);
+  }
+
+  return true;
+}
+
+static bool getOptions(v8::Local<v8::Value> value, CsvOptions& options)
+{
+  if(value->IsNullOrUndefined())
+    return true;
+  if(!value->IsObject())
+    return false;
+
+  v8::Local<v8::Object> object = value.As<v8::Object>();
+  v8::Local<v8::Value> item;
+
+  item = Nan::Get(object, Nan::New<v8::String>("separator").ToLocalChecked()).ToLocalChecked();
+  if(!item->IsUndefined())
+    options.separator = *Nan::Utf8String(item);
+
+  item = Nan::Get(object, Nan::New<v8::String>("eol").ToLocalChecked()).ToLocalChecked();
+  if(!item->IsUndefined())
+    options.eol = *Nan::Utf8String(item);
+
+  item = Nan::Get(object, Nan::New<v8::String>("precision").ToLocalChecked()).ToLocalChecked();
+  if(!item->IsUndefined())
+    options.precision = std::min(20, Nan::To<int32_t>(item).FromJust());
+
+  item = Nan::Get(object, Nan::New<v8::String>("index").ToLocalChecked()).ToLocalChecked();
+  if(!item->IsUndefined())
+    options.index = Nan::To<bool>(item).FromJust();
+
+  item = Nan::Get(object, Nan::New<v8::String>("threads").ToLocalChecked()).ToLocalChecked();
+  if(!item->IsUndefined())
+    options.threadCount = std::max(1u, Nan::To<uint32_t>(item).FromJust());
+
+  item = Nan::Get(object, Nan::New<v8::String>("header").ToLocalChecked()).ToLocalChecked();
+  if(item->IsArray())
+  {
+    v8::Local<v8::Array> header = item.As<v8::Array>();
+    for(uint32_t i = 0; i < header->Length(); ++i)
+      options.header.push_back(*Nan::Utf8String(Nan::Get(header, i).ToLocalChecked()));
+  }
+  else if(!item->IsUndefined())
+    return false;
+
+  return true;
+}
+
+NAN_MODULE_INIT(Csv::Init)
+{
+  v8::Local<v8::Object> csv = Nan::New<v8::Object>();
+  Nan::SetMethod(csv, "format", Format);
+  Nan::SetMethod(csv, "write", Write);
+
+  Nan::Set(target, Nan::New<v8::String>("Csv").ToLocalChecked(), csv);
+}
+
+NAN_METHOD(Csv::Format)
+{
+  const int length = info.Length();
+  if(length < 1 || length > 2)
+    return Nan::ThrowSyntaxError("Invalid parameter count, expected 1 or 2.");
+
+  std::vector<CsvColumn> columns;
+  if(!getColumns(info[0], columns))
+    return Nan::ThrowTypeError("Invalid columns, expected an array of typed arrays");
+  CsvOptions options;
+  if(!getOptions(info[1], options))
+    return Nan::ThrowTypeError("Invalid options");
+
+  std::string text;
+  formatCsvHeader(options, text);
+  formatCsvRows(columns, options, 0, rowCount(columns), text);
+
+  info.GetReturnValue().Set(Nan::New<v8::String>(text).ToLocalChecked());
+}
+
+NAN_METHOD(Csv::Write)
+{
+  CHECK_PARAMETER_COUNT(4);
+  if(!info[0]->IsNumber() && !info[0]->IsString())
+    return Nan::ThrowTypeError("Invalid file, expected a file descriptor or file name");
+  std::vector<CsvColumn> columns;
+  if(!getColumns(info[1], columns))
+    return Nan::ThrowTypeError("Invalid columns, expected an array of typed arrays");
+  CsvOptions options;
+  if(!getOptions(info[2], options))
+    return Nan::ThrowTypeError("Invalid options");
+  if(!info[3]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  Nan::Callback* callback = new Nan::Callback(info[3].As<v8::Function>());
+  Nan::AsyncQueueWorker(new CsvWriteWorker(callback, info[0], columns, options, info[1]));
+
+  info.GetReturnValue().SetUndefined();
+}
@@ -0,0 +1,49 @@
+/**
+ * \file csv.h
+ * \brief CSV export of typed array columns.
+ */
+
+#ifndef _CSV_H_
+#define _CSV_H_
+
+#include "common.h"
+
+#define CSV_BLOCK_ROWS 16384 //!< Number of rows formatted per thread at once.
+
+struct CsvColumn
+{
+  uint32_t dataType; //!< \ref DATARAWTYPE_ "DATARAWTYPE_*"
+  const uint8_t* data;
+  size_t length;
+};
+
+struct CsvOptions
+{
+  CsvOptions();
+
+  std::string separator;
+  std::string eol;
+  int precision; //!< Digits after the decimal point, negative for the shortest representation that reads back exactly.
+  bool index; //!< Prepend a column with the sample index.
+  std::vector<std::string> header;
+  unsigned threadCount;
+};
+
+/**
+ * Append rows \p begin up to \p end to \p text, columns shorter than the row get an empty field.
+ */
+void formatCsvRows(const std::vector<CsvColumn>& columns, const CsvOptions& options, size_t begin, size_t end, std::string& text);
+
+void formatCsvHeader(const CsvOptions& options, std::string& text);
+
+class Csv
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    static NAN_METHOD(Format);
+    static NAN_METHOD(Write);
+};
+
+#endif
@@ -0,0 +1,170 @@
+/**
+ * \file devicelist.cc
+ * \brief Device list snapshots, gathered in a single native pass.
+ */
+
+#include "devicelist.h"
+
+typedef uint32_t(*LstDevGetString_t)(uint32_t idKind, uint32_t id, char* buffer, uint32_t length);
+
+static bool getString(LstDevGetString_t function, uint32_t index, std::string& s)
+{
+  return GetString([=](char* buffer, uint32_t length) { return function(IDKIND_INDEX, index, buffer, length); }, s);
+}
+
+#define READ_OPTIONAL(item, flag, member, function) \
+  { \
+    item.member = function(IDKIND_INDEX, i); \
+    if(LibGetLastStatus() >= LIBTIEPIESTATUS_SUCCESS) \
+      item.available |= flag; \
+  }
+
+bool readDeviceList(std::vector<DeviceListItem>& items)
+{
+  static const uint32_t deviceTypes[] = {DEVICETYPE_OSCILLOSCOPE, DEVICETYPE_GENERATOR, DEVICETYPE_I2CHOST};
+
+  const uint32_t count = LstGetCount();
+  RETURN_FALSE_ON_ERROR();
+
+  items.resize(count);
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    DeviceListItem& item = items[i];
+
+    item.serialNumber = LstDevGetSerialNumber(IDKIND_INDEX, i);
+    RETURN_FALSE_ON_ERROR();
+    item.productId = LstDevGetProductId(IDKIND_INDEX, i);
+    RETURN_FALSE_ON_ERROR();
+    item.vendorId = LstDevGetVendorId(IDKIND_INDEX, i);
+    RETURN_FALSE_ON_ERROR();
+    item.types = LstDevGetTypes(IDKIND_INDEX, i);
+    RETURN_FALSE_ON_ERROR();
+    item.hasServer = LstDevHasServer(IDKIND_INDEX, i) != BOOL8_FALSE;
+    RETURN_FALSE_ON_ERROR();
+
+    item.available = 0;
+    READ_OPTIONAL(item, DEVICELISTITEM_DRIVERVERSION, driverVersion, LstDevGetDriverVersion);
+    READ_OPTIONAL(item, DEVICELISTITEM_RECOMMENDEDDRIVERVERSION, recommendedDriverVersion, LstDevGetRecommendedDriverVersion);
+    READ_OPTIONAL(item, DEVICELISTITEM_FIRMWAREVERSION, firmwareVersion, LstDevGetFirmwareVersion);
+    READ_OPTIONAL(item, DEVICELISTITEM_RECOMMENDEDFIRMWAREVERSION, recommendedFirmwareVersion, LstDevGetRecommendedFirmwareVersion);
+    READ_OPTIONAL(item, DEVICELISTITEM_CALIBRATIONDATE, calibrationDate, LstDevGetCalibrationDate);
+    READ_OPTIONAL(item, DEVICELISTITEM_IPV4ADDRESS, ipv4Address, LstDevGetIPv4Address);
+    READ_OPTIONAL(item, DEVICELISTITEM_IPPORT, ipPort, LstDevGetIPPort);
+
+    item.canOpen = 0;
+    for(size_t j = 0; j < sizeof(deviceTypes) / sizeof(deviceTypes[0]); ++j)
+      if((item.types & deviceTypes[j]) != 0)
+      {
+        if(LstDevCanOpen(IDKIND_INDEX, i, deviceTypes[j]) != BOOL8_FALSE)
+          item.canOpen |= deviceTypes[j];
+        RETURN_FALSE_ON_ERROR();
+      }
+
+    if(!getString(LstDevGetName, i, item.name) ||
+       !getString(LstDevGetNameShort, i, item.nameShort) ||
+       !getString(LstDevGetNameShortest, i, item.nameShortest))
+      return false;
+
+    const uint32_t containedCount = LstDevGetContainedSerialNumbers(IDKIND_INDEX, i, 0, 0);
+    RETURN_FALSE_ON_ERROR();
+    item.containedSerialNumbers.resize(containedCount);
+    if(containedCount > 0)
+    {
+      LstDevGetContainedSerialNumbers(IDKIND_INDEX, i, &item.containedSerialNumbers[0], containedCount);
+      RETURN_FALSE_ON_ERROR();
+    }
+  }
+
+  return true;
+}
+
+v8::Local<v8::Array> deviceListToArray(const std::vector<DeviceListItem>& items)
+{
+  v8::Local<v8::Array> result = Nan::New<v8::Array>((int)items.size());
+  for(size_t i = 0; i < items.size(); ++i)
+  {
+    const DeviceListItem& item = items[i];
+    v8::Local<v8::Object> object = Nan::New<v8::Object>();
+    Nan::Set(object, Nan::New<v8::String>("serialNumber").ToLocalChecked(), Nan::New<v8::Uint32>(item.serialNumber));
+    Nan::Set(object, Nan::New<v8::String>("productId").ToLocalChecked(), Nan::New<v8::Uint32>(item.productId));
+    Nan::Set(object, Nan::New<v8::String>("vendorId").ToLocalChecked(), Nan::New<v8::Uint32>(item.vendorId));
+    Nan::Set(object, Nan::New<v8::String>("name").ToLocalChecked(), Nan::New(item.name).ToLocalChecked());
+    Nan::Set(object, Nan::New<v8::String>("nameShort").ToLocalChecked(), Nan::New(item.nameShort).ToLocalChecked());
+    Nan::Set(object, Nan::New<v8::String>("nameShortest").ToLocalChecked(), Nan::New(item.nameShortest).ToLocalChecked());
+    Nan::Set(object, Nan::New<v8::String>("types").ToLocalChecked(), Nan::New<v8::Uint32>(item.types));
+    Nan::Set(object, Nan::New<v8::String>("canOpen").ToLocalChecked(), Nan::New<v8::Uint32>(item.canOpen));
+    Nan::Set(object, Nan::New<v8::String>("hasServer").ToLocalChecked(), Nan::New<v8::Boolean>(item.hasServer));
+
+    // Unavailable optional properties are left undefined:
+    if(item.available & DEVICELISTITEM_DRIVERVERSION)
+      Nan::Set(object, Nan::New<v8::String>("driverVersion").ToLocalChecked(), Nan::New(tpVersionToStr(item.driverVersion)).ToLocalChecked());
+    if(item.available & DEVICELISTITEM_RECOMMENDEDDRIVERVERSION)
+      Nan::Set(object, Nan::New<v8::String>("recommendedDriverVersion").ToLocalChecked(), Nan::New(tpVersionToStr(item.recommendedDriverVersion)).ToLocalChecked());
+    if(item.available & DEVICELISTITEM_FIRMWAREVERSION)
+      Nan::Set(object, Nan::New<v8::String>("firmwareVersion").ToLocalChecked(), Nan::New(tpVersionToStr(item.firmwareVersion)).ToLocalChecked());
+    if(item.available & DEVICELISTITEM_RECOMMENDEDFIRMWAREVERSION)
+      Nan::Set(object, Nan::New<v8::String>("recommendedFirmwareVersion").ToLocalChecked(), Nan::New(tpVersionToStr(item.recommendedFirmwareVersion)).ToLocalChecked());
+    if(item.available & DEVICELISTITEM_CALIBRATIONDATE)
+      Nan::Set(object, Nan::New<v8::String>("calibrationDate").ToLocalChecked(), Nan::New<v8::Uint32>(item.calibrationDate));
+    if(item.available & DEVICELISTITEM_IPV4ADDRESS)
+      Nan::Set(object, Nan::New<v8::String>("ipv4Address").ToLocalChecked(), Nan::New<v8::Uint32>(item.ipv4Address));
+    if(item.available & DEVICELISTITEM_IPPORT)
+      Nan::Set(object, Nan::New<v8::String>("ipPort").ToLocalChecked(), Nan::New<v8::Uint32>((uint32_t)item.ipPort));
+
+    v8::Local<v8::Array> contained = Nan::New<v8::Array>((int)item.containedSerialNumbers.size());
+    for(size_t j = 0; j < item.containedSerialNumbers.size(); ++j)
+      Nan::Set(contained, (uint32_t)j, Nan::New<v8::Uint32>(item.containedSerialNumbers[j]));
+    Nan::Set(object, Nan::New<v8::String>("containedSerialNumbers").ToLocalChecked(), contained);
+
+    Nan::Set(result, (uint32_t)i, object);
+  }
+  return result;
+}
+
+class LstUpdateWorker : public Nan::AsyncWorker
+{
+  public:
+    explicit LstUpdateWorker(Nan::Callback* callback) :
+      Nan::AsyncWorker(callback, "libtiepie:LstUpdateAsync")
+    {
+    }
+
+    void Execute()
+    {
+      LstUpdate();
+      if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS || !readDeviceList(m_items))
+        SetErrorMessage(LibGetLastStatusStr());
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), deviceListToArray(m_items)};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    std::vector<DeviceListItem> m_items;
+};
+
+NAN_METHOD(LstUpdateAsyncWrapper)
+{
+  CHECK_PARAMETER_COUNT(1);
+  if(!info[0]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  Nan::AsyncQueueWorker(new LstUpdateWorker(new Nan::Callback(info[0].As<v8::Function>())));
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(LstGetSnapshotWrapper)
+{
+  CHECK_PARAMETER_COUNT(0);
+
+  std::vector<DeviceListItem> items;
+  if(!readDeviceList(items))
+    return Nan::ThrowError(LibGetLastStatusStr());
+
+  info.GetReturnValue().Set(deviceListToArray(items));
+}
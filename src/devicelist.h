@@ -0,0 +1,53 @@
+/**
+ * \file devicelist.h
+ * \brief Device list snapshots, gathered in a single native pass.
+ */
+
+#ifndef _DEVICELIST_H_
+#define _DEVICELIST_H_
+
+#include "common.h"
+
+// Optional device properties, not all devices support them:
+#define DEVICELISTITEM_DRIVERVERSION               0x0001
+#define DEVICELISTITEM_RECOMMENDEDDRIVERVERSION    0x0002
+#define DEVICELISTITEM_FIRMWAREVERSION             0x0004
+#define DEVICELISTITEM_RECOMMENDEDFIRMWAREVERSION  0x0008
+#define DEVICELISTITEM_CALIBRATIONDATE             0x0010
+#define DEVICELISTITEM_IPV4ADDRESS                 0x0020
+#define DEVICELISTITEM_IPPORT                      0x0040
+
+struct DeviceListItem
+{
+  uint32_t serialNumber;
+  uint32_t productId;
+  uint32_t vendorId;
+  uint32_t types; //!< \ref DEVICETYPE_ "DEVICETYPE_*" flags.
+  uint32_t canOpen; //!< \ref DEVICETYPE_ "DEVICETYPE_*" flags of the types that can be opened.
+  std::string name;
+  std::string nameShort;
+  std::string nameShortest;
+  uint32_t available; //!< DEVICELISTITEM_* flags of the optional properties that are available.
+  TpVersion_t driverVersion;
+  TpVersion_t recommendedDriverVersion;
+  TpVersion_t firmwareVersion;
+  TpVersion_t recommendedFirmwareVersion;
+  TpDate_t calibrationDate;
+  uint32_t ipv4Address;
+  uint16_t ipPort;
+  bool hasServer;
+  std::vector<uint32_t> containedSerialNumbers;
+};
+
+/**
+ * Read all devices in the device list.
+ * \return \c false if a LibTiePie call failed, see LibGetLastStatus().
+ */
+bool readDeviceList(std::vector<DeviceListItem>& items);
+
+v8::Local<v8::Array> deviceListToArray(const std::vector<DeviceListItem>& items);
+
+NAN_METHOD(LstUpdateAsyncWrapper);
+NAN_METHOD(LstGetSnapshotWrapper);
+
+#endif
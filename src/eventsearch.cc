@@ -0,0 +1,599 @@
+/**
+ * \file eventsearch.cc
+ * \brief Software trigger, searches streamed chunks for trigger events.
+ */
+
+#include "eventsearch.h"
+#include "simd.h"
+#include <algorithm>
+
+static const uint64_t noStart = std::numeric_limits<uint64_t>::max();
+
+#define CHECK_NOT_BUSY(search) { if((search)->m_busy) return Nan::ThrowError("A chunk is being processed"); }
+
+class EventSearchWorker : public Nan::AsyncWorker
+{
+  public:
+    EventSearchWorker(Nan::Callback* callback, EventSearch* search, v8::Local<v8::Object> self, v8::Local<v8::Value> data) :
+      Nan::AsyncWorker(callback),
+      m_search(search)
+    {
+      SaveToPersistent("self", self);
+      SaveToPersistent("data", data);
+      m_data.assign(data);
+    }
+
+    void Execute()
+    {
+      m_search->process(m_data.data(), m_data.length(), m_events);
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      m_search->m_busy = false;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), EventSearch::toArray(m_events)};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    EventSearch* m_search;
+    FloatArrayArgument m_data;
+    std::vector<SearchEvent> m_events;
+};
+
+NAN_MODULE_INIT(EventSearch::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("EventSearch").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "setSampleFrequency", SetSampleFrequency);
+  Nan::SetPrototypeMethod(tpl, "setDataValueRange", SetDataValueRange);
+  Nan::SetPrototypeMethod(tpl, "setLevelMode", SetLevelMode);
+  Nan::SetPrototypeMethod(tpl, "setLevel", SetLevel);
+  Nan::SetPrototypeMethod(tpl, "setHysteresis", SetHysteresis);
+  Nan::SetPrototypeMethod(tpl, "setCondition", SetCondition);
+  Nan::SetPrototypeMethod(tpl, "setTime", SetTime);
+  Nan::SetPrototypeMethod(tpl, "setWindow", SetWindow);
+  Nan::SetPrototypeMethod(tpl, "process", Process);
+  Nan::SetPrototypeMethod(tpl, "flush", Flush);
+  Nan::SetPrototypeMethod(tpl, "reset", Reset);
+
+  Nan::Set(target, Nan::New<v8::String>("EventSearch").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+EventSearch::EventSearch(uint64_t kind) :
+  m_kind(kind),
+  m_sampleFrequency(1),
+  m_dataValueMin(-1),
+  m_dataValueMax(1),
+  m_levelMode(TLM_RELATIVE),
+  m_condition(TC_NONE),
+  m_preSamples(0),
+  m_postSamples(0),
+  m_chunk(0),
+  m_chunkLength(0),
+  m_completed(0),
+  m_busy(false)
+{
+  m_levels[0] = m_levels[1] = 0.5;
+  m_hysteresis[0] = m_hysteresis[1] = 0.05;
+  m_times[0] = m_times[1] = 0;
+  configure();
+  reset();
+}
+
+void EventSearch::configure()
+{
+  const double range = m_dataValueMax - m_dataValueMin;
+  double levels[2];
+  for(int i = 0; i < 2; ++i)
+    levels[i] = (m_levelMode == TLM_ABSOLUTE) ? m_levels[i] : m_dataValueMin + m_levels[i] * range;
+  const double hysteresis[2] = {m_hysteresis[0] * range, m_hysteresis[1] * range};
+
+  switch(m_kind)
+  {
+    case TK_INWINDOW:
+    case TK_OUTWINDOW:
+    case TK_ENTERWINDOW:
+    case TK_EXITWINDOW:
+    case TK_RUNTPULSEPOSITIVE:
+    case TK_RUNTPULSENEGATIVE:
+    case TK_RUNTPULSEEITHER:
+    {
+      const int low = levels[0] <= levels[1] ? 0 : 1;
+      m_low = (float)levels[low];
+      m_lowHysteresis = (float)hysteresis[low];
+      m_high = (float)levels[1 - low];
+      m_highHysteresis = (float)hysteresis[1 - low];
+      break;
+    }
+    case TK_FALLINGEDGE:
+    case TK_PULSEWIDTHNEGATIVE:
+    case TK_INTERVALFALLING:
+      // Hysteresis above the level, leaving zone 1 at the level:
+      m_low = (float)(levels[0] + hysteresis[0]);
+      m_lowHysteresis = (float)hysteresis[0];
+      m_high = std::numeric_limits<float>::infinity();
+      m_highHysteresis = 0;
+      break;
+    default:
+      m_low = (float)levels[0];
+      m_lowHysteresis = (float)hysteresis[0];
+      m_high = std::numeric_limits<float>::infinity();
+      m_highHysteresis = 0;
+      break;
+  }
+}
+
+void EventSearch::reset()
+{
+  m_position = 0;
+  m_zone = -1;
+  m_positiveStart = noStart;
+  m_positiveExtreme = 0;
+  m_negativeStart = noStart;
+  m_negativeExtreme = 0;
+  m_history.clear();
+  m_pending.clear();
+}
+
+int EventSearch::nextZone(float value) const
+{
+  switch(m_zone)
+  {
+    case 0:
+      return value >= m_high ? 2 : 1;
+    case 1:
+      return value >= m_high ? 2 : 0;
+    default:
+      return value >= m_low - m_lowHysteresis ? 1 : 0;
+  }
+}
+
+bool EventSearch::checkCondition(double width) const
+{
+  const double t0 = std::min(m_times[0], m_times[1]);
+  const double t1 = std::max(m_times[0], m_times[1]);
+
+  switch(m_condition)
+  {
+    case TC_SMALLER:
+      return width < m_times[0];
+    case TC_LARGER:
+      return width > m_times[0];
+    case TC_INSIDE:
+      return width > t0 && width < t1;
+    case TC_OUTSIDE:
+      return width < t0 || width > t1;
+    default:
+      return true;
+  }
+}
+
+void EventSearch::transition(int from, int to, uint64_t index)
+{
+  const bool rising = to > from;
+
+  switch(m_kind)
+  {
+    case TK_RISINGEDGE:
+      if(rising)
+        addEvent(index, -1);
+      break;
+
+    case TK_FALLINGEDGE:
+      if(!rising)
+        addEvent(index, -1);
+      break;
+
+    case TK_ANYEDGE:
+      addEvent(index, -1);
+      break;
+
+    case TK_INWINDOW:
+    case TK_ENTERWINDOW:
+      if(to == 1)
+        addEvent(index, -1);
+      break;
+
+    case TK_OUTWINDOW:
+    case TK_EXITWINDOW:
+      if(from == 1)
+        addEvent(index, -1);
+      break;
+
+    case TK_PULSEWIDTHPOSITIVE:
+    case TK_PULSEWIDTHNEGATIVE:
+    case TK_PULSEWIDTHEITHER:
+    {
+      // Positive pulses run from a rising to a falling transition, negative pulses the other way around:
+      uint64_t& start = rising ? m_negativeStart : m_positiveStart;
+      const bool enabled = rising ? (m_kind != TK_PULSEWIDTHPOSITIVE) : (m_kind != TK_PULSEWIDTHNEGATIVE);
+      if(enabled && start != noStart)
+      {
+        const double width = (double)(index - start) / m_sampleFrequency;
+        if(checkCondition(width))
+          addEvent(index, width);
+      }
+      start = noStart;
+      (rising ? m_positiveStart : m_negativeStart) = index;
+      break;
+    }
+
+    case TK_RUNTPULSEPOSITIVE:
+    case TK_RUNTPULSENEGATIVE:
+    case TK_RUNTPULSEEITHER:
+      // A runt crosses one level and returns without crossing the other level:
+      if(m_kind != TK_RUNTPULSENEGATIVE)
+      {
+        if(from == 0)
+        {
+          m_positiveStart = index;
+          m_positiveExtreme = to;
+        }
+        else if(m_positiveStart != noStart)
+        {
+          m_positiveExtreme = std::max(m_positiveExtreme, to);
+          if(to == 0)
+          {
+            const double width = (double)(index - m_positiveStart) / m_sampleFrequency;
+            if(m_positiveExtreme == 1 && checkCondition(width))
+              addEvent(index, width);
+            m_positiveStart = noStart;
+          }
+        }
+      }
+      if(m_kind != TK_RUNTPULSEPOSITIVE)
+      {
+        if(from == 2)
+        {
+          m_negativeStart = index;
+          m_negativeExtreme = to;
+        }
+        else if(m_negativeStart != noStart)
+        {
+          m_negativeExtreme = std::min(m_negativeExtreme, to);
+          if(to == 2)
+          {
+            const double width = (double)(index - m_negativeStart) / m_sampleFrequency;
+            if(m_negativeExtreme == 1 && checkCondition(width))
+              addEvent(index, width);
+            m_negativeStart = noStart;
+          }
+        }
+      }
+      break;
+
+    case TK_INTERVALRISING:
+    case TK_INTERVALFALLING:
+      if(rising == (m_kind == TK_INTERVALRISING))
+      {
+        if(m_positiveStart != noStart)
+        {
+          const double width = (double)(index - m_positiveStart) / m_sampleFrequency;
+          if(checkCondition(width))
+            addEvent(index, width);
+        }
+        m_positiveStart = index;
+      }
+      break;
+  }
+}
+
+void EventSearch::addEvent(uint64_t index, double width)
+{
+  const size_t offset = (size_t)(index - m_position);
+  const size_t pre = (size_t)std::min<uint64_t>(m_preSamples, m_history.size() + offset);
+  const size_t post = std::min(m_postSamples, m_chunkLength - offset);
+
+  SearchEvent event;
+  event.index = index;
+  event.start = index - pre;
+  event.width = width;
+  event.data.reserve(pre + m_postSamples);
+  if(pre > offset)
+  {
+    event.data.insert(event.data.end(), m_history.end() - (pre - offset), m_history.end());
+    event.data.insert(event.data.end(), m_chunk, m_chunk + offset);
+  }
+  else
+    event.data.insert(event.data.end(), m_chunk + offset - pre, m_chunk + offset);
+  event.data.insert(event.data.end(), m_chunk + offset, m_chunk + offset + post);
+  event.remaining = m_postSamples - post;
+
+  if(event.remaining == 0)
+    m_completed->push_back(std::move(event));
+  else
+    m_pending.push_back(std::move(event));
+}
+
+void EventSearch::process(const float* data, size_t length, std::vector<SearchEvent>& events)
+{
+  m_chunk = data;
+  m_chunkLength = length;
+  m_completed = &events;
+
+  // Complete the windows of earlier events, these all need the same number of samples so they finish in order:
+  size_t completed = 0;
+  for(std::vector<SearchEvent>::iterator it = m_pending.begin(); it != m_pending.end(); ++it)
+  {
+    const size_t count = std::min(it->remaining, length);
+    it->data.insert(it->data.end(), data, data + count);
+    it->remaining -= count;
+    if(it->remaining == 0)
+    {
+      events.push_back(std::move(*it));
+      ++completed;
+    }
+  }
+  m_pending.erase(m_pending.begin(), m_pending.begin() + completed);
+
+  size_t i = 0;
+  if(m_zone < 0 && length > 0)
+  {
+    m_zone = data[0] >= m_high ? 2 : (data[0] >= m_low ? 1 : 0);
+    i = 1;
+  }
+
+  while(i < length)
+  {
+    float low;
+    float high;
+    switch(m_zone)
+    {
+      case 0:
+        low = -std::numeric_limits<float>::infinity();
+        high = m_low;
+        break;
+      case 1:
+        low = m_low - m_lowHysteresis;
+        high = m_high;
+        break;
+      default:
+        low = m_high - m_highHysteresis;
+        high = std::numeric_limits<float>::infinity();
+        break;
+    }
+
+    i = findFirstOutside(data, i, length, low, high);
+    if(i == length)
+      break;
+
+    const int zone = nextZone(data[i]);
+    transition(m_zone, zone, m_position + i);
+    m_zone = zone;
+    ++i;
+  }
+
+  // Keep the pre samples for events early in the next chunk:
+  if(length >= m_preSamples)
+    m_history.assign(data + length - m_preSamples, data + length);
+  else
+  {
+    m_history.insert(m_history.end(), data, data + length);
+    if(m_history.size() > m_preSamples)
+      m_history.erase(m_history.begin(), m_history.end() - m_preSamples);
+  }
+
+  m_position += length;
+  m_chunk = 0;
+  m_chunkLength = 0;
+  m_completed = 0;
+}
+
+v8::Local<v8::Array> EventSearch::toArray(std::vector<SearchEvent>& events)
+{
+  v8::Local<v8::Array> result = Nan::New<v8::Array>((int)events.size());
+  for(size_t i = 0; i < events.size(); ++i)
+  {
+    const SearchEvent& event = events[i];
+    v8::Local<v8::Object> item = Nan::New<v8::Object>();
+    Nan::Set(item, Nan::New<v8::String>("index").ToLocalChecked(), Nan::New<v8::Number>((double)event.index));
+    Nan::Set(item, Nan::New<v8::String>("start").ToLocalChecked(), Nan::New<v8::Number>((double)event.start));
+    if(event.width >= 0)
+      Nan::Set(item, Nan::New<v8::String>("width").ToLocalChecked(), Nan::New<v8::Number>(event.width));
+    float* data;
+    v8::Local<v8::Float32Array> samples = NewFloat32Array(event.data.size(), data);
+    std::copy(event.data.begin(), event.data.end(), data);
+    Nan::Set(item, Nan::New<v8::String>("data").ToLocalChecked(), samples);
+    Nan::Set(result, (uint32_t)i, item);
+  }
+  return result;
+}
+
+NAN_METHOD(EventSearch::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowTypeError("EventSearch must be called with new");
+
+  CHECK_PARAMETER_COUNT(1);
+  const uint32_t kind = Nan::To<uint32_t>(info[0]).FromJust();
+  switch(kind)
+  {
+    case TK_RISINGEDGE:
+    case TK_FALLINGEDGE:
+    case TK_ANYEDGE:
+    case TK_INWINDOW:
+    case TK_OUTWINDOW:
+    case TK_ENTERWINDOW:
+    case TK_EXITWINDOW:
+    case TK_PULSEWIDTHPOSITIVE:
+    case TK_PULSEWIDTHNEGATIVE:
+    case TK_PULSEWIDTHEITHER:
+    case TK_RUNTPULSEPOSITIVE:
+    case TK_RUNTPULSENEGATIVE:
+    case TK_RUNTPULSEEITHER:
+    case TK_INTERVALRISING:
+    case TK_INTERVALFALLING:
+      break;
+    default:
+      return Nan::ThrowRangeError("Invalid trigger kind");
+  }
+
+  EventSearch* search = new EventSearch(kind);
+  search->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(EventSearch::SetSampleFrequency)
+{
+  CHECK_PARAMETER_COUNT(1);
+  const double sampleFrequency = Nan::To<double>(info[0]).FromJust();
+  if(!(sampleFrequency > 0))
+    return Nan::ThrowRangeError("Value out of range");
+
+  EventSearch* search = Nan::ObjectWrap::Unwrap<EventSearch>(info.Holder());
+  CHECK_NOT_BUSY(search);
+  search->m_sampleFrequency = sampleFrequency;
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(EventSearch::SetDataValueRange)
+{
+  CHECK_PARAMETER_COUNT(2);
+  const double min = Nan::To<double>(info[0]).FromJust();
+  const double max = Nan::To<double>(info[1]).FromJust();
+  if(!(max > min))
+    return Nan::ThrowRangeError("Value out of range");
+
+  EventSearch* search = Nan::ObjectWrap::Unwrap<EventSearch>(info.Holder());
+  CHECK_NOT_BUSY(search);
+  search->m_dataValueMin = min;
+  search->m_dataValueMax = max;
+  search->configure();
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(EventSearch::SetLevelMode)
+{
+  CHECK_PARAMETER_COUNT(1);
+  const uint32_t mode = Nan::To<uint32_t>(info[0]).FromJust();
+  if(mode != TLM_RELATIVE && mode != TLM_ABSOLUTE)
+    return Nan::ThrowRangeError("Value out of range");
+
+  EventSearch* search = Nan::ObjectWrap::Unwrap<EventSearch>(info.Holder());
+  CHECK_NOT_BUSY(search);
+  search->m_levelMode = mode;
+  search->configure();
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(EventSearch::SetLevel)
+{
+  CHECK_PARAMETER_COUNT(2);
+  const uint32_t index = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(index, 0, 1);
+  const double level = Nan::To<double>(info[1]).FromJust();
+
+  EventSearch* search = Nan::ObjectWrap::Unwrap<EventSearch>(info.Holder());
+  CHECK_NOT_BUSY(search);
+  search->m_levels[index] = level;
+  search->configure();
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(EventSearch::SetHysteresis)
+{
+  CHECK_PARAMETER_COUNT(2);
+  const uint32_t index = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(index, 0, 1);
+  const double hysteresis = Nan::To<double>(info[1]).FromJust();
+  CHECK_RANGE(hysteresis, 0, 1);
+
+  EventSearch* search = Nan::ObjectWrap::Unwrap<EventSearch>(info.Holder());
+  CHECK_NOT_BUSY(search);
+  search->m_hysteresis[index] = hysteresis;
+  search->configure();
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(EventSearch::SetCondition)
+{
+  CHECK_PARAMETER_COUNT(1);
+  const uint32_t condition = Nan::To<uint32_t>(info[0]).FromJust();
+  if(condition != TC_NONE && condition != TC_SMALLER && condition != TC_LARGER && condition != TC_INSIDE && condition != TC_OUTSIDE)
+    return Nan::ThrowRangeError("Value out of range");
+
+  EventSearch* search = Nan::ObjectWrap::Unwrap<EventSearch>(info.Holder());
+  CHECK_NOT_BUSY(search);
+  search->m_condition = condition;
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(EventSearch::SetTime)
+{
+  CHECK_PARAMETER_COUNT(2);
+  const uint32_t index = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(index, 0, 1);
+  const double time = Nan::To<double>(info[1]).FromJust();
+
+  EventSearch* search = Nan::ObjectWrap::Unwrap<EventSearch>(info.Holder());
+  CHECK_NOT_BUSY(search);
+  search->m_times[index] = time;
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(EventSearch::SetWindow)
+{
+  CHECK_PARAMETER_COUNT(2);
+  const uint32_t preSamples = Nan::To<uint32_t>(info[0]).FromJust();
+  const uint32_t postSamples = Nan::To<uint32_t>(info[1]).FromJust();
+
+  EventSearch* search = Nan::ObjectWrap::Unwrap<EventSearch>(info.Holder());
+  CHECK_NOT_BUSY(search);
+  search->m_preSamples = preSamples;
+  search->m_postSamples = postSamples;
+  search->m_pending.clear();
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(EventSearch::Process)
+{
+  CHECK_PARAMETER_COUNT(2);
+  if(!info[0]->IsArray() && !info[0]->IsTypedArray())
+    return Nan::ThrowTypeError("Invalid data, expected an array");
+  if(!info[1]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  EventSearch* search = Nan::ObjectWrap::Unwrap<EventSearch>(info.Holder());
+  CHECK_NOT_BUSY(search);
+  search->m_busy = true;
+
+  Nan::Callback* callback = new Nan::Callback(info[1].As<v8::Function>());
+  Nan::AsyncQueueWorker(new EventSearchWorker(callback, search, info.Holder(), info[0]));
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(EventSearch::Flush)
+{
+  CHECK_PARAMETER_COUNT(0);
+  EventSearch* search = Nan::ObjectWrap::Unwrap<EventSearch>(info.Holder());
+  CHECK_NOT_BUSY(search);
+
+  std::vector<SearchEvent> events;
+  events.swap(search->m_pending);
+
+  info.GetReturnValue().Set(toArray(events));
+}
+
+NAN_METHOD(EventSearch::Reset)
+{
+  CHECK_PARAMETER_COUNT(0);
+  EventSearch* search = Nan::ObjectWrap::Unwrap<EventSearch>(info.Holder());
+  CHECK_NOT_BUSY(search);
+  search->reset();
+
+  info.GetReturnValue().SetUndefined();
+}
@@ -0,0 +1,91 @@
+/**
+ * \file eventsearch.h
+ * \brief Software trigger, searches streamed chunks for trigger events.
+ */
+
+#ifndef _EVENTSEARCH_H_
+#define _EVENTSEARCH_H_
+
+#include "common.h"
+
+struct SearchEvent
+{
+  uint64_t index; //!< Sample index of the event in the stream.
+  uint64_t start; //!< Sample index of the first window sample.
+  double width; //!< Pulse width or interval in seconds, negative if not applicable.
+  std::vector<float> data;
+  size_t remaining; //!< Number of window samples still to be received.
+};
+
+class EventSearch : public Nan::ObjectWrap
+{
+  friend class EventSearchWorker;
+
+  public:
+    static NAN_MODULE_INIT(Init);
+
+    /**
+     * Scan the next chunk of the stream, events with complete windows are appended to \p events.
+     */
+    void process(const float* data, size_t length, std::vector<SearchEvent>& events);
+
+    static v8::Local<v8::Array> toArray(std::vector<SearchEvent>& events);
+
+  private:
+    explicit EventSearch(uint64_t kind);
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(SetSampleFrequency);
+    static NAN_METHOD(SetDataValueRange);
+    static NAN_METHOD(SetLevelMode);
+    static NAN_METHOD(SetLevel);
+    static NAN_METHOD(SetHysteresis);
+    static NAN_METHOD(SetCondition);
+    static NAN_METHOD(SetTime);
+    static NAN_METHOD(SetWindow);
+    static NAN_METHOD(Process);
+    static NAN_METHOD(Flush);
+    static NAN_METHOD(Reset);
+
+    void configure();
+    void reset();
+    int nextZone(float value) const;
+    void transition(int from, int to, uint64_t index);
+    bool checkCondition(double width) const;
+    void addEvent(uint64_t index, double width);
+
+    // Settings:
+    uint64_t m_kind;
+    double m_sampleFrequency;
+    double m_dataValueMin;
+    double m_dataValueMax;
+    uint32_t m_levelMode;
+    double m_levels[2];
+    double m_hysteresis[2];
+    uint32_t m_condition;
+    double m_times[2];
+    size_t m_preSamples;
+    size_t m_postSamples;
+
+    // Zone thresholds, zone 0 is below the low level, zone 1 between the levels and zone 2 above the high level:
+    float m_low;
+    float m_lowHysteresis;
+    float m_high;
+    float m_highHysteresis;
+
+    // State:
+    uint64_t m_position;
+    int m_zone;
+    uint64_t m_positiveStart;
+    int m_positiveExtreme;
+    uint64_t m_negativeStart;
+    int m_negativeExtreme;
+    const float* m_chunk;
+    size_t m_chunkLength;
+    std::vector<float> m_history;
+    std::vector<SearchEvent> m_pending;
+    std::vector<SearchEvent>* m_completed;
+    bool m_busy;
+};
+
+#endif
@@ -0,0 +1,357 @@
+/**
+ * \file fft.cc
+ * \brief Mixed radix FFT with cached plans.
+ */
+
+#include "fft.h"
+#include <cmath>
+#include <map>
+#include <mutex>
+
+#ifndef M_PI
+  #define M_PI 3.14159265358979323846
+#endif
+
+static const size_t maxGenericRadix = 64;
+static const size_t maxCachedPlans = 32;
+
+template<class T>
+static std::shared_ptr<const T> getCachedPlan(size_t length)
+{
+  static std::mutex mutex;
+  static std::map<size_t, std::shared_ptr<const T>> cache;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    typename std::map<size_t, std::shared_ptr<const T>>::const_iterator it = cache.find(length);
+    if(it != cache.end())
+      return it->second;
+  }
+
+  // Created unlocked, plans may request other plans while being constructed:
+  std::shared_ptr<const T> plan = std::make_shared<T>(length);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if(cache.size() >= maxCachedPlans)
+    cache.clear();
+  cache[length] = plan;
+  return plan;
+}
+
+std::shared_ptr<const FFTPlan> FFTPlan::get(size_t length)
+{
+  return getCachedPlan<FFTPlan>(length);
+}
+
+FFTPlan::FFTPlan(size_t length) :
+  m_length(length)
+{
+  // Factorize, powers of four first:
+  size_t n = length;
+  size_t p = 4;
+  bool generic = false;
+  while(n > 1)
+  {
+    while(n % p != 0)
+    {
+      switch(p)
+      {
+        case 4:
+          p = 2;
+          break;
+        case 2:
+          p = 3;
+          break;
+        default:
+          p += 2;
+          break;
+      }
+      if(p * p > n)
+        p = n;
+    }
+    n /= p;
+    m_factors.push_back(p);
+    m_factors.push_back(n);
+    if(p > maxGenericRadix)
+      generic = true;
+  }
+
+  if(generic)
+  {
+    // Bluestein, chirp z-transform using a power of two convolution:
+    m_factors.clear();
+
+    size_t m = 1;
+    while(m < 2 * length - 1)
+      m <<= 1;
+    m_inner = get(m);
+
+    m_chirp.resize(length);
+    const uint64_t period = 2 * (uint64_t)length;
+    for(size_t k = 0; k < length; ++k)
+    {
+      const uint64_t k2 = ((uint64_t)k * (uint64_t)k) % period;
+      m_chirp[k] = std::polar(1.0, -M_PI * (double)k2 / (double)length);
+    }
+
+    std::vector<Complex> b(m, Complex(0, 0));
+    b[0] = std::conj(m_chirp[0]);
+    for(size_t k = 1; k < length; ++k)
+      b[k] = b[m - k] = std::conj(m_chirp[k]);
+
+    m_chirpSpectrum.resize(m);
+    m_inner->forward(&b[0], &m_chirpSpectrum[0]);
+    const double scale = 1.0 / (double)m;
+    for(size_t k = 0; k < m; ++k)
+      m_chirpSpectrum[k] *= scale;
+  }
+  else
+  {
+    m_twiddles.resize(length);
+    for(size_t i = 0; i < length; ++i)
+      m_twiddles[i] = std::polar(1.0, -2.0 * M_PI * (double)i / (double)length);
+  }
+}
+
+void FFTPlan::forward(const Complex* input, Complex* output) const
+{
+  if(m_length == 0)
+    return;
+  else if(m_length == 1)
+    output[0] = input[0];
+  else if(m_inner)
+    bluestein(input, output);
+  else
+    work(output, input, 1, &m_factors[0]);
+}
+
+void FFTPlan::work(Complex* output, const Complex* input, size_t stride, const size_t* factors) const
+{
+  const size_t p = factors[0];
+  const size_t m = factors[1];
+  Complex* const begin = output;
+  Complex* const end = output + p * m;
+
+  if(m == 1)
+  {
+    for(; output != end; ++output, input += stride)
+      *output = *input;
+  }
+  else
+  {
+    for(; output != end; output += m, input += stride)
+      work(output, input, stride * p, factors + 2);
+  }
+
+  switch(p)
+  {
+    case 2:
+      butterfly2(begin, stride, m);
+      break;
+    case 3:
+      butterfly3(begin, stride, m);
+      break;
+    case 4:
+      butterfly4(begin, stride, m);
+      break;
+    case 5:
+      butterfly5(begin, stride, m);
+      break;
+    default:
+      butterflyGeneric(begin, stride, m, p);
+      break;
+  }
+}
+
+void FFTPlan::butterfly2(Complex* output, size_t stride, size_t m) const
+{
+  const Complex* tw = &m_twiddles[0];
+  for(size_t k = 0; k < m; ++k, tw += stride)
+  {
+    const Complex t = output[m + k] * *tw;
+    output[m + k] = output[k] - t;
+    output[k] += t;
+  }
+}
+
+void FFTPlan::butterfly3(Complex* output, size_t stride, size_t m) const
+{
+  const double epi3 = m_twiddles[stride * m].imag();
+  const Complex* tw1 = &m_twiddles[0];
+  const Complex* tw2 = &m_twiddles[0];
+  for(size_t k = 0; k < m; ++k, tw1 += stride, tw2 += 2 * stride)
+  {
+    const Complex s1 = output[k + m] * *tw1;
+    const Complex s2 = output[k + 2 * m] * *tw2;
+    const Complex s3 = s1 + s2;
+    const Complex s0 = (s1 - s2) * epi3;
+    const Complex a = output[k] - s3 * 0.5;
+    output[k] += s3;
+    output[k + m] = Complex(a.real() - s0.imag(), a.imag() + s0.real());
+    output[k + 2 * m] = Complex(a.real() + s0.imag(), a.imag() - s0.real());
+  }
+}
+
+void FFTPlan::butterfly4(Complex* output, size_t stride, size_t m) const
+{
+  const Complex* tw1 = &m_twiddles[0];
+  const Complex* tw2 = &m_twiddles[0];
+  const Complex* tw3 = &m_twiddles[0];
+  for(size_t k = 0; k < m; ++k, tw1 += stride, tw2 += 2 * stride, tw3 += 3 * stride)
+  {
+    const Complex s0 = output[k + m] * *tw1;
+    const Complex s1 = output[k + 2 * m] * *tw2;
+    const Complex s2 = output[k + 3 * m] * *tw3;
+    const Complex s5 = output[k] - s1;
+    const Complex s6 = output[k] + s1;
+    const Complex s3 = s0 + s2;
+    const Complex s4 = s0 - s2;
+    output[k] = s6 + s3;
+    output[k + 2 * m] = s6 - s3;
+    output[k + m] = Complex(s5.real() + s4.imag(), s5.imag() - s4.real());
+    output[k + 3 * m] = Complex(s5.real() - s4.imag(), s5.imag() + s4.real());
+  }
+}
+
+void FFTPlan::butterfly5(Complex* output, size_t stride, size_t m) const
+{
+  const Complex ya = m_twiddles[stride * m];
+  const Complex yb = m_twiddles[2 * stride * m];
+  for(size_t u = 0; u < m; ++u)
+  {
+    const Complex s0 = output[u];
+    const Complex s1 = output[u + m] * m_twiddles[u * stride];
+    const Complex s2 = output[u + 2 * m] * m_twiddles[2 * u * stride];
+    const Complex s3 = output[u + 3 * m] * m_twiddles[3 * u * stride];
+    const Complex s4 = output[u + 4 * m] * m_twiddles[4 * u * stride];
+
+    const Complex s7 = s1 + s4;
+    const Complex s10 = s1 - s4;
+    const Complex s8 = s2 + s3;
+    const Complex s9 = s2 - s3;
+
+    output[u] = s0 + s7 + s8;
+
+    const Complex s5(s0.real() + s7.real() * ya.real() + s8.real() * yb.real(), s0.imag() + s7.imag() * ya.real() + s8.imag() * yb.real());
+    const Complex s6(s10.imag() * ya.imag() + s9.imag() * yb.imag(), -s10.real() * ya.imag() - s9.real() * yb.imag());
+    output[u + m] = s5 - s6;
+    output[u + 4 * m] = s5 + s6;
+
+    const Complex s11(s0.real() + s7.real() * yb.real() + s8.real() * ya.real(), s0.imag() + s7.imag() * yb.real() + s8.imag() * ya.real());
+    const Complex s12(-s10.imag() * yb.imag() + s9.imag() * ya.imag(), s10.real() * yb.imag() - s9.real() * ya.imag());
+    output[u + 2 * m] = s11 + s12;
+    output[u + 3 * m] = s11 - s12;
+  }
+}
+
+void FFTPlan::butterflyGeneric(Complex* output, size_t stride, size_t m, size_t p) const
+{
+  std::vector<Complex> scratch(p);
+  for(size_t u = 0; u < m; ++u)
+  {
+    for(size_t q = 0, k = u; q < p; ++q, k += m)
+      scratch[q] = output[k];
+
+    for(size_t q = 0, k = u; q < p; ++q, k += m)
+    {
+      size_t index = 0;
+      Complex sum = scratch[0];
+      for(size_t r = 1; r < p; ++r)
+      {
+        index += stride * k;
+        if(index >= m_length)
+          index %= m_length;
+        sum += scratch[r] * m_twiddles[index];
+      }
+      output[k] = sum;
+    }
+  }
+}
+
+void FFTPlan::bluestein(const Complex* input, Complex* output) const
+{
+  const size_t m = m_inner->length();
+  std::vector<Complex> a(m, Complex(0, 0));
+  std::vector<Complex> b(m);
+
+  for(size_t k = 0; k < m_length; ++k)
+    a[k] = input[k] * m_chirp[k];
+
+  m_inner->forward(&a[0], &b[0]);
+
+  // Multiply with the chirp spectrum and inverse transform using conjugation:
+  for(size_t k = 0; k < m; ++k)
+    b[k] = std::conj(b[k] * m_chirpSpectrum[k]);
+
+  m_inner->forward(&b[0], &a[0]);
+
+  for(size_t k = 0; k < m_length; ++k)
+    output[k] = std::conj(a[k]) * m_chirp[k];
+}
+
+std::shared_ptr<const RealFFTPlan> RealFFTPlan::get(size_t length)
+{
+  return getCachedPlan<RealFFTPlan>(length);
+}
+
+RealFFTPlan::RealFFTPlan(size_t length) :
+  m_length(length)
+{
+  if(length % 2 == 0)
+  {
+    const size_t half = length / 2;
+    m_plan = FFTPlan::get(half);
+    m_twiddles.resize(half + 1);
+    for(size_t k = 0; k <= half; ++k)
+      m_twiddles[k] = std::polar(1.0, -2.0 * M_PI * (double)k / (double)length);
+  }
+  else
+    m_plan = FFTPlan::get(length);
+}
+
+void RealFFTPlan::forward(const float* input, const double* window, Complex* output, Complex* work) const
+{
+  if(m_length % 2 == 0)
+  {
+    const size_t half = m_length / 2;
+    Complex* z = work;
+    Complex* spectrum = work + half;
+
+    if(window)
+    {
+      for(size_t k = 0; k < half; ++k)
+        z[k] = Complex(input[2 * k] * window[2 * k], input[2 * k + 1] * window[2 * k + 1]);
+    }
+    else
+    {
+      for(size_t k = 0; k < half; ++k)
+        z[k] = Complex(input[2 * k], input[2 * k + 1]);
+    }
+
+    m_plan->forward(z, spectrum);
+
+    // Split the half length spectrum into the even and odd sample spectra:
+    for(size_t k = 0; k <= half; ++k)
+    {
+      const Complex zk = spectrum[k == half ? 0 : k];
+      const Complex zc = std::conj(spectrum[k == 0 ? 0 : half - k]);
+      const Complex even = (zk + zc) * 0.5;
+      const Complex diff = zk - zc;
+      const Complex odd(diff.imag() * 0.5, -diff.real() * 0.5);
+      output[k] = even + m_twiddles[k] * odd;
+    }
+  }
+  else
+  {
+    Complex* z = work;
+    Complex* spectrum = work + m_length;
+
+    for(size_t k = 0; k < m_length; ++k)
+      z[k] = Complex(window ? input[k] * window[k] : input[k], 0);
+
+    m_plan->forward(z, spectrum);
+
+    for(size_t k = 0; k < binCount(); ++k)
+      output[k] = spectrum[k];
+  }
+}
@@ -0,0 +1,98 @@
+/**
+ * \file fft.h
+ * \brief Mixed radix FFT with cached plans.
+ */
+
+#ifndef _FFT_H_
+#define _FFT_H_
+
+#include <complex>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+typedef std::complex<double> Complex;
+
+/**
+ * Forward complex FFT of a fixed length.
+ *
+ * Lengths with only small prime factors use a mixed radix (4, 2, 3, 5, generic) algorithm,
+ * other lengths fall back to Bluestein's algorithm on top of a power of two plan.
+ * Plans are immutable once created and can be shared between threads.
+ */
+class FFTPlan
+{
+  public:
+    static std::shared_ptr<const FFTPlan> get(size_t length);
+
+    explicit FFTPlan(size_t length);
+
+    size_t length() const
+    {
+      return m_length;
+    }
+
+    /**
+     * Transform \p input into \p output, both have length() elements and must not overlap.
+     */
+    void forward(const Complex* input, Complex* output) const;
+
+  private:
+    void work(Complex* output, const Complex* input, size_t stride, const size_t* factors) const;
+    void butterfly2(Complex* output, size_t stride, size_t m) const;
+    void butterfly3(Complex* output, size_t stride, size_t m) const;
+    void butterfly4(Complex* output, size_t stride, size_t m) const;
+    void butterfly5(Complex* output, size_t stride, size_t m) const;
+    void butterflyGeneric(Complex* output, size_t stride, size_t m, size_t p) const;
+    void bluestein(const Complex* input, Complex* output) const;
+
+    size_t m_length;
+    std::vector<size_t> m_factors;
+    std::vector<Complex> m_twiddles;
+
+    // Bluestein:
+    std::shared_ptr<const FFTPlan> m_inner;
+    std::vector<Complex> m_chirp;
+    std::vector<Complex> m_chirpSpectrum;
+};
+
+/**
+ * Forward FFT of real input, producing the length / 2 + 1 non negative frequency bins.
+ *
+ * Even lengths are computed with a half length complex FFT.
+ */
+class RealFFTPlan
+{
+  public:
+    static std::shared_ptr<const RealFFTPlan> get(size_t length);
+
+    explicit RealFFTPlan(size_t length);
+
+    size_t length() const
+    {
+      return m_length;
+    }
+
+    size_t binCount() const
+    {
+      return m_length / 2 + 1;
+    }
+
+    size_t workSize() const
+    {
+      return (m_length % 2 == 0) ? m_length : 2 * m_length;
+    }
+
+    /**
+     * Transform \p input (length() samples) into \p output (binCount() bins).
+     * \p window is optional and multiplied with the input, \p work needs workSize() elements.
+     */
+    void forward(const float* input, const double* window, Complex* output, Complex* work) const;
+
+  private:
+    size_t m_length;
+    std::shared_ptr<const FFTPlan> m_plan;
+    std::vector<Complex> m_twiddles;
+};
+
+#endif
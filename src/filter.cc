@@ -0,0 +1,531 @@
+/**
+ * \file filter.cc
+ * \brief Streaming FIR, biquad IIR and CIC filters, keeping their state from one chunk to the next.
+ */
+
+#include "filter.h"
+#include "simd.h"
+#include <cmath>
+#include <thread>
+
+#define FILTER_PARALLEL_SAMPLES  (1 << 20) //!< Channels are filtered on separate threads from this many samples.
+
+FirStage::FirStage(const std::vector<float>& coefficients, uint32_t decimation) :
+  m_coefficients(coefficients.rbegin(), coefficients.rend()),
+  m_decimation(decimation),
+  m_skip(0),
+  m_buffer(coefficients.size() - 1, 0.0f)
+{
+}
+
+FilterStage* FirStage::clone() const
+{
+  return new FirStage(*this);
+}
+
+size_t FirStage::outputLength(size_t length) const
+{
+  return length > m_skip ? (length - m_skip - 1) / m_decimation + 1 : 0;
+}
+
+void FirStage::process(const float* input, size_t length, float* output)
+{
+  const size_t taps = m_coefficients.size();
+  const size_t history = taps - 1;
+  m_buffer.resize(history + length);
+  std::copy(input, input + length, m_buffer.begin() + history);
+
+  // Output j uses inputs j - history .. j, which are at j .. j + history in the buffer:
+  const float* x = &m_buffer[0];
+  size_t j = m_skip;
+  for(; j < length; j += m_decimation)
+    *output++ = dotProduct(&m_coefficients[0], x + j, taps);
+  m_skip = j - length;
+
+  std::copy(m_buffer.end() - history, m_buffer.end(), m_buffer.begin());
+  m_buffer.resize(history);
+}
+
+void FirStage::reset()
+{
+  m_skip = 0;
+  m_buffer.assign(m_coefficients.size() - 1, 0.0f);
+}
+
+BiquadStage::BiquadStage(const std::vector<Section>& sections) :
+  m_sections(sections)
+{
+  reset();
+}
+
+FilterStage* BiquadStage::clone() const
+{
+  return new BiquadStage(*this);
+}
+
+size_t BiquadStage::outputLength(size_t length) const
+{
+  return length;
+}
+
+void BiquadStage::process(const float* input, size_t length, float* output)
+{
+  // Section by section over the whole block, so the state stays in registers:
+  for(std::vector<Section>::iterator it = m_sections.begin(); it != m_sections.end(); ++it)
+  {
+    const double b0 = it->b0;
+    const double b1 = it->b1;
+    const double b2 = it->b2;
+    const double a1 = it->a1;
+    const double a2 = it->a2;
+    double s1 = it->s1;
+    double s2 = it->s2;
+    for(size_t i = 0; i < length; ++i)
+    {
+      const double x = input[i];
+      const double y = b0 * x + s1;
+      s1 = b1 * x - a1 * y + s2;
+      s2 = b2 * x - a2 * y;
+      output[i] = (float)y;
+    }
+    it->s1 = s1;
+    it->s2 = s2;
+    input = output;
+  }
+
+  if(m_sections.empty() && input != output)
+    std::copy(input, input + length, output);
+}
+
+void BiquadStage::reset()
+{
+  for(std::vector<Section>::iterator it = m_sections.begin(); it != m_sections.end(); ++it)
+    it->s1 = it->s2 = 0;
+}
+
+CicStage::CicStage(uint32_t decimation, uint32_t order, double range) :
+  m_decimation(decimation),
+  m_range(range),
+  m_phase(0),
+  m_integrators(order, 0),
+  m_combs(order, 0)
+{
+  const int bits = fractionBits(decimation, order, range);
+  m_inputScale = std::ldexp(1.0, bits);
+  m_outputScale = std::ldexp(std::pow((double)decimation, -(double)order), -bits);
+}
+
+int CicStage::fractionBits(uint32_t decimation, uint32_t order, double range)
+{
+  // One bit is kept as margin for rounding:
+  return (int)std::floor(62.0 - order * std::log2((double)decimation) - std::log2(range));
+}
+
+FilterStage* CicStage::clone() const
+{
+  return new CicStage(*this);
+}
+
+size_t CicStage::outputLength(size_t length) const
+{
+  return (m_phase + length) / m_decimation;
+}
+
+void CicStage::process(const float* input, size_t length, float* output)
+{
+  const size_t order = m_integrators.size();
+  uint64_t* integrators = &m_integrators[0];
+  uint64_t* combs = &m_combs[0];
+  for(size_t i = 0; i < length; ++i)
+  {
+    // Clamped, so the conversion can't overflow, NaN ends up at the range:
+    const double x = std::max(-m_range, std::min(m_range, (double)input[i]));
+    uint64_t value = (uint64_t)std::llround(x * m_inputScale);
+    for(size_t k = 0; k < order; ++k)
+      value = integrators[k] += value;
+
+    if(++m_phase == m_decimation)
+    {
+      m_phase = 0;
+      for(size_t k = 0; k < order; ++k)
+      {
+        const uint64_t previous = combs[k];
+        combs[k] = value;
+        value -= previous;
+      }
+      *output++ = (float)((double)(int64_t)value * m_outputScale);
+    }
+  }
+}
+
+void CicStage::reset()
+{
+  m_phase = 0;
+  m_integrators.assign(m_integrators.size(), 0);
+  m_combs.assign(m_combs.size(), 0);
+}
+
+FilterChain::FilterChain(const FilterChain& other) :
+  m_buffers(other.m_buffers)
+{
+  for(std::vector<FilterStage*>::const_iterator it = other.m_stages.begin(); it != other.m_stages.end(); ++it)
+    m_stages.push_back((*it)->clone());
+}
+
+FilterChain::~FilterChain()
+{
+  for(std::vector<FilterStage*>::iterator it = m_stages.begin(); it != m_stages.end(); ++it)
+    delete *it;
+}
+
+void FilterChain::add(FilterStage* stage)
+{
+  m_stages.push_back(stage);
+  m_buffers.assign(m_stages.size() - 1, std::vector<float>(FILTER_BLOCK_SIZE));
+}
+
+size_t FilterChain::outputLength(size_t length) const
+{
+  // The number of outputs of a stage only depends on its phase and the number of inputs, not on the block sizes:
+  for(std::vector<FilterStage*>::const_iterator it = m_stages.begin(); it != m_stages.end(); ++it)
+    length = (*it)->outputLength(length);
+  return length;
+}
+
+void FilterChain::process(const float* input, size_t length, float* output)
+{
+  if(m_stages.empty())
+  {
+    std::copy(input, input + length, output);
+    return;
+  }
+
+  for(size_t begin = 0; begin < length; begin += FILTER_BLOCK_SIZE)
+  {
+    size_t count = std::min<size_t>(length - begin, FILTER_BLOCK_SIZE);
+    const float* in = input + begin;
+    for(size_t s = 0; s < m_stages.size(); ++s)
+    {
+      float* out = s + 1 == m_stages.size() ? output : &m_buffers[s][0];
+      const size_t outputCount = m_stages[s]->outputLength(count);
+      m_stages[s]->process(in, count, out);
+      in = out;
+      count = outputCount;
+    }
+    output += count;
+  }
+}
+
+void FilterChain::reset()
+{
+  for(std::vector<FilterStage*>::iterator it = m_stages.begin(); it != m_stages.end(); ++it)
+    (*it)->reset();
+}
+
+uint32_t FilterChain::decimation() const
+{
+  uint32_t result = 1;
+  for(std::vector<FilterStage*>::const_iterator it = m_stages.begin(); it != m_stages.end(); ++it)
+    result *= (*it)->decimation();
+  return result;
+}
+
+static v8::Local<v8::Value> getValue(v8::Local<v8::Object> options, const char* name)
+{
+  return Nan::Get(options, Nan::New<v8::String>(name).ToLocalChecked()).ToLocalChecked();
+}
+
+static uint32_t getOption(v8::Local<v8::Object> options, const char* name, uint32_t defaultValue)
+{
+  v8::Local<v8::Value> value = getValue(options, name);
+  return value->IsUndefined() ? defaultValue : Nan::To<uint32_t>(value).FromJust();
+}
+
+/**
+ * Create a stage from its options, see Filter::New.
+ * \return The stage or null, with \p error set.
+ */
+static FilterStage* createStage(v8::Local<v8::Value> value, std::string& error)
+{
+  if(!value->IsObject())
+  {
+    error = "Invalid stage, expected an object";
+    return 0;
+  }
+  v8::Local<v8::Object> options = value.As<v8::Object>();
+  const std::string type(*Nan::Utf8String(getValue(options, "type")));
+
+  if(type == "fir")
+  {
+    FloatArrayArgument coefficients;
+    if(!coefficients.assign(getValue(options, "coefficients")) || coefficients.length() == 0 || coefficients.length() > 65536)
+    {
+      error = "Invalid FIR coefficients";
+      return 0;
+    }
+    const uint32_t decimation = getOption(options, "decimation", 1);
+    if(decimation < 1 || decimation > 65536)
+    {
+      error = "Invalid decimation";
+      return 0;
+    }
+    return new FirStage(std::vector<float>(coefficients.data(), coefficients.data() + coefficients.length()), decimation);
+  }
+  else if(type == "biquad")
+  {
+    v8::Local<v8::Value> sectionsValue = getValue(options, "sections");
+    if(!sectionsValue->IsArray())
+    {
+      error = "Invalid biquad sections, expected an array";
+      return 0;
+    }
+    v8::Local<v8::Array> sections = sectionsValue.As<v8::Array>();
+    std::vector<BiquadStage::Section> result(sections->Length());
+    for(uint32_t i = 0; i < sections->Length(); ++i)
+    {
+      // Read in double precision, float coefficients move the poles of narrow low-pass sections too far:
+      v8::Local<v8::Value> section = Nan::Get(sections, i).ToLocalChecked();
+      double sos[6];
+      bool valid = (section->IsArray() || section->IsTypedArray()) && Nan::To<uint32_t>(getValue(section.As<v8::Object>(), "length")).FromJust() == 6;
+      for(uint32_t j = 0; valid && j < 6; ++j)
+      {
+        sos[j] = Nan::To<double>(Nan::Get(section.As<v8::Object>(), j).ToLocalChecked()).FromJust();
+        valid = std::isfinite(sos[j]);
+      }
+      if(!valid || sos[3] == 0)
+      {
+        error = "Invalid biquad section, expected [b0, b1, b2, a0, a1, a2]";
+        return 0;
+      }
+      result[i].b0 = sos[0] / sos[3];
+      result[i].b1 = sos[1] / sos[3];
+      result[i].b2 = sos[2] / sos[3];
+      result[i].a1 = sos[4] / sos[3];
+      result[i].a2 = sos[5] / sos[3];
+    }
+    return new BiquadStage(result);
+  }
+  else if(type == "cic")
+  {
+    const uint32_t decimation = getOption(options, "decimation", 0);
+    const uint32_t order = getOption(options, "order", 3);
+    v8::Local<v8::Value> rangeValue = getValue(options, "range");
+    const double range = rangeValue->IsUndefined() ? 1.0 : Nan::To<double>(rangeValue).FromJust();
+    if(decimation < 2 || decimation > 65536)
+      error = "Invalid decimation";
+    else if(order < 1 || order > 8)
+      error = "Invalid CIC order";
+    else if(!(range > 0) || std::isinf(range))
+      error = "Invalid range";
+    else if(CicStage::fractionBits(decimation, order, range) < 0)
+      error = "CIC gain too large for the range";
+    else
+      return new CicStage(decimation, order, range);
+    return 0;
+  }
+
+  error = "Invalid stage type, expected fir, biquad or cic";
+  return 0;
+}
+
+/**
+ * Check the data passed to process() and create the output arrays.
+ * \return \c false on invalid data, with \p error set.
+ */
+static bool prepare(std::vector<FilterChain>& chains, v8::Local<v8::Value> value, std::vector<FloatArrayArgument>& inputs, std::vector<float*>& outputs, v8::Local<v8::Array>& result, std::string& error)
+{
+  if(!value->IsArray())
+  {
+    error = "Invalid data, expected an array";
+    return false;
+  }
+  v8::Local<v8::Array> data = value.As<v8::Array>();
+  if(data->Length() > chains.size())
+  {
+    error = "Invalid data, more arrays than channels";
+    return false;
+  }
+
+  inputs.resize(data->Length());
+  outputs.assign(data->Length(), (float*)0);
+  result = Nan::New<v8::Array>(data->Length());
+  for(uint32_t ch = 0; ch < data->Length(); ++ch)
+  {
+    v8::Local<v8::Value> item = Nan::Get(data, ch).ToLocalChecked();
+    if(item->IsNullOrUndefined())
+    {
+      Nan::Set(result, ch, Nan::Null());
+      continue;
+    }
+    if(!inputs[ch].assign(item))
+    {
+      error = "Invalid data, expected an array";
+      return false;
+    }
+    Nan::Set(result, ch, NewFloat32Array(chains[ch].outputLength(inputs[ch].length()), outputs[ch]));
+  }
+  return true;
+}
+
+static void processChannels(std::vector<FilterChain>& chains, const std::vector<FloatArrayArgument>& inputs, const std::vector<float*>& outputs)
+{
+  size_t total = 0;
+  for(size_t ch = 0; ch < inputs.size(); ++ch)
+    if(outputs[ch])
+      total += inputs[ch].length();
+
+  std::vector<std::thread> threads;
+  for(size_t ch = 0; ch < inputs.size(); ++ch)
+  {
+    if(!outputs[ch])
+      continue;
+    if(total >= FILTER_PARALLEL_SAMPLES && ch + 1 < inputs.size())
+      threads.push_back(std::thread(&FilterChain::process, &chains[ch], inputs[ch].data(), inputs[ch].length(), outputs[ch]));
+    else
+      chains[ch].process(inputs[ch].data(), inputs[ch].length(), outputs[ch]);
+  }
+
+  for(std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it)
+    it->join();
+}
+
+class FilterProcessWorker : public Nan::AsyncWorker
+{
+  public:
+    FilterProcessWorker(Nan::Callback* callback, Filter* filter, v8::Local<v8::Object> self, v8::Local<v8::Value> data, std::vector<FloatArrayArgument>& inputs, const std::vector<float*>& outputs, v8::Local<v8::Array> result) :
+      Nan::AsyncWorker(callback),
+      m_filter(filter),
+      m_outputs(outputs)
+    {
+      m_inputs.swap(inputs);
+      SaveToPersistent("self", self);
+      SaveToPersistent("data", data);
+      SaveToPersistent("result", result);
+    }
+
+    void Execute()
+    {
+      processChannels(m_filter->m_chains, m_inputs, m_outputs);
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      m_filter->m_busy = false;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), GetFromPersistent("result")};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    Filter* m_filter;
+    std::vector<FloatArrayArgument> m_inputs;
+    std::vector<float*> m_outputs;
+};
+
+NAN_MODULE_INIT(Filter::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("Filter").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "process", Process);
+  Nan::SetPrototypeMethod(tpl, "reset", Reset);
+
+  Nan::Set(target, Nan::New<v8::String>("Filter").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+Filter::Filter(uint16_t channelCount, const FilterChain& chain) :
+  m_chains(channelCount, chain),
+  m_busy(false)
+{
+}
+
+/**
+ * new Filter(channelCount, stages), stages is a stage or an array of stages applied in order, each channel gets its
+ * own state. Stages:
+ *  - {type: 'fir', coefficients, decimation = 1}
+ *  - {type: 'biquad', sections}, sections holds [b0, b1, b2, a0, a1, a2] per second order section
+ *  - {type: 'cic', decimation, order = 3, range = 1}, range is the largest input magnitude, larger inputs are clipped
+ */
+NAN_METHOD(Filter::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowTypeError("Filter must be called with new");
+  CHECK_PARAMETER_COUNT(2);
+
+  const uint32_t channelCount = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(channelCount, 1, std::numeric_limits<uint16_t>::max());
+
+  FilterChain chain;
+  std::string error;
+  if(info[1]->IsArray())
+  {
+    v8::Local<v8::Array> stages = info[1].As<v8::Array>();
+    for(uint32_t i = 0; i < stages->Length() && error.empty(); ++i)
+      if(FilterStage* stage = createStage(Nan::Get(stages, i).ToLocalChecked(), error))
+        chain.add(stage);
+  }
+  else if(FilterStage* stage = createStage(info[1], error))
+    chain.add(stage);
+  if(!error.empty())
+    return Nan::ThrowTypeError(error.c_str());
+
+  Filter* filter = new Filter((uint16_t)channelCount, chain);
+  filter->Wrap(info.This());
+  Nan::DefineOwnProperty(info.This(), Nan::New<v8::String>("decimation").ToLocalChecked(), Nan::New<v8::Uint32>(chain.decimation()), v8::ReadOnly);
+
+  info.GetReturnValue().Set(info.This());
+}
+
+/**
+ * process(data[, callback]), data has an array per channel or null, the next chunk of each channel. Returns, or passes
+ * to the callback, a Float32Array per channel with the filtered samples, shorter when decimating. With a callback the
+ * channels are filtered on a worker thread, the next chunk can be passed once the callback is called.
+ */
+NAN_METHOD(Filter::Process)
+{
+  if(info.Length() < 1 || info.Length() > 2)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+  if(info.Length() > 1 && !info[1]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  Filter* filter = Nan::ObjectWrap::Unwrap<Filter>(info.Holder());
+  if(filter->m_busy)
+    return Nan::ThrowError("Filter is busy");
+
+  std::vector<FloatArrayArgument> inputs;
+  std::vector<float*> outputs;
+  v8::Local<v8::Array> result;
+  std::string error;
+  if(!prepare(filter->m_chains, info[0], inputs, outputs, result, error))
+    return Nan::ThrowTypeError(error.c_str());
+
+  if(info.Length() > 1)
+  {
+    filter->m_busy = true;
+    Nan::Callback* callback = new Nan::Callback(info[1].As<v8::Function>());
+    Nan::AsyncQueueWorker(new FilterProcessWorker(callback, filter, info.Holder(), info[0], inputs, outputs, result));
+    info.GetReturnValue().SetUndefined();
+  }
+  else
+  {
+    processChannels(filter->m_chains, inputs, outputs);
+    info.GetReturnValue().Set(result);
+  }
+}
+
+/**
+ * reset(), clears the state of all channels, as if no data was filtered yet.
+ */
+NAN_METHOD(Filter::Reset)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Filter* filter = Nan::ObjectWrap::Unwrap<Filter>(info.Holder());
+  if(filter->m_busy)
+    return Nan::ThrowError("Filter is busy");
+
+  for(std::vector<FilterChain>::iterator it = filter->m_chains.begin(); it != filter->m_chains.end(); ++it)
+    it->reset();
+
+  info.GetReturnValue().SetUndefined();
+}
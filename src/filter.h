@@ -0,0 +1,172 @@
+/**
+ * \file filter.h
+ * \brief Streaming FIR, biquad IIR and CIC filters, keeping their state from one chunk to the next.
+ *
+ * A filter is a chain of stages, each channel has its own copy of the chain. Stages that decimate keep their phase
+ * across chunks, so filtering a stream chunk by chunk gives the same samples as filtering it at once.
+ */
+
+#ifndef _FILTER_H_
+#define _FILTER_H_
+
+#include "common.h"
+#include <atomic>
+
+#define FILTER_BLOCK_SIZE  4096 //!< Samples per block, blocks of all stages stay in the cache.
+
+class FilterStage
+{
+  public:
+    virtual ~FilterStage()
+    {
+    }
+
+    virtual FilterStage* clone() const = 0;
+
+    /**
+     * Number of samples process() returns for \p length input samples, in the current state.
+     */
+    virtual size_t outputLength(size_t length) const = 0;
+
+    /**
+     * Filter \p length samples of \p input into \p output, which holds outputLength(length) samples.
+     */
+    virtual void process(const float* input, size_t length, float* output) = 0;
+
+    virtual void reset() = 0;
+
+    virtual uint32_t decimation() const
+    {
+      return 1;
+    }
+};
+
+/**
+ * FIR filter, computing only the samples kept after decimation.
+ */
+class FirStage : public FilterStage
+{
+  public:
+    FirStage(const std::vector<float>& coefficients, uint32_t decimation);
+
+    FilterStage* clone() const;
+    size_t outputLength(size_t length) const;
+    void process(const float* input, size_t length, float* output);
+    void reset();
+
+    uint32_t decimation() const
+    {
+      return m_decimation;
+    }
+
+  private:
+    std::vector<float> m_coefficients; //!< Reversed, so an output is a dot product with the input.
+    uint32_t m_decimation;
+    size_t m_skip; //!< Input samples before the next output.
+    std::vector<float> m_buffer; //!< The last taps - 1 input samples, followed by a block of new ones.
+};
+
+/**
+ * Cascade of second order sections in transposed direct form II, with the state in double precision.
+ */
+class BiquadStage : public FilterStage
+{
+  public:
+    struct Section
+    {
+      double b0;
+      double b1;
+      double b2;
+      double a1;
+      double a2;
+      double s1;
+      double s2;
+    };
+
+    explicit BiquadStage(const std::vector<Section>& sections);
+
+    FilterStage* clone() const;
+    size_t outputLength(size_t length) const;
+    void process(const float* input, size_t length, float* output);
+    void reset();
+
+  private:
+    std::vector<Section> m_sections;
+};
+
+/**
+ * Cascaded integrator comb decimator with a gain of one. The input is converted to fixed point, scaled so \p range
+ * times the CIC gain fits 63 bits, and the integrators wrap around as the CIC allows.
+ */
+class CicStage : public FilterStage
+{
+  public:
+    CicStage(uint32_t decimation, uint32_t order, double range);
+
+    /**
+     * Number of fractional bits of the fixed point input, negative if the gain is too large for the range.
+     */
+    static int fractionBits(uint32_t decimation, uint32_t order, double range);
+
+    FilterStage* clone() const;
+    size_t outputLength(size_t length) const;
+    void process(const float* input, size_t length, float* output);
+    void reset();
+
+    uint32_t decimation() const
+    {
+      return m_decimation;
+    }
+
+  private:
+    uint32_t m_decimation;
+    double m_range;
+    double m_inputScale;
+    double m_outputScale;
+    uint32_t m_phase; //!< Input samples since the last output.
+    std::vector<uint64_t> m_integrators;
+    std::vector<uint64_t> m_combs; //!< Previous input of each comb.
+};
+
+class FilterChain
+{
+  public:
+    FilterChain()
+    {
+    }
+
+    FilterChain(const FilterChain& other);
+    ~FilterChain();
+
+    void add(FilterStage* stage);
+    size_t outputLength(size_t length) const;
+    void process(const float* input, size_t length, float* output);
+    void reset();
+    uint32_t decimation() const;
+
+  private:
+    FilterChain& operator=(const FilterChain&);
+
+    std::vector<FilterStage*> m_stages;
+    std::vector<std::vector<float> > m_buffers; //!< Output of each stage but the last, for a block.
+};
+
+class Filter : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    Filter(uint16_t channelCount, const FilterChain& chain);
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Process);
+    static NAN_METHOD(Reset);
+
+    friend class FilterProcessWorker;
+
+    std::vector<FilterChain> m_chains;
+    std::atomic<bool> m_busy; //!< Set while a worker filters, chunks must be filtered in order.
+};
+
+#endif
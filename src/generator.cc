@@ -0,0 +1,206 @@
+/**
+ * \file generator.cc
+ * \brief Object oriented generator interface.
+ */
+
+#include "generator.h"
+#include "capabilitycache.h"
+#include "instance.h"
+
+OBJECT_GETTER(Generator, GetConnectorType, uint32_t, GenGetConnectorType(handle))
+OBJECT_GETTER(Generator, GetIsDifferential, bool, GenIsDifferential(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Generator, GetImpedance, double, GenGetImpedance(handle))
+OBJECT_GETTER(Generator, GetResolution, uint32_t, GenGetResolution(handle))
+OBJECT_GETTER(Generator, GetOutputValueMin, double, GenGetOutputValueMin(handle))
+OBJECT_GETTER(Generator, GetOutputValueMax, double, GenGetOutputValueMax(handle))
+OBJECT_GETTER(Generator, GetIsControllable, bool, GenIsControllable(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Generator, GetIsRunning, bool, GenIsRunning(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Generator, GetStatus, uint32_t, GenGetStatus(handle))
+OBJECT_GETTER(Generator, GetOutputOn, bool, GenGetOutputOn(handle) != BOOL8_FALSE)
+OBJECT_SETTER(Generator, SetOutputOn, bool, GenSetOutputOn(handle, value ? BOOL8_TRUE : BOOL8_FALSE))
+OBJECT_GETTER(Generator, GetHasOutputInvert, bool, GenHasOutputInvert(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Generator, GetOutputInvert, bool, GenGetOutputInvert(handle) != BOOL8_FALSE)
+OBJECT_SETTER(Generator, SetOutputInvert, bool, GenSetOutputInvert(handle, value ? BOOL8_TRUE : BOOL8_FALSE))
+OBJECT_GETTER(Generator, GetSignalTypes, uint32_t, GenGetSignalTypes(handle))
+OBJECT_GETTER(Generator, GetSignalType, uint32_t, GenGetSignalType(handle))
+OBJECT_SETTER(Generator, SetSignalType, uint32_t, GenSetSignalType(handle, value))
+OBJECT_GETTER(Generator, GetHasAmplitude, bool, GenHasAmplitude(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Generator, GetAmplitudeMin, double, GenGetAmplitudeMin(handle))
+OBJECT_GETTER(Generator, GetAmplitudeMax, double, GenGetAmplitudeMax(handle))
+OBJECT_GETTER(Generator, GetAmplitude, double, GenGetAmplitude(handle))
+OBJECT_SETTER(Generator, SetAmplitude, double, GenSetAmplitude(handle, value))
+OBJECT_GETTER(Generator, GetAmplitudeRange, double, GenGetAmplitudeRange(handle))
+OBJECT_SETTER(Generator, SetAmplitudeRange, double, GenSetAmplitudeRange(handle, value))
+OBJECT_GETTER(Generator, GetAmplitudeAutoRanging, bool, GenGetAmplitudeAutoRanging(handle) != BOOL8_FALSE)
+OBJECT_SETTER(Generator, SetAmplitudeAutoRanging, bool, GenSetAmplitudeAutoRanging(handle, value ? BOOL8_TRUE : BOOL8_FALSE))
+OBJECT_GETTER(Generator, GetHasOffset, bool, GenHasOffset(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Generator, GetOffsetMin, double, GenGetOffsetMin(handle))
+OBJECT_GETTER(Generator, GetOffsetMax, double, GenGetOffsetMax(handle))
+OBJECT_GETTER(Generator, GetOffset, double, GenGetOffset(handle))
+OBJECT_SETTER(Generator, SetOffset, double, GenSetOffset(handle, value))
+OBJECT_GETTER(Generator, GetFrequencyModes, uint32_t, GenGetFrequencyModes(handle))
+OBJECT_GETTER(Generator, GetFrequencyMode, uint32_t, GenGetFrequencyMode(handle))
+OBJECT_SETTER(Generator, SetFrequencyMode, uint32_t, GenSetFrequencyMode(handle, value))
+OBJECT_GETTER(Generator, GetHasFrequency, bool, GenHasFrequency(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Generator, GetFrequencyMin, double, GenGetFrequencyMin(handle))
+OBJECT_GETTER(Generator, GetFrequencyMax, double, GenGetFrequencyMax(handle))
+OBJECT_GETTER(Generator, GetFrequency, double, GenGetFrequency(handle))
+OBJECT_SETTER(Generator, SetFrequency, double, GenSetFrequency(handle, value))
+OBJECT_GETTER(Generator, GetHasPhase, bool, GenHasPhase(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Generator, GetPhaseMin, double, GenGetPhaseMin(handle))
+OBJECT_GETTER(Generator, GetPhaseMax, double, GenGetPhaseMax(handle))
+OBJECT_GETTER(Generator, GetPhase, double, GenGetPhase(handle))
+OBJECT_SETTER(Generator, SetPhase, double, GenSetPhase(handle, value))
+OBJECT_GETTER(Generator, GetHasSymmetry, bool, GenHasSymmetry(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Generator, GetSymmetryMin, double, GenGetSymmetryMin(handle))
+OBJECT_GETTER(Generator, GetSymmetryMax, double, GenGetSymmetryMax(handle))
+OBJECT_GETTER(Generator, GetSymmetry, double, GenGetSymmetry(handle))
+OBJECT_SETTER(Generator, SetSymmetry, double, GenSetSymmetry(handle, value))
+OBJECT_GETTER(Generator, GetHasWidth, bool, GenHasWidth(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Generator, GetWidthMin, double, GenGetWidthMin(handle))
+OBJECT_GETTER(Generator, GetWidthMax, double, GenGetWidthMax(handle))
+OBJECT_GETTER(Generator, GetWidth, double, GenGetWidth(handle))
+OBJECT_SETTER(Generator, SetWidth, double, GenSetWidth(handle, value))
+OBJECT_GETTER(Generator, GetHasData, bool, GenHasData(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Generator, GetDataLengthMin, double, (double)GenGetDataLengthMin(handle))
+OBJECT_GETTER(Generator, GetDataLengthMax, double, (double)GenGetDataLengthMax(handle))
+OBJECT_GETTER(Generator, GetDataLength, double, (double)GenGetDataLength(handle))
+OBJECT_GETTER(Generator, GetModes, double, (double)GenGetModes(handle))
+OBJECT_GETTER(Generator, GetMode, double, (double)GenGetMode(handle))
+OBJECT_SETTER(Generator, SetMode, double, GenSetMode(handle, (uint64_t)value))
+OBJECT_GETTER(Generator, GetBurstCountMin, double, (double)GenGetBurstCountMin(handle))
+OBJECT_GETTER(Generator, GetBurstCountMax, double, (double)GenGetBurstCountMax(handle))
+OBJECT_GETTER(Generator, GetBurstCount, double, (double)GenGetBurstCount(handle))
+OBJECT_SETTER(Generator, SetBurstCount, double, GenSetBurstCount(handle, (uint64_t)value))
+OBJECT_GETTER(Generator, Start, bool, GenStart(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Generator, Stop, bool, GenStop(handle) != BOOL8_FALSE)
+
+static NAN_METHOD(GetAmplitudeRanges)
+{
+  OBJECT_HANDLE(Generator);
+  v8::Local<v8::TypedArray> result;
+  if(!CapabilityCache::getGenAmplitudeRanges(handle, result))
+    CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set(result);
+}
+
+/**
+ * setData(data), data is a Float32Array or an array-like of numbers.
+ */
+static NAN_METHOD(SetData)
+{
+  CHECK_PARAMETER_COUNT(1);
+  OBJECT_HANDLE(Generator);
+  FloatArrayArgument data;
+  if(!data.assign(info[0]))
+    return Nan::ThrowTypeError("Invalid data");
+
+  GenSetData(handle, data.data(), data.length());
+  CHECK_LAST_STATUS();
+}
+
+NAN_MODULE_INIT(Generator::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("Generator").ToLocalChecked());
+  Device::initPrototype(tpl);
+
+  Nan::SetPrototypeMethod(tpl, "start", Start);
+  Nan::SetPrototypeMethod(tpl, "stop", Stop);
+  Nan::SetPrototypeMethod(tpl, "setData", SetData);
+
+  setAccessor(tpl, "connectorType", GetConnectorType);
+  setAccessor(tpl, "isDifferential", GetIsDifferential);
+  setAccessor(tpl, "impedance", GetImpedance);
+  setAccessor(tpl, "resolution", GetResolution);
+  setAccessor(tpl, "outputValueMin", GetOutputValueMin);
+  setAccessor(tpl, "outputValueMax", GetOutputValueMax);
+  setAccessor(tpl, "isControllable", GetIsControllable);
+  setAccessor(tpl, "isRunning", GetIsRunning);
+  setAccessor(tpl, "status", GetStatus);
+  setAccessor(tpl, "outputOn", GetOutputOn, SetOutputOn);
+  setAccessor(tpl, "hasOutputInvert", GetHasOutputInvert);
+  setAccessor(tpl, "outputInvert", GetOutputInvert, SetOutputInvert);
+  setAccessor(tpl, "signalTypes", GetSignalTypes);
+  setAccessor(tpl, "signalType", GetSignalType, SetSignalType);
+  setAccessor(tpl, "hasAmplitude", GetHasAmplitude);
+  setAccessor(tpl, "amplitudeMin", GetAmplitudeMin);
+  setAccessor(tpl, "amplitudeMax", GetAmplitudeMax);
+  setAccessor(tpl, "amplitude", GetAmplitude, SetAmplitude);
+  setAccessor(tpl, "amplitudeRanges", GetAmplitudeRanges);
+  setAccessor(tpl, "amplitudeRange", GetAmplitudeRange, SetAmplitudeRange);
+  setAccessor(tpl, "amplitudeAutoRanging", GetAmplitudeAutoRanging, SetAmplitudeAutoRanging);
+  setAccessor(tpl, "hasOffset", GetHasOffset);
+  setAccessor(tpl, "offsetMin", GetOffsetMin);
+  setAccessor(tpl, "offsetMax", GetOffsetMax);
+  setAccessor(tpl, "offset", GetOffset, SetOffset);
+  setAccessor(tpl, "frequencyModes", GetFrequencyModes);
+  setAccessor(tpl, "frequencyMode", GetFrequencyMode, SetFrequencyMode);
+  setAccessor(tpl, "hasFrequency", GetHasFrequency);
+  setAccessor(tpl, "frequencyMin", GetFrequencyMin);
+  setAccessor(tpl, "frequencyMax", GetFrequencyMax);
+  setAccessor(tpl, "frequency", GetFrequency, SetFrequency);
+  setAccessor(tpl, "hasPhase", GetHasPhase);
+  setAccessor(tpl, "phaseMin", GetPhaseMin);
+  setAccessor(tpl, "phaseMax", GetPhaseMax);
+  setAccessor(tpl, "phase", GetPhase, SetPhase);
+  setAccessor(tpl, "hasSymmetry", GetHasSymmetry);
+  setAccessor(tpl, "symmetryMin", GetSymmetryMin);
+  setAccessor(tpl, "symmetryMax", GetSymmetryMax);
+  setAccessor(tpl, "symmetry", GetSymmetry, SetSymmetry);
+  setAccessor(tpl, "hasWidth", GetHasWidth);
+  setAccessor(tpl, "widthMin", GetWidthMin);
+  setAccessor(tpl, "widthMax", GetWidthMax);
+  setAccessor(tpl, "width", GetWidth, SetWidth);
+  setAccessor(tpl, "hasData", GetHasData);
+  setAccessor(tpl, "dataLengthMin", GetDataLengthMin);
+  setAccessor(tpl, "dataLengthMax", GetDataLengthMax);
+  setAccessor(tpl, "dataLength", GetDataLength);
+  setAccessor(tpl, "modes", GetModes);
+  setAccessor(tpl, "mode", GetMode, SetMode);
+  setAccessor(tpl, "burstCountMin", GetBurstCountMin);
+  setAccessor(tpl, "burstCountMax", GetBurstCountMax);
+  setAccessor(tpl, "burstCount", GetBurstCount, SetBurstCount);
+
+  Nan::SetMethod(tpl, "open", Open);
+
+  v8::Local<v8::Function> constructor = Nan::GetFunction(tpl).ToLocalChecked();
+  Instance::current()->generator.Reset(constructor);
+
+  Nan::Set(target, Nan::New<v8::String>("Generator").ToLocalChecked(), constructor);
+}
+
+NAN_METHOD(Generator::New)
+{
+  LibTiePieHandle_t handle;
+  if(!getHandle(info, LIBTIEPIE_INTERFACE_GENERATOR, handle))
+    return;
+
+  Generator* obj = new Generator(handle);
+  obj->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(Generator::Open)
+{
+  CHECK_PARAMETER_COUNT(2);
+  const uint32_t idKind = Nan::To<uint32_t>(info[0]).FromJust();
+  const uint32_t id = Nan::To<uint32_t>(info[1]).FromJust();
+
+  const LibTiePieHandle_t handle = LstOpenGenerator(idKind, id);
+  CHECK_LAST_STATUS();
+  CapabilityCache::open(handle);
+
+  v8::Local<v8::Value> argv[] = {Nan::New<v8::Uint32>(handle)};
+  v8::Local<v8::Object> result;
+  if(!Nan::NewInstance(Nan::New(Instance::current()->generator), 1, argv).ToLocal(&result))
+  {
+    CapabilityCache::remove(handle);
+    ObjClose(handle);
+    return;
+  }
+
+  info.GetReturnValue().Set(result);
+}
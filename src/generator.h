@@ -0,0 +1,26 @@
+/**
+ * \file generator.h
+ * \brief Object oriented generator interface.
+ */
+
+#ifndef _GENERATOR_H_
+#define _GENERATOR_H_
+
+#include "object.h"
+
+class Generator : public Device
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    explicit Generator(LibTiePieHandle_t handle) :
+      Device(handle)
+    {
+    }
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Open);
+};
+
+#endif
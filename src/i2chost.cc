@@ -0,0 +1,131 @@
+/**
+ * \file i2chost.cc
+ * \brief Object oriented I2C host interface.
+ */
+
+#include "i2chost.h"
+#include "capabilitycache.h"
+#include "instance.h"
+
+OBJECT_GETTER(I2CHost, GetSpeedMax, double, I2CGetSpeedMax(handle))
+OBJECT_GETTER(I2CHost, GetSpeed, double, I2CGetSpeed(handle))
+OBJECT_SETTER(I2CHost, SetSpeed, double, I2CSetSpeed(handle, value))
+
+static NAN_METHOD(IsInternalAddress)
+{
+  CHECK_PARAMETER_COUNT(1);
+  OBJECT_HANDLE(I2CHost);
+  const bool8_t result = I2CIsInternalAddress(handle, (uint16_t)Nan::To<uint32_t>(info[0]).FromJust());
+  CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set(result != BOOL8_FALSE);
+}
+
+/**
+ * read(address, length[, stop = true]), returns an Uint8Array.
+ */
+static NAN_METHOD(Read)
+{
+  if(info.Length() < 2 || info.Length() > 3)
+    return Nan::ThrowError("Invalid number of parameters");
+  OBJECT_HANDLE(I2CHost);
+  const uint16_t address = (uint16_t)Nan::To<uint32_t>(info[0]).FromJust();
+  const uint32_t length = Nan::To<uint32_t>(info[1]).FromJust();
+  const bool stop = info.Length() < 3 || Nan::To<bool>(info[2]).FromJust();
+
+  v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), length);
+  v8::Local<v8::Uint8Array> result = v8::Uint8Array::New(buffer, 0, length);
+  Nan::TypedArrayContents<uint8_t> contents(result);
+  I2CRead(handle, address, *contents, length, stop ? BOOL8_TRUE : BOOL8_FALSE);
+  CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set(result);
+}
+
+/**
+ * write(address, data[, stop = true]), data is an Uint8Array, Buffer or array of bytes.
+ */
+static NAN_METHOD(Write)
+{
+  if(info.Length() < 2 || info.Length() > 3)
+    return Nan::ThrowError("Invalid number of parameters");
+  OBJECT_HANDLE(I2CHost);
+  const uint16_t address = (uint16_t)Nan::To<uint32_t>(info[0]).FromJust();
+  const bool stop = info.Length() < 3 || Nan::To<bool>(info[2]).FromJust();
+
+  std::vector<uint8_t> data;
+  if(info[1]->IsUint8Array())
+  {
+    Nan::TypedArrayContents<uint8_t> contents(info[1]);
+    data.assign(*contents, *contents + contents.length());
+  }
+  else if(info[1]->IsArray())
+  {
+    v8::Local<v8::Array> array = info[1].As<v8::Array>();
+    data.resize(array->Length());
+    for(uint32_t i = 0; i < data.size(); ++i)
+      data[i] = (uint8_t)Nan::To<uint32_t>(Nan::Get(array, i).ToLocalChecked()).FromJust();
+  }
+  else
+    return Nan::ThrowTypeError("Invalid data");
+
+  const bool8_t result = I2CWrite(handle, address, data.empty() ? 0 : &data[0], (uint32_t)data.size(), stop ? BOOL8_TRUE : BOOL8_FALSE);
+  CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set(result != BOOL8_FALSE);
+}
+
+NAN_MODULE_INIT(I2CHost::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("I2CHost").ToLocalChecked());
+  Device::initPrototype(tpl);
+
+  Nan::SetPrototypeMethod(tpl, "isInternalAddress", IsInternalAddress);
+  Nan::SetPrototypeMethod(tpl, "read", Read);
+  Nan::SetPrototypeMethod(tpl, "write", Write);
+
+  setAccessor(tpl, "speedMax", GetSpeedMax);
+  setAccessor(tpl, "speed", GetSpeed, SetSpeed);
+
+  Nan::SetMethod(tpl, "open", Open);
+
+  v8::Local<v8::Function> constructor = Nan::GetFunction(tpl).ToLocalChecked();
+  Instance::current()->i2cHost.Reset(constructor);
+
+  Nan::Set(target, Nan::New<v8::String>("I2CHost").ToLocalChecked(), constructor);
+}
+
+NAN_METHOD(I2CHost::New)
+{
+  LibTiePieHandle_t handle;
+  if(!getHandle(info, LIBTIEPIE_INTERFACE_I2CHOST, handle))
+    return;
+
+  I2CHost* obj = new I2CHost(handle);
+  obj->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(I2CHost::Open)
+{
+  CHECK_PARAMETER_COUNT(2);
+  const uint32_t idKind = Nan::To<uint32_t>(info[0]).FromJust();
+  const uint32_t id = Nan::To<uint32_t>(info[1]).FromJust();
+
+  const LibTiePieHandle_t handle = LstOpenI2CHost(idKind, id);
+  CHECK_LAST_STATUS();
+  CapabilityCache::open(handle);
+
+  v8::Local<v8::Value> argv[] = {Nan::New<v8::Uint32>(handle)};
+  v8::Local<v8::Object> result;
+  if(!Nan::NewInstance(Nan::New(Instance::current()->i2cHost), 1, argv).ToLocal(&result))
+  {
+    CapabilityCache::remove(handle);
+    ObjClose(handle);
+    return;
+  }
+
+  info.GetReturnValue().Set(result);
+}
@@ -0,0 +1,26 @@
+/**
+ * \file i2chost.h
+ * \brief Object oriented I2C host interface.
+ */
+
+#ifndef _I2CHOST_H_
+#define _I2CHOST_H_
+
+#include "object.h"
+
+class I2CHost : public Device
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    explicit I2CHost(LibTiePieHandle_t handle) :
+      Device(handle)
+    {
+    }
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Open);
+};
+
+#endif
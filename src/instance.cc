@@ -0,0 +1,81 @@
+/**
+ * \file instance.cc
+ * \brief State of an addon instance.
+ */
+
+#include "instance.h"
+#include "capabilitycache.h"
+#include <mutex>
+
+// A worker's environment runs on a single thread for its whole lifetime:
+static thread_local Instance* t_instance = 0;
+
+static std::mutex g_mutex;
+static unsigned g_libInitCount = 0;
+
+// node::AddEnvironmentCleanupHook() was added in Node.js 10.2:
+#if NODE_MAJOR_VERSION > 10 || (NODE_MAJOR_VERSION == 10 && NODE_MINOR_VERSION >= 2)
+  #define HAVE_ENVIRONMENT_CLEANUP_HOOK
+#endif
+
+Instance::Instance() :
+  m_libInitialized(false)
+{
+}
+
+Instance::~Instance()
+{
+  if(t_instance == this)
+    t_instance = 0;
+
+  if(!m_libInitialized)
+    return;
+
+  std::lock_guard<std::mutex> lock(g_mutex);
+  if(--g_libInitCount == 0)
+  {
+    CapabilityCache::clear();
+
+    if(LibIsInitialized() == BOOL8_TRUE)
+      LibExit();
+
+#ifdef _MSC_VER
+    LibTiePieUnload();
+#endif
+  }
+}
+
+Instance* Instance::create()
+{
+  Instance* instance = new Instance();
+  t_instance = instance;
+
+#ifdef HAVE_ENVIRONMENT_CLEANUP_HOOK
+  node::AddEnvironmentCleanupHook(v8::Isolate::GetCurrent(), cleanup, instance);
+#else
+  node::AtExit(cleanup, instance);
+#endif
+
+  return instance;
+}
+
+Instance* Instance::current()
+{
+  return t_instance;
+}
+
+void Instance::libInit()
+{
+  if(m_libInitialized)
+    return;
+
+  std::lock_guard<std::mutex> lock(g_mutex);
+  if(g_libInitCount++ == 0)
+    LibInit();
+  m_libInitialized = true;
+}
+
+void Instance::cleanup(void* arg)
+{
+  delete static_cast<Instance*>(arg);
+}
@@ -0,0 +1,72 @@
+/**
+ * \file instance.h
+ * \brief State of an addon instance.
+ *
+ * The addon is instantiated once by the main thread and once by every worker thread that requires it. JavaScript
+ * values belong to the isolate they were created in, so they are kept per instance. LibTiePie itself is process wide:
+ * it is initialized by the first instance and exited when the last instance is torn down.
+ */
+
+#ifndef _INSTANCE_H_
+#define _INSTANCE_H_
+
+#include "common.h"
+#include <map>
+
+/**
+ * JavaScript values the capability cache handed out for a handle.
+ */
+struct HandleValues
+{
+  HandleValues() :
+    id(0)
+  {
+  }
+
+  uint64_t id; //!< Capability cache entry the values belong to, a reused handle gets a new entry.
+  std::map<uint32_t, Nan::Global<v8::TypedArray> > arrays;
+  std::map<uint32_t, Nan::Global<v8::String> > strings;
+};
+
+class Instance
+{
+  public:
+    /**
+     * Create the instance of the calling thread, it is deleted when its environment is torn down.
+     */
+    static Instance* create();
+
+    /**
+     * Instance of the calling thread, null on threads that don't run JavaScript.
+     */
+    static Instance* current();
+
+    /**
+     * Initialize LibTiePie for this instance, LibExit() is called when the last initialized instance is torn down.
+     */
+    void libInit();
+
+    // Typed arrays returned for lists, reused while the list is unchanged:
+    Nan::Global<v8::TypedArray> config;
+    std::map<std::pair<uint32_t, uint32_t>, Nan::Global<v8::TypedArray> > containedSerialNumbers;
+    std::map<LibTiePieHandle_t, HandleValues> handleValues;
+
+    // Constructors of the object oriented interface:
+    Nan::Global<v8::Function> oscilloscope;
+    Nan::Global<v8::Function> oscilloscopeChannel;
+    Nan::Global<v8::Function> generator;
+    Nan::Global<v8::Function> i2cHost;
+    Nan::Global<v8::Function> rawCapture;
+
+  private:
+    Instance();
+    ~Instance();
+    Instance(const Instance&);
+    Instance& operator=(const Instance&);
+
+    static void cleanup(void* arg);
+
+    bool m_libInitialized;
+};
+
+#endif
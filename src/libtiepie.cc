@@ -1,41 +1,28 @@
-#include <nan.h>
-#include <string>
-#include <sstream>
-#include <limits>
-
-#ifdef _MSC_VER
-  #include "libtiepieloader.h"
-
-  #ifdef min
-    #undef min
-  #endif
-  #ifdef max
-    #undef max
-  #endif
-#else
-  #include <libtiepie.h>
-#endif
-
-#define CHECK_PARAMETER_COUNT(expected) { const int length = info.Length(); if(length != expected) { std::stringstream ss; ss << "Invalid parameter count, expected " << expected << " got " << length << "."; return Nan::ThrowSyntaxError(ss.str().c_str()); } }
-#define CHECK_RANGE(value, min, max) { if((value < min) || (value > max)) return Nan::ThrowRangeError("Value out of range"); }
-#define CHECK_LAST_STATUS() { LibTiePieStatus_t status = LibGetLastStatus(); if(status < LIBTIEPIESTATUS_SUCCESS) return Nan::ThrowError(LibGetLastStatusStr()); }
-
-std::string tpVersionToStr(TpVersion_t version)
-{
-  std::stringstream ss;
-  ss << TPVERSION_MAJOR(version) << "." << TPVERSION_MINOR(version) << "." << TPVERSION_RELEASE(version) << "." << TPVERSION_BUILD(version);
-  return ss.str();
-}
-
-void AtExit(void*)
-{
-  if(LibIsInitialized() == BOOL8_TRUE)
-    LibExit();
-
-#ifdef _MSC_VER
-  LibTiePieUnload();
-#endif
-}
+#include "common.h"
+#include "spectrum.h"
+#include "averager.h"
+#include "persistence.h"
+#include "masktest.h"
+#include "rawconverter.h"
+#include "rawcapture.h"
+#include "virtualrecord.h"
+#include "pyramid.h"
+#include "filter.h"
+#include "resampler.h"
+#include "eventsearch.h"
+#include "capturefile.h"
+#include "recorder.h"
+#include "streamring.h"
+#include "captureloop.h"
+#include "csv.h"
+#include "devicelist.h"
+#include "scopeconfig.h"
+#include "capabilitycache.h"
+#include "oscilloscope.h"
+#include "generator.h"
+#include "i2chost.h"
+#include "server.h"
+#include "instance.h"
 
 #ifdef _MSC_VER
 NAN_METHOD(LibTiePieLoadWrapper)
@@ -47,7 +34,7 @@ NAN_METHOD(LibTiePieLoadWrapper)
   if(LibTiePieLoad(path.c_str()) != LIBTIEPIESTATUS_SUCCESS)
     return Nan::ThrowError("Failed to load libtiepie.dll");
 
-  LibInit();
+  Instance::current()->libInit();
 }
 #endif
 
@@ -73,15 +60,10 @@ NAN_METHOD(LibGetConfigWrapper)
 {
   CHECK_PARAMETER_COUNT(0);
 
-  const uint32_t length = LibGetConfig(0, 0) + 1;
-  std::vector<uint8_t> buffer;
-  buffer.resize(length);
-  LibGetConfig(&buffer[0], length);
-  v8::Local<v8::Array> result = Nan::New<v8::Array>();
-  for(uint64_t i = 0; i < length; ++i)
-    Nan::Set(result, (uint32_t)i, Nan::New<v8::Uint32>(buffer[i]));
+  std::vector<uint8_t> buffer(LibGetConfig(0, 0));
+  LibGetConfig(buffer.data(), (uint32_t)buffer.size());
 
-  info.GetReturnValue().Set(result);
+  info.GetReturnValue().Set(SharedTypedArray(Instance::current()->config, buffer.data(), buffer.size()));
 }
 
 NAN_METHOD(LibGetLastStatusWrapper)
@@ -131,6 +113,7 @@ NAN_METHOD(LstOpenDeviceWrapper)
 
   const LibTiePieHandle_t result = LstOpenDevice(idKind, id, deviceType);
   CHECK_LAST_STATUS();
+  CapabilityCache::open(result);
 
   info.GetReturnValue().Set(result);
 }
@@ -143,6 +126,7 @@ NAN_METHOD(LstOpenOscilloscopeWrapper)
 
   const LibTiePieHandle_t result = LstOpenOscilloscope(idKind, id);
   CHECK_LAST_STATUS();
+  CapabilityCache::open(result);
 
   info.GetReturnValue().Set(result);
 }
@@ -155,6 +139,7 @@ NAN_METHOD(LstOpenGeneratorWrapper)
 
   const LibTiePieHandle_t result = LstOpenGenerator(idKind, id);
   CHECK_LAST_STATUS();
+  CapabilityCache::open(result);
 
   info.GetReturnValue().Set(result);
 }
@@ -167,6 +152,7 @@ NAN_METHOD(LstOpenI2CHostWrapper)
 
   const LibTiePieHandle_t result = LstOpenI2CHost(idKind, id);
   CHECK_LAST_STATUS();
+  CapabilityCache::open(result);
 
   info.GetReturnValue().Set(result);
 }
@@ -225,14 +211,11 @@ NAN_METHOD(LstDevGetNameWrapper)
   const uint32_t idKind = Nan::To<uint32_t>(info[0]).FromJust();
   const uint32_t id = Nan::To<uint32_t>(info[1]).FromJust();
 
-  const uint32_t length = LstDevGetName(idKind, id, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  LstDevGetName(idKind, id, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!GetString([&](char* buffer, uint32_t length) { return LstDevGetName(idKind, id, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(LstDevGetNameShortWrapper)
@@ -241,14 +224,11 @@ NAN_METHOD(LstDevGetNameShortWrapper)
   const uint32_t idKind = Nan::To<uint32_t>(info[0]).FromJust();
   const uint32_t id = Nan::To<uint32_t>(info[1]).FromJust();
 
-  const uint32_t length = LstDevGetNameShort(idKind, id, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  LstDevGetNameShort(idKind, id, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!GetString([&](char* buffer, uint32_t length) { return LstDevGetNameShort(idKind, id, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(LstDevGetNameShortestWrapper)
@@ -257,14 +237,11 @@ NAN_METHOD(LstDevGetNameShortestWrapper)
   const uint32_t idKind = Nan::To<uint32_t>(info[0]).FromJust();
   const uint32_t id = Nan::To<uint32_t>(info[1]).FromJust();
 
-  const uint32_t length = LstDevGetNameShortest(idKind, id, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  LstDevGetNameShortest(idKind, id, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!GetString([&](char* buffer, uint32_t length) { return LstDevGetNameShortest(idKind, id, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(LstDevGetDriverVersionWrapper)
@@ -405,17 +382,12 @@ NAN_METHOD(LstDevGetContainedSerialNumbersWrapper)
   const uint32_t idKind = Nan::To<uint32_t>(info[0]).FromJust();
   const uint32_t id = Nan::To<uint32_t>(info[1]).FromJust();
 
-  const uint32_t length = LstDevGetContainedSerialNumbers(idKind, id, 0, 0) + 1;
+  std::vector<uint32_t> buffer(LstDevGetContainedSerialNumbers(idKind, id, 0, 0));
   CHECK_LAST_STATUS();
-  std::vector<uint32_t> buffer;
-  buffer.resize(length);
-  LstDevGetContainedSerialNumbers(idKind, id, &buffer[0], length);
+  LstDevGetContainedSerialNumbers(idKind, id, buffer.data(), (uint32_t)buffer.size());
   CHECK_LAST_STATUS();
-  v8::Local<v8::Array> result = Nan::New<v8::Array>();
-  for(uint64_t i = 0; i < length; ++i)
-    Nan::Set(result, (uint32_t)i, Nan::New<v8::Uint32>(buffer[i]));
 
-  info.GetReturnValue().Set(result);
+  info.GetReturnValue().Set(SharedTypedArray(Instance::current()->containedSerialNumbers[std::make_pair(idKind, id)], buffer.data(), buffer.size()));
 }
 
 NAN_METHOD(LstCbDevGetProductIdWrapper)
@@ -451,14 +423,11 @@ NAN_METHOD(LstCbDevGetNameWrapper)
   const uint32_t id = Nan::To<uint32_t>(info[1]).FromJust();
   const uint32_t containedDeviceSerialNumber = Nan::To<uint32_t>(info[2]).FromJust();
 
-  const uint32_t length = LstCbDevGetName(idKind, id, containedDeviceSerialNumber, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  LstCbDevGetName(idKind, id, containedDeviceSerialNumber, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!GetString([&](char* buffer, uint32_t length) { return LstCbDevGetName(idKind, id, containedDeviceSerialNumber, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(LstCbDevGetNameShortWrapper)
@@ -468,14 +437,11 @@ NAN_METHOD(LstCbDevGetNameShortWrapper)
   const uint32_t id = Nan::To<uint32_t>(info[1]).FromJust();
   const uint32_t containedDeviceSerialNumber = Nan::To<uint32_t>(info[2]).FromJust();
 
-  const uint32_t length = LstCbDevGetNameShort(idKind, id, containedDeviceSerialNumber, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  LstCbDevGetNameShort(idKind, id, containedDeviceSerialNumber, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!GetString([&](char* buffer, uint32_t length) { return LstCbDevGetNameShort(idKind, id, containedDeviceSerialNumber, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(LstCbDevGetNameShortestWrapper)
@@ -485,14 +451,11 @@ NAN_METHOD(LstCbDevGetNameShortestWrapper)
   const uint32_t id = Nan::To<uint32_t>(info[1]).FromJust();
   const uint32_t containedDeviceSerialNumber = Nan::To<uint32_t>(info[2]).FromJust();
 
-  const uint32_t length = LstCbDevGetNameShortest(idKind, id, containedDeviceSerialNumber, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  LstCbDevGetNameShortest(idKind, id, containedDeviceSerialNumber, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!GetString([&](char* buffer, uint32_t length) { return LstCbDevGetNameShortest(idKind, id, containedDeviceSerialNumber, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(LstCbDevGetDriverVersionWrapper)
@@ -619,6 +582,7 @@ NAN_METHOD(ObjCloseWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t handle = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
+  CapabilityCache::remove(handle);
   ObjClose(handle);
   CHECK_LAST_STATUS();
 
@@ -632,6 +596,8 @@ NAN_METHOD(ObjIsRemovedWrapper)
 
   const bool8_t result = ObjIsRemoved(handle);
   CHECK_LAST_STATUS();
+  if(result != BOOL8_FALSE)
+    CapabilityCache::remove(handle);
 
   info.GetReturnValue().Set(result != BOOL8_FALSE);
 }
@@ -685,14 +651,11 @@ NAN_METHOD(DevGetCalibrationTokenWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = DevGetCalibrationToken(device, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  DevGetCalibrationToken(device, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!GetString([&](char* buffer, uint32_t length) { return DevGetCalibrationToken(device, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(DevGetSerialNumberWrapper)
@@ -766,14 +729,11 @@ NAN_METHOD(DevGetNameWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = DevGetName(device, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  DevGetName(device, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!CapabilityCache::getString(device, CAPABILITYCACHE_STRING_NAME, [&](char* buffer, uint32_t length) { return DevGetName(device, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(DevGetNameShortWrapper)
@@ -781,14 +741,11 @@ NAN_METHOD(DevGetNameShortWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = DevGetNameShort(device, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  DevGetNameShort(device, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!CapabilityCache::getString(device, CAPABILITYCACHE_STRING_NAMESHORT, [&](char* buffer, uint32_t length) { return DevGetNameShort(device, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(DevGetNameShortestWrapper)
@@ -796,14 +753,11 @@ NAN_METHOD(DevGetNameShortestWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = DevGetNameShortest(device, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  DevGetNameShortest(device, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!CapabilityCache::getString(device, CAPABILITYCACHE_STRING_NAMESHORTEST, [&](char* buffer, uint32_t length) { return DevGetNameShortest(device, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(DevHasBatteryWrapper)
@@ -1019,14 +973,11 @@ NAN_METHOD(DevTrInGetNameWrapper)
   const uint32_t input = Nan::To<uint32_t>(info[1]).FromJust();
   CHECK_RANGE(input, std::numeric_limits<uint16_t>::min(), std::numeric_limits<uint16_t>::max());
 
-  const uint32_t length = DevTrInGetName(device, input, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  DevTrInGetName(device, input, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!CapabilityCache::getString(device, CAPABILITYCACHE_STRING_TRINNAME | input, [&](char* buffer, uint32_t length) { return DevTrInGetName(device, input, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(DevTrGetOutputCountWrapper)
@@ -1099,14 +1050,11 @@ NAN_METHOD(DevTrOutGetNameWrapper)
   const uint32_t output = Nan::To<uint32_t>(info[1]).FromJust();
   CHECK_RANGE(output, std::numeric_limits<uint16_t>::min(), std::numeric_limits<uint16_t>::max());
 
-  const uint32_t length = DevTrOutGetName(device, output, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  DevTrOutGetName(device, output, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!CapabilityCache::getString(device, CAPABILITYCACHE_STRING_TROUTNAME | output, [&](char* buffer, uint32_t length) { return DevTrOutGetName(device, output, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(DevTrOutTriggerWrapper)
@@ -1192,15 +1140,9 @@ NAN_METHOD(ScpChGetBandwidthsWrapper)
   const uint32_t ch = Nan::To<uint32_t>(info[1]).FromJust();
   CHECK_RANGE(ch, std::numeric_limits<uint16_t>::min(), std::numeric_limits<uint16_t>::max());
 
-  const uint32_t length = ScpChGetBandwidths(device, ch, 0, 0) + 1;
-  CHECK_LAST_STATUS();
-  std::vector<double> buffer;
-  buffer.resize(length);
-  ScpChGetBandwidths(device, ch, &buffer[0], length);
-  CHECK_LAST_STATUS();
-  v8::Local<v8::Array> result = Nan::New<v8::Array>();
-  for(uint64_t i = 0; i < length; ++i)
-    Nan::Set(result, (uint32_t)i, Nan::New<v8::Number>(buffer[i]));
+  v8::Local<v8::TypedArray> result;
+  if(!CapabilityCache::getScpChBandwidths(device, ch, result))
+    CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set(result);
 }
@@ -1267,6 +1209,7 @@ NAN_METHOD(ScpChSetCouplingWrapper)
   const uint32_t coupling = Nan::To<uint32_t>(info[2]).FromJust();
 
   const uint64_t result = ScpChSetCoupling(device, ch, coupling);
+  CapabilityCache::invalidateChannel(device, ch);
   CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set((uint32_t)result);
@@ -1294,6 +1237,7 @@ NAN_METHOD(ScpChSetEnabledWrapper)
   const bool enable = Nan::To<bool>(info[2]).FromJust();
 
   const bool8_t result = ScpChSetEnabled(device, ch, enable ? BOOL8_TRUE : BOOL8_FALSE);
+  CapabilityCache::invalidate(device);
   CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set(result != BOOL8_FALSE);
@@ -1321,6 +1265,7 @@ NAN_METHOD(ScpChSetProbeGainWrapper)
   const double probeGain = Nan::To<double>(info[2]).FromJust();
 
   const double result = ScpChSetProbeGain(device, ch, probeGain);
+  CapabilityCache::invalidateChannel(device, ch);
   CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set(result);
@@ -1348,6 +1293,7 @@ NAN_METHOD(ScpChSetProbeOffsetWrapper)
   const double probeOffset = Nan::To<double>(info[2]).FromJust();
 
   const double result = ScpChSetProbeOffset(device, ch, probeOffset);
+  CapabilityCache::invalidateChannel(device, ch);
   CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set(result);
@@ -1387,15 +1333,9 @@ NAN_METHOD(ScpChGetRangesWrapper)
   const uint32_t ch = Nan::To<uint32_t>(info[1]).FromJust();
   CHECK_RANGE(ch, std::numeric_limits<uint16_t>::min(), std::numeric_limits<uint16_t>::max());
 
-  const uint32_t length = ScpChGetRanges(device, ch, 0, 0) + 1;
-  CHECK_LAST_STATUS();
-  std::vector<double> buffer;
-  buffer.resize(length);
-  ScpChGetRanges(device, ch, &buffer[0], length);
-  CHECK_LAST_STATUS();
-  v8::Local<v8::Array> result = Nan::New<v8::Array>();
-  for(uint64_t i = 0; i < length; ++i)
-    Nan::Set(result, (uint32_t)i, Nan::New<v8::Number>(buffer[i]));
+  v8::Local<v8::TypedArray> result;
+  if(!CapabilityCache::getScpChRanges(device, ch, result))
+    CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set(result);
 }
@@ -1607,8 +1547,9 @@ NAN_METHOD(ScpChTrGetKindsWrapper)
   const uint32_t ch = Nan::To<uint32_t>(info[1]).FromJust();
   CHECK_RANGE(ch, std::numeric_limits<uint16_t>::min(), std::numeric_limits<uint16_t>::max());
 
-  const uint64_t result = ScpChTrGetKinds(device, ch);
-  CHECK_LAST_STATUS();
+  uint64_t result;
+  if(!CapabilityCache::getScpChTrKinds(device, ch, result))
+    CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set((uint32_t)result);
 }
@@ -1899,6 +1840,67 @@ NAN_METHOD(ScpGetDataWrapper)
   info.GetReturnValue().Set(result);
 }
 
+/**
+ * ScpGetDataInto(handle, buffers, startIndex), reads into the Float32Array per channel of buffers.
+ * Returns the number of samples read.
+ */
+NAN_METHOD(ScpGetDataIntoWrapper)
+{
+  CHECK_PARAMETER_COUNT(3);
+  const LibTiePieHandle_t device = Nan::To<uint32_t>(info[0]).FromJust();
+  std::vector<float*> bufferPointers;
+  uint64_t sampleCount;
+  if(!FloatArrayList(info[1], bufferPointers, sampleCount))
+    return Nan::ThrowTypeError("Invalid buffers");
+  CHECK_RANGE(bufferPointers.size(), 1, std::numeric_limits<uint16_t>::max());
+  const uint64_t startIndex = (uint64_t)Nan::To<double>(info[2]).FromJust();
+
+  const uint64_t result = ScpGetData(device, &bufferPointers[0], (uint16_t)bufferPointers.size(), startIndex, sampleCount);
+  CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set((double)result);
+}
+
+/**
+ * ScpGetDataRaw(handle, buffers, startIndex), reads raw data into the typed array per channel of buffers, the array
+ * type must match ScpChGetDataRawType(). Returns the number of samples read.
+ */
+NAN_METHOD(ScpGetDataRawWrapper)
+{
+  CHECK_PARAMETER_COUNT(3);
+  const LibTiePieHandle_t device = Nan::To<uint32_t>(info[0]).FromJust();
+  if(!info[1]->IsArray())
+    return Nan::ThrowTypeError("Invalid buffers");
+  v8::Local<v8::Array> buffers = info[1].As<v8::Array>();
+  CHECK_RANGE(buffers->Length(), 1, std::numeric_limits<uint16_t>::max());
+  const uint64_t startIndex = (uint64_t)Nan::To<double>(info[2]).FromJust();
+
+  std::vector<void*> bufferPointers(buffers->Length(), (void*)0);
+  uint64_t sampleCount = std::numeric_limits<uint64_t>::max();
+  for(uint32_t ch = 0; ch < buffers->Length(); ++ch)
+  {
+    v8::Local<v8::Value> item = Nan::Get(buffers, ch).ToLocalChecked();
+    if(item->IsNullOrUndefined())
+      continue;
+
+    const uint32_t dataType = ScpChGetDataRawType(device, (uint16_t)ch);
+    CHECK_LAST_STATUS();
+    if(GetDataRawType(item) != dataType)
+      return Nan::ThrowTypeError("Invalid buffer type");
+
+    Nan::TypedArrayContents<uint8_t> contents(item);
+    bufferPointers[ch] = *contents;
+    sampleCount = std::min<uint64_t>(sampleCount, contents.length() / GetDataRawTypeSize(dataType));
+  }
+  if(sampleCount == std::numeric_limits<uint64_t>::max())
+    sampleCount = 0;
+
+  const uint64_t result = ScpGetDataRaw(device, &bufferPointers[0], (uint16_t)bufferPointers.size(), startIndex, sampleCount);
+  CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set((double)result);
+}
+
 NAN_METHOD(ScpGetValidPreSampleCountWrapper)
 {
   CHECK_PARAMETER_COUNT(1);
@@ -2011,6 +2013,7 @@ NAN_METHOD(ScpSetMeasureModeWrapper)
   const uint32_t measureMode = Nan::To<uint32_t>(info[1]).FromJust();
 
   const uint32_t result = ScpSetMeasureMode(device, measureMode);
+  CapabilityCache::invalidate(device);
   CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set(result);
@@ -2111,6 +2114,7 @@ NAN_METHOD(ScpSetAutoResolutionModeWrapper)
   const uint32_t autoResolutionMode = Nan::To<uint32_t>(info[1]).FromJust();
 
   const uint32_t result = ScpSetAutoResolutionMode(device, autoResolutionMode);
+  CapabilityCache::invalidate(device);
   CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set(result);
@@ -2121,15 +2125,9 @@ NAN_METHOD(ScpGetResolutionsWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = ScpGetResolutions(device, 0, 0) + 1;
-  CHECK_LAST_STATUS();
-  std::vector<uint8_t> buffer;
-  buffer.resize(length);
-  ScpGetResolutions(device, &buffer[0], length);
-  CHECK_LAST_STATUS();
-  v8::Local<v8::Array> result = Nan::New<v8::Array>();
-  for(uint64_t i = 0; i < length; ++i)
-    Nan::Set(result, (uint32_t)i, Nan::New<v8::Uint32>(buffer[i]));
+  v8::Local<v8::TypedArray> result;
+  if(!CapabilityCache::getScpResolutions(device, result))
+    CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set(result);
 }
@@ -2153,6 +2151,7 @@ NAN_METHOD(ScpSetResolutionWrapper)
   CHECK_RANGE(resolution, std::numeric_limits<uint8_t>::min(), std::numeric_limits<uint8_t>::max());
 
   const uint8_t result = ScpSetResolution(device, resolution);
+  CapabilityCache::invalidate(device);
   CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set((uint32_t)result);
@@ -2198,6 +2197,7 @@ NAN_METHOD(ScpSetClockSourceWrapper)
   const uint32_t clockSource = Nan::To<uint32_t>(info[1]).FromJust();
 
   const uint32_t result = ScpSetClockSource(device, clockSource);
+  CapabilityCache::invalidate(device);
   CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set(result);
@@ -2208,17 +2208,12 @@ NAN_METHOD(ScpGetClockSourceFrequenciesWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = ScpGetClockSourceFrequencies(device, 0, 0) + 1;
+  std::vector<double> buffer(ScpGetClockSourceFrequencies(device, 0, 0));
   CHECK_LAST_STATUS();
-  std::vector<double> buffer;
-  buffer.resize(length);
-  ScpGetClockSourceFrequencies(device, &buffer[0], length);
+  ScpGetClockSourceFrequencies(device, buffer.data(), (uint32_t)buffer.size());
   CHECK_LAST_STATUS();
-  v8::Local<v8::Array> result = Nan::New<v8::Array>();
-  for(uint64_t i = 0; i < length; ++i)
-    Nan::Set(result, (uint32_t)i, Nan::New<v8::Number>(buffer[i]));
 
-  info.GetReturnValue().Set(result);
+  info.GetReturnValue().Set(NewTypedArrayCopy(buffer.data(), buffer.size()));
 }
 
 NAN_METHOD(ScpGetClockSourceFrequencyWrapper)
@@ -2283,17 +2278,12 @@ NAN_METHOD(ScpGetClockOutputFrequenciesWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = ScpGetClockOutputFrequencies(device, 0, 0) + 1;
+  std::vector<double> buffer(ScpGetClockOutputFrequencies(device, 0, 0));
   CHECK_LAST_STATUS();
-  std::vector<double> buffer;
-  buffer.resize(length);
-  ScpGetClockOutputFrequencies(device, &buffer[0], length);
+  ScpGetClockOutputFrequencies(device, buffer.data(), (uint32_t)buffer.size());
   CHECK_LAST_STATUS();
-  v8::Local<v8::Array> result = Nan::New<v8::Array>();
-  for(uint64_t i = 0; i < length; ++i)
-    Nan::Set(result, (uint32_t)i, Nan::New<v8::Number>(buffer[i]));
 
-  info.GetReturnValue().Set(result);
+  info.GetReturnValue().Set(NewTypedArrayCopy(buffer.data(), buffer.size()));
 }
 
 NAN_METHOD(ScpGetClockOutputFrequencyWrapper)
@@ -2324,8 +2314,9 @@ NAN_METHOD(ScpGetSampleFrequencyMaxWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const double result = ScpGetSampleFrequencyMax(device);
-  CHECK_LAST_STATUS();
+  double result;
+  if(!CapabilityCache::getScpSampleFrequencyMax(device, result))
+    CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set(result);
 }
@@ -2983,15 +2974,9 @@ NAN_METHOD(GenGetAmplitudeRangesWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = GenGetAmplitudeRanges(device, 0, 0) + 1;
-  CHECK_LAST_STATUS();
-  std::vector<double> buffer;
-  buffer.resize(length);
-  GenGetAmplitudeRanges(device, &buffer[0], length);
-  CHECK_LAST_STATUS();
-  v8::Local<v8::Array> result = Nan::New<v8::Array>();
-  for(uint64_t i = 0; i < length; ++i)
-    Nan::Set(result, (uint32_t)i, Nan::New<v8::Number>(buffer[i]));
+  v8::Local<v8::TypedArray> result;
+  if(!CapabilityCache::getGenAmplitudeRanges(device, result))
+    CHECK_LAST_STATUS();
 
   info.GetReturnValue().Set(result);
 }
@@ -3863,14 +3848,11 @@ NAN_METHOD(SrvGetURLWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t server = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = SrvGetURL(server, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  SrvGetURL(server, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!CapabilityCache::getString(server, CAPABILITYCACHE_STRING_URL, [&](char* buffer, uint32_t length) { return SrvGetURL(server, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(SrvGetIDWrapper)
@@ -3878,14 +3860,11 @@ NAN_METHOD(SrvGetIDWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t server = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = SrvGetID(server, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  SrvGetID(server, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!CapabilityCache::getString(server, CAPABILITYCACHE_STRING_ID, [&](char* buffer, uint32_t length) { return SrvGetID(server, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(SrvGetIPv4AddressWrapper)
@@ -3915,14 +3894,11 @@ NAN_METHOD(SrvGetNameWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t server = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = SrvGetName(server, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  SrvGetName(server, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!GetString([&](char* buffer, uint32_t length) { return SrvGetName(server, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(SrvGetDescriptionWrapper)
@@ -3930,14 +3906,11 @@ NAN_METHOD(SrvGetDescriptionWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t server = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = SrvGetDescription(server, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  SrvGetDescription(server, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!GetString([&](char* buffer, uint32_t length) { return SrvGetDescription(server, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_METHOD(SrvGetVersionWrapper)
@@ -3956,18 +3929,17 @@ NAN_METHOD(SrvGetVersionExtraWrapper)
   CHECK_PARAMETER_COUNT(1);
   const LibTiePieHandle_t server = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
 
-  const uint32_t length = SrvGetVersionExtra(server, 0, 0);
-  CHECK_LAST_STATUS();
-  std::vector<char> s;
-  s.resize(length);
-  SrvGetVersionExtra(server, &s[0], length);
-  CHECK_LAST_STATUS();
+  v8::Local<v8::String> result;
+  if(!GetString([&](char* buffer, uint32_t length) { return SrvGetVersionExtra(server, buffer, length); }, result))
+    CHECK_LAST_STATUS();
 
-  info.GetReturnValue().Set(Nan::New(&s[0], length).ToLocalChecked());
+  info.GetReturnValue().Set(result);
 }
 
 NAN_MODULE_INIT(init)
 {
+  Instance::create();
+
   v8::Local<v8::Array> api = Nan::New<v8::Array>();
   Nan::Set(api, Nan::New<v8::String>("LibGetVersion").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(LibGetVersionWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("LibGetVersionExtra").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(LibGetVersionExtraWrapper)).ToLocalChecked());
@@ -3975,7 +3947,9 @@ NAN_MODULE_INIT(init)
   Nan::Set(api, Nan::New<v8::String>("LibGetLastStatus").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(LibGetLastStatusWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("LibGetLastStatusStr").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(LibGetLastStatusStrWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("LstUpdate").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(LstUpdateWrapper)).ToLocalChecked());
+  Nan::Set(api, Nan::New<v8::String>("LstUpdateAsync").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(LstUpdateAsyncWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("LstGetCount").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(LstGetCountWrapper)).ToLocalChecked());
+  Nan::Set(api, Nan::New<v8::String>("LstGetSnapshot").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(LstGetSnapshotWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("LstOpenDevice").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(LstOpenDeviceWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("LstOpenOscilloscope").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(LstOpenOscilloscopeWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("LstOpenGenerator").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(LstOpenGeneratorWrapper)).ToLocalChecked());
@@ -4110,6 +4084,8 @@ NAN_MODULE_INIT(init)
   Nan::Set(api, Nan::New<v8::String>("ScpChTrSetTime").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpChTrSetTimeWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("ScpChTrVerifyTime").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpChTrVerifyTimeWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("ScpGetData").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpGetDataWrapper)).ToLocalChecked());
+  Nan::Set(api, Nan::New<v8::String>("ScpGetDataInto").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpGetDataIntoWrapper)).ToLocalChecked());
+  Nan::Set(api, Nan::New<v8::String>("ScpGetDataRaw").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpGetDataRawWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("ScpGetValidPreSampleCount").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpGetValidPreSampleCountWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("ScpChGetDataValueMin").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpChGetDataValueMinWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("ScpChGetDataValueMax").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpChGetDataValueMaxWrapper)).ToLocalChecked());
@@ -4117,6 +4093,8 @@ NAN_MODULE_INIT(init)
   Nan::Set(api, Nan::New<v8::String>("ScpStart").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpStartWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("ScpStop").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpStopWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("ScpForceTrigger").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpForceTriggerWrapper)).ToLocalChecked());
+  Nan::Set(api, Nan::New<v8::String>("ScpApplyConfig").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpApplyConfigWrapper)).ToLocalChecked());
+  Nan::Set(api, Nan::New<v8::String>("ScpReadConfig").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpReadConfigWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("ScpGetMeasureModes").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpGetMeasureModesWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("ScpGetMeasureMode").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpGetMeasureModeWrapper)).ToLocalChecked());
   Nan::Set(api, Nan::New<v8::String>("ScpSetMeasureMode").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(ScpSetMeasureModeWrapper)).ToLocalChecked());
@@ -4661,15 +4639,35 @@ NAN_MODULE_INIT(init)
   Nan::Set(target, Nan::New<v8::String>("const").ToLocalChecked(), constants);
   Nan::Set(target, Nan::New<v8::String>("api").ToLocalChecked(), api);
 
+  Spectrum::Init(target);
+  Averager::Init(target);
+  Persistence::Init(target);
+  MaskTest::Init(target);
+  RawConverter::Init(target);
+  RawCapture::Init(target);
+  VirtualRecord::Init(target);
+  Pyramid::Init(target);
+  Filter::Init(target);
+  Resampler::Init(target);
+  EventSearch::Init(target);
+  CaptureFile::Init(target);
+  Recorder::Init(target);
+  StreamRing::Init(target);
+  CaptureLoop::Init(target);
+  Csv::Init(target);
+  CapabilityCache::Init(target);
+  Oscilloscope::Init(target);
+  Generator::Init(target);
+  I2CHost::Init(target);
+  Server::Init(target);
+
 #ifdef _MSC_VER
   v8::Local<v8::Array> loader = Nan::New<v8::Array>();
   Nan::Set(loader, Nan::New<v8::String>("LibTiePieLoad").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(LibTiePieLoadWrapper)).ToLocalChecked());
   Nan::Set(target, Nan::New<v8::String>("loader").ToLocalChecked(), loader);
 #else
-  LibInit();
+  Instance::current()->libInit();
 #endif
-
-  node::AtExit(AtExit);
 }
 
-NODE_MODULE(NODE_GYP_MODULE_NAME, init)
+NAN_MODULE_WORKER_ENABLED(NODE_GYP_MODULE_NAME, init)
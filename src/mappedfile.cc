@@ -0,0 +1,174 @@
+/**
+ * \file mappedfile.cc
+ * \brief Memory mapped files.
+ */
+
+#include "mappedfile.h"
+
+#ifdef _WIN32
+  static const HANDLE invalidFile = INVALID_HANDLE_VALUE;
+#else
+  #include <cerrno>
+  #include <cstring>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+
+  static const int invalidFile = -1;
+#endif
+
+MappedFile::MappedFile() :
+  m_data(0),
+  m_size(0),
+  m_file(invalidFile)
+{
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+bool MappedFile::fail(const char* message)
+{
+  m_error = message;
+#ifndef _WIN32
+  m_error += ": ";
+  m_error += strerror(errno);
+#endif
+  close(0);
+  return false;
+}
+
+bool MappedFile::create(const std::string& filename, uint64_t size)
+{
+  close();
+
+#ifdef _WIN32
+  m_file = CreateFileW(toWide(filename).c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(m_file == INVALID_HANDLE_VALUE)
+    return fail("Failed to create file");
+
+  HANDLE mapping = CreateFileMappingW(m_file, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, NULL);
+  if(!mapping)
+    return fail("Failed to map file");
+
+  m_data = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)size);
+  CloseHandle(mapping);
+  if(!m_data)
+    return fail("Failed to map file");
+#else
+  m_file = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(m_file < 0)
+    return fail("Failed to create file");
+
+  if(ftruncate(m_file, (off_t)size) != 0)
+    return fail("Failed to resize file");
+
+  void* data = mmap(0, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+  if(data == MAP_FAILED)
+    return fail("Failed to map file");
+  m_data = (uint8_t*)data;
+#endif
+
+  m_size = size;
+  return true;
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+  close();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileW(toWide(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(file == INVALID_HANDLE_VALUE)
+    return fail("Failed to open file");
+
+  LARGE_INTEGER size;
+  if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+  {
+    CloseHandle(file);
+    return fail("Invalid file size");
+  }
+
+  HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  CloseHandle(file);
+  if(!mapping)
+    return fail("Failed to map file");
+
+  m_data = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  CloseHandle(mapping);
+  if(!m_data)
+    return fail("Failed to map file");
+  m_size = (uint64_t)size.QuadPart;
+#else
+  const int file = ::open(filename.c_str(), O_RDONLY);
+  if(file < 0)
+    return fail("Failed to open file");
+
+  struct stat st;
+  if(fstat(file, &st) != 0 || st.st_size == 0)
+  {
+    ::close(file);
+    return fail("Invalid file size");
+  }
+
+  void* data = mmap(0, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+  ::close(file);
+  if(data == MAP_FAILED)
+    return fail("Failed to map file");
+  m_data = (uint8_t*)data;
+  m_size = (uint64_t)st.st_size;
+#endif
+
+  return true;
+}
+
+bool MappedFile::close(uint64_t size)
+{
+  bool result = true;
+
+  if(m_data)
+    unmap(m_data, m_size);
+  m_data = 0;
+  m_size = 0;
+
+  if(m_file != invalidFile)
+  {
+#ifdef _WIN32
+    if(size != UINT64_MAX)
+    {
+      LARGE_INTEGER position;
+      position.QuadPart = (LONGLONG)size;
+      result = SetFilePointerEx(m_file, position, NULL, FILE_BEGIN) && SetEndOfFile(m_file);
+    }
+    CloseHandle(m_file);
+#else
+    if(size != UINT64_MAX)
+      result = ftruncate(m_file, (off_t)size) == 0;
+    ::close(m_file);
+#endif
+    m_file = invalidFile;
+  }
+
+  return result;
+}
+
+uint8_t* MappedFile::release()
+{
+  uint8_t* data = m_data;
+  m_data = 0;
+  m_size = 0;
+  return data;
+}
+
+void MappedFile::unmap(void* data, uint64_t size)
+{
+#ifdef _WIN32
+  (void)size;
+  UnmapViewOfFile(data);
+#else
+  munmap(data, (size_t)size);
+#endif
+}
@@ -0,0 +1,98 @@
+/**
+ * \file mappedfile.h
+ * \brief Memory mapped files.
+ */
+
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _WIN32
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+  #ifdef min
+    #undef min
+  #endif
+  #ifdef max
+    #undef max
+  #endif
+
+  #include <vector>
+
+  /**
+   * Convert an UTF-8 file name to UTF-16.
+   */
+  inline std::wstring toWide(const std::string& s)
+  {
+    const int length = MultiByteToWideChar(CP_UTF8, 0, s.c_str(), -1, 0, 0);
+    std::vector<wchar_t> buffer(length > 0 ? length : 1, 0);
+    MultiByteToWideChar(CP_UTF8, 0, s.c_str(), -1, &buffer[0], length);
+    return std::wstring(&buffer[0]);
+  }
+#endif
+
+class MappedFile
+{
+  public:
+    MappedFile();
+    ~MappedFile();
+
+    /**
+     * Create or overwrite \p filename with \p size bytes and map it for writing.
+     */
+    bool create(const std::string& filename, uint64_t size);
+
+    /**
+     * Map an existing file, copy on write: changes are never written back to the file.
+     */
+    bool open(const std::string& filename);
+
+    /**
+     * Unmap the file and, for created files, set the final file size.
+     */
+    bool close(uint64_t size = UINT64_MAX);
+
+    /**
+     * Take ownership of the mapping, it must be released with unmap().
+     */
+    uint8_t* release();
+
+    static void unmap(void* data, uint64_t size);
+
+    uint8_t* data() const
+    {
+      return m_data;
+    }
+
+    uint64_t size() const
+    {
+      return m_size;
+    }
+
+    const std::string& error() const
+    {
+      return m_error;
+    }
+
+  private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    bool fail(const char* message);
+
+    uint8_t* m_data;
+    uint64_t m_size;
+    std::string m_error;
+#ifdef _WIN32
+    HANDLE m_file;
+#else
+    int m_file;
+#endif
+};
+
+#endif
@@ -0,0 +1,413 @@
+/**
+ * \file masktest.cc
+ * \brief Pass/fail testing of records against lower and upper limits.
+ */
+
+#include "masktest.h"
+#include "simd.h"
+#include "acquire.h"
+#include <cmath>
+
+class MaskProcessWorker : public Nan::AsyncWorker
+{
+  public:
+    MaskProcessWorker(Nan::Callback* callback, MaskTest* mask, v8::Local<v8::Object> self, v8::Local<v8::Array> data) :
+      Nan::AsyncWorker(callback),
+      m_mask(mask),
+      m_data(data->Length()),
+      m_results(mask->channelCount())
+    {
+      SaveToPersistent("self", self);
+      SaveToPersistent("data", data);
+      for(uint32_t i = 0; i < data->Length(); ++i)
+      {
+        v8::Local<v8::Value> item = Nan::Get(data, i).ToLocalChecked();
+        if(!item->IsNullOrUndefined())
+          m_data[i].assign(item);
+      }
+    }
+
+    void Execute()
+    {
+      std::vector<const float*> data(m_data.size());
+      size_t length = std::numeric_limits<size_t>::max();
+      for(size_t i = 0; i < m_data.size(); ++i)
+      {
+        data[i] = m_data[i].data();
+        if(data[i])
+          length = std::min(length, m_data[i].length());
+      }
+      if(length != std::numeric_limits<size_t>::max())
+        m_mask->check(data, length, 0, m_results);
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), MaskTest::toObject(m_results, 1)};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    MaskTest* m_mask;
+    std::vector<FloatArrayArgument> m_data;
+    std::vector<MaskResult> m_results;
+};
+
+class MaskAcquireWorker : public Nan::AsyncWorker
+{
+  public:
+    MaskAcquireWorker(Nan::Callback* callback, MaskTest* mask, v8::Local<v8::Object> self, LibTiePieHandle_t device, uint64_t length, uint32_t count, double timeout) :
+      Nan::AsyncWorker(callback),
+      m_mask(mask),
+      m_device(device),
+      m_length((size_t)length),
+      m_count(count),
+      m_timeout(timeout),
+      m_recordCount(0),
+      m_results(mask->channelCount())
+    {
+      SaveToPersistent("self", self);
+    }
+
+    void Execute()
+    {
+      std::string error;
+      if(!acquireRecords(m_device, m_mask->channelCount(), m_length, m_count, m_timeout, [this](const std::vector<const float*>& data) { m_mask->check(data, m_length, m_recordCount++, m_results); }, error))
+        SetErrorMessage(error.c_str());
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), MaskTest::toObject(m_results, m_recordCount)};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    MaskTest* m_mask;
+    LibTiePieHandle_t m_device;
+    size_t m_length;
+    uint32_t m_count;
+    double m_timeout;
+    uint32_t m_recordCount;
+    std::vector<MaskResult> m_results;
+};
+
+static bool getMaskLine(v8::Local<v8::Value> value, std::vector<MaskPoint>& line)
+{
+  line.clear();
+  if(value->IsNullOrUndefined())
+    return true;
+  if(!value->IsArray())
+    return false;
+
+  v8::Local<v8::Array> points = value.As<v8::Array>();
+  for(uint32_t i = 0; i < points->Length(); ++i)
+  {
+    v8::Local<v8::Value> item = Nan::Get(points, i).ToLocalChecked();
+    if(!item->IsArray() || item.As<v8::Array>()->Length() != 2)
+      return false;
+
+    MaskPoint point;
+    point.time = Nan::To<double>(Nan::Get(item.As<v8::Array>(), 0).ToLocalChecked()).FromJust();
+    point.value = Nan::To<double>(Nan::Get(item.As<v8::Array>(), 1).ToLocalChecked()).FromJust();
+    if(!line.empty() && !(point.time >= line.back().time))
+      return false;
+    line.push_back(point);
+  }
+  return true;
+}
+
+NAN_MODULE_INIT(MaskTest::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("MaskTest").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "setLimits", SetLimits);
+  Nan::SetPrototypeMethod(tpl, "setLimitLines", SetLimitLines);
+  Nan::SetPrototypeMethod(tpl, "clear", Clear);
+  Nan::SetPrototypeMethod(tpl, "process", Process);
+  Nan::SetPrototypeMethod(tpl, "acquire", Acquire);
+
+  Nan::Set(target, Nan::New<v8::String>("MaskTest").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+MaskTest::MaskTest(uint16_t channelCount) :
+  m_channels(channelCount)
+{
+  for(std::vector<MaskChannel>::iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+  {
+    it->enabled = false;
+    it->lines = false;
+  }
+}
+
+void MaskTest::interpolate(const std::vector<MaskPoint>& line, float outside, std::vector<float>& limits, size_t length)
+{
+  limits.assign(length, outside);
+  if(line.empty())
+    return;
+
+  size_t segment = 0;
+  for(size_t i = 0; i < length; ++i)
+  {
+    const double time = length > 1 ? (double)i / (length - 1) : 0.0;
+    if(time < line.front().time || time > line.back().time)
+      continue;
+    while(segment + 1 < line.size() - 1 && time > line[segment + 1].time)
+      segment++;
+
+    if(line.size() == 1)
+      limits[i] = (float)line[0].value;
+    else
+    {
+      const MaskPoint& a = line[segment];
+      const MaskPoint& b = line[segment + 1];
+      limits[i] = (float)(b.time > a.time ? a.value + (b.value - a.value) * (time - a.time) / (b.time - a.time) : b.value);
+    }
+  }
+}
+
+void MaskTest::check(const std::vector<const float*>& data, size_t length, uint32_t record, std::vector<MaskResult>& results)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const size_t channelCount = std::min(data.size(), m_channels.size());
+  for(size_t ch = 0; ch < channelCount; ++ch)
+  {
+    MaskChannel& channel = m_channels[ch];
+    if(!data[ch] || !channel.enabled)
+      continue;
+
+    if(channel.lines && channel.lower.size() != length)
+    {
+      interpolate(channel.lowerLine, -std::numeric_limits<float>::infinity(), channel.lower, length);
+      interpolate(channel.upperLine, std::numeric_limits<float>::infinity(), channel.upper, length);
+    }
+
+    const float* samples = data[ch];
+    const float* lower = channel.lower.empty() ? 0 : &channel.lower[0];
+    const float* upper = channel.upper.empty() ? 0 : &channel.upper[0];
+    const size_t end = std::min(length, channel.lower.size());
+    MaskResult& result = results[ch];
+    bool failed = false;
+    for(size_t i = findFirstOutsideLimits(samples, lower, upper, 0, end); i < end; i = findFirstOutsideLimits(samples, lower, upper, i + 1, end))
+    {
+      const double excess = samples[i] < lower[i] ? lower[i] - samples[i] : samples[i] - upper[i];
+      if(result.violationCount == 0)
+      {
+        result.firstRecord = record;
+        result.firstIndex = i;
+      }
+      if(result.violationCount == 0 || excess > result.worstExcess)
+      {
+        result.worstRecord = record;
+        result.worstIndex = i;
+        result.worstExcess = excess;
+      }
+      result.violationCount++;
+      failed = true;
+    }
+    if(failed)
+      result.failCount++;
+  }
+}
+
+v8::Local<v8::Object> MaskTest::toObject(const std::vector<MaskResult>& results, uint32_t recordCount)
+{
+  uint32_t failCount = 0;
+  v8::Local<v8::Array> channels = Nan::New<v8::Array>(results.size());
+  for(size_t ch = 0; ch < results.size(); ++ch)
+  {
+    const MaskResult& result = results[ch];
+    v8::Local<v8::Object> channel = Nan::New<v8::Object>();
+    Nan::Set(channel, Nan::New<v8::String>("failCount").ToLocalChecked(), Nan::New<v8::Uint32>(result.failCount));
+    Nan::Set(channel, Nan::New<v8::String>("violationCount").ToLocalChecked(), Nan::New<v8::Number>((double)result.violationCount));
+    if(result.violationCount != 0)
+    {
+      v8::Local<v8::Object> first = Nan::New<v8::Object>();
+      Nan::Set(first, Nan::New<v8::String>("record").ToLocalChecked(), Nan::New<v8::Uint32>(result.firstRecord));
+      Nan::Set(first, Nan::New<v8::String>("index").ToLocalChecked(), Nan::New<v8::Number>((double)result.firstIndex));
+      Nan::Set(channel, Nan::New<v8::String>("first").ToLocalChecked(), first);
+
+      v8::Local<v8::Object> worst = Nan::New<v8::Object>();
+      Nan::Set(worst, Nan::New<v8::String>("record").ToLocalChecked(), Nan::New<v8::Uint32>(result.worstRecord));
+      Nan::Set(worst, Nan::New<v8::String>("index").ToLocalChecked(), Nan::New<v8::Number>((double)result.worstIndex));
+      Nan::Set(worst, Nan::New<v8::String>("excess").ToLocalChecked(), Nan::New<v8::Number>(result.worstExcess));
+      Nan::Set(channel, Nan::New<v8::String>("worst").ToLocalChecked(), worst);
+    }
+    else
+    {
+      Nan::Set(channel, Nan::New<v8::String>("first").ToLocalChecked(), Nan::Null());
+      Nan::Set(channel, Nan::New<v8::String>("worst").ToLocalChecked(), Nan::Null());
+    }
+    Nan::Set(channels, ch, channel);
+    failCount = std::max(failCount, result.failCount);
+  }
+
+  v8::Local<v8::Object> object = Nan::New<v8::Object>();
+  Nan::Set(object, Nan::New<v8::String>("recordCount").ToLocalChecked(), Nan::New<v8::Uint32>(recordCount));
+  Nan::Set(object, Nan::New<v8::String>("passed").ToLocalChecked(), Nan::New<v8::Boolean>(failCount == 0));
+  Nan::Set(object, Nan::New<v8::String>("channels").ToLocalChecked(), channels);
+  return object;
+}
+
+/**
+ * new MaskTest(channelCount)
+ */
+NAN_METHOD(MaskTest::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowTypeError("MaskTest must be called with new");
+
+  CHECK_PARAMETER_COUNT(1);
+  const uint32_t channelCount = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(channelCount, 1, std::numeric_limits<uint16_t>::max());
+
+  MaskTest* mask = new MaskTest((uint16_t)channelCount);
+  mask->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
+
+/**
+ * setLimits(channel, lower, upper), per sample limits, null for no limit. Samples past the end of the limits aren't
+ * tested.
+ */
+NAN_METHOD(MaskTest::SetLimits)
+{
+  CHECK_PARAMETER_COUNT(3);
+  MaskTest* mask = Nan::ObjectWrap::Unwrap<MaskTest>(info.Holder());
+  const uint32_t ch = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(ch, 0, mask->m_channels.size() - 1);
+
+  FloatArrayArgument lower;
+  FloatArrayArgument upper;
+  if((!info[1]->IsNullOrUndefined() && !lower.assign(info[1])) || (!info[2]->IsNullOrUndefined() && !upper.assign(info[2])))
+    return Nan::ThrowTypeError("Invalid limits, expected an array");
+  if(lower.data() && upper.data() && lower.length() != upper.length())
+    return Nan::ThrowRangeError("Lower and upper limits differ in length");
+
+  const size_t length = lower.data() ? lower.length() : upper.length();
+  std::lock_guard<std::mutex> lock(mask->m_mutex);
+  MaskChannel& channel = mask->m_channels[ch];
+  channel.enabled = lower.data() || upper.data();
+  channel.lines = false;
+  channel.lowerLine.clear();
+  channel.upperLine.clear();
+  if(lower.data())
+    channel.lower.assign(lower.data(), lower.data() + length);
+  else
+    channel.lower.assign(length, -std::numeric_limits<float>::infinity());
+  if(upper.data())
+    channel.upper.assign(upper.data(), upper.data() + length);
+  else
+    channel.upper.assign(length, std::numeric_limits<float>::infinity());
+
+  info.GetReturnValue().SetUndefined();
+}
+
+/**
+ * setLimitLines(channel, lower, upper), limits as lines of [time, value] points, null for no limit. Time runs from 0
+ * at the first to 1 at the last sample of a record, samples before the first or after the last point aren't limited.
+ */
+NAN_METHOD(MaskTest::SetLimitLines)
+{
+  CHECK_PARAMETER_COUNT(3);
+  MaskTest* mask = Nan::ObjectWrap::Unwrap<MaskTest>(info.Holder());
+  const uint32_t ch = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(ch, 0, mask->m_channels.size() - 1);
+
+  std::vector<MaskPoint> lower;
+  std::vector<MaskPoint> upper;
+  if(!getMaskLine(info[1], lower) || !getMaskLine(info[2], upper))
+    return Nan::ThrowTypeError("Invalid limit line, expected an array of [time, value] points in time order");
+
+  std::lock_guard<std::mutex> lock(mask->m_mutex);
+  MaskChannel& channel = mask->m_channels[ch];
+  channel.enabled = !lower.empty() || !upper.empty();
+  channel.lines = true;
+  channel.lowerLine.swap(lower);
+  channel.upperLine.swap(upper);
+  channel.lower.clear();
+  channel.upper.clear();
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(MaskTest::Clear)
+{
+  CHECK_PARAMETER_COUNT(1);
+  MaskTest* mask = Nan::ObjectWrap::Unwrap<MaskTest>(info.Holder());
+  const uint32_t ch = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(ch, 0, mask->m_channels.size() - 1);
+
+  std::lock_guard<std::mutex> lock(mask->m_mutex);
+  MaskChannel& channel = mask->m_channels[ch];
+  channel.enabled = false;
+  channel.lines = false;
+  channel.lowerLine.clear();
+  channel.upperLine.clear();
+  channel.lower.clear();
+  channel.upper.clear();
+
+  info.GetReturnValue().SetUndefined();
+}
+
+/**
+ * process(data, callback), data has an array per channel or null, callback(err, result).
+ */
+NAN_METHOD(MaskTest::Process)
+{
+  CHECK_PARAMETER_COUNT(2);
+  if(!info[0]->IsArray())
+    return Nan::ThrowTypeError("Invalid data, expected an array");
+  if(!info[1]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  v8::Local<v8::Array> data = info[0].As<v8::Array>();
+  for(uint32_t i = 0; i < data->Length(); ++i)
+  {
+    v8::Local<v8::Value> item = Nan::Get(data, i).ToLocalChecked();
+    if(!item->IsNullOrUndefined() && !item->IsArray() && !item->IsTypedArray())
+      return Nan::ThrowTypeError("Invalid data, expected an array");
+  }
+
+  MaskTest* mask = Nan::ObjectWrap::Unwrap<MaskTest>(info.Holder());
+  Nan::Callback* callback = new Nan::Callback(info[1].As<v8::Function>());
+  Nan::AsyncQueueWorker(new MaskProcessWorker(callback, mask, info.Holder(), data));
+
+  info.GetReturnValue().SetUndefined();
+}
+
+/**
+ * acquire(handle, count[, timeout], callback), measures and tests count records in block mode, callback(err, result).
+ */
+NAN_METHOD(MaskTest::Acquire)
+{
+  if(info.Length() < 3 || info.Length() > 4)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+  const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
+  const uint32_t count = Nan::To<uint32_t>(info[1]).FromJust();
+  double timeout;
+  if(!getAcquireTimeout(info, timeout))
+    return Nan::ThrowRangeError("Value out of range");
+  const v8::Local<v8::Value> function = info[info.Length() - 1];
+  if(!function->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  if(ScpGetMeasureMode(device) != MM_BLOCK)
+  {
+    CHECK_LAST_STATUS();
+    return Nan::ThrowError("Oscilloscope is not in block mode");
+  }
+  const uint64_t length = ScpGetRecordLength(device);
+  CHECK_LAST_STATUS();
+
+  MaskTest* mask = Nan::ObjectWrap::Unwrap<MaskTest>(info.Holder());
+  Nan::Callback* callback = new Nan::Callback(function.As<v8::Function>());
+  Nan::AsyncQueueWorker(new MaskAcquireWorker(callback, mask, info.Holder(), device, length, count, timeout));
+
+  info.GetReturnValue().SetUndefined();
+}
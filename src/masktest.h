@@ -0,0 +1,73 @@
+/**
+ * \file masktest.h
+ * \brief Pass/fail testing of records against lower and upper limits.
+ */
+
+#ifndef _MASKTEST_H_
+#define _MASKTEST_H_
+
+#include "common.h"
+#include <mutex>
+
+struct MaskPoint
+{
+  double time; //!< Position in the record, 0 is the first and 1 the last sample.
+  double value;
+};
+
+struct MaskChannel
+{
+  bool enabled;
+  bool lines; //!< Limits are interpolated from the lines for records of \c length samples.
+  std::vector<MaskPoint> lowerLine;
+  std::vector<MaskPoint> upperLine;
+  std::vector<float> lower; //!< Per sample limits, -infinity or +infinity where there is no limit.
+  std::vector<float> upper;
+};
+
+struct MaskResult
+{
+  uint32_t failCount; //!< Number of records with violations.
+  uint64_t violationCount; //!< Number of samples outside the limits.
+  uint32_t firstRecord;
+  uint64_t firstIndex;
+  uint32_t worstRecord;
+  uint64_t worstIndex;
+  double worstExcess; //!< Distance of the worst sample to its limit.
+};
+
+class MaskTest : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+    /**
+     * Test a record of \p length samples, \p data holds a pointer per channel, null skips a channel. The violations
+     * are added to \p results, \p record is the index of the record. Thread safe.
+     */
+    void check(const std::vector<const float*>& data, size_t length, uint32_t record, std::vector<MaskResult>& results);
+
+    uint16_t channelCount() const
+    {
+      return (uint16_t)m_channels.size();
+    }
+
+    static v8::Local<v8::Object> toObject(const std::vector<MaskResult>& results, uint32_t recordCount);
+
+  private:
+    MaskTest(uint16_t channelCount);
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(SetLimits);
+    static NAN_METHOD(SetLimitLines);
+    static NAN_METHOD(Clear);
+    static NAN_METHOD(Process);
+    static NAN_METHOD(Acquire);
+
+    static void interpolate(const std::vector<MaskPoint>& line, float outside, std::vector<float>& limits, size_t length);
+
+    std::mutex m_mutex;
+    std::vector<MaskChannel> m_channels;
+};
+
+#endif
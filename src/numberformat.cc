@@ -0,0 +1,320 @@
+/**
+ * \file numberformat.cc
+ * \brief Fast number to text conversion.
+ */
+
+#include "numberformat.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+static const double powersOf10[] =
+{
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const char digitPairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+// x * 10^exponent, using exact powers of ten where possible:
+static double scale10(double x, int exponent)
+{
+  if(exponent >= 0)
+  {
+    for(; exponent > 22; exponent -= 22)
+      x *= 1e22;
+    return x * powersOf10[exponent];
+  }
+
+  for(; exponent < -22; exponent += 22)
+    x /= 1e22;
+  return x / powersOf10[-exponent];
+}
+
+static size_t formatSpecial(double value, char* buffer)
+{
+  const char* text = (value != value) ? "NaN" : (value < 0 ? "-Infinity" : "Infinity");
+  const size_t length = strlen(text);
+  memcpy(buffer, text, length);
+  return length;
+}
+
+// Format digits * 10^exponent like JavaScript's Number.prototype.toString():
+static size_t formatDecimal(bool negative, uint64_t digits, int exponent, char* buffer)
+{
+  char d[24];
+  size_t n = formatUnsigned(digits, d);
+  while(n > 1 && d[n - 1] == '0')
+  {
+    --n;
+    ++exponent;
+  }
+
+  const int point = (int)n + exponent; // Position of the decimal point relative to the first digit.
+  char* p = buffer;
+  if(negative)
+    *p++ = '-';
+
+  if(exponent >= 0 && point <= 21)
+  {
+    memcpy(p, d, n);
+    p += n;
+    memset(p, '0', exponent);
+    p += exponent;
+  }
+  else if(point > 0 && point <= 21)
+  {
+    memcpy(p, d, point);
+    p += point;
+    *p++ = '.';
+    memcpy(p, d + point, n - point);
+    p += n - point;
+  }
+  else if(point > -6 && point <= 0)
+  {
+    *p++ = '0';
+    *p++ = '.';
+    memset(p, '0', -point);
+    p += -point;
+    memcpy(p, d, n);
+    p += n;
+  }
+  else
+  {
+    *p++ = d[0];
+    if(n > 1)
+    {
+      *p++ = '.';
+      memcpy(p, d + 1, n - 1);
+      p += n - 1;
+    }
+    *p++ = 'e';
+    *p++ = point > 0 ? '+' : '-';
+    p += formatUnsigned(point > 0 ? point - 1 : 1 - point, p);
+  }
+
+  return p - buffer;
+}
+
+size_t formatUnsigned(uint64_t value, char* buffer)
+{
+  char temp[20];
+  char* p = temp + sizeof(temp);
+
+  while(value >= 100)
+  {
+    const unsigned pair = (unsigned)(value % 100) * 2;
+    value /= 100;
+    *--p = digitPairs[pair + 1];
+    *--p = digitPairs[pair];
+  }
+  if(value >= 10)
+  {
+    *--p = digitPairs[value * 2 + 1];
+    *--p = digitPairs[value * 2];
+  }
+  else
+    *--p = (char)('0' + value);
+
+  const size_t length = temp + sizeof(temp) - p;
+  memcpy(buffer, p, length);
+  return length;
+}
+
+size_t formatInteger(int64_t value, char* buffer)
+{
+  if(value < 0)
+  {
+    *buffer = '-';
+    return 1 + formatUnsigned(~(uint64_t)value + 1, buffer + 1);
+  }
+  return formatUnsigned((uint64_t)value, buffer);
+}
+
+// Find the nearest decimal of \p precision significant digits inside the interval of the float:
+struct FloatInterval
+{
+  double value;
+  double lo; //!< Midpoint to the previous float.
+  double hi; //!< Midpoint to the next float.
+  double low; //!< lo with a margin for the rounding errors of scale10(), far below the float resolution.
+  double high;
+  bool even; //!< Midpoints round to the float with an even mantissa.
+  int e10;
+
+  bool contains(double digits, int exponent) const
+  {
+    const double v = scale10(digits, exponent);
+    if(v > low && v < high)
+      return true;
+
+    // Ties can only be decided when the product is exact:
+    return even && exponent >= 0 && v < 9007199254740992.0 && (v == lo || v == hi);
+  }
+
+  bool fits(int precision, uint64_t& digits, int& exponent) const
+  {
+    exponent = e10 - precision + 1;
+    const double m = std::floor(scale10(value, -exponent) + 0.5);
+    if(contains(m, exponent))
+    {
+      digits = (uint64_t)m;
+      return true;
+    }
+
+    // The interval is asymmetric at powers of two, the other neighbour may still fit:
+    const double other = m + (scale10(m, exponent) < value ? 1 : -1);
+    if(other > 0 && contains(other, exponent))
+    {
+      digits = (uint64_t)other;
+      return true;
+    }
+
+    return false;
+  }
+};
+
+size_t formatFloatShortest(float value, char* buffer)
+{
+  if(!std::isfinite(value))
+    return formatSpecial(value, buffer);
+  if(value == 0)
+  {
+    *buffer = '0';
+    return 1;
+  }
+
+  // Every decimal strictly between the midpoints to the neighbouring floats reads back as value,
+  // the midpoints are exact in double precision:
+  const float a = std::fabs(value);
+  const float next = std::nextafter(a, std::numeric_limits<float>::infinity());
+  uint32_t bits;
+  memcpy(&bits, &a, sizeof(bits));
+
+  FloatInterval interval;
+  interval.value = a;
+  interval.lo = ((double)a + (double)std::nextafter(a, 0.0f)) / 2;
+  interval.hi = std::isfinite(next) ? ((double)a + (double)next) / 2 : 2 * (double)a - interval.lo;
+  interval.low = interval.lo * (1 + 1e-15);
+  interval.high = interval.hi * (1 - 1e-15);
+  interval.even = (bits & 1) == 0;
+  interval.e10 = (int)std::floor(std::log10((double)a));
+
+  // If a precision fits, all higher precisions fit too. Nine significant digits always do:
+  int low = 1;
+  int high = 9;
+  uint64_t digits = 0;
+  int exponent = 0;
+  while(low < high)
+  {
+    const int precision = (low + high) / 2;
+    if(interval.fits(precision, digits, exponent))
+      high = precision;
+    else
+      low = precision + 1;
+  }
+
+  if(!interval.fits(high, digits, exponent))
+  {
+    exponent = interval.e10 - 8;
+    digits = (uint64_t)std::floor(scale10(a, -exponent) + 0.5);
+  }
+
+  return formatDecimal(value < 0, digits, exponent, buffer);
+}
+
+size_t formatDoubleShortest(double value, char* buffer)
+{
+  if(!std::isfinite(value))
+    return formatSpecial(value, buffer);
+  if(value == 0)
+  {
+    *buffer = '0';
+    return 1;
+  }
+
+  // Up to 15 significant digits are exact, probe 15 to 17 digits with the C library:
+  char text[NUMBERFORMAT_BUFFER_SIZE];
+  for(int precision = 15; precision <= 17; ++precision)
+  {
+    snprintf(text, sizeof(text), "%.*e", precision - 1, std::fabs(value));
+    if(precision == 17 || strtod(text, 0) == std::fabs(value))
+      break;
+  }
+
+  // Convert d.ddde[+-]x to digits and exponent:
+  uint64_t digits = 0;
+  int count = 0;
+  const char* p = text;
+  for(; *p != 'e'; ++p)
+    if(*p >= '0' && *p <= '9')
+    {
+      digits = digits * 10 + (*p - '0');
+      ++count;
+    }
+  const int exponent = atoi(p + 1) - (count - 1);
+
+  return formatDecimal(value < 0, digits, exponent, buffer);
+}
+
+size_t formatFixed(double value, int precision, char* buffer)
+{
+  if(!std::isfinite(value))
+    return formatSpecial(value, buffer);
+  if(std::fabs(value) >= 1e21)
+    return formatDoubleShortest(value, buffer);
+  if(precision < 0)
+    precision = 0;
+  else if(precision > 20)
+    precision = 20;
+
+  const double scaled = scale10(std::fabs(value), precision);
+  if(scaled >= 9007199254740992.0) // 2^53
+  {
+    // Below 1e21 with at most 20 decimals this fits, the clamp only guards the buffer:
+    const int length = snprintf(buffer, NUMBERFORMAT_BUFFER_SIZE, "%.*f", precision, value);
+    return length > 0 ? std::min<size_t>((size_t)length, NUMBERFORMAT_BUFFER_SIZE - 1) : 0;
+  }
+
+  char d[24];
+  const uint64_t m = (uint64_t)std::floor(scaled + 0.5);
+  size_t n = formatUnsigned(m, d);
+
+  char* p = buffer;
+  if(value < 0)
+    *p++ = '-';
+
+  // Pad with leading zeros so there is at least one digit before the decimal point:
+  if(n <= (size_t)precision)
+  {
+    const size_t zeros = precision + 1 - n;
+    memmove(d + zeros, d, n);
+    memset(d, '0', zeros);
+    n += zeros;
+  }
+
+  const size_t integer = n - precision;
+  memcpy(p, d, integer);
+  p += integer;
+  if(precision > 0)
+  {
+    *p++ = '.';
+    memcpy(p, d + integer, precision);
+    p += precision;
+  }
+
+  return p - buffer;
+}
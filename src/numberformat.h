@@ -0,0 +1,33 @@
+/**
+ * \file numberformat.h
+ * \brief Fast number to text conversion.
+ */
+
+#ifndef _NUMBERFORMAT_H_
+#define _NUMBERFORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#define NUMBERFORMAT_BUFFER_SIZE 48 //!< Large enough for any formatted number, the longest is formatFixed() of -1e20 with 20 decimals at 43 characters.
+
+/**
+ * Format the shortest decimal representation that reads back as the same float, in JavaScript notation.
+ * \return The number of characters written to \p buffer, it is not zero terminated.
+ */
+size_t formatFloatShortest(float value, char* buffer);
+
+/**
+ * Format the shortest decimal representation that reads back as the same double, in JavaScript notation.
+ */
+size_t formatDoubleShortest(double value, char* buffer);
+
+/**
+ * Format with a fixed number of digits after the decimal point, like Number.prototype.toFixed().
+ */
+size_t formatFixed(double value, int precision, char* buffer);
+
+size_t formatInteger(int64_t value, char* buffer);
+size_t formatUnsigned(uint64_t value, char* buffer);
+
+#endif
@@ -0,0 +1,151 @@
+/**
+ * \file object.cc
+ * \brief Base classes of the object oriented interface.
+ */
+
+#include "object.h"
+#include "capabilitycache.h"
+
+LibTiePieObject::LibTiePieObject(LibTiePieHandle_t handle) :
+  m_handle(handle)
+{
+}
+
+LibTiePieObject::~LibTiePieObject()
+{
+  close();
+}
+
+void LibTiePieObject::close()
+{
+  if(m_handle == LIBTIEPIE_HANDLE_INVALID)
+    return;
+
+  CapabilityCache::remove(m_handle);
+  ObjClose(m_handle);
+  m_handle = LIBTIEPIE_HANDLE_INVALID;
+}
+
+void LibTiePieObject::setAccessor(v8::Local<v8::FunctionTemplate> tpl, const char* name, Nan::FunctionCallback getter, Nan::FunctionCallback setter)
+{
+  // The signature makes V8 reject receivers that aren't instances of tpl, so Unwrap() is safe:
+  v8::Local<v8::Signature> signature = Nan::New<v8::Signature>(tpl);
+  v8::Local<v8::FunctionTemplate> get = Nan::New<v8::FunctionTemplate>(getter, v8::Local<v8::Value>(), signature);
+  v8::Local<v8::FunctionTemplate> set;
+  if(setter)
+    set = Nan::New<v8::FunctionTemplate>(setter, v8::Local<v8::Value>(), signature);
+
+  tpl->PrototypeTemplate()->SetAccessorProperty(Nan::New<v8::String>(name).ToLocalChecked(), get, set);
+}
+
+bool LibTiePieObject::getHandle(const Nan::FunctionCallbackInfo<v8::Value>& info, uint64_t requiredInterface, LibTiePieHandle_t& handle)
+{
+  if(!info.IsConstructCall())
+  {
+    Nan::ThrowTypeError("Class constructor cannot be invoked without 'new'");
+    return false;
+  }
+  if(info.Length() != 1 || !info[0]->IsUint32())
+  {
+    Nan::ThrowTypeError("Invalid handle");
+    return false;
+  }
+
+  handle = Nan::To<uint32_t>(info[0]).FromJust();
+  const uint64_t interfaces = ObjGetInterfaces(handle);
+  if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+  {
+    Nan::ThrowError(LibGetLastStatusStr());
+    return false;
+  }
+  if((interfaces & requiredInterface) == 0)
+  {
+    Nan::ThrowTypeError("Handle doesn't support the required interface");
+    return false;
+  }
+
+  return true;
+}
+
+static NAN_METHOD(Close)
+{
+  Nan::ObjectWrap::Unwrap<LibTiePieObject>(info.This())->close();
+  info.GetReturnValue().SetUndefined();
+}
+
+static NAN_METHOD(GetHandle)
+{
+  info.GetReturnValue().Set(Nan::ObjectWrap::Unwrap<LibTiePieObject>(info.This())->tpHandle());
+}
+
+static NAN_METHOD(GetIsRemoved)
+{
+  OBJECT_HANDLE(LibTiePieObject);
+  const bool8_t result = ObjIsRemoved(handle);
+  CHECK_LAST_STATUS();
+  if(result != BOOL8_FALSE)
+    CapabilityCache::remove(handle);
+
+  info.GetReturnValue().Set(result != BOOL8_FALSE);
+}
+
+OBJECT_GETTER(LibTiePieObject, GetInterfaces, double, (double)ObjGetInterfaces(handle))
+
+void LibTiePieObject::initPrototype(v8::Local<v8::FunctionTemplate> tpl)
+{
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "close", Close);
+  setAccessor(tpl, "handle", GetHandle);
+  setAccessor(tpl, "isRemoved", GetIsRemoved);
+  setAccessor(tpl, "interfaces", GetInterfaces);
+}
+
+#define DEVICE_STRING_GETTER(name, key, function) \
+  static NAN_METHOD(name) \
+  { \
+    OBJECT_HANDLE(Device); \
+    v8::Local<v8::String> result; \
+    if(!CapabilityCache::getString(handle, key, [&](char* buffer, uint32_t length) { return function(handle, buffer, length); }, result)) \
+      CHECK_LAST_STATUS(); \
+    info.GetReturnValue().Set(result); \
+  }
+
+DEVICE_STRING_GETTER(GetName, CAPABILITYCACHE_STRING_NAME, DevGetName)
+DEVICE_STRING_GETTER(GetNameShort, CAPABILITYCACHE_STRING_NAMESHORT, DevGetNameShort)
+DEVICE_STRING_GETTER(GetNameShortest, CAPABILITYCACHE_STRING_NAMESHORTEST, DevGetNameShortest)
+OBJECT_GETTER(Device, GetSerialNumber, uint32_t, DevGetSerialNumber(handle))
+OBJECT_GETTER(Device, GetProductId, uint32_t, DevGetProductId(handle))
+OBJECT_GETTER(Device, GetVendorId, uint32_t, DevGetVendorId(handle))
+OBJECT_GETTER(Device, GetType, uint32_t, DevGetType(handle))
+OBJECT_GETTER(Device, GetDriverVersion, v8::Local<v8::String>, Nan::New(tpVersionToStr(DevGetDriverVersion(handle))).ToLocalChecked())
+OBJECT_GETTER(Device, GetFirmwareVersion, v8::Local<v8::String>, Nan::New(tpVersionToStr(DevGetFirmwareVersion(handle))).ToLocalChecked())
+OBJECT_GETTER(Device, GetCalibrationDate, uint32_t, DevGetCalibrationDate(handle))
+OBJECT_GETTER(Device, GetIPv4Address, uint32_t, DevGetIPv4Address(handle))
+OBJECT_GETTER(Device, GetIPPort, uint32_t, DevGetIPPort(handle))
+OBJECT_GETTER(Device, GetHasBattery, bool, DevHasBattery(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Device, GetBatteryCharge, int32_t, DevGetBatteryCharge(handle))
+OBJECT_GETTER(Device, GetTriggerInputCount, uint32_t, DevTrGetInputCount(handle))
+OBJECT_GETTER(Device, GetTriggerOutputCount, uint32_t, DevTrGetOutputCount(handle))
+
+void Device::initPrototype(v8::Local<v8::FunctionTemplate> tpl)
+{
+  LibTiePieObject::initPrototype(tpl);
+
+  setAccessor(tpl, "name", GetName);
+  setAccessor(tpl, "nameShort", GetNameShort);
+  setAccessor(tpl, "nameShortest", GetNameShortest);
+  setAccessor(tpl, "serialNumber", GetSerialNumber);
+  setAccessor(tpl, "productId", GetProductId);
+  setAccessor(tpl, "vendorId", GetVendorId);
+  setAccessor(tpl, "type", GetType);
+  setAccessor(tpl, "driverVersion", GetDriverVersion);
+  setAccessor(tpl, "firmwareVersion", GetFirmwareVersion);
+  setAccessor(tpl, "calibrationDate", GetCalibrationDate);
+  setAccessor(tpl, "ipv4Address", GetIPv4Address);
+  setAccessor(tpl, "ipPort", GetIPPort);
+  setAccessor(tpl, "hasBattery", GetHasBattery);
+  setAccessor(tpl, "batteryCharge", GetBatteryCharge);
+  setAccessor(tpl, "triggerInputCount", GetTriggerInputCount);
+  setAccessor(tpl, "triggerOutputCount", GetTriggerOutputCount);
+}
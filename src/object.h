@@ -0,0 +1,86 @@
+/**
+ * \file object.h
+ * \brief Base classes of the object oriented interface.
+ *
+ * An object owns its LibTiePie handle, the handle is closed by close() or when the object is garbage collected.
+ * Properties are accessors on the prototype that take the handle from the object, so they skip the argument
+ * conversion and checks the flat api functions need.
+ */
+
+#ifndef _OBJECT_H_
+#define _OBJECT_H_
+
+#include "common.h"
+
+// Accessor helpers, they define handle (and ch for channels) for the expression or statement:
+#define OBJECT_HANDLE(T) \
+  const LibTiePieHandle_t handle = Nan::ObjectWrap::Unwrap<T>(info.This())->tpHandle(); \
+  if(handle == LIBTIEPIE_HANDLE_INVALID) \
+    return Nan::ThrowError("Object is closed");
+
+#define OBJECT_GETTER(T, name, type, expression) \
+  static NAN_METHOD(name) \
+  { \
+    OBJECT_HANDLE(T); \
+    const type result = expression; \
+    CHECK_LAST_STATUS(); \
+    info.GetReturnValue().Set(result); \
+  }
+
+#define OBJECT_SETTER(T, name, type, statement) \
+  static NAN_METHOD(name) \
+  { \
+    OBJECT_HANDLE(T); \
+    const type value = Nan::To<type>(info[0]).FromJust(); \
+    statement; \
+    CHECK_LAST_STATUS(); \
+  }
+
+class LibTiePieObject : public Nan::ObjectWrap
+{
+  public:
+    LibTiePieHandle_t tpHandle() const
+    {
+      return m_handle;
+    }
+
+    void close();
+
+    /**
+     * Define an accessor property on the prototype of \p tpl, \p setter may be null for a read only property.
+     */
+    static void setAccessor(v8::Local<v8::FunctionTemplate> tpl, const char* name, Nan::FunctionCallback getter, Nan::FunctionCallback setter = 0);
+
+  protected:
+    explicit LibTiePieObject(LibTiePieHandle_t handle);
+    ~LibTiePieObject();
+
+    /**
+     * Add the methods and properties every object has: close(), handle, isRemoved and interfaces.
+     */
+    static void initPrototype(v8::Local<v8::FunctionTemplate> tpl);
+
+    /**
+     * Get the handle passed to a constructor, throws when it doesn't support \p requiredInterface.
+     */
+    static bool getHandle(const Nan::FunctionCallbackInfo<v8::Value>& info, uint64_t requiredInterface, LibTiePieHandle_t& handle);
+
+  private:
+    LibTiePieHandle_t m_handle;
+};
+
+class Device : public LibTiePieObject
+{
+  protected:
+    explicit Device(LibTiePieHandle_t handle) :
+      LibTiePieObject(handle)
+    {
+    }
+
+    /**
+     * Add the device properties: name, serialNumber, driverVersion...
+     */
+    static void initPrototype(v8::Local<v8::FunctionTemplate> tpl);
+};
+
+#endif
@@ -0,0 +1,464 @@
+/**
+ * \file oscilloscope.cc
+ * \brief Object oriented oscilloscope interface.
+ */
+
+#include "oscilloscope.h"
+#include "capabilitycache.h"
+#include "instance.h"
+#include "rawcapture.h"
+#include "scopeconfig.h"
+
+#define CHANNEL_HANDLE() \
+  const OscilloscopeChannel* channel = Nan::ObjectWrap::Unwrap<OscilloscopeChannel>(info.This()); \
+  const LibTiePieHandle_t handle = channel->tpHandle(); \
+  if(handle == LIBTIEPIE_HANDLE_INVALID) \
+    return Nan::ThrowError("Object is closed"); \
+  const uint16_t ch = channel->index();
+
+#define CHANNEL_GETTER(name, type, expression) \
+  static NAN_METHOD(name) \
+  { \
+    CHANNEL_HANDLE(); \
+    const type result = expression; \
+    CHECK_LAST_STATUS(); \
+    info.GetReturnValue().Set(result); \
+  }
+
+#define CHANNEL_SETTER(name, type, statement) \
+  static NAN_METHOD(name) \
+  { \
+    CHANNEL_HANDLE(); \
+    const type value = Nan::To<type>(info[0]).FromJust(); \
+    statement; \
+    CHECK_LAST_STATUS(); \
+  }
+
+// Indexed trigger properties: get(index) and set(index, value).
+#define CHANNEL_INDEXED_GETTER(name, function) \
+  static NAN_METHOD(name) \
+  { \
+    CHECK_PARAMETER_COUNT(1); \
+    CHANNEL_HANDLE(); \
+    const double result = function(handle, ch, Nan::To<uint32_t>(info[0]).FromJust()); \
+    CHECK_LAST_STATUS(); \
+    info.GetReturnValue().Set(result); \
+  }
+
+#define CHANNEL_INDEXED_SETTER(name, function) \
+  static NAN_METHOD(name) \
+  { \
+    CHECK_PARAMETER_COUNT(2); \
+    CHANNEL_HANDLE(); \
+    const double result = function(handle, ch, Nan::To<uint32_t>(info[0]).FromJust(), Nan::To<double>(info[1]).FromJust()); \
+    CHECK_LAST_STATUS(); \
+    info.GetReturnValue().Set(result); \
+  }
+
+OBJECT_GETTER(Oscilloscope, GetChannelCount, uint32_t, ScpGetChannelCount(handle))
+OBJECT_GETTER(Oscilloscope, GetMeasureModes, uint32_t, ScpGetMeasureModes(handle))
+OBJECT_GETTER(Oscilloscope, GetMeasureMode, uint32_t, ScpGetMeasureMode(handle))
+OBJECT_SETTER(Oscilloscope, SetMeasureMode, uint32_t, { ScpSetMeasureMode(handle, value); CapabilityCache::invalidate(handle); })
+OBJECT_GETTER(Oscilloscope, GetResolution, uint32_t, ScpGetResolution(handle))
+OBJECT_SETTER(Oscilloscope, SetResolution, uint32_t, { CHECK_RANGE(value, std::numeric_limits<uint8_t>::min(), std::numeric_limits<uint8_t>::max()); ScpSetResolution(handle, (uint8_t)value); CapabilityCache::invalidate(handle); })
+OBJECT_GETTER(Oscilloscope, GetIsResolutionEnhanced, bool, ScpIsResolutionEnhanced(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Oscilloscope, GetAutoResolutionModes, uint32_t, ScpGetAutoResolutionModes(handle))
+OBJECT_GETTER(Oscilloscope, GetAutoResolutionMode, uint32_t, ScpGetAutoResolutionMode(handle))
+OBJECT_SETTER(Oscilloscope, SetAutoResolutionMode, uint32_t, { ScpSetAutoResolutionMode(handle, value); CapabilityCache::invalidate(handle); })
+OBJECT_GETTER(Oscilloscope, GetClockSources, uint32_t, ScpGetClockSources(handle))
+OBJECT_GETTER(Oscilloscope, GetClockSource, uint32_t, ScpGetClockSource(handle))
+OBJECT_SETTER(Oscilloscope, SetClockSource, uint32_t, { ScpSetClockSource(handle, value); CapabilityCache::invalidate(handle); })
+OBJECT_GETTER(Oscilloscope, GetSampleFrequency, double, ScpGetSampleFrequency(handle))
+OBJECT_SETTER(Oscilloscope, SetSampleFrequency, double, ScpSetSampleFrequency(handle, value))
+OBJECT_GETTER(Oscilloscope, GetRecordLengthMax, double, (double)ScpGetRecordLengthMax(handle))
+OBJECT_GETTER(Oscilloscope, GetRecordLength, double, (double)ScpGetRecordLength(handle))
+OBJECT_SETTER(Oscilloscope, SetRecordLength, double, ScpSetRecordLength(handle, (uint64_t)value))
+OBJECT_GETTER(Oscilloscope, GetPreSampleRatio, double, ScpGetPreSampleRatio(handle))
+OBJECT_SETTER(Oscilloscope, SetPreSampleRatio, double, ScpSetPreSampleRatio(handle, value))
+OBJECT_GETTER(Oscilloscope, GetSegmentCountMax, uint32_t, ScpGetSegmentCountMax(handle))
+OBJECT_GETTER(Oscilloscope, GetSegmentCount, uint32_t, ScpGetSegmentCount(handle))
+OBJECT_SETTER(Oscilloscope, SetSegmentCount, uint32_t, ScpSetSegmentCount(handle, value))
+OBJECT_GETTER(Oscilloscope, GetValidPreSampleCount, double, (double)ScpGetValidPreSampleCount(handle))
+OBJECT_GETTER(Oscilloscope, GetHasTrigger, bool, ScpHasTrigger(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Oscilloscope, GetTriggerTimeOut, double, ScpGetTriggerTimeOut(handle))
+OBJECT_SETTER(Oscilloscope, SetTriggerTimeOut, double, ScpSetTriggerTimeOut(handle, value))
+OBJECT_GETTER(Oscilloscope, GetTriggerDelayMax, double, ScpGetTriggerDelayMax(handle))
+OBJECT_GETTER(Oscilloscope, GetTriggerDelay, double, ScpGetTriggerDelay(handle))
+OBJECT_SETTER(Oscilloscope, SetTriggerDelay, double, ScpSetTriggerDelay(handle, value))
+OBJECT_GETTER(Oscilloscope, GetTriggerHoldOffCountMax, double, (double)ScpGetTriggerHoldOffCountMax(handle))
+OBJECT_GETTER(Oscilloscope, GetTriggerHoldOffCount, double, (double)ScpGetTriggerHoldOffCount(handle))
+OBJECT_SETTER(Oscilloscope, SetTriggerHoldOffCount, double, ScpSetTriggerHoldOffCount(handle, (uint64_t)value))
+OBJECT_GETTER(Oscilloscope, GetIsRunning, bool, ScpIsRunning(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Oscilloscope, GetIsTriggered, bool, ScpIsTriggered(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Oscilloscope, GetIsTimeOutTriggered, bool, ScpIsTimeOutTriggered(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Oscilloscope, GetIsForceTriggered, bool, ScpIsForceTriggered(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Oscilloscope, GetIsDataReady, bool, ScpIsDataReady(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Oscilloscope, GetIsDataOverflow, bool, ScpIsDataOverflow(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Oscilloscope, Start, bool, ScpStart(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Oscilloscope, Stop, bool, ScpStop(handle) != BOOL8_FALSE)
+OBJECT_GETTER(Oscilloscope, ForceTrigger, bool, ScpForceTrigger(handle) != BOOL8_FALSE)
+
+static NAN_METHOD(GetResolutions)
+{
+  OBJECT_HANDLE(Oscilloscope);
+  v8::Local<v8::TypedArray> result;
+  if(!CapabilityCache::getScpResolutions(handle, result))
+    CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set(result);
+}
+
+static NAN_METHOD(GetSampleFrequencyMax)
+{
+  OBJECT_HANDLE(Oscilloscope);
+  double result;
+  if(!CapabilityCache::getScpSampleFrequencyMax(handle, result))
+    CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set(result);
+}
+
+static NAN_METHOD(GetConfig)
+{
+  OBJECT_HANDLE(Oscilloscope);
+  info.GetReturnValue().Set(readScopeConfig(handle));
+}
+
+static NAN_METHOD(SetConfig)
+{
+  OBJECT_HANDLE(Oscilloscope);
+  if(!info[0]->IsObject())
+    return Nan::ThrowTypeError("Invalid config");
+
+  std::string error;
+  if(!validateScopeConfig(info[0].As<v8::Object>(), error))
+    return Nan::ThrowTypeError(error.c_str());
+
+  const bool applied = applyScopeConfig(handle, info[0].As<v8::Object>(), error);
+  CapabilityCache::invalidate(handle);
+  if(!applied)
+    return Nan::ThrowError(error.c_str());
+}
+
+/**
+ * getData([startIndex[, sampleCount]]), returns a Float32Array per channel, null for disabled channels. The sample
+ * count is limited to the rest of the record.
+ */
+static NAN_METHOD(GetData)
+{
+  OBJECT_HANDLE(Oscilloscope);
+  const uint16_t channelCount = ScpGetChannelCount(handle);
+  CHECK_LAST_STATUS();
+
+  const uint64_t startIndex = (info.Length() > 0 && !info[0]->IsUndefined()) ? (uint64_t)Nan::To<double>(info[0]).FromJust() : 0;
+  const uint64_t recordLength = ScpGetRecordLength(handle);
+  CHECK_LAST_STATUS();
+  uint64_t sampleCount = startIndex < recordLength ? recordLength - startIndex : 0;
+  if(info.Length() > 1 && !info[1]->IsUndefined())
+    sampleCount = std::min(sampleCount, (uint64_t)Nan::To<double>(info[1]).FromJust()); // No arrays larger than the record.
+
+  v8::Local<v8::Array> result = Nan::New<v8::Array>(channelCount);
+  std::vector<float*> pointers(channelCount, (float*)0);
+  for(uint16_t ch = 0; ch < channelCount; ++ch)
+  {
+    if(ScpChGetEnabled(handle, ch) != BOOL8_FALSE)
+      Nan::Set(result, ch, NewFloat32Array(sampleCount, pointers[ch]));
+    else
+      Nan::Set(result, ch, Nan::Null());
+  }
+
+  const uint64_t count = ScpGetData(handle, &pointers[0], channelCount, startIndex, sampleCount);
+  CHECK_LAST_STATUS();
+
+  if(count < sampleCount)
+  {
+    for(uint16_t ch = 0; ch < channelCount; ++ch)
+    {
+      if(!pointers[ch])
+        continue;
+      v8::Local<v8::Float32Array> data = Nan::Get(result, ch).ToLocalChecked().As<v8::Float32Array>();
+      Nan::Set(result, ch, v8::Float32Array::New(data->Buffer(), 0, count));
+    }
+  }
+
+  info.GetReturnValue().Set(result);
+}
+
+/**
+ * getDataInto(buffers[, startIndex]), reads into the Float32Array per channel of buffers, returns the sample count.
+ */
+static NAN_METHOD(GetDataInto)
+{
+  OBJECT_HANDLE(Oscilloscope);
+  std::vector<float*> pointers;
+  uint64_t sampleCount;
+  if(info.Length() < 1 || !FloatArrayList(info[0], pointers, sampleCount) || pointers.empty() || pointers.size() > std::numeric_limits<uint16_t>::max())
+    return Nan::ThrowTypeError("Invalid buffers");
+  const uint64_t startIndex = (info.Length() > 1 && !info[1]->IsUndefined()) ? (uint64_t)Nan::To<double>(info[1]).FromJust() : 0;
+
+  const uint64_t result = ScpGetData(handle, &pointers[0], (uint16_t)pointers.size(), startIndex, sampleCount);
+  CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set((double)result);
+}
+
+/**
+ * getRawCapture([startIndex[, sampleCount]]), returns a RawCapture with the raw data of the enabled channels.
+ */
+static NAN_METHOD(GetRawCapture)
+{
+  OBJECT_HANDLE(Oscilloscope);
+  const uint64_t startIndex = (info.Length() > 0 && !info[0]->IsUndefined()) ? (uint64_t)Nan::To<double>(info[0]).FromJust() : 0;
+  uint64_t sampleCount;
+  if(info.Length() > 1 && !info[1]->IsUndefined())
+    sampleCount = (uint64_t)Nan::To<double>(info[1]).FromJust();
+  else
+  {
+    const uint64_t recordLength = ScpGetRecordLength(handle);
+    CHECK_LAST_STATUS();
+    sampleCount = startIndex < recordLength ? recordLength - startIndex : 0;
+  }
+
+  v8::Local<v8::Object> result;
+  if(!RawCapture::read(handle, startIndex, sampleCount, result))
+    return Nan::ThrowError(LibGetLastStatusStr());
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_MODULE_INIT(Oscilloscope::Init)
+{
+  OscilloscopeChannel::Init();
+
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("Oscilloscope").ToLocalChecked());
+  Device::initPrototype(tpl);
+
+  Nan::SetPrototypeMethod(tpl, "start", Start);
+  Nan::SetPrototypeMethod(tpl, "stop", Stop);
+  Nan::SetPrototypeMethod(tpl, "forceTrigger", ForceTrigger);
+  Nan::SetPrototypeMethod(tpl, "getData", GetData);
+  Nan::SetPrototypeMethod(tpl, "getDataInto", GetDataInto);
+  Nan::SetPrototypeMethod(tpl, "getRawCapture", GetRawCapture);
+
+  setAccessor(tpl, "channelCount", GetChannelCount);
+  setAccessor(tpl, "measureModes", GetMeasureModes);
+  setAccessor(tpl, "measureMode", GetMeasureMode, SetMeasureMode);
+  setAccessor(tpl, "resolutions", GetResolutions);
+  setAccessor(tpl, "resolution", GetResolution, SetResolution);
+  setAccessor(tpl, "isResolutionEnhanced", GetIsResolutionEnhanced);
+  setAccessor(tpl, "autoResolutionModes", GetAutoResolutionModes);
+  setAccessor(tpl, "autoResolutionMode", GetAutoResolutionMode, SetAutoResolutionMode);
+  setAccessor(tpl, "clockSources", GetClockSources);
+  setAccessor(tpl, "clockSource", GetClockSource, SetClockSource);
+  setAccessor(tpl, "sampleFrequencyMax", GetSampleFrequencyMax);
+  setAccessor(tpl, "sampleFrequency", GetSampleFrequency, SetSampleFrequency);
+  setAccessor(tpl, "recordLengthMax", GetRecordLengthMax);
+  setAccessor(tpl, "recordLength", GetRecordLength, SetRecordLength);
+  setAccessor(tpl, "preSampleRatio", GetPreSampleRatio, SetPreSampleRatio);
+  setAccessor(tpl, "segmentCountMax", GetSegmentCountMax);
+  setAccessor(tpl, "segmentCount", GetSegmentCount, SetSegmentCount);
+  setAccessor(tpl, "validPreSampleCount", GetValidPreSampleCount);
+  setAccessor(tpl, "hasTrigger", GetHasTrigger);
+  setAccessor(tpl, "triggerTimeOut", GetTriggerTimeOut, SetTriggerTimeOut);
+  setAccessor(tpl, "triggerDelayMax", GetTriggerDelayMax);
+  setAccessor(tpl, "triggerDelay", GetTriggerDelay, SetTriggerDelay);
+  setAccessor(tpl, "triggerHoldOffCountMax", GetTriggerHoldOffCountMax);
+  setAccessor(tpl, "triggerHoldOffCount", GetTriggerHoldOffCount, SetTriggerHoldOffCount);
+  setAccessor(tpl, "isRunning", GetIsRunning);
+  setAccessor(tpl, "isTriggered", GetIsTriggered);
+  setAccessor(tpl, "isTimeOutTriggered", GetIsTimeOutTriggered);
+  setAccessor(tpl, "isForceTriggered", GetIsForceTriggered);
+  setAccessor(tpl, "isDataReady", GetIsDataReady);
+  setAccessor(tpl, "isDataOverflow", GetIsDataOverflow);
+  setAccessor(tpl, "config", GetConfig, SetConfig);
+
+  Nan::SetMethod(tpl, "open", Open);
+
+  v8::Local<v8::Function> constructor = Nan::GetFunction(tpl).ToLocalChecked();
+  Instance::current()->oscilloscope.Reset(constructor);
+
+  Nan::Set(target, Nan::New<v8::String>("Oscilloscope").ToLocalChecked(), constructor);
+}
+
+NAN_METHOD(Oscilloscope::New)
+{
+  LibTiePieHandle_t handle;
+  if(!getHandle(info, LIBTIEPIE_INTERFACE_OSCILLOSCOPE, handle))
+    return;
+
+  const uint16_t channelCount = ScpGetChannelCount(handle);
+  CHECK_LAST_STATUS();
+
+  Oscilloscope* obj = new Oscilloscope(handle);
+  obj->Wrap(info.This());
+
+  v8::Local<v8::Array> channels = Nan::New<v8::Array>(channelCount);
+  for(uint16_t ch = 0; ch < channelCount; ++ch)
+    Nan::Set(channels, ch, OscilloscopeChannel::NewInstance(info.This(), ch));
+  Nan::SetIntegrityLevel(channels, v8::IntegrityLevel::kFrozen);
+  Nan::DefineOwnProperty(info.This(), Nan::New<v8::String>("channels").ToLocalChecked(), channels, v8::ReadOnly);
+
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(Oscilloscope::Open)
+{
+  CHECK_PARAMETER_COUNT(2);
+  const uint32_t idKind = Nan::To<uint32_t>(info[0]).FromJust();
+  const uint32_t id = Nan::To<uint32_t>(info[1]).FromJust();
+
+  const LibTiePieHandle_t handle = LstOpenOscilloscope(idKind, id);
+  CHECK_LAST_STATUS();
+  CapabilityCache::open(handle);
+
+  v8::Local<v8::Value> argv[] = {Nan::New<v8::Uint32>(handle)};
+  v8::Local<v8::Object> result;
+  if(!Nan::NewInstance(Nan::New(Instance::current()->oscilloscope), 1, argv).ToLocal(&result))
+  {
+    CapabilityCache::remove(handle);
+    ObjClose(handle);
+    return;
+  }
+
+  info.GetReturnValue().Set(result);
+}
+
+CHANNEL_GETTER(GetIndex, uint32_t, ch)
+CHANNEL_GETTER(GetIsAvailable, bool, ScpChIsAvailable(handle, ch) != BOOL8_FALSE)
+CHANNEL_GETTER(GetConnectorType, uint32_t, ScpChGetConnectorType(handle, ch))
+CHANNEL_GETTER(GetIsDifferential, bool, ScpChIsDifferential(handle, ch) != BOOL8_FALSE)
+CHANNEL_GETTER(GetImpedance, double, ScpChGetImpedance(handle, ch))
+CHANNEL_GETTER(GetEnabled, bool, ScpChGetEnabled(handle, ch) != BOOL8_FALSE)
+CHANNEL_SETTER(SetEnabled, bool, { ScpChSetEnabled(handle, ch, value ? BOOL8_TRUE : BOOL8_FALSE); CapabilityCache::invalidate(handle); })
+CHANNEL_GETTER(GetCouplings, double, (double)ScpChGetCouplings(handle, ch))
+CHANNEL_GETTER(GetCoupling, double, (double)ScpChGetCoupling(handle, ch))
+CHANNEL_SETTER(SetCoupling, double, { ScpChSetCoupling(handle, ch, (uint64_t)value); CapabilityCache::invalidateChannel(handle, ch); })
+CHANNEL_GETTER(GetRange, double, ScpChGetRange(handle, ch))
+CHANNEL_SETTER(SetRange, double, ScpChSetRange(handle, ch, value))
+CHANNEL_GETTER(GetAutoRanging, bool, ScpChGetAutoRanging(handle, ch) != BOOL8_FALSE)
+CHANNEL_SETTER(SetAutoRanging, bool, ScpChSetAutoRanging(handle, ch, value ? BOOL8_TRUE : BOOL8_FALSE))
+CHANNEL_GETTER(GetProbeGain, double, ScpChGetProbeGain(handle, ch))
+CHANNEL_SETTER(SetProbeGain, double, { ScpChSetProbeGain(handle, ch, value); CapabilityCache::invalidateChannel(handle, ch); })
+CHANNEL_GETTER(GetProbeOffset, double, ScpChGetProbeOffset(handle, ch))
+CHANNEL_SETTER(SetProbeOffset, double, { ScpChSetProbeOffset(handle, ch, value); CapabilityCache::invalidateChannel(handle, ch); })
+CHANNEL_GETTER(GetBandwidth, double, ScpChGetBandwidth(handle, ch))
+CHANNEL_SETTER(SetBandwidth, double, ScpChSetBandwidth(handle, ch, value))
+CHANNEL_GETTER(GetDataValueMin, double, ScpChGetDataValueMin(handle, ch))
+CHANNEL_GETTER(GetDataValueMax, double, ScpChGetDataValueMax(handle, ch))
+CHANNEL_GETTER(GetChHasTrigger, bool, ScpChHasTrigger(handle, ch) != BOOL8_FALSE)
+CHANNEL_GETTER(GetTriggerEnabled, bool, ScpChTrGetEnabled(handle, ch) != BOOL8_FALSE)
+CHANNEL_SETTER(SetTriggerEnabled, bool, ScpChTrSetEnabled(handle, ch, value ? BOOL8_TRUE : BOOL8_FALSE))
+CHANNEL_GETTER(GetTriggerKind, double, (double)ScpChTrGetKind(handle, ch))
+CHANNEL_SETTER(SetTriggerKind, double, ScpChTrSetKind(handle, ch, (uint64_t)value))
+CHANNEL_GETTER(GetTriggerLevelModes, uint32_t, ScpChTrGetLevelModes(handle, ch))
+CHANNEL_GETTER(GetTriggerLevelMode, uint32_t, ScpChTrGetLevelMode(handle, ch))
+CHANNEL_SETTER(SetTriggerLevelMode, uint32_t, ScpChTrSetLevelMode(handle, ch, value))
+CHANNEL_GETTER(GetTriggerConditions, uint32_t, ScpChTrGetConditions(handle, ch))
+CHANNEL_GETTER(GetTriggerCondition, uint32_t, ScpChTrGetCondition(handle, ch))
+CHANNEL_SETTER(SetTriggerCondition, uint32_t, ScpChTrSetCondition(handle, ch, value))
+CHANNEL_GETTER(GetTriggerLevelCount, uint32_t, ScpChTrGetLevelCount(handle, ch))
+CHANNEL_GETTER(GetTriggerHysteresisCount, uint32_t, ScpChTrGetHysteresisCount(handle, ch))
+CHANNEL_GETTER(GetTriggerTimeCount, uint32_t, ScpChTrGetTimeCount(handle, ch))
+CHANNEL_INDEXED_GETTER(GetTriggerLevel, ScpChTrGetLevel)
+CHANNEL_INDEXED_SETTER(SetTriggerLevel, ScpChTrSetLevel)
+CHANNEL_INDEXED_GETTER(GetTriggerHysteresis, ScpChTrGetHysteresis)
+CHANNEL_INDEXED_SETTER(SetTriggerHysteresis, ScpChTrSetHysteresis)
+CHANNEL_INDEXED_GETTER(GetTriggerTime, ScpChTrGetTime)
+CHANNEL_INDEXED_SETTER(SetTriggerTime, ScpChTrSetTime)
+
+static NAN_METHOD(GetRanges)
+{
+  CHANNEL_HANDLE();
+  v8::Local<v8::TypedArray> result;
+  if(!CapabilityCache::getScpChRanges(handle, ch, result))
+    CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set(result);
+}
+
+static NAN_METHOD(GetBandwidths)
+{
+  CHANNEL_HANDLE();
+  v8::Local<v8::TypedArray> result;
+  if(!CapabilityCache::getScpChBandwidths(handle, ch, result))
+    CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set(result);
+}
+
+static NAN_METHOD(GetTriggerKinds)
+{
+  CHANNEL_HANDLE();
+  uint64_t result;
+  if(!CapabilityCache::getScpChTrKinds(handle, ch, result))
+    CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set((double)result);
+}
+
+void OscilloscopeChannel::Init()
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("OscilloscopeChannel").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "getTriggerLevel", GetTriggerLevel);
+  Nan::SetPrototypeMethod(tpl, "setTriggerLevel", SetTriggerLevel);
+  Nan::SetPrototypeMethod(tpl, "getTriggerHysteresis", GetTriggerHysteresis);
+  Nan::SetPrototypeMethod(tpl, "setTriggerHysteresis", SetTriggerHysteresis);
+  Nan::SetPrototypeMethod(tpl, "getTriggerTime", GetTriggerTime);
+  Nan::SetPrototypeMethod(tpl, "setTriggerTime", SetTriggerTime);
+
+  LibTiePieObject::setAccessor(tpl, "index", GetIndex);
+  LibTiePieObject::setAccessor(tpl, "isAvailable", GetIsAvailable);
+  LibTiePieObject::setAccessor(tpl, "connectorType", GetConnectorType);
+  LibTiePieObject::setAccessor(tpl, "isDifferential", GetIsDifferential);
+  LibTiePieObject::setAccessor(tpl, "impedance", GetImpedance);
+  LibTiePieObject::setAccessor(tpl, "enabled", GetEnabled, SetEnabled);
+  LibTiePieObject::setAccessor(tpl, "couplings", GetCouplings);
+  LibTiePieObject::setAccessor(tpl, "coupling", GetCoupling, SetCoupling);
+  LibTiePieObject::setAccessor(tpl, "ranges", GetRanges);
+  LibTiePieObject::setAccessor(tpl, "range", GetRange, SetRange);
+  LibTiePieObject::setAccessor(tpl, "autoRanging", GetAutoRanging, SetAutoRanging);
+  LibTiePieObject::setAccessor(tpl, "probeGain", GetProbeGain, SetProbeGain);
+  LibTiePieObject::setAccessor(tpl, "probeOffset", GetProbeOffset, SetProbeOffset);
+  LibTiePieObject::setAccessor(tpl, "bandwidths", GetBandwidths);
+  LibTiePieObject::setAccessor(tpl, "bandwidth", GetBandwidth, SetBandwidth);
+  LibTiePieObject::setAccessor(tpl, "dataValueMin", GetDataValueMin);
+  LibTiePieObject::setAccessor(tpl, "dataValueMax", GetDataValueMax);
+  LibTiePieObject::setAccessor(tpl, "hasTrigger", GetChHasTrigger);
+  LibTiePieObject::setAccessor(tpl, "triggerEnabled", GetTriggerEnabled, SetTriggerEnabled);
+  LibTiePieObject::setAccessor(tpl, "triggerKinds", GetTriggerKinds);
+  LibTiePieObject::setAccessor(tpl, "triggerKind", GetTriggerKind, SetTriggerKind);
+  LibTiePieObject::setAccessor(tpl, "triggerLevelModes", GetTriggerLevelModes);
+  LibTiePieObject::setAccessor(tpl, "triggerLevelMode", GetTriggerLevelMode, SetTriggerLevelMode);
+  LibTiePieObject::setAccessor(tpl, "triggerConditions", GetTriggerConditions);
+  LibTiePieObject::setAccessor(tpl, "triggerCondition", GetTriggerCondition, SetTriggerCondition);
+  LibTiePieObject::setAccessor(tpl, "triggerLevelCount", GetTriggerLevelCount);
+  LibTiePieObject::setAccessor(tpl, "triggerHysteresisCount", GetTriggerHysteresisCount);
+  LibTiePieObject::setAccessor(tpl, "triggerTimeCount", GetTriggerTimeCount);
+
+  Instance::current()->oscilloscopeChannel.Reset(Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+v8::Local<v8::Object> OscilloscopeChannel::NewInstance(v8::Local<v8::Object> oscilloscope, uint16_t ch)
+{
+  Nan::EscapableHandleScope scope;
+  v8::Local<v8::Value> argv[] = {oscilloscope, Nan::New<v8::External>(Nan::ObjectWrap::Unwrap<Oscilloscope>(oscilloscope)), Nan::New<v8::Uint32>(ch)};
+  return scope.Escape(Nan::NewInstance(Nan::New(Instance::current()->oscilloscopeChannel), 3, argv).ToLocalChecked());
+}
+
+NAN_METHOD(OscilloscopeChannel::New)
+{
+  // Only constructed by Oscilloscope, JavaScript can't create an External:
+  if(info.Length() != 3 || !info[1]->IsExternal())
+    return Nan::ThrowTypeError("Illegal constructor");
+
+  Oscilloscope* oscilloscope = static_cast<Oscilloscope*>(info[1].As<v8::External>()->Value());
+  OscilloscopeChannel* obj = new OscilloscopeChannel(oscilloscope, (uint16_t)Nan::To<uint32_t>(info[2]).FromJust());
+  obj->Wrap(info.This());
+  Nan::DefineOwnProperty(info.This(), Nan::New<v8::String>("oscilloscope").ToLocalChecked(), info[0], (v8::PropertyAttribute)(v8::ReadOnly | v8::DontEnum));
+
+  info.GetReturnValue().Set(info.This());
+}
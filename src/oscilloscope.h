@@ -0,0 +1,66 @@
+/**
+ * \file oscilloscope.h
+ * \brief Object oriented oscilloscope interface.
+ *
+ *     const scp = libtiepie.Oscilloscope.open(libtiepie.const.IDKIND_INDEX, 0);
+ *     scp.recordLength = 10000;
+ *     scp.channels[0].range = 8;
+ *     scp.start();
+ *     ...
+ *     const data = scp.getData();
+ *     scp.close();
+ */
+
+#ifndef _OSCILLOSCOPE_H_
+#define _OSCILLOSCOPE_H_
+
+#include "object.h"
+
+class Oscilloscope : public Device
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    explicit Oscilloscope(LibTiePieHandle_t handle) :
+      Device(handle)
+    {
+    }
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Open);
+};
+
+/**
+ * A channel keeps its oscilloscope alive through its \c oscilloscope property.
+ */
+class OscilloscopeChannel : public Nan::ObjectWrap
+{
+  public:
+    static void Init();
+    static v8::Local<v8::Object> NewInstance(v8::Local<v8::Object> oscilloscope, uint16_t ch);
+
+    LibTiePieHandle_t tpHandle() const
+    {
+      return m_oscilloscope->tpHandle();
+    }
+
+    uint16_t index() const
+    {
+      return m_index;
+    }
+
+  private:
+    OscilloscopeChannel(Oscilloscope* oscilloscope, uint16_t ch) :
+      m_oscilloscope(oscilloscope),
+      m_index(ch)
+    {
+    }
+
+    static NAN_METHOD(New);
+
+    Oscilloscope* m_oscilloscope;
+    uint16_t m_index;
+};
+
+#endif
@@ -0,0 +1,331 @@
+/**
+ * \file persistence.cc
+ * \brief Persistence map, a per channel 2D histogram of time against voltage over many records.
+ */
+
+#include "persistence.h"
+#include "acquire.h"
+#include <thread>
+#include <cmath>
+
+class PersistenceProcessWorker : public Nan::AsyncWorker
+{
+  public:
+    PersistenceProcessWorker(Nan::Callback* callback, Persistence* persistence, v8::Local<v8::Object> self, v8::Local<v8::Array> data) :
+      Nan::AsyncWorker(callback),
+      m_persistence(persistence),
+      m_data(data->Length()),
+      m_count(0)
+    {
+      SaveToPersistent("self", self);
+      SaveToPersistent("data", data);
+      for(uint32_t i = 0; i < data->Length(); ++i)
+      {
+        v8::Local<v8::Value> item = Nan::Get(data, i).ToLocalChecked();
+        if(!item->IsNullOrUndefined())
+          m_data[i].assign(item);
+      }
+    }
+
+    void Execute()
+    {
+      // All channels of a record share the time axis, so they must have the same length:
+      std::vector<const float*> data(m_data.size());
+      size_t length = std::numeric_limits<size_t>::max();
+      for(size_t i = 0; i < m_data.size(); ++i)
+      {
+        data[i] = m_data[i].data();
+        if(data[i])
+          length = std::min(length, m_data[i].length());
+      }
+      if(length != std::numeric_limits<size_t>::max())
+        m_count = m_persistence->add(data, length);
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), Nan::New<v8::Uint32>(m_count)};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    Persistence* m_persistence;
+    std::vector<FloatArrayArgument> m_data;
+    uint32_t m_count;
+};
+
+class PersistenceAcquireWorker : public Nan::AsyncWorker
+{
+  public:
+    PersistenceAcquireWorker(Nan::Callback* callback, Persistence* persistence, v8::Local<v8::Object> self, LibTiePieHandle_t device, uint64_t length, uint32_t count, double timeout) :
+      Nan::AsyncWorker(callback),
+      m_persistence(persistence),
+      m_device(device),
+      m_length((size_t)length),
+      m_count(count),
+      m_timeout(timeout),
+      m_recordCount(0)
+    {
+      SaveToPersistent("self", self);
+    }
+
+    void Execute()
+    {
+      std::string error;
+      if(!acquireRecords(m_device, m_persistence->channelCount(), m_length, m_count, m_timeout, [this](const std::vector<const float*>& data) { m_recordCount = m_persistence->add(data, m_length); }, error))
+        SetErrorMessage(error.c_str());
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), Nan::New<v8::Uint32>(m_recordCount)};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    Persistence* m_persistence;
+    LibTiePieHandle_t m_device;
+    size_t m_length;
+    uint32_t m_count;
+    double m_timeout;
+    uint32_t m_recordCount;
+};
+
+NAN_MODULE_INIT(Persistence::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("Persistence").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "setDataValueRange", SetDataValueRange);
+  Nan::SetPrototypeMethod(tpl, "process", Process);
+  Nan::SetPrototypeMethod(tpl, "acquire", Acquire);
+  Nan::SetPrototypeMethod(tpl, "decay", Decay);
+  Nan::SetPrototypeMethod(tpl, "getImage", GetImage);
+  Nan::SetPrototypeMethod(tpl, "getRecordCount", GetRecordCount);
+  Nan::SetPrototypeMethod(tpl, "reset", Reset);
+
+  Nan::Set(target, Nan::New<v8::String>("Persistence").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+Persistence::Persistence(uint16_t channelCount, uint32_t width, uint32_t height) :
+  m_width(width),
+  m_height(height),
+  m_channels(channelCount),
+  m_recordCount(0)
+{
+  for(std::vector<PersistenceChannel>::iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+  {
+    it->min = -1;
+    it->max = 1;
+    it->counts.assign((size_t)width * height, 0);
+  }
+}
+
+void Persistence::bin(PersistenceChannel& channel, const float* data, size_t length, uint32_t firstColumn, uint32_t lastColumn)
+{
+  // Columns are filled left to right, so threads that bin different columns never touch the same count:
+  const double scale = m_height / (channel.max - channel.min);
+  const size_t begin = (size_t)(((uint64_t)firstColumn * length + m_width - 1) / m_width);
+  const size_t end = (size_t)std::min<uint64_t>(((uint64_t)lastColumn * length + m_width - 1) / m_width, length);
+  uint32_t* counts = &channel.counts[0];
+  for(size_t i = begin; i < end; ++i)
+  {
+    const double y = (channel.max - data[i]) * scale;
+    if(!(y >= 0 && y < m_height))
+      continue;
+    const size_t x = (size_t)((uint64_t)i * m_width / length);
+    counts[(size_t)y * m_width + x]++;
+  }
+}
+
+uint32_t Persistence::add(const std::vector<const float*>& data, size_t length)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if(length == 0)
+    return m_recordCount;
+
+  const size_t channelCount = std::min(data.size(), m_channels.size());
+  const uint32_t threadCount = length < PERSISTENCE_PARALLEL_SAMPLES ? 1 : std::min(std::max(std::thread::hardware_concurrency(), 1u), m_width);
+  std::vector<std::thread> threads;
+  for(uint32_t t = 1; t < threadCount; ++t)
+  {
+    const uint32_t first = (uint32_t)((uint64_t)m_width * t / threadCount);
+    const uint32_t last = (uint32_t)((uint64_t)m_width * (t + 1) / threadCount);
+    threads.push_back(std::thread([this, &data, channelCount, length, first, last]()
+      {
+        for(size_t ch = 0; ch < channelCount; ++ch)
+          if(data[ch])
+            bin(m_channels[ch], data[ch], length, first, last);
+      }));
+  }
+
+  const uint32_t last = (uint32_t)(m_width / threadCount);
+  for(size_t ch = 0; ch < channelCount; ++ch)
+    if(data[ch])
+      bin(m_channels[ch], data[ch], length, 0, last);
+
+  for(std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it)
+    it->join();
+
+  return ++m_recordCount;
+}
+
+/**
+ * new Persistence(channelCount, width, height)
+ */
+NAN_METHOD(Persistence::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowTypeError("Persistence must be called with new");
+
+  CHECK_PARAMETER_COUNT(3);
+  const uint32_t channelCount = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(channelCount, 1, std::numeric_limits<uint16_t>::max());
+  const uint32_t width = Nan::To<uint32_t>(info[1]).FromJust();
+  CHECK_RANGE(width, 1, 65536);
+  const uint32_t height = Nan::To<uint32_t>(info[2]).FromJust();
+  CHECK_RANGE(height, 1, 65536);
+
+  Persistence* persistence = new Persistence((uint16_t)channelCount, width, height);
+  persistence->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
+
+/**
+ * setDataValueRange(channel, min, max), the voltage range of the rows of a channel, defaults to -1 .. 1 V.
+ */
+NAN_METHOD(Persistence::SetDataValueRange)
+{
+  CHECK_PARAMETER_COUNT(3);
+  Persistence* persistence = Nan::ObjectWrap::Unwrap<Persistence>(info.Holder());
+  const uint32_t ch = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(ch, 0, persistence->m_channels.size() - 1);
+  const double min = Nan::To<double>(info[1]).FromJust();
+  const double max = Nan::To<double>(info[2]).FromJust();
+  if(!(max > min))
+    return Nan::ThrowRangeError("Invalid range");
+
+  std::lock_guard<std::mutex> lock(persistence->m_mutex);
+  PersistenceChannel& channel = persistence->m_channels[ch];
+  channel.min = min;
+  channel.max = max;
+  channel.counts.assign(channel.counts.size(), 0);
+
+  info.GetReturnValue().SetUndefined();
+}
+
+/**
+ * process(data, callback), data has an array per channel or null. The record is stretched over the width of the map.
+ */
+NAN_METHOD(Persistence::Process)
+{
+  CHECK_PARAMETER_COUNT(2);
+  if(!info[0]->IsArray())
+    return Nan::ThrowTypeError("Invalid data, expected an array");
+  if(!info[1]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  v8::Local<v8::Array> data = info[0].As<v8::Array>();
+  for(uint32_t i = 0; i < data->Length(); ++i)
+  {
+    v8::Local<v8::Value> item = Nan::Get(data, i).ToLocalChecked();
+    if(!item->IsNullOrUndefined() && !item->IsArray() && !item->IsTypedArray())
+      return Nan::ThrowTypeError("Invalid data, expected an array");
+  }
+
+  Persistence* persistence = Nan::ObjectWrap::Unwrap<Persistence>(info.Holder());
+  Nan::Callback* callback = new Nan::Callback(info[1].As<v8::Function>());
+  Nan::AsyncQueueWorker(new PersistenceProcessWorker(callback, persistence, info.Holder(), data));
+
+  info.GetReturnValue().SetUndefined();
+}
+
+/**
+ * acquire(handle, count[, timeout], callback), measures count records in block mode and adds them to the map.
+ */
+NAN_METHOD(Persistence::Acquire)
+{
+  if(info.Length() < 3 || info.Length() > 4)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+  const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
+  const uint32_t count = Nan::To<uint32_t>(info[1]).FromJust();
+  double timeout;
+  if(!getAcquireTimeout(info, timeout))
+    return Nan::ThrowRangeError("Value out of range");
+  const v8::Local<v8::Value> function = info[info.Length() - 1];
+  if(!function->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  if(ScpGetMeasureMode(device) != MM_BLOCK)
+  {
+    CHECK_LAST_STATUS();
+    return Nan::ThrowError("Oscilloscope is not in block mode");
+  }
+  const uint64_t length = ScpGetRecordLength(device);
+  CHECK_LAST_STATUS();
+
+  Persistence* persistence = Nan::ObjectWrap::Unwrap<Persistence>(info.Holder());
+  Nan::Callback* callback = new Nan::Callback(function.As<v8::Function>());
+  Nan::AsyncQueueWorker(new PersistenceAcquireWorker(callback, persistence, info.Holder(), device, length, count, timeout));
+
+  info.GetReturnValue().SetUndefined();
+}
+
+/**
+ * decay(factor), multiplies all counts by factor, 0 <= factor <= 1.
+ */
+NAN_METHOD(Persistence::Decay)
+{
+  CHECK_PARAMETER_COUNT(1);
+  Persistence* persistence = Nan::ObjectWrap::Unwrap<Persistence>(info.Holder());
+  const double factor = Nan::To<double>(info[0]).FromJust();
+  CHECK_RANGE(factor, 0.0, 1.0);
+
+  std::lock_guard<std::mutex> lock(persistence->m_mutex);
+  for(std::vector<PersistenceChannel>::iterator it = persistence->m_channels.begin(); it != persistence->m_channels.end(); ++it)
+    for(std::vector<uint32_t>::iterator count = it->counts.begin(); count != it->counts.end(); ++count)
+      *count = (uint32_t)(*count * factor);
+
+  info.GetReturnValue().SetUndefined();
+}
+
+/**
+ * getImage(channel), returns a copy of the counts of a channel as a Uint32Array of height rows of width columns.
+ */
+NAN_METHOD(Persistence::GetImage)
+{
+  CHECK_PARAMETER_COUNT(1);
+  Persistence* persistence = Nan::ObjectWrap::Unwrap<Persistence>(info.Holder());
+  const uint32_t ch = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(ch, 0, persistence->m_channels.size() - 1);
+
+  std::lock_guard<std::mutex> lock(persistence->m_mutex);
+  const std::vector<uint32_t>& counts = persistence->m_channels[ch].counts;
+  info.GetReturnValue().Set(NewTypedArrayCopy(&counts[0], counts.size()));
+}
+
+NAN_METHOD(Persistence::GetRecordCount)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Persistence* persistence = Nan::ObjectWrap::Unwrap<Persistence>(info.Holder());
+
+  std::lock_guard<std::mutex> lock(persistence->m_mutex);
+  info.GetReturnValue().Set(persistence->m_recordCount);
+}
+
+NAN_METHOD(Persistence::Reset)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Persistence* persistence = Nan::ObjectWrap::Unwrap<Persistence>(info.Holder());
+
+  std::lock_guard<std::mutex> lock(persistence->m_mutex);
+  for(std::vector<PersistenceChannel>::iterator it = persistence->m_channels.begin(); it != persistence->m_channels.end(); ++it)
+    it->counts.assign(it->counts.size(), 0);
+  persistence->m_recordCount = 0;
+
+  info.GetReturnValue().SetUndefined();
+}
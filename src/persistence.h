@@ -0,0 +1,59 @@
+/**
+ * \file persistence.h
+ * \brief Persistence map, a per channel 2D histogram of time against voltage over many records.
+ */
+
+#ifndef _PERSISTENCE_H_
+#define _PERSISTENCE_H_
+
+#include "common.h"
+#include <mutex>
+
+#define PERSISTENCE_PARALLEL_SAMPLES  65536 //!< Records with at least this many samples are binned by several threads.
+
+struct PersistenceChannel
+{
+  double min;
+  double max;
+  std::vector<uint32_t> counts; //!< height rows of width columns, row 0 holds the highest voltages.
+};
+
+class Persistence : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+    /**
+     * Add a record of \p length samples to the map, \p data holds a pointer per channel, null skips a channel.
+     * Thread safe.
+     */
+    uint32_t add(const std::vector<const float*>& data, size_t length);
+
+    uint16_t channelCount() const
+    {
+      return (uint16_t)m_channels.size();
+    }
+
+  private:
+    Persistence(uint16_t channelCount, uint32_t width, uint32_t height);
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(SetDataValueRange);
+    static NAN_METHOD(Process);
+    static NAN_METHOD(Acquire);
+    static NAN_METHOD(Decay);
+    static NAN_METHOD(GetImage);
+    static NAN_METHOD(GetRecordCount);
+    static NAN_METHOD(Reset);
+
+    void bin(PersistenceChannel& channel, const float* data, size_t length, uint32_t firstColumn, uint32_t lastColumn);
+
+    uint32_t m_width;
+    uint32_t m_height;
+
+    std::mutex m_mutex;
+    std::vector<PersistenceChannel> m_channels;
+    uint32_t m_recordCount;
+};
+
+#endif
@@ -0,0 +1,497 @@
+/**
+ * \file pyramid.cc
+ * \brief Min/max pyramid of a capture file, for drawing any part of a long recording from a few values per pixel.
+ */
+
+#include "pyramid.h"
+#include "simd.h"
+#include <cmath>
+
+static const char magic[8] = {'T', 'P', 'P', 'Y', 'R', 'M', 0, 0};
+
+template<class T>
+static void put(uint8_t* data, size_t offset, T value)
+{
+  memcpy(data + offset, &value, sizeof(T));
+}
+
+template<class T>
+static T get(const uint8_t* data, size_t offset)
+{
+  T value;
+  memcpy(&value, data + offset, sizeof(T));
+  return value;
+}
+
+template<class T>
+static void rawMinMax(const uint8_t* data, uint64_t count, double& min, double& max)
+{
+  T lo;
+  T hi;
+  minMax((const T*)data, (size_t)count, lo, hi);
+  min = (double)lo;
+  max = (double)hi;
+}
+
+/**
+ * Minimum and maximum of \p count raw samples, \p count must be at least 1.
+ */
+static void rawMinMax(uint32_t dataType, const uint8_t* data, uint64_t count, double& min, double& max)
+{
+  switch(dataType)
+  {
+    case DATARAWTYPE_INT8:
+      return rawMinMax<int8_t>(data, count, min, max);
+    case DATARAWTYPE_INT16:
+      return rawMinMax<int16_t>(data, count, min, max);
+    case DATARAWTYPE_INT32:
+      return rawMinMax<int32_t>(data, count, min, max);
+    case DATARAWTYPE_INT64:
+      return rawMinMax<int64_t>(data, count, min, max);
+    case DATARAWTYPE_UINT8:
+      return rawMinMax<uint8_t>(data, count, min, max);
+    case DATARAWTYPE_UINT16:
+      return rawMinMax<uint16_t>(data, count, min, max);
+    case DATARAWTYPE_UINT32:
+      return rawMinMax<uint32_t>(data, count, min, max);
+    case DATARAWTYPE_UINT64:
+      return rawMinMax<uint64_t>(data, count, min, max);
+    case DATARAWTYPE_FLOAT32:
+      return rawMinMax<float>(data, count, min, max);
+    case DATARAWTYPE_FLOAT64:
+      return rawMinMax<double>(data, count, min, max);
+  }
+  min = max = NAN;
+}
+
+/**
+ * Convert a raw minimum and maximum to values, a negative gain swaps them.
+ */
+static void toValues(const RawCoefficients& coefficients, double rawMin, double rawMax, float& min, float& max)
+{
+  const float a = (float)(rawMin * coefficients.gain + coefficients.offset);
+  const float b = (float)(rawMax * coefficients.gain + coefficients.offset);
+  min = std::min(a, b);
+  max = std::max(a, b);
+}
+
+/**
+ * Coefficients converting the samples of a capture file channel to values, floating point samples already are values.
+ */
+static RawCoefficients captureCoefficients(const CaptureChannel& channel)
+{
+  if(channel.dataType == DATARAWTYPE_FLOAT32 || channel.dataType == DATARAWTYPE_FLOAT64)
+  {
+    RawCoefficients result;
+    result.gain = 1;
+    result.offset = 0;
+    return result;
+  }
+  return RawConverter::fromRanges((double)channel.rawValueMin, (double)channel.rawValueMax, channel.dataValueMin, channel.dataValueMax);
+}
+
+static uint64_t levelSize(uint64_t sampleCount, uint32_t shift)
+{
+  return (sampleCount + ((uint64_t)1 << shift) - 1) >> shift;
+}
+
+MinMaxPyramid::MinMaxPyramid() :
+  m_bucketShift(PYRAMID_DEFAULT_BUCKETSHIFT)
+{
+}
+
+void MinMaxPyramid::reset(const CaptureHeader& header, uint32_t bucketShift)
+{
+  m_bucketShift = bucketShift;
+  m_channels.clear();
+  for(std::vector<CaptureChannel>::const_iterator it = header.channels.begin(); it != header.channels.end(); ++it)
+  {
+    PyramidChannel channel;
+    channel.number = it->number;
+    channel.dataType = it->dataType;
+    channel.coefficients = captureCoefficients(*it);
+    channel.partialMin = 0;
+    channel.partialMax = 0;
+    channel.partialCount = 0;
+    channel.sampleCount = 0;
+    channel.levels.resize(1);
+    m_channels.push_back(channel);
+  }
+}
+
+void MinMaxPyramid::flush(PyramidChannel& channel)
+{
+  float min;
+  float max;
+  toValues(channel.coefficients, channel.partialMin, channel.partialMax, min, max);
+  channel.levels[0].push_back(min);
+  channel.levels[0].push_back(max);
+  channel.partialCount = 0;
+}
+
+void MinMaxPyramid::append(size_t ch, const uint8_t* data, uint64_t count)
+{
+  PyramidChannel& channel = m_channels[ch];
+  const uint64_t bucketSize = this->bucketSize();
+  const size_t sampleSize = GetDataRawTypeSize(channel.dataType);
+  channel.sampleCount += count;
+  while(count > 0)
+  {
+    const uint64_t n = std::min(count, bucketSize - channel.partialCount);
+    double min;
+    double max;
+    rawMinMax(channel.dataType, data, n, min, max);
+    if(channel.partialCount == 0)
+    {
+      channel.partialMin = min;
+      channel.partialMax = max;
+    }
+    else
+    {
+      channel.partialMin = std::min(channel.partialMin, min);
+      channel.partialMax = std::max(channel.partialMax, max);
+    }
+    channel.partialCount += n;
+    if(channel.partialCount == bucketSize)
+      flush(channel);
+
+    data += n * sampleSize;
+    count -= n;
+  }
+}
+
+void MinMaxPyramid::appendFile(const uint8_t* data, const CaptureHeader& header)
+{
+  for(size_t ch = 0; ch < header.channels.size(); ++ch)
+    visitCaptureSamples(data, header, header.channels[ch], 0, header.sampleCount, [this, ch](const uint8_t* samples, uint64_t count) { append(ch, samples, count); });
+}
+
+void MinMaxPyramid::finish()
+{
+  for(std::vector<PyramidChannel>::iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+  {
+    if(it->partialCount > 0)
+      flush(*it);
+
+    it->levels.resize(1);
+    while(it->levels.back().size() > 2)
+    {
+      const std::vector<float>& lower = it->levels.back();
+      std::vector<float> level((lower.size() / 2 + 1) / 2 * 2);
+      for(size_t i = 0; i < level.size(); i += 2)
+      {
+        const size_t j = 2 * i;
+        level[i] = j + 2 < lower.size() ? std::min(lower[j], lower[j + 2]) : lower[j];
+        level[i + 1] = j + 2 < lower.size() ? std::max(lower[j + 1], lower[j + 3]) : lower[j + 1];
+      }
+      it->levels.push_back(level);
+    }
+  }
+}
+
+bool MinMaxPyramid::save(const std::string& filename, std::string& error) const
+{
+  const size_t levelCount = m_channels.empty() ? 0 : m_channels[0].levels.size();
+  const uint64_t channelTableSize = (m_channels.size() * 2 + 7) & ~(uint64_t)7;
+  uint64_t size = PYRAMID_HEADER_SIZE + channelTableSize;
+  for(std::vector<PyramidChannel>::const_iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+    for(std::vector<std::vector<float> >::const_iterator level = it->levels.begin(); level != it->levels.end(); ++level)
+      size += level->size() * sizeof(float);
+
+  MappedFile file;
+  if(!file.create(filename, size))
+  {
+    error = file.error();
+    return false;
+  }
+
+  uint8_t* p = file.data();
+  memset(p, 0, PYRAMID_HEADER_SIZE + channelTableSize);
+  memcpy(p, magic, sizeof(magic));
+  put<uint32_t>(p, 8, PYRAMID_VERSION);
+  put<uint32_t>(p, 12, (uint32_t)m_channels.size());
+  put<uint64_t>(p, 16, sampleCount());
+  put<uint32_t>(p, 24, m_bucketShift);
+  put<uint32_t>(p, 28, (uint32_t)levelCount);
+  for(size_t ch = 0; ch < m_channels.size(); ++ch)
+    put<uint16_t>(p, PYRAMID_HEADER_SIZE + 2 * ch, m_channels[ch].number);
+
+  uint64_t offset = PYRAMID_HEADER_SIZE + channelTableSize;
+  for(std::vector<PyramidChannel>::const_iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+    for(std::vector<std::vector<float> >::const_iterator level = it->levels.begin(); level != it->levels.end(); ++level)
+    {
+      if(!level->empty())
+        memcpy(p + offset, &(*level)[0], level->size() * sizeof(float));
+      offset += level->size() * sizeof(float);
+    }
+
+  if(!file.close())
+  {
+    error = "Failed to close file";
+    return false;
+  }
+  return true;
+}
+
+bool MinMaxPyramid::load(const std::string& filename, std::string& error)
+{
+  MappedFile file;
+  if(!file.open(filename))
+  {
+    error = file.error();
+    return false;
+  }
+
+  const uint8_t* p = file.data();
+  if(file.size() < PYRAMID_HEADER_SIZE || memcmp(p, magic, sizeof(magic)) != 0 || get<uint32_t>(p, 8) != PYRAMID_VERSION)
+  {
+    error = "Invalid pyramid file";
+    return false;
+  }
+
+  const uint32_t channelCount = get<uint32_t>(p, 12);
+  const uint64_t sampleCount = get<uint64_t>(p, 16);
+  const uint32_t bucketShift = get<uint32_t>(p, 24);
+  const uint32_t levelCount = get<uint32_t>(p, 28);
+  const uint64_t channelTableSize = ((uint64_t)channelCount * 2 + 7) & ~(uint64_t)7;
+  // Level shifts must stay below 64 bits:
+  if(bucketShift > 40 || levelCount > 64 || bucketShift + levelCount > 64 || PYRAMID_HEADER_SIZE + channelTableSize > file.size())
+  {
+    error = "Invalid pyramid file";
+    return false;
+  }
+
+  uint64_t offset = PYRAMID_HEADER_SIZE + channelTableSize;
+  std::vector<PyramidChannel> channels(channelCount);
+  for(uint32_t ch = 0; ch < channelCount; ++ch)
+  {
+    PyramidChannel& channel = channels[ch];
+    channel.number = get<uint16_t>(p, PYRAMID_HEADER_SIZE + 2 * ch);
+    channel.dataType = DATARAWTYPE_FLOAT32;
+    channel.coefficients.gain = 1;
+    channel.coefficients.offset = 0;
+    channel.partialMin = 0;
+    channel.partialMax = 0;
+    channel.partialCount = 0;
+    channel.sampleCount = sampleCount;
+    channel.levels.resize(levelCount);
+    for(uint32_t level = 0; level < levelCount; ++level)
+    {
+      const uint64_t count = 2 * levelSize(sampleCount, bucketShift + level);
+      if(count > (file.size() - offset) / sizeof(float))
+      {
+        error = "Truncated pyramid file";
+        return false;
+      }
+      const float* data = (const float*)(p + offset);
+      channel.levels[level].assign(data, data + count);
+      offset += count * sizeof(float);
+    }
+  }
+
+  m_bucketShift = bucketShift;
+  m_channels.swap(channels);
+  return true;
+}
+
+uint64_t MinMaxPyramid::query(size_t ch, uint64_t start, uint64_t end, size_t pixelCount, float* min, float* max) const
+{
+  const PyramidChannel& channel = m_channels[ch];
+  const double samplesPerPixel = (double)(end - start) / pixelCount;
+  size_t level = 0;
+  while(level + 1 < channel.levels.size() && (double)(bucketSize() << (level + 1)) <= samplesPerPixel)
+    level++;
+
+  const uint32_t shift = m_bucketShift + (uint32_t)level;
+  const std::vector<float>& buckets = channel.levels[level];
+  const uint64_t bucketCount = buckets.size() / 2;
+  for(size_t i = 0; i < pixelCount; ++i)
+  {
+    const uint64_t first = (start + (uint64_t)((end - start) * (double)i / pixelCount)) >> shift;
+    const uint64_t last = std::min(((start + (uint64_t)((end - start) * (double)(i + 1) / pixelCount) + ((uint64_t)1 << shift) - 1) >> shift), bucketCount);
+    min[i] = max[i] = NAN;
+    for(uint64_t b = first; b < std::max(last, first + 1) && b < bucketCount; ++b)
+    {
+      if(!(buckets[2 * b] >= min[i]))
+        min[i] = buckets[2 * b];
+      if(!(buckets[2 * b + 1] <= max[i]))
+        max[i] = buckets[2 * b + 1];
+    }
+  }
+  return (uint64_t)1 << shift;
+}
+
+class PyramidBuildWorker : public Nan::AsyncWorker
+{
+  public:
+    PyramidBuildWorker(Nan::Callback* callback, const std::string& filename, uint32_t bucketShift) :
+      Nan::AsyncWorker(callback),
+      m_filename(filename),
+      m_bucketShift(bucketShift)
+    {
+    }
+
+    void Execute()
+    {
+      MappedFile file;
+      if(!file.open(m_filename))
+        return SetErrorMessage(file.error().c_str());
+
+      CaptureHeader header;
+      std::string error;
+      if(!parseCaptureHeader(file.data(), file.size(), header, error))
+        return SetErrorMessage(error.c_str());
+
+      MinMaxPyramid pyramid;
+      pyramid.reset(header, m_bucketShift);
+      pyramid.appendFile(file.data(), header);
+      pyramid.finish();
+      if(!pyramid.save(m_filename + PYRAMID_EXTENSION, error))
+        SetErrorMessage(error.c_str());
+    }
+
+  private:
+    std::string m_filename;
+    uint32_t m_bucketShift;
+};
+
+NAN_MODULE_INIT(Pyramid::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("Pyramid").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "getMinMax", GetMinMax);
+  Nan::SetMethod(tpl, "build", Build);
+
+  Nan::Set(target, Nan::New<v8::String>("Pyramid").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+Pyramid::Pyramid()
+{
+}
+
+/**
+ * new Pyramid(filename), opens the pyramid of a capture file, the capture file must still exist.
+ */
+NAN_METHOD(Pyramid::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowTypeError("Pyramid must be called with new");
+  CHECK_PARAMETER_COUNT(1);
+  const std::string filename(*Nan::Utf8String(info[0]));
+
+  Pyramid* pyramid = new Pyramid();
+  std::string error;
+  if(!pyramid->m_file.open(filename))
+    error = pyramid->m_file.error();
+  else if(parseCaptureHeader(pyramid->m_file.data(), pyramid->m_file.size(), pyramid->m_header, error))
+    pyramid->m_pyramid.load(filename + PYRAMID_EXTENSION, error);
+  if(error.empty() && (pyramid->m_pyramid.channels().size() != pyramid->m_header.channels.size() || pyramid->m_pyramid.sampleCount() != pyramid->m_header.sampleCount))
+    error = "Pyramid doesn't match the capture file";
+  if(!error.empty())
+  {
+    delete pyramid;
+    return Nan::ThrowError(error.c_str());
+  }
+  pyramid->Wrap(info.This());
+
+  const std::vector<PyramidChannel>& channels = pyramid->m_pyramid.channels();
+  v8::Local<v8::Array> numbers = Nan::New<v8::Array>(channels.size());
+  for(size_t i = 0; i < channels.size(); ++i)
+    Nan::Set(numbers, i, Nan::New<v8::Uint32>(channels[i].number));
+  Nan::DefineOwnProperty(info.This(), Nan::New<v8::String>("channels").ToLocalChecked(), numbers, v8::ReadOnly);
+  Nan::DefineOwnProperty(info.This(), Nan::New<v8::String>("sampleCount").ToLocalChecked(), Nan::New<v8::Number>((double)pyramid->m_pyramid.sampleCount()), v8::ReadOnly);
+  Nan::DefineOwnProperty(info.This(), Nan::New<v8::String>("bucketSize").ToLocalChecked(), Nan::New<v8::Number>((double)pyramid->m_pyramid.bucketSize()), v8::ReadOnly);
+
+  info.GetReturnValue().Set(info.This());
+}
+
+/**
+ * Pyramid.build(filename[, bucketSize], callback), builds the pyramid of an existing capture file. bucketSize is the
+ * number of samples per level 0 bucket, a power of two.
+ */
+NAN_METHOD(Pyramid::Build)
+{
+  if(info.Length() < 2 || info.Length() > 3)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+  const std::string filename(*Nan::Utf8String(info[0]));
+  uint32_t bucketShift = PYRAMID_DEFAULT_BUCKETSHIFT;
+  if(info.Length() > 2)
+  {
+    const uint32_t bucketSize = Nan::To<uint32_t>(info[1]).FromJust();
+    if(bucketSize < 2 || (bucketSize & (bucketSize - 1)) != 0)
+      return Nan::ThrowRangeError("Invalid bucket size, expected a power of two");
+    for(bucketShift = 0; (1u << bucketShift) < bucketSize; ++bucketShift)
+      ;
+  }
+  if(!info[info.Length() - 1]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  Nan::Callback* callback = new Nan::Callback(info[info.Length() - 1].As<v8::Function>());
+  Nan::AsyncQueueWorker(new PyramidBuildWorker(callback, filename, bucketShift));
+
+  info.GetReturnValue().SetUndefined();
+}
+
+/**
+ * getMinMax(channel, start, end, pixelCount), returns {min, max, bucketSize} with a Float32Array of pixelCount values
+ * each. Parts smaller than a bucket are read from the capture file, bucketSize is then 1.
+ */
+NAN_METHOD(Pyramid::GetMinMax)
+{
+  CHECK_PARAMETER_COUNT(4);
+  Pyramid* pyramid = Nan::ObjectWrap::Unwrap<Pyramid>(info.Holder());
+  const uint32_t number = Nan::To<uint32_t>(info[0]).FromJust();
+  const std::vector<PyramidChannel>& channels = pyramid->m_pyramid.channels();
+  size_t ch = 0;
+  while(ch < channels.size() && channels[ch].number != number)
+    ch++;
+  if(ch == channels.size())
+    return Nan::ThrowRangeError("Invalid channel");
+
+  const uint64_t sampleCount = pyramid->m_pyramid.sampleCount();
+  const uint64_t start = std::min(sampleCount, (uint64_t)Nan::To<double>(info[1]).FromJust());
+  const uint64_t end = std::min(sampleCount, (uint64_t)Nan::To<double>(info[2]).FromJust());
+  const uint32_t pixelCount = Nan::To<uint32_t>(info[3]).FromJust();
+  CHECK_RANGE(pixelCount, 1, 1 << 24);
+  if(end <= start)
+    return Nan::ThrowRangeError("Invalid range");
+
+  float* min;
+  float* max;
+  v8::Local<v8::Float32Array> minArray = NewFloat32Array(pixelCount, min);
+  v8::Local<v8::Float32Array> maxArray = NewFloat32Array(pixelCount, max);
+  uint64_t bucketSize;
+  if((double)(end - start) / pixelCount >= (double)pyramid->m_pyramid.bucketSize())
+    bucketSize = pyramid->m_pyramid.query(ch, start, end, pixelCount, min, max);
+  else
+  {
+    // Zoomed in below the pyramid, the part is small enough to scan:
+    const CaptureChannel& channel = pyramid->m_header.channels[ch];
+    const RawCoefficients coefficients = captureCoefficients(channel);
+    for(uint32_t i = 0; i < pixelCount; ++i)
+    {
+      const uint64_t first = start + (uint64_t)((end - start) * (double)i / pixelCount);
+      const uint64_t last = std::max(first + 1, start + (uint64_t)((end - start) * (double)(i + 1) / pixelCount));
+      double rawMin = INFINITY;
+      double rawMax = -INFINITY;
+      visitCaptureSamples(pyramid->m_file.data(), pyramid->m_header, channel, first, std::min(last, end), [&channel, &rawMin, &rawMax](const uint8_t* data, uint64_t count)
+        {
+          double lo;
+          double hi;
+          rawMinMax(channel.dataType, data, count, lo, hi);
+          rawMin = std::min(rawMin, lo);
+          rawMax = std::max(rawMax, hi);
+        });
+      toValues(coefficients, rawMin, rawMax, min[i], max[i]);
+    }
+    bucketSize = 1;
+  }
+
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  Nan::Set(result, Nan::New<v8::String>("min").ToLocalChecked(), minArray);
+  Nan::Set(result, Nan::New<v8::String>("max").ToLocalChecked(), maxArray);
+  Nan::Set(result, Nan::New<v8::String>("bucketSize").ToLocalChecked(), Nan::New<v8::Number>((double)bucketSize));
+  info.GetReturnValue().Set(result);
+}
@@ -0,0 +1,144 @@
+/**
+ * \file pyramid.h
+ * \brief Min/max pyramid of a capture file, for drawing any part of a long recording from a few values per pixel.
+ *
+ * Level 0 holds the minimum and maximum value of every bucket of 2^bucketShift samples, each next level halves the
+ * number of buckets. The pyramid of a capture file is stored next to it, with #PYRAMID_EXTENSION appended to the file
+ * name. All values are little endian, the file starts with a 64 byte header:
+ *
+ * | Offset | Type     | Description                                                |
+ * |--------|----------|------------------------------------------------------------|
+ * |      0 | char[8]  | Magic, <tt>"TPPYRM\0\0"</tt>                               |
+ * |      8 | uint32   | Format version, #PYRAMID_VERSION                           |
+ * |     12 | uint32   | Channel count                                              |
+ * |     16 | uint64   | Sample count per channel                                   |
+ * |     24 | uint32   | Bucket shift, level 0 buckets hold 2^shift samples         |
+ * |     28 | uint32   | Level count                                                |
+ *
+ * Followed by an uint16 channel number per channel, padded to a multiple of 8 bytes, and then for each channel all
+ * levels from 0 up, each level a float32 minimum and maximum value per bucket.
+ */
+
+#ifndef _PYRAMID_H_
+#define _PYRAMID_H_
+
+#include "common.h"
+#include "capturefile.h"
+#include "rawconverter.h"
+#include "mappedfile.h"
+
+#define PYRAMID_VERSION               1
+#define PYRAMID_HEADER_SIZE           64
+#define PYRAMID_EXTENSION             ".pyramid"
+#define PYRAMID_DEFAULT_BUCKETSHIFT   10
+
+struct PyramidChannel
+{
+  uint16_t number;
+  uint32_t dataType;
+  RawCoefficients coefficients;
+  double partialMin; //!< Raw minimum of the bucket being filled.
+  double partialMax;
+  uint64_t partialCount;
+  uint64_t sampleCount;
+  std::vector<std::vector<float> > levels; //!< Minimum and maximum per bucket.
+};
+
+/**
+ * Builds, stores and queries a pyramid, not thread safe.
+ */
+class MinMaxPyramid
+{
+  public:
+    MinMaxPyramid();
+
+    /**
+     * Start a new pyramid for the channels of \p header.
+     */
+    void reset(const CaptureHeader& header, uint32_t bucketShift);
+
+    /**
+     * Add \p count raw samples of a channel, \p channel is the index in the header channel list.
+     */
+    void append(size_t channel, const uint8_t* data, uint64_t count);
+
+    /**
+     * Add all samples of a mapped capture file.
+     */
+    void appendFile(const uint8_t* data, const CaptureHeader& header);
+
+    /**
+     * Close the last buckets and build the upper levels.
+     */
+    void finish();
+
+    bool save(const std::string& filename, std::string& error) const;
+    bool load(const std::string& filename, std::string& error);
+
+    /**
+     * Minimum and maximum of \p pixelCount equal parts of samples \p start up to \p end of a channel, taken from the
+     * coarsest level whose buckets fit in a part.
+     * \return Samples per bucket of the level used.
+     */
+    uint64_t query(size_t channel, uint64_t start, uint64_t end, size_t pixelCount, float* min, float* max) const;
+
+    const std::vector<PyramidChannel>& channels() const
+    {
+      return m_channels;
+    }
+
+    uint64_t sampleCount() const
+    {
+      return m_channels.empty() ? 0 : m_channels[0].sampleCount;
+    }
+
+    uint64_t bucketSize() const
+    {
+      return (uint64_t)1 << m_bucketShift;
+    }
+
+  private:
+    void flush(PyramidChannel& channel);
+
+    uint32_t m_bucketShift;
+    std::vector<PyramidChannel> m_channels;
+};
+
+/**
+ * Visit the samples \p start up to \p end of a channel of a mapped capture file, in contiguous runs:
+ * visit(data, count).
+ */
+template<class Visit>
+inline void visitCaptureSamples(const uint8_t* data, const CaptureHeader& header, const CaptureChannel& channel, uint64_t start, uint64_t end, Visit visit)
+{
+  const uint64_t chunkSampleCount = header.chunkSampleCount != 0 ? header.chunkSampleCount : header.sampleCount;
+  const uint64_t stride = header.chunkSampleCount != 0 ? captureChunkStride(header) : 0;
+  const size_t sampleSize = GetDataRawTypeSize(channel.dataType);
+  for(uint64_t i = start; i < end;)
+  {
+    const uint64_t chunk = i / chunkSampleCount;
+    const uint64_t index = i % chunkSampleCount;
+    const uint64_t count = std::min(end - i, chunkSampleCount - index);
+    visit(data + channel.dataOffset + chunk * stride + index * sampleSize, count);
+    i += count;
+  }
+}
+
+class Pyramid : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    Pyramid();
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Build);
+    static NAN_METHOD(GetMinMax);
+
+    MinMaxPyramid m_pyramid;
+    MappedFile m_file; //!< The capture file, for parts smaller than a bucket.
+    CaptureHeader m_header;
+};
+
+#endif
@@ -0,0 +1,289 @@
+/**
+ * \file rawcapture.cc
+ * \brief Raw capture data, converted to values on access.
+ */
+
+#include "rawcapture.h"
+#include "instance.h"
+
+NAN_MODULE_INIT(RawCapture::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("RawCapture").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "slice", Slice);
+  Nan::SetPrototypeMethod(tpl, "getRaw", GetRaw);
+  Nan::SetPrototypeMethod(tpl, "setCacheSize", SetCacheSize);
+  Nan::SetPrototypeMethod(tpl, "clearCache", ClearCache);
+
+  v8::Local<v8::Function> constructor = Nan::GetFunction(tpl).ToLocalChecked();
+  Instance::current()->rawCapture.Reset(constructor);
+
+  Nan::Set(target, Nan::New<v8::String>("RawCapture").ToLocalChecked(), constructor);
+}
+
+/**
+ * Tell V8 about memory held outside the JavaScript heap. Nan::AdjustExternalMemory() takes an int, which overflows
+ * for the deep captures this class is for.
+ */
+static void adjustExternalMemory(int64_t change)
+{
+  v8::Isolate::GetCurrent()->AdjustAmountOfExternalAllocatedMemory(change);
+}
+
+static const int64_t tileMemorySize = (int64_t)(RAWCAPTURE_TILE_SIZE * sizeof(float));
+
+RawCapture::RawCapture(std::vector<RawCaptureChannel>& channels) :
+  m_sampleCount(0),
+  m_cacheSize(RAWCAPTURE_DEFAULT_TILES)
+{
+  m_channels.swap(channels);
+  if(!m_channels.empty())
+  {
+    m_sampleCount = std::numeric_limits<uint64_t>::max();
+    for(std::vector<RawCaptureChannel>::const_iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+      m_sampleCount = std::min<uint64_t>(m_sampleCount, it->data.size() / GetDataRawTypeSize(it->dataType));
+  }
+
+  adjustExternalMemory((int64_t)memorySize());
+}
+
+RawCapture::~RawCapture()
+{
+  adjustExternalMemory(-((int64_t)memorySize() + (int64_t)m_tiles.size() * tileMemorySize));
+}
+
+size_t RawCapture::memorySize() const
+{
+  size_t size = 0;
+  for(std::vector<RawCaptureChannel>::const_iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+    size += it->data.size();
+  return size;
+}
+
+int RawCapture::channelIndex(uint32_t number) const
+{
+  for(size_t i = 0; i < m_channels.size(); ++i)
+    if(m_channels[i].number == number)
+      return (int)i;
+  return -1;
+}
+
+const float* RawCapture::tile(uint16_t channel, uint64_t index)
+{
+  const std::pair<uint16_t, uint64_t> key(channel, index);
+  std::map<std::pair<uint16_t, uint64_t>, std::list<RawCaptureTile>::iterator>::iterator it = m_tileIndex.find(key);
+  if(it != m_tileIndex.end())
+  {
+    m_tiles.splice(m_tiles.begin(), m_tiles, it->second);
+    return &m_tiles.front().data[0];
+  }
+
+  // Reuse the least recently used tile when the cache is full:
+  if(m_tiles.size() >= m_cacheSize)
+  {
+    m_tileIndex.erase(std::make_pair(m_tiles.back().channel, m_tiles.back().index));
+    m_tiles.splice(m_tiles.begin(), m_tiles, --m_tiles.end());
+  }
+  else
+  {
+    m_tiles.push_front(RawCaptureTile());
+    adjustExternalMemory(tileMemorySize);
+  }
+
+  RawCaptureTile& t = m_tiles.front();
+  t.channel = channel;
+  t.index = index;
+  t.data.resize(RAWCAPTURE_TILE_SIZE);
+  m_tileIndex[key] = m_tiles.begin();
+
+  const RawCaptureChannel& ch = m_channels[channel];
+  const uint64_t start = index * RAWCAPTURE_TILE_SIZE;
+  const size_t length = (size_t)std::min<uint64_t>(RAWCAPTURE_TILE_SIZE, m_sampleCount - start);
+  RawConverter::convert(ch.dataType, &ch.data[(size_t)start * GetDataRawTypeSize(ch.dataType)], DATARAWTYPE_FLOAT32, &t.data[0], length, ch.coefficients);
+  return &t.data[0];
+}
+
+v8::Local<v8::Object> RawCapture::newInstance(std::vector<RawCaptureChannel>& channels)
+{
+  Nan::EscapableHandleScope scope;
+  v8::Local<v8::Value> argv[] = {Nan::New<v8::External>(&channels)};
+  return scope.Escape(Nan::NewInstance(Nan::New(Instance::current()->rawCapture), 1, argv).ToLocalChecked());
+}
+
+bool RawCapture::read(LibTiePieHandle_t device, uint64_t startIndex, uint64_t sampleCount, v8::Local<v8::Object>& result)
+{
+  const uint16_t channelCount = ScpGetChannelCount(device);
+  if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+    return false;
+
+  std::vector<RawCaptureChannel> channels;
+  std::vector<void*> pointers(channelCount, (void*)0);
+  for(uint16_t ch = 0; ch < channelCount; ++ch)
+  {
+    const bool8_t enabled = ScpChGetEnabled(device, ch);
+    if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+      return false;
+    if(enabled == BOOL8_FALSE)
+      continue;
+
+    RawCaptureChannel channel;
+    channel.number = ch;
+    channel.dataType = ScpChGetDataRawType(device, ch);
+    if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS || !RawConverter::fromDevice(device, ch, channel.coefficients))
+      return false;
+    channels.push_back(channel);
+    channels.back().data.resize((size_t)sampleCount * GetDataRawTypeSize(channel.dataType));
+  }
+  for(std::vector<RawCaptureChannel>::iterator it = channels.begin(); it != channels.end(); ++it)
+    pointers[it->number] = it->data.empty() ? 0 : &it->data[0];
+
+  const uint64_t count = channelCount > 0 ? ScpGetDataRaw(device, &pointers[0], channelCount, startIndex, sampleCount) : 0;
+  if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+    return false;
+
+  for(std::vector<RawCaptureChannel>::iterator it = channels.begin(); it != channels.end(); ++it)
+    it->data.resize((size_t)count * GetDataRawTypeSize(it->dataType));
+
+  result = newInstance(channels);
+  return true;
+}
+
+/**
+ * new RawCapture(channels), channels is an array of {number, data, gain, offset} with a raw typed array as data, or
+ * with rawValueMin, rawValueMax, dataValueMin and dataValueMax instead of gain and offset, as stored in capture files.
+ * The raw data is copied.
+ */
+NAN_METHOD(RawCapture::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowTypeError("RawCapture must be called with new");
+  CHECK_PARAMETER_COUNT(1);
+
+  std::vector<RawCaptureChannel> channels;
+  if(info[0]->IsExternal())
+    channels.swap(*static_cast<std::vector<RawCaptureChannel>*>(info[0].As<v8::External>()->Value()));
+  else if(info[0]->IsArray())
+  {
+    v8::Local<v8::Array> array = info[0].As<v8::Array>();
+    for(uint32_t i = 0; i < array->Length(); ++i)
+    {
+      v8::Local<v8::Value> item = Nan::Get(array, i).ToLocalChecked();
+      if(!item->IsObject())
+        return Nan::ThrowTypeError("Invalid channel, expected an object");
+      v8::Local<v8::Object> object = item.As<v8::Object>();
+      v8::Local<v8::Value> data = Nan::Get(object, Nan::New<v8::String>("data").ToLocalChecked()).ToLocalChecked();
+      const uint32_t dataType = GetDataRawType(data);
+      if(dataType == DATARAWTYPE_UNKNOWN)
+        return Nan::ThrowTypeError("Invalid channel data, expected a typed array");
+      v8::Local<v8::Value> number = Nan::Get(object, Nan::New<v8::String>("number").ToLocalChecked()).ToLocalChecked();
+
+      RawCaptureChannel channel;
+      channel.number = (uint16_t)(number->IsUndefined() ? i : Nan::To<uint32_t>(number).FromJust());
+      channel.dataType = dataType;
+      channel.coefficients = RawConverter::fromObject(object);
+      Nan::TypedArrayContents<uint8_t> contents(data);
+      channel.data.assign(*contents, *contents + contents.length());
+      channels.push_back(channel);
+    }
+  }
+  else
+    return Nan::ThrowTypeError("Invalid channels, expected an array");
+
+  RawCapture* capture = new RawCapture(channels);
+  capture->Wrap(info.This());
+
+  v8::Local<v8::Array> numbers = Nan::New<v8::Array>(capture->m_channels.size());
+  for(size_t i = 0; i < capture->m_channels.size(); ++i)
+    Nan::Set(numbers, i, Nan::New<v8::Uint32>(capture->m_channels[i].number));
+  Nan::DefineOwnProperty(info.This(), Nan::New<v8::String>("channels").ToLocalChecked(), numbers, v8::ReadOnly);
+  Nan::DefineOwnProperty(info.This(), Nan::New<v8::String>("sampleCount").ToLocalChecked(), Nan::New<v8::Number>((double)capture->m_sampleCount), v8::ReadOnly);
+
+  info.GetReturnValue().Set(info.This());
+}
+
+/**
+ * slice(channel[, start[, end]]), returns the values of samples start up to end of a channel as a Float32Array.
+ */
+NAN_METHOD(RawCapture::Slice)
+{
+  if(info.Length() < 1 || info.Length() > 3)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+  RawCapture* capture = Nan::ObjectWrap::Unwrap<RawCapture>(info.Holder());
+  const int channel = capture->channelIndex(Nan::To<uint32_t>(info[0]).FromJust());
+  if(channel < 0)
+    return Nan::ThrowRangeError("Invalid channel");
+  const uint64_t start = std::min(capture->m_sampleCount, (info.Length() > 1 && !info[1]->IsUndefined()) ? (uint64_t)Nan::To<double>(info[1]).FromJust() : 0);
+  const uint64_t end = std::min(capture->m_sampleCount, (info.Length() > 2 && !info[2]->IsUndefined()) ? (uint64_t)Nan::To<double>(info[2]).FromJust() : capture->m_sampleCount);
+  const size_t length = end > start ? (size_t)(end - start) : 0;
+
+  float* data;
+  v8::Local<v8::Float32Array> result = NewFloat32Array(length, data);
+  for(uint64_t i = start; i < start + length;)
+  {
+    const uint64_t index = i / RAWCAPTURE_TILE_SIZE;
+    const size_t offset = (size_t)(i % RAWCAPTURE_TILE_SIZE);
+    const size_t count = (size_t)std::min<uint64_t>(RAWCAPTURE_TILE_SIZE - offset, start + length - i);
+    memcpy(data + (i - start), capture->tile((uint16_t)channel, index) + offset, count * sizeof(float));
+    i += count;
+  }
+
+  info.GetReturnValue().Set(result);
+}
+
+/**
+ * getRaw(channel), returns a copy of the raw samples of a channel.
+ */
+NAN_METHOD(RawCapture::GetRaw)
+{
+  CHECK_PARAMETER_COUNT(1);
+  RawCapture* capture = Nan::ObjectWrap::Unwrap<RawCapture>(info.Holder());
+  const int channel = capture->channelIndex(Nan::To<uint32_t>(info[0]).FromJust());
+  if(channel < 0)
+    return Nan::ThrowRangeError("Invalid channel");
+
+  const RawCaptureChannel& ch = capture->m_channels[channel];
+  v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), ch.data.size());
+  v8::Local<v8::TypedArray> result = NewTypedArray(ch.dataType, buffer, 0, (size_t)capture->m_sampleCount);
+  if(!ch.data.empty())
+  {
+    Nan::TypedArrayContents<uint8_t> contents(result);
+    memcpy(*contents, &ch.data[0], ch.data.size());
+  }
+
+  info.GetReturnValue().Set(result);
+}
+
+/**
+ * setCacheSize(tileCount), the number of converted tiles of 64 kS that are kept.
+ */
+NAN_METHOD(RawCapture::SetCacheSize)
+{
+  CHECK_PARAMETER_COUNT(1);
+  RawCapture* capture = Nan::ObjectWrap::Unwrap<RawCapture>(info.Holder());
+  const uint32_t tileCount = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(tileCount, 1, 65536);
+
+  capture->m_cacheSize = tileCount;
+  while(capture->m_tiles.size() > capture->m_cacheSize)
+  {
+    capture->m_tileIndex.erase(std::make_pair(capture->m_tiles.back().channel, capture->m_tiles.back().index));
+    capture->m_tiles.pop_back();
+    adjustExternalMemory(-tileMemorySize);
+  }
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(RawCapture::ClearCache)
+{
+  CHECK_PARAMETER_COUNT(0);
+  RawCapture* capture = Nan::ObjectWrap::Unwrap<RawCapture>(info.Holder());
+
+  adjustExternalMemory(-(int64_t)capture->m_tiles.size() * tileMemorySize);
+  capture->m_tiles.clear();
+  capture->m_tileIndex.clear();
+
+  info.GetReturnValue().SetUndefined();
+}
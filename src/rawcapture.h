@@ -0,0 +1,70 @@
+/**
+ * \file rawcapture.h
+ * \brief Raw capture data, converted to values on access.
+ *
+ * A capture keeps the raw samples of its channels. slice() converts the requested samples in tiles, which are
+ * cached, so memory stays close to the raw size and only data that is read is converted.
+ */
+
+#ifndef _RAWCAPTURE_H_
+#define _RAWCAPTURE_H_
+
+#include "common.h"
+#include "rawconverter.h"
+#include <list>
+#include <map>
+
+#define RAWCAPTURE_TILE_SIZE        65536 //!< Samples per converted tile.
+#define RAWCAPTURE_DEFAULT_TILES    64    //!< Default number of cached tiles.
+
+struct RawCaptureChannel
+{
+  uint16_t number;
+  uint32_t dataType;
+  RawCoefficients coefficients;
+  std::vector<uint8_t> data;
+};
+
+struct RawCaptureTile
+{
+  uint16_t channel; //!< Index in the channel list.
+  uint64_t index;
+  std::vector<float> data;
+};
+
+class RawCapture : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+    /**
+     * Read the raw data of the enabled channels of an oscilloscope into a new capture.
+     * \return \c false on failure, the last status is left as set by LibTiePie.
+     */
+    static bool read(LibTiePieHandle_t device, uint64_t startIndex, uint64_t sampleCount, v8::Local<v8::Object>& result);
+
+  private:
+    RawCapture(std::vector<RawCaptureChannel>& channels);
+    ~RawCapture();
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Slice);
+    static NAN_METHOD(GetRaw);
+    static NAN_METHOD(SetCacheSize);
+    static NAN_METHOD(ClearCache);
+
+    static v8::Local<v8::Object> newInstance(std::vector<RawCaptureChannel>& channels);
+    int channelIndex(uint32_t number) const;
+    const float* tile(uint16_t channel, uint64_t index);
+    size_t memorySize() const;
+
+    std::vector<RawCaptureChannel> m_channels;
+    uint64_t m_sampleCount;
+
+    // Converted tiles, most recently used first:
+    std::list<RawCaptureTile> m_tiles;
+    std::map<std::pair<uint16_t, uint64_t>, std::list<RawCaptureTile>::iterator> m_tileIndex;
+    size_t m_cacheSize;
+};
+
+#endif
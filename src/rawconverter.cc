@@ -0,0 +1,290 @@
+/**
+ * \file rawconverter.cc
+ * \brief Conversion of raw oscilloscope data to values.
+ */
+
+#include "rawconverter.h"
+#include "simd.h"
+#include <thread>
+
+template<class U>
+static void convertTo(uint32_t dataType, const void* raw, U* output, size_t length, double gain, double offset)
+{
+  switch(dataType)
+  {
+    case DATARAWTYPE_INT8:
+      return scaleRaw((const int8_t*)raw, output, length, gain, offset);
+    case DATARAWTYPE_INT16:
+      return scaleRaw((const int16_t*)raw, output, length, gain, offset);
+    case DATARAWTYPE_INT32:
+      return scaleRaw((const int32_t*)raw, output, length, gain, offset);
+    case DATARAWTYPE_UINT8:
+      return scaleRaw((const uint8_t*)raw, output, length, gain, offset);
+    case DATARAWTYPE_UINT16:
+      return scaleRaw((const uint16_t*)raw, output, length, gain, offset);
+    case DATARAWTYPE_UINT32:
+      return scaleRaw((const uint32_t*)raw, output, length, gain, offset);
+    case DATARAWTYPE_INT64:
+      return scaleRaw((const int64_t*)raw, output, length, gain, offset);
+    case DATARAWTYPE_UINT64:
+      return scaleRaw((const uint64_t*)raw, output, length, gain, offset);
+    case DATARAWTYPE_FLOAT32:
+      return scaleRaw((const float*)raw, output, length, gain, offset);
+    case DATARAWTYPE_FLOAT64:
+      return scaleRaw((const double*)raw, output, length, gain, offset);
+  }
+}
+
+static void convertRange(uint32_t dataType, const uint8_t* raw, uint32_t outputType, uint8_t* output, size_t begin, size_t end, const RawCoefficients& coefficients)
+{
+  raw += begin * GetDataRawTypeSize(dataType);
+  output += begin * GetDataRawTypeSize(outputType);
+  if(outputType == DATARAWTYPE_FLOAT32)
+    convertTo(dataType, raw, (float*)output, end - begin, coefficients.gain, coefficients.offset);
+  else
+    convertTo(dataType, raw, (double*)output, end - begin, coefficients.gain, coefficients.offset);
+}
+
+void RawConverter::convert(uint32_t dataType, const void* raw, uint32_t outputType, void* output, size_t length, const RawCoefficients& coefficients)
+{
+  const uint32_t threadCount = length < RAWCONVERTER_PARALLEL_SAMPLES ? 1 : std::max(std::thread::hardware_concurrency(), 1u);
+  std::vector<std::thread> threads;
+  for(uint32_t t = 1; t < threadCount; ++t)
+  {
+    // Split on multiples of 16 samples, so all but the last thread run full SIMD blocks:
+    const size_t begin = (size_t)((uint64_t)length * t / threadCount) & ~(size_t)15;
+    const size_t end = t + 1 == threadCount ? length : (size_t)((uint64_t)length * (t + 1) / threadCount) & ~(size_t)15;
+    threads.push_back(std::thread(convertRange, dataType, (const uint8_t*)raw, outputType, (uint8_t*)output, begin, end, coefficients));
+  }
+
+  convertRange(dataType, (const uint8_t*)raw, outputType, (uint8_t*)output, 0, threadCount == 1 ? length : (size_t)(length / threadCount) & ~(size_t)15, coefficients);
+
+  for(std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it)
+    it->join();
+}
+
+class RawConvertWorker : public Nan::AsyncWorker
+{
+  public:
+    RawConvertWorker(Nan::Callback* callback, v8::Local<v8::Value> raw, v8::Local<v8::Value> output, size_t length, const RawCoefficients& coefficients) :
+      Nan::AsyncWorker(callback),
+      m_dataType(GetDataRawType(raw)),
+      m_outputType(GetDataRawType(output)),
+      m_length(length),
+      m_coefficients(coefficients)
+    {
+      SaveToPersistent("raw", raw);
+      SaveToPersistent("output", output);
+      m_raw = *Nan::TypedArrayContents<uint8_t>(raw);
+      m_output = *Nan::TypedArrayContents<uint8_t>(output);
+    }
+
+    void Execute()
+    {
+      RawConverter::convert(m_dataType, m_raw, m_outputType, m_output, m_length, m_coefficients);
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), Nan::New<v8::Number>((double)m_length)};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    uint32_t m_dataType;
+    uint32_t m_outputType;
+    const uint8_t* m_raw;
+    uint8_t* m_output;
+    size_t m_length;
+    RawCoefficients m_coefficients;
+};
+
+NAN_MODULE_INIT(RawConverter::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("RawConverter").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "setCalibration", SetCalibration);
+  Nan::SetPrototypeMethod(tpl, "getCoefficients", GetCoefficients);
+  Nan::SetPrototypeMethod(tpl, "convert", Convert);
+
+  Nan::Set(target, Nan::New<v8::String>("RawConverter").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+RawConverter::RawConverter(const std::vector<RawCoefficients>& coefficients) :
+  m_channels(coefficients)
+{
+  const RawCoefficients none = {1.0, 0.0};
+  m_calibration.assign(coefficients.size(), none);
+}
+
+RawCoefficients RawConverter::coefficients(uint16_t ch) const
+{
+  const RawCoefficients& channel = m_channels[ch];
+  const RawCoefficients& calibration = m_calibration[ch];
+  RawCoefficients result;
+  result.gain = channel.gain * calibration.gain;
+  result.offset = channel.offset * calibration.gain + calibration.offset;
+  return result;
+}
+
+static double getNumber(v8::Local<v8::Object> object, const char* name)
+{
+  return Nan::To<double>(Nan::Get(object, Nan::New<v8::String>(name).ToLocalChecked()).ToLocalChecked()).FromJust();
+}
+
+RawCoefficients RawConverter::fromRanges(double rawValueMin, double rawValueMax, double dataValueMin, double dataValueMax)
+{
+  RawCoefficients result;
+  result.gain = rawValueMax != rawValueMin ? (dataValueMax - dataValueMin) / (rawValueMax - rawValueMin) : 0.0;
+  result.offset = dataValueMin - rawValueMin * result.gain;
+  return result;
+}
+
+bool RawConverter::fromDevice(LibTiePieHandle_t device, uint16_t ch, RawCoefficients& coefficients)
+{
+  // The data value range includes the probe gain and offset, so they are part of the coefficients:
+  int64_t rawValueMin;
+  int64_t rawValueMax;
+  double dataValueMin;
+  double dataValueMax;
+  ScpChGetDataRawValueRange(device, ch, &rawValueMin, 0, &rawValueMax);
+  if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+    return false;
+  ScpChGetDataValueRange(device, ch, &dataValueMin, &dataValueMax);
+  if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+    return false;
+  coefficients = fromRanges((double)rawValueMin, (double)rawValueMax, dataValueMin, dataValueMax);
+  return true;
+}
+
+RawCoefficients RawConverter::fromObject(v8::Local<v8::Object> object)
+{
+  if(!Nan::Has(object, Nan::New<v8::String>("gain").ToLocalChecked()).FromJust())
+    return fromRanges(getNumber(object, "rawValueMin"), getNumber(object, "rawValueMax"), getNumber(object, "dataValueMin"), getNumber(object, "dataValueMax"));
+
+  RawCoefficients result;
+  result.gain = getNumber(object, "gain");
+  result.offset = getNumber(object, "offset");
+  return result;
+}
+
+/**
+ * new RawConverter(handle), with the ranges the current data of the oscilloscope was measured with, or
+ * new RawConverter(channels), with {gain, offset} or {rawValueMin, rawValueMax, dataValueMin, dataValueMax} per
+ * channel, as stored in capture files.
+ */
+NAN_METHOD(RawConverter::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowTypeError("RawConverter must be called with new");
+
+  CHECK_PARAMETER_COUNT(1);
+  std::vector<RawCoefficients> coefficients;
+  if(info[0]->IsArray())
+  {
+    v8::Local<v8::Array> channels = info[0].As<v8::Array>();
+    for(uint32_t ch = 0; ch < channels->Length(); ++ch)
+    {
+      v8::Local<v8::Value> item = Nan::Get(channels, ch).ToLocalChecked();
+      if(!item->IsObject())
+        return Nan::ThrowTypeError("Invalid channel, expected an object");
+
+      coefficients.push_back(fromObject(item.As<v8::Object>()));
+    }
+  }
+  else
+  {
+    const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
+    const uint16_t channelCount = ScpGetChannelCount(device);
+    CHECK_LAST_STATUS();
+    coefficients.resize(channelCount);
+    for(uint16_t ch = 0; ch < channelCount; ++ch)
+      if(!fromDevice(device, ch, coefficients[ch]))
+        return Nan::ThrowError(LibGetLastStatusStr());
+  }
+  if(coefficients.empty())
+    return Nan::ThrowRangeError("No channels");
+
+  RawConverter* converter = new RawConverter(coefficients);
+  converter->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
+
+/**
+ * setCalibration(channel, gain, offset), a correction applied after the conversion: value * gain + offset.
+ */
+NAN_METHOD(RawConverter::SetCalibration)
+{
+  CHECK_PARAMETER_COUNT(3);
+  RawConverter* converter = Nan::ObjectWrap::Unwrap<RawConverter>(info.Holder());
+  const uint32_t ch = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(ch, 0, converter->m_channels.size() - 1);
+
+  RawCoefficients& calibration = converter->m_calibration[ch];
+  calibration.gain = Nan::To<double>(info[1]).FromJust();
+  calibration.offset = Nan::To<double>(info[2]).FromJust();
+
+  info.GetReturnValue().SetUndefined();
+}
+
+/**
+ * getCoefficients(), returns {gain, offset} per channel, including the calibration: value = raw * gain + offset.
+ */
+NAN_METHOD(RawConverter::GetCoefficients)
+{
+  CHECK_PARAMETER_COUNT(0);
+  RawConverter* converter = Nan::ObjectWrap::Unwrap<RawConverter>(info.Holder());
+
+  v8::Local<v8::Array> result = Nan::New<v8::Array>(converter->m_channels.size());
+  for(uint16_t ch = 0; ch < converter->m_channels.size(); ++ch)
+  {
+    const RawCoefficients c = converter->coefficients(ch);
+    v8::Local<v8::Object> item = Nan::New<v8::Object>();
+    Nan::Set(item, Nan::New<v8::String>("gain").ToLocalChecked(), Nan::New<v8::Number>(c.gain));
+    Nan::Set(item, Nan::New<v8::String>("offset").ToLocalChecked(), Nan::New<v8::Number>(c.offset));
+    Nan::Set(result, ch, item);
+  }
+
+  info.GetReturnValue().Set(result);
+}
+
+/**
+ * convert(channel, raw, output[, callback]), converts raw into the Float32Array or Float64Array output. Without a
+ * callback the conversion is done right away and the number of samples is returned, otherwise on a worker thread and
+ * callback(err, sampleCount) is called when done.
+ */
+NAN_METHOD(RawConverter::Convert)
+{
+  if(info.Length() < 3 || info.Length() > 4)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+  RawConverter* converter = Nan::ObjectWrap::Unwrap<RawConverter>(info.Holder());
+  const uint32_t ch = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(ch, 0, converter->m_channels.size() - 1);
+
+  const uint32_t dataType = GetDataRawType(info[1]);
+  if(dataType == DATARAWTYPE_UNKNOWN)
+    return Nan::ThrowTypeError("Invalid raw data, expected a typed array");
+  if(!info[2]->IsFloat32Array() && !info[2]->IsFloat64Array())
+    return Nan::ThrowTypeError("Invalid output, expected a Float32Array or Float64Array");
+  if(info.Length() > 3 && !info[3]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  const size_t length = std::min(info[1].As<v8::TypedArray>()->Length(), info[2].As<v8::TypedArray>()->Length());
+  const RawCoefficients coefficients = converter->coefficients((uint16_t)ch);
+  if(info.Length() > 3)
+  {
+    Nan::Callback* callback = new Nan::Callback(info[3].As<v8::Function>());
+    Nan::AsyncQueueWorker(new RawConvertWorker(callback, info[1], info[2], length, coefficients));
+    return info.GetReturnValue().SetUndefined();
+  }
+
+  Nan::TypedArrayContents<uint8_t> raw(info[1]);
+  Nan::TypedArrayContents<uint8_t> output(info[2]);
+  convert(dataType, *raw, GetDataRawType(info[2]), *output, length, coefficients);
+
+  info.GetReturnValue().Set((double)length);
+}
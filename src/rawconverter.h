@@ -0,0 +1,62 @@
+/**
+ * \file rawconverter.h
+ * \brief Conversion of raw oscilloscope data to values.
+ */
+
+#ifndef _RAWCONVERTER_H_
+#define _RAWCONVERTER_H_
+
+#include "common.h"
+
+#define RAWCONVERTER_PARALLEL_SAMPLES  (1 << 20) //!< Records with at least this many samples are converted by several threads.
+
+struct RawCoefficients
+{
+  double gain; //!< Value of one raw step, including the probe gain.
+  double offset; //!< Value of raw 0, including the probe offset.
+};
+
+class RawConverter : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+    /**
+     * Convert \p length samples of \ref DATARAWTYPE_ "raw data type" \p dataType, \p output is a float or a double
+     * buffer, depending on \p outputType. Large records are split over several threads.
+     */
+    static void convert(uint32_t dataType, const void* raw, uint32_t outputType, void* output, size_t length, const RawCoefficients& coefficients);
+
+    /**
+     * Coefficients that map raw values from \p rawValueMin to \p rawValueMax linearly on \p dataValueMin to
+     * \p dataValueMax.
+     */
+    static RawCoefficients fromRanges(double rawValueMin, double rawValueMax, double dataValueMin, double dataValueMax);
+
+    /**
+     * Coefficients of a channel of the current data of an oscilloscope.
+     * \return \c false on failure, the last status is left as set by LibTiePie.
+     */
+    static bool fromDevice(LibTiePieHandle_t device, uint16_t ch, RawCoefficients& coefficients);
+
+    /**
+     * Coefficients from an object with gain and offset, or with rawValueMin, rawValueMax, dataValueMin and
+     * dataValueMax as stored in capture files.
+     */
+    static RawCoefficients fromObject(v8::Local<v8::Object> object);
+
+  private:
+    RawConverter(const std::vector<RawCoefficients>& coefficients);
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(SetCalibration);
+    static NAN_METHOD(GetCoefficients);
+    static NAN_METHOD(Convert);
+
+    RawCoefficients coefficients(uint16_t ch) const;
+
+    std::vector<RawCoefficients> m_channels;
+    std::vector<RawCoefficients> m_calibration;
+};
+
+#endif
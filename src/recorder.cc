@@ -0,0 +1,562 @@
+/**
+ * \file recorder.cc
+ * \brief Records a streaming measurement to disk on background threads.
+ */
+
+#include "recorder.h"
+#include "mappedfile.h"
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+
+#ifdef _WIN32
+  #include <malloc.h>
+#else
+  #include <cerrno>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+static uint8_t* allocateAligned(size_t size)
+{
+#ifdef _WIN32
+  return (uint8_t*)_aligned_malloc(size, CAPTUREFILE_ALIGNMENT);
+#else
+  void* data = 0;
+  return posix_memalign(&data, CAPTUREFILE_ALIGNMENT, size) == 0 ? (uint8_t*)data : 0;
+#endif
+}
+
+static void freeAligned(uint8_t* data)
+{
+#ifdef _WIN32
+  _aligned_free(data);
+#else
+  free(data);
+#endif
+}
+
+/**
+ * Write only file bypassing the page cache, all writes must be aligned to #CAPTUREFILE_ALIGNMENT.
+ */
+class StreamFile
+{
+  public:
+    StreamFile() :
+#ifdef _WIN32
+      m_file(INVALID_HANDLE_VALUE)
+#else
+      m_file(-1)
+#endif
+    {
+    }
+
+    ~StreamFile()
+    {
+      close();
+    }
+
+    bool open(const std::string& filename, std::string& error)
+    {
+#ifdef _WIN32
+      m_file = CreateFileW(toWide(filename).c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+      if(m_file == INVALID_HANDLE_VALUE)
+      {
+        error = "Failed to create file";
+        return false;
+      }
+#else
+  #ifdef O_DIRECT
+      m_file = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+      if(m_file < 0 && errno != EINVAL) // EINVAL: file system without direct I/O support
+      {
+        error = std::string("Failed to create file: ") + strerror(errno);
+        return false;
+      }
+  #endif
+      if(m_file < 0)
+        m_file = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if(m_file < 0)
+      {
+        error = std::string("Failed to create file: ") + strerror(errno);
+        return false;
+      }
+  #ifdef F_NOCACHE
+      fcntl(m_file, F_NOCACHE, 1);
+  #endif
+#endif
+      return true;
+    }
+
+    bool write(const uint8_t* data, uint64_t size, uint64_t offset, std::string& error)
+    {
+      while(size > 0)
+      {
+        const size_t count = (size_t)std::min<uint64_t>(size, 1 << 30);
+#ifdef _WIN32
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD written = 0;
+        if(!WriteFile(m_file, data, (DWORD)count, &written, &overlapped) || written == 0)
+        {
+          error = "Failed to write file";
+          return false;
+        }
+#else
+        const ssize_t written = pwrite(m_file, data, count, (off_t)offset);
+        if(written < 0 && errno == EINTR)
+          continue;
+        if(written <= 0)
+        {
+          error = std::string("Failed to write file: ") + strerror(errno);
+          return false;
+        }
+#endif
+        data += written;
+        size -= written;
+        offset += written;
+      }
+      return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+      if(m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+      m_file = INVALID_HANDLE_VALUE;
+#else
+      if(m_file >= 0)
+        ::close(m_file);
+      m_file = -1;
+#endif
+    }
+
+  private:
+#ifdef _WIN32
+    HANDLE m_file;
+#else
+    int m_file;
+#endif
+};
+
+NAN_MODULE_INIT(Recorder::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("Recorder").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "start", Start);
+  Nan::SetPrototypeMethod(tpl, "stop", Stop);
+  Nan::SetPrototypeMethod(tpl, "getStatus", GetStatus);
+
+  Nan::Set(target, Nan::New<v8::String>("Recorder").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+Recorder::Recorder(LibTiePieHandle_t device) :
+  m_device(device),
+  m_channelCount(0),
+  m_file(0),
+  m_stride(0),
+  m_bufferChunkCount(0),
+  m_buildPyramid(false),
+  m_dataReady(false),
+  m_pending(-1),
+  m_pendingChunkCount(0),
+  m_flushed(false),
+  m_running(false),
+  m_stop(false),
+  m_finished(false),
+  m_chunkCount(0),
+  m_writtenChunkCount(0),
+  m_bytesWritten(0),
+  m_overflowCount(0),
+  m_async(0),
+  m_progress(0),
+  m_done(0),
+  m_resource(0)
+{
+  m_buffers[0] = m_buffers[1] = 0;
+  m_header.chunkSampleCount = 0;
+}
+
+Recorder::~Recorder()
+{
+  freeAligned(m_buffers[0]);
+  freeAligned(m_buffers[1]);
+}
+
+NAN_METHOD(Recorder::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowError("Use the new operator");
+
+  CHECK_PARAMETER_COUNT(1);
+  const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
+
+  Recorder* recorder = new Recorder(device);
+  recorder->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+/**
+ * start(filename, onProgress, callback[, options]), options.pyramid builds a min/max pyramid while recording, which is
+ * saved as filename + ".pyramid", see Pyramid.
+ */
+NAN_METHOD(Recorder::Start)
+{
+  if(info.Length() < 3 || info.Length() > 4)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+  Recorder* recorder = Nan::ObjectWrap::Unwrap<Recorder>(info.Holder());
+  const std::string filename(*Nan::Utf8String(info[0]));
+  if(!info[1]->IsFunction() && !info[1]->IsNullOrUndefined())
+    return Nan::ThrowTypeError("Invalid progress callback");
+  if(!info[2]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+  bool buildPyramid = false;
+  if(info.Length() > 3 && info[3]->IsObject())
+  {
+    v8::Local<v8::Value> value = Nan::Get(info[3].As<v8::Object>(), Nan::New<v8::String>("pyramid").ToLocalChecked()).ToLocalChecked();
+    buildPyramid = Nan::To<bool>(value).FromJust();
+  }
+  if(recorder->m_running)
+    return Nan::ThrowError("Recorder is running");
+
+  CaptureHeader& header = recorder->m_header;
+  recorder->m_channelCount = ScpGetChannelCount(recorder->m_device);
+  CHECK_LAST_STATUS();
+  if(!readScopeCaptureHeader(recorder->m_device, true, header))
+    return Nan::ThrowError(LibGetLastStatusStr());
+  if(header.measureMode != MM_STREAM)
+    return Nan::ThrowError("Oscilloscope is not in stream mode");
+  if(header.channels.empty())
+    return Nan::ThrowError("No channels enabled");
+
+  // Each chunk is one record of the stream:
+  header.chunkSampleCount = header.sampleCount;
+  header.sampleCount = 0;
+  header.triggerIndex = 0;
+  header.validPreSampleCount = 0;
+  layoutCaptureFile(header);
+
+  recorder->m_stride = captureChunkStride(header);
+  recorder->m_bufferChunkCount = (size_t)std::max<uint64_t>(1, RECORDER_WRITE_SIZE / recorder->m_stride);
+  for(int i = 0; i < 2; ++i)
+  {
+    freeAligned(recorder->m_buffers[i]);
+    recorder->m_buffers[i] = allocateAligned((size_t)(recorder->m_bufferChunkCount * recorder->m_stride));
+    if(!recorder->m_buffers[i])
+      return Nan::ThrowError("Out of memory");
+  }
+
+  recorder->m_buildPyramid = buildPyramid;
+  if(buildPyramid)
+    recorder->m_pyramid.reset(header, PYRAMID_DEFAULT_BUCKETSHIFT);
+
+  recorder->m_filename = filename;
+  recorder->m_error.clear();
+  recorder->m_dataReady = false;
+  recorder->m_pending = -1;
+  recorder->m_flushed = false;
+  recorder->m_stop = false;
+  recorder->m_finished = false;
+  recorder->m_chunkCount = 0;
+  recorder->m_writtenChunkCount = 0;
+  recorder->m_bytesWritten = 0;
+  recorder->m_overflowCount = 0;
+
+  recorder->m_progress = info[1]->IsFunction() ? new Nan::Callback(info[1].As<v8::Function>()) : 0;
+  recorder->m_done = new Nan::Callback(info[2].As<v8::Function>());
+  recorder->m_resource = new Nan::AsyncResource("libtiepie:Recorder");
+  recorder->m_async = new uv_async_t;
+  uv_async_init(Nan::GetCurrentEventLoop(), recorder->m_async, onAsync);
+  recorder->m_async->data = recorder;
+
+  // Keep the object alive while recording:
+  recorder->Ref();
+  recorder->m_running = true;
+  recorder->m_thread = std::thread(&Recorder::run, recorder);
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(Recorder::Stop)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Recorder* recorder = Nan::ObjectWrap::Unwrap<Recorder>(info.Holder());
+  {
+    std::lock_guard<std::mutex> lock(recorder->m_mutex);
+    recorder->m_stop = true;
+  }
+  recorder->m_condition.notify_all();
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(Recorder::GetStatus)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Recorder* recorder = Nan::ObjectWrap::Unwrap<Recorder>(info.Holder());
+  info.GetReturnValue().Set(recorder->status());
+}
+
+v8::Local<v8::Object> Recorder::status() const
+{
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  Nan::Set(result, Nan::New<v8::String>("running").ToLocalChecked(), Nan::New<v8::Boolean>(m_running.load()));
+  Nan::Set(result, Nan::New<v8::String>("chunkCount").ToLocalChecked(), Nan::New<v8::Number>((double)m_chunkCount));
+  Nan::Set(result, Nan::New<v8::String>("sampleCount").ToLocalChecked(), Nan::New<v8::Number>((double)(m_chunkCount * m_header.chunkSampleCount)));
+  Nan::Set(result, Nan::New<v8::String>("bytesWritten").ToLocalChecked(), Nan::New<v8::Number>((double)m_bytesWritten));
+  Nan::Set(result, Nan::New<v8::String>("overflowCount").ToLocalChecked(), Nan::New<v8::Number>((double)m_overflowCount));
+  return result;
+}
+
+void Recorder::onDataReady(void* data)
+{
+  Recorder* recorder = (Recorder*)data;
+  {
+    std::lock_guard<std::mutex> lock(recorder->m_mutex);
+    recorder->m_dataReady = true;
+  }
+  recorder->m_condition.notify_all();
+}
+
+void Recorder::onDataOverflow(void* data)
+{
+  ++((Recorder*)data)->m_overflowCount;
+}
+
+void Recorder::run()
+{
+  StreamFile file;
+  std::string error;
+  if(!file.open(m_filename, error))
+  {
+    fail(error);
+    finish();
+    return;
+  }
+  m_file = &file;
+
+  // The header is written again when done, with the final sample count:
+  const uint64_t headerSize = captureHeaderBlockSize(m_header);
+  uint8_t* header = allocateAligned((size_t)headerSize);
+  if(!header)
+  {
+    fail("Out of memory");
+    finish();
+    return;
+  }
+  memset(header, 0, (size_t)headerSize);
+  writeCaptureHeader(header, m_header);
+  if(!file.write(header, headerSize, 0, error))
+  {
+    freeAligned(header);
+    fail(error);
+    finish();
+    return;
+  }
+
+  m_writer = std::thread(&Recorder::writer, this);
+
+  ScpSetCallbackDataReady(m_device, onDataReady, this);
+  ScpSetCallbackDataOverflow(m_device, onDataOverflow, this);
+  ScpStart(m_device);
+  if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+    fail(LibGetLastStatusStr());
+
+  std::vector<void*> pointers(m_channelCount, (void*)0);
+  int current = 0;
+  size_t count = 0;
+  while(!m_stop)
+  {
+    if(ScpIsDataReady(m_device) == BOOL8_TRUE)
+    {
+      uint8_t* chunk = m_buffers[current] + count * m_stride;
+      for(std::vector<CaptureChannel>::const_iterator it = m_header.channels.begin(); it != m_header.channels.end(); ++it)
+        pointers[it->number] = chunk + (it->dataOffset - headerSize);
+
+      ScpGetDataRaw(m_device, &pointers[0], m_channelCount, 0, m_header.chunkSampleCount);
+      if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+      {
+        fail(LibGetLastStatusStr());
+        break;
+      }
+
+      ++m_chunkCount;
+      if(++count == m_bufferChunkCount)
+      {
+        submit(current, count);
+        current = 1 - current;
+        count = 0;
+      }
+    }
+    else if(ScpIsRunning(m_device) == BOOL8_FALSE)
+    {
+      // The measurement stops after a data overflow, resume it:
+      ScpStart(m_device);
+      if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+        fail(LibGetLastStatusStr());
+    }
+    else
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if(!m_dataReady && !m_stop)
+        m_condition.wait_for(lock, std::chrono::milliseconds(100));
+      m_dataReady = false;
+    }
+  }
+
+  ScpStop(m_device);
+  ScpSetCallbackDataReady(m_device, 0, 0);
+  ScpSetCallbackDataOverflow(m_device, 0, 0);
+
+  if(count > 0)
+    submit(current, count);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_flushed = true;
+  }
+  m_condition.notify_all();
+  m_writer.join();
+
+  m_header.sampleCount = m_writtenChunkCount * m_header.chunkSampleCount;
+  writeCaptureHeader(header, m_header);
+  if(!file.write(header, headerSize, 0, error))
+    fail(error);
+  freeAligned(header);
+
+  m_file = 0;
+  file.close();
+
+  if(m_buildPyramid && m_error.empty())
+  {
+    m_pyramid.finish();
+    if(!m_pyramid.save(m_filename + PYRAMID_EXTENSION, error))
+      fail(error);
+    m_pyramid.reset(CaptureHeader(), PYRAMID_DEFAULT_BUCKETSHIFT);
+  }
+  finish();
+}
+
+void Recorder::submit(int buffer, size_t chunkCount)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while(m_pending != -1)
+    m_condition.wait(lock);
+  m_pending = buffer;
+  m_pendingChunkCount = chunkCount;
+  m_condition.notify_all();
+}
+
+void Recorder::writer()
+{
+  uint64_t offset = captureHeaderBlockSize(m_header);
+  for(;;)
+  {
+    int buffer;
+    size_t chunkCount;
+    bool failed;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while(m_pending == -1 && !m_flushed)
+        m_condition.wait(lock);
+      if(m_pending == -1)
+        break;
+      buffer = m_pending;
+      chunkCount = m_pendingChunkCount;
+      failed = !m_error.empty();
+    }
+
+    // After a failure buffers are discarded, so the acquisition thread never blocks:
+    if(!failed)
+    {
+      const uint64_t size = chunkCount * m_stride;
+      std::string error;
+      if(m_file->write(m_buffers[buffer], size, offset, error))
+      {
+        offset += size;
+        m_bytesWritten += size;
+        m_writtenChunkCount += chunkCount;
+
+        // The chunks are still in memory, so the pyramid costs no extra reads:
+        if(m_buildPyramid)
+        {
+          const uint64_t headerSize = captureHeaderBlockSize(m_header);
+          for(size_t i = 0; i < chunkCount; ++i)
+            for(size_t ch = 0; ch < m_header.channels.size(); ++ch)
+              m_pyramid.append(ch, m_buffers[buffer] + i * m_stride + (m_header.channels[ch].dataOffset - headerSize), m_header.chunkSampleCount);
+        }
+      }
+      else
+        fail(error);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_pending = -1;
+    }
+    m_condition.notify_all();
+    uv_async_send(m_async);
+  }
+}
+
+void Recorder::fail(const std::string& error)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_error.empty())
+      m_error = error;
+    m_stop = true;
+  }
+  m_condition.notify_all();
+}
+
+void Recorder::finish()
+{
+  m_finished = true;
+  uv_async_send(m_async);
+}
+
+void Recorder::onAsync(uv_async_t* handle)
+{
+  Nan::HandleScope scope;
+  Recorder* recorder = (Recorder*)handle->data;
+
+  if(!recorder->m_finished)
+  {
+    if(recorder->m_progress)
+    {
+      v8::Local<v8::Value> argv[] = {recorder->status()};
+      recorder->m_progress->Call(1, argv, recorder->m_resource);
+    }
+    return;
+  }
+
+  recorder->m_thread.join();
+  recorder->m_running = false;
+  uv_close((uv_handle_t*)handle, onClose);
+  recorder->m_async = 0;
+
+  Nan::Callback* progress = recorder->m_progress;
+  Nan::Callback* done = recorder->m_done;
+  Nan::AsyncResource* resource = recorder->m_resource;
+  recorder->m_progress = 0;
+  recorder->m_done = 0;
+  recorder->m_resource = 0;
+
+  v8::Local<v8::Value> argv[] = {recorder->m_error.empty() ? v8::Local<v8::Value>(Nan::Null()) : Nan::Error(recorder->m_error.c_str()), recorder->status()};
+  done->Call(2, argv, resource);
+
+  delete progress;
+  delete done;
+  delete resource;
+  recorder->Unref();
+}
+
+void Recorder::onClose(uv_handle_t* handle)
+{
+  delete (uv_async_t*)handle;
+}
@@ -0,0 +1,87 @@
+/**
+ * \file recorder.h
+ * \brief Records a streaming measurement to disk on background threads.
+ *
+ * The recorder owns the streaming measurement of an oscilloscope while running: one thread drains the
+ * oscilloscope into one of two buffers while a second thread writes the other buffer to disk, bypassing
+ * the page cache where the platform allows it. The data is stored raw in a chunked capture file, see
+ * capturefile.h, and never enters the JavaScript heap.
+ */
+
+#ifndef _RECORDER_H_
+#define _RECORDER_H_
+
+#include "common.h"
+#include "capturefile.h"
+#include "pyramid.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#define RECORDER_WRITE_SIZE   (8 * 1024 * 1024) //!< Minimum number of bytes per write.
+
+class StreamFile;
+
+class Recorder : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    explicit Recorder(LibTiePieHandle_t device);
+    ~Recorder();
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Start);
+    static NAN_METHOD(Stop);
+    static NAN_METHOD(GetStatus);
+
+    static void onDataReady(void* data);
+    static void onDataOverflow(void* data);
+    static void onAsync(uv_async_t* handle);
+    static void onClose(uv_handle_t* handle);
+
+    void run();
+    void writer();
+    void submit(int buffer, size_t chunkCount);
+    void fail(const std::string& error);
+    void finish();
+    v8::Local<v8::Object> status() const;
+
+    LibTiePieHandle_t m_device;
+    uint16_t m_channelCount;
+    std::string m_filename;
+    StreamFile* m_file;
+    CaptureHeader m_header;
+    uint64_t m_stride;
+    size_t m_bufferChunkCount;
+    uint8_t* m_buffers[2];
+    bool m_buildPyramid;
+    MinMaxPyramid m_pyramid; //!< Built by the writer thread, saved next to the file when done.
+
+    std::thread m_thread;
+    std::thread m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_dataReady;
+    int m_pending; //!< Buffer being written, -1 if the writer is idle.
+    size_t m_pendingChunkCount;
+    bool m_flushed;
+    std::string m_error;
+
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_stop;
+    std::atomic<bool> m_finished;
+    std::atomic<uint64_t> m_chunkCount;
+    std::atomic<uint64_t> m_writtenChunkCount;
+    std::atomic<uint64_t> m_bytesWritten;
+    std::atomic<uint64_t> m_overflowCount;
+
+    uv_async_t* m_async;
+    Nan::Callback* m_progress;
+    Nan::Callback* m_done;
+    Nan::AsyncResource* m_resource;
+};
+
+#endif
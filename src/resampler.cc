@@ -0,0 +1,466 @@
+/**
+ * \file resampler.cc
+ * \brief Polyphase windowed sinc resampler, for records and streams.
+ */
+
+#include "resampler.h"
+#include "simd.h"
+#include <cmath>
+#include <thread>
+
+#ifndef M_PI
+  #define M_PI 3.14159265358979323846
+#endif
+
+/**
+ * Modified Bessel function of the first kind, order zero.
+ */
+static double besselI0(double x)
+{
+  double sum = 1;
+  double term = 1;
+  for(int k = 1; k < 64 && term > sum * 1e-17; ++k)
+  {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+static uint64_t gcd(uint64_t a, uint64_t b)
+{
+  while(b != 0)
+  {
+    const uint64_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+PolyphaseResampler::PolyphaseResampler(uint64_t step, uint64_t denominator, uint32_t taps, double cutoff) :
+  m_step(step),
+  m_denominator(denominator)
+{
+  // When decimating the filter gets longer, so the transition band stays the same relative to the output rate:
+  const double scale = std::min(1.0, (double)denominator / step);
+  const double fc = cutoff * scale;
+  const size_t half = (size_t)std::ceil(taps / scale);
+  m_length = 2 * half;
+  m_interpolate = denominator > RESAMPLER_PHASES || denominator * m_length > RESAMPLER_MAX_TABLESIZE;
+  m_phaseCount = m_interpolate ? std::min<size_t>(RESAMPLER_PHASES, RESAMPLER_MAX_TABLESIZE / m_length - 1) : (size_t)denominator;
+
+  const size_t rowCount = m_phaseCount + (m_interpolate ? 1 : 0);
+  const double i0beta = besselI0(RESAMPLER_KAISER_BETA);
+  m_table.resize(rowCount * m_length);
+  std::vector<double> row(m_length);
+  for(size_t p = 0; p < rowCount; ++p)
+  {
+    // Window sample k is at k - (half - 1) - fraction from the output:
+    const double fraction = (double)p / m_phaseCount;
+    double sum = 0;
+    for(size_t k = 0; k < m_length; ++k)
+    {
+      const double d = (double)k - (double)(half - 1) - fraction;
+      const double x = M_PI * fc * d;
+      const double sinc = x == 0 ? 1.0 : std::sin(x) / x;
+      const double w = d / half;
+      const double window = std::fabs(w) < 1 ? besselI0(RESAMPLER_KAISER_BETA * std::sqrt(1 - w * w)) / i0beta : 0.0;
+      row[k] = sinc * window;
+      sum += row[k];
+    }
+
+    // Unity gain at DC for every phase:
+    for(size_t k = 0; k < m_length; ++k)
+      m_table[p * m_length + k] = (float)(row[k] / sum);
+  }
+}
+
+void PolyphaseResampler::toFraction(double inputRate, double outputRate, uint64_t& step, uint64_t& denominator)
+{
+  if(inputRate == std::floor(inputRate) && outputRate == std::floor(outputRate) && inputRate < 9007199254740992.0 && outputRate < 9007199254740992.0)
+  {
+    const uint64_t g = gcd((uint64_t)inputRate, (uint64_t)outputRate);
+    if((uint64_t)outputRate / g <= RESAMPLER_MAX_DENOMINATOR)
+    {
+      step = (uint64_t)inputRate / g;
+      denominator = (uint64_t)outputRate / g;
+      return;
+    }
+  }
+
+  // Best approximation by continued fraction:
+  uint64_t h0 = 0;
+  uint64_t h1 = 1;
+  uint64_t k0 = 1;
+  uint64_t k1 = 0;
+  double x = inputRate / outputRate;
+  for(int i = 0; i < 64; ++i)
+  {
+    const double a = std::floor(x);
+    const uint64_t h2 = (uint64_t)a * h1 + h0;
+    const uint64_t k2 = (uint64_t)a * k1 + k0;
+    if(k2 > RESAMPLER_MAX_DENOMINATOR)
+      break;
+    h0 = h1;
+    h1 = h2;
+    k0 = k1;
+    k1 = k2;
+    if(x - a < 1e-12)
+      break;
+    x = 1 / (x - a);
+  }
+  step = h1;
+  denominator = k1;
+}
+
+float PolyphaseResampler::sample(const float* window, uint64_t fraction) const
+{
+  if(!m_interpolate)
+    return dotProduct(&m_table[(size_t)fraction * m_length], window, m_length);
+
+  const double f = (double)fraction * m_phaseCount / m_denominator;
+  const size_t p = std::min((size_t)f, m_phaseCount - 1);
+  const float a = (float)(f - p);
+  const float* coefficients = &m_table[p * m_length];
+  const float y0 = dotProduct(coefficients, window, m_length);
+  const float y1 = dotProduct(coefficients + m_length, window, m_length);
+  return y0 + a * (y1 - y0);
+}
+
+void PolyphaseResampler::run(const float* data, size_t size, int64_t offset, uint64_t position, uint64_t count, float* output) const
+{
+  const uint32_t threadCount = count < RESAMPLER_PARALLEL_SAMPLES ? 1 : std::max(std::thread::hardware_concurrency(), 1u);
+  std::vector<std::thread> threads;
+  for(uint32_t t = 1; t < threadCount; ++t)
+    threads.push_back(std::thread(&PolyphaseResampler::runRange, this, data, size, offset, position, count * t / threadCount, count * (t + 1) / threadCount, output));
+
+  runRange(data, size, offset, position, 0, count / threadCount, output);
+
+  for(std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it)
+    it->join();
+}
+
+void PolyphaseResampler::runRange(const float* data, size_t size, int64_t offset, uint64_t position, uint64_t begin, uint64_t end, float* output) const
+{
+  // Step through the positions without dividing for every output:
+  const uint64_t stepIndex = m_step / m_denominator;
+  const uint64_t stepFraction = m_step % m_denominator;
+  position += begin * m_step;
+  int64_t index = offset + (int64_t)(position / m_denominator);
+  uint64_t fraction = position % m_denominator;
+
+  std::vector<float> padded;
+  for(uint64_t k = begin; k < end; ++k)
+  {
+    if(index >= 0 && index + (int64_t)m_length <= (int64_t)size)
+      output[k] = sample(data + index, fraction);
+    else
+    {
+      // The window is partly outside the data, at the start or end:
+      padded.assign(m_length, 0.0f);
+      for(size_t i = 0; i < m_length; ++i)
+        if(index + (int64_t)i >= 0 && index + (int64_t)i < (int64_t)size)
+          padded[i] = data[index + i];
+      output[k] = sample(&padded[0], fraction);
+    }
+
+    index += (int64_t)stepIndex;
+    fraction += stepFraction;
+    if(fraction >= m_denominator)
+    {
+      fraction -= m_denominator;
+      index++;
+    }
+  }
+}
+
+class ResamplerWorker : public Nan::AsyncWorker
+{
+  public:
+    ResamplerWorker(Nan::Callback* callback, Resampler* resampler, v8::Local<v8::Object> self, v8::Local<v8::Value> data, std::vector<FloatArrayArgument>& inputs, const std::vector<float*>& outputs, v8::Local<v8::Value> result, bool stream) :
+      Nan::AsyncWorker(callback),
+      m_resampler(resampler),
+      m_outputs(outputs),
+      m_stream(stream)
+    {
+      m_inputs.swap(inputs);
+      SaveToPersistent("self", self);
+      SaveToPersistent("data", data);
+      SaveToPersistent("result", result);
+    }
+
+    void Execute()
+    {
+      const PolyphaseResampler& resampler = m_resampler->m_resampler;
+      for(size_t ch = 0; ch < m_inputs.size(); ++ch)
+      {
+        if(!m_outputs[ch])
+          continue;
+        if(m_stream)
+          m_resampler->stream(ch, m_inputs[ch].data(), m_inputs[ch].length(), m_outputs[ch]);
+        else
+          resampler.run(m_inputs[ch].data(), m_inputs[ch].length(), 1 - (int64_t)resampler.length() / 2, 0, resampler.count(0, m_inputs[ch].length()), m_outputs[ch]);
+      }
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      if(m_stream)
+        m_resampler->m_busy = false;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), GetFromPersistent("result")};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    Resampler* m_resampler;
+    std::vector<FloatArrayArgument> m_inputs;
+    std::vector<float*> m_outputs;
+    bool m_stream;
+};
+
+NAN_MODULE_INIT(Resampler::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("Resampler").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "resample", Resample);
+  Nan::SetPrototypeMethod(tpl, "process", Process);
+  Nan::SetPrototypeMethod(tpl, "flush", Flush);
+  Nan::SetPrototypeMethod(tpl, "reset", Reset);
+
+  Nan::Set(target, Nan::New<v8::String>("Resampler").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+Resampler::Resampler(uint16_t channelCount, uint64_t step, uint64_t denominator, uint32_t taps, double cutoff) :
+  m_resampler(step, denominator, taps, cutoff),
+  m_streams(channelCount),
+  m_busy(false)
+{
+  resetStreams();
+}
+
+void Resampler::resetStreams()
+{
+  // A stream starts with half a window of zeros, like a record:
+  for(std::vector<ResamplerStream>::iterator it = m_streams.begin(); it != m_streams.end(); ++it)
+  {
+    it->buffer.assign(m_resampler.length() / 2 - 1, 0.0f);
+    it->position = 0;
+  }
+}
+
+uint64_t Resampler::streamLength(size_t ch, size_t length) const
+{
+  const ResamplerStream& s = m_streams[ch];
+  const size_t size = s.buffer.size() + length;
+  return size + 1 > m_resampler.length() ? m_resampler.count(s.position, size + 1 - m_resampler.length()) : 0;
+}
+
+void Resampler::stream(size_t ch, const float* input, size_t length, float* output)
+{
+  const uint64_t count = streamLength(ch, length);
+  ResamplerStream& s = m_streams[ch];
+  s.buffer.insert(s.buffer.end(), input, input + length);
+  m_resampler.run(s.buffer.empty() ? 0 : &s.buffer[0], s.buffer.size(), 0, s.position, count, output);
+  s.position += count * m_resampler.step();
+
+  // Drop the samples before the next window:
+  const size_t consumed = (size_t)std::min<uint64_t>(s.position / m_resampler.denominator(), s.buffer.size());
+  s.buffer.erase(s.buffer.begin(), s.buffer.begin() + consumed);
+  s.position -= consumed * m_resampler.denominator();
+}
+
+static v8::Local<v8::Value> getValue(v8::Local<v8::Object> options, const char* name)
+{
+  return Nan::Get(options, Nan::New<v8::String>(name).ToLocalChecked()).ToLocalChecked();
+}
+
+static uint32_t getOption(v8::Local<v8::Object> options, const char* name, uint32_t defaultValue)
+{
+  v8::Local<v8::Value> value = getValue(options, name);
+  return value->IsUndefined() ? defaultValue : Nan::To<uint32_t>(value).FromJust();
+}
+
+/**
+ * new Resampler(inputRate, outputRate[, options]), options: channelCount (streams for process()), taps (filter taps
+ * on each side of an output sample, more gives a steeper filter) and cutoff (relative to the lowest Nyquist frequency).
+ * The input rate may be at most 256 times the output rate.
+ */
+NAN_METHOD(Resampler::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowTypeError("Resampler must be called with new");
+  if(info.Length() < 2 || info.Length() > 3)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+
+  const double inputRate = Nan::To<double>(info[0]).FromJust();
+  const double outputRate = Nan::To<double>(info[1]).FromJust();
+  if(!(inputRate > 0) || !(outputRate > 0) || std::isinf(inputRate) || std::isinf(outputRate))
+    return Nan::ThrowRangeError("Invalid sample rate");
+  const double ratio = inputRate / outputRate;
+  if(ratio > RESAMPLER_MAX_DECIMATION || ratio * RESAMPLER_MAX_DENOMINATOR < 1)
+    return Nan::ThrowRangeError("Ratio out of range");
+
+  uint32_t channelCount = 1;
+  uint32_t taps = RESAMPLER_DEFAULT_TAPS;
+  double cutoff = RESAMPLER_DEFAULT_CUTOFF;
+  if(info.Length() > 2 && info[2]->IsObject())
+  {
+    v8::Local<v8::Object> options = info[2].As<v8::Object>();
+    channelCount = getOption(options, "channelCount", channelCount);
+    taps = getOption(options, "taps", taps);
+    v8::Local<v8::Value> value = getValue(options, "cutoff");
+    if(!value->IsUndefined())
+      cutoff = Nan::To<double>(value).FromJust();
+  }
+  CHECK_RANGE(channelCount, 1, std::numeric_limits<uint16_t>::max());
+  CHECK_RANGE(taps, 2, 64);
+  if(!(cutoff > 0 && cutoff <= 1))
+    return Nan::ThrowRangeError("Invalid cutoff");
+
+  uint64_t step;
+  uint64_t denominator;
+  PolyphaseResampler::toFraction(inputRate, outputRate, step, denominator);
+
+  Resampler* resampler = new Resampler((uint16_t)channelCount, step, denominator, taps, cutoff);
+  resampler->Wrap(info.This());
+  Nan::DefineOwnProperty(info.This(), Nan::New<v8::String>("inputRate").ToLocalChecked(), Nan::New<v8::Number>(inputRate), v8::ReadOnly);
+  Nan::DefineOwnProperty(info.This(), Nan::New<v8::String>("outputRate").ToLocalChecked(), Nan::New<v8::Number>(outputRate), v8::ReadOnly);
+
+  info.GetReturnValue().Set(info.This());
+}
+
+/**
+ * resample(data[, callback]), resamples a complete record, independent of the streams. Returns, or passes to the
+ * callback, a Float32Array with an output sample for every output period within the record.
+ */
+NAN_METHOD(Resampler::Resample)
+{
+  if(info.Length() < 1 || info.Length() > 2)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+  if(info.Length() > 1 && !info[1]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  Resampler* resampler = Nan::ObjectWrap::Unwrap<Resampler>(info.Holder());
+  std::vector<FloatArrayArgument> inputs(1);
+  if(!inputs[0].assign(info[0]))
+    return Nan::ThrowTypeError("Invalid data, expected an array");
+
+  const PolyphaseResampler& polyphase = resampler->m_resampler;
+  const uint64_t count = polyphase.count(0, inputs[0].length());
+  if(count > std::numeric_limits<uint32_t>::max())
+    return Nan::ThrowRangeError("Result too large");
+  std::vector<float*> outputs(1);
+  v8::Local<v8::Float32Array> result = NewFloat32Array((size_t)count, outputs[0]);
+
+  if(info.Length() > 1)
+  {
+    Nan::Callback* callback = new Nan::Callback(info[1].As<v8::Function>());
+    Nan::AsyncQueueWorker(new ResamplerWorker(callback, resampler, info.Holder(), info[0], inputs, outputs, result, false));
+    info.GetReturnValue().SetUndefined();
+  }
+  else
+  {
+    polyphase.run(inputs[0].data(), inputs[0].length(), 1 - (int64_t)polyphase.length() / 2, 0, count, outputs[0]);
+    info.GetReturnValue().Set(result);
+  }
+}
+
+/**
+ * process(data[, callback]), data has an array per channel or null, the next chunk of each stream. Returns, or passes
+ * to the callback, a Float32Array per channel with the output samples that can be computed so far, the rest follows
+ * with the next chunk or flush().
+ */
+NAN_METHOD(Resampler::Process)
+{
+  if(info.Length() < 1 || info.Length() > 2)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+  if(info.Length() > 1 && !info[1]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+  if(!info[0]->IsArray())
+    return Nan::ThrowTypeError("Invalid data, expected an array");
+
+  Resampler* resampler = Nan::ObjectWrap::Unwrap<Resampler>(info.Holder());
+  if(resampler->m_busy)
+    return Nan::ThrowError("Resampler is busy");
+
+  v8::Local<v8::Array> data = info[0].As<v8::Array>();
+  if(data->Length() > resampler->m_streams.size())
+    return Nan::ThrowTypeError("Invalid data, more arrays than channels");
+
+  std::vector<FloatArrayArgument> inputs(data->Length());
+  std::vector<float*> outputs(data->Length(), (float*)0);
+  v8::Local<v8::Array> result = Nan::New<v8::Array>(data->Length());
+  for(uint32_t ch = 0; ch < data->Length(); ++ch)
+  {
+    v8::Local<v8::Value> item = Nan::Get(data, ch).ToLocalChecked();
+    if(item->IsNullOrUndefined())
+    {
+      Nan::Set(result, ch, Nan::Null());
+      continue;
+    }
+    if(!inputs[ch].assign(item))
+      return Nan::ThrowTypeError("Invalid data, expected an array");
+    Nan::Set(result, ch, NewFloat32Array((size_t)resampler->streamLength(ch, inputs[ch].length()), outputs[ch]));
+  }
+
+  if(info.Length() > 1)
+  {
+    resampler->m_busy = true;
+    Nan::Callback* callback = new Nan::Callback(info[1].As<v8::Function>());
+    Nan::AsyncQueueWorker(new ResamplerWorker(callback, resampler, info.Holder(), data, inputs, outputs, result, true));
+    info.GetReturnValue().SetUndefined();
+  }
+  else
+  {
+    for(size_t ch = 0; ch < inputs.size(); ++ch)
+      if(outputs[ch])
+        resampler->stream(ch, inputs[ch].data(), inputs[ch].length(), outputs[ch]);
+    info.GetReturnValue().Set(result);
+  }
+}
+
+/**
+ * flush(), returns a Float32Array per channel with the remaining output samples of each stream, up to the end of the
+ * input, and starts new streams.
+ */
+NAN_METHOD(Resampler::Flush)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Resampler* resampler = Nan::ObjectWrap::Unwrap<Resampler>(info.Holder());
+  if(resampler->m_busy)
+    return Nan::ThrowError("Resampler is busy");
+
+  const PolyphaseResampler& polyphase = resampler->m_resampler;
+  const size_t half = polyphase.length() / 2;
+  v8::Local<v8::Array> result = Nan::New<v8::Array>(resampler->m_streams.size());
+  for(size_t ch = 0; ch < resampler->m_streams.size(); ++ch)
+  {
+    // Outputs up to the last input sample, the window is padded with zeros beyond it:
+    const ResamplerStream& s = resampler->m_streams[ch];
+    const uint64_t count = s.buffer.size() + 1 > half ? polyphase.count(s.position, s.buffer.size() + 1 - half) : 0;
+    float* output;
+    Nan::Set(result, ch, NewFloat32Array((size_t)count, output));
+    polyphase.run(s.buffer.empty() ? 0 : &s.buffer[0], s.buffer.size(), 0, s.position, count, output);
+  }
+  resampler->resetStreams();
+
+  info.GetReturnValue().Set(result);
+}
+
+/**
+ * reset(), discards the state of all streams.
+ */
+NAN_METHOD(Resampler::Reset)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Resampler* resampler = Nan::ObjectWrap::Unwrap<Resampler>(info.Holder());
+  if(resampler->m_busy)
+    return Nan::ThrowError("Resampler is busy");
+
+  resampler->resetStreams();
+  info.GetReturnValue().SetUndefined();
+}
@@ -0,0 +1,111 @@
+/**
+ * \file resampler.h
+ * \brief Polyphase windowed sinc resampler, for records and streams.
+ *
+ * The ratio between the input and output rate is kept as a fraction, so a stream never drifts. Ratios with a small
+ * denominator have a filter per phase, others interpolate linearly between #RESAMPLER_PHASES precomputed phases.
+ */
+
+#ifndef _RESAMPLER_H_
+#define _RESAMPLER_H_
+
+#include "common.h"
+#include <atomic>
+
+#define RESAMPLER_MAX_DENOMINATOR    (1 << 24)
+#define RESAMPLER_PHASES             1024 //!< Phases interpolated between when the denominator is larger.
+#define RESAMPLER_MAX_TABLESIZE      (1 << 22) //!< Coefficients in the phase table.
+#define RESAMPLER_MAX_DECIMATION     256
+#define RESAMPLER_DEFAULT_TAPS       16 //!< Filter taps on each side of an output sample, before decimation.
+#define RESAMPLER_DEFAULT_CUTOFF     0.9 //!< Relative to the lowest Nyquist frequency.
+#define RESAMPLER_KAISER_BETA        8.0
+#define RESAMPLER_PARALLEL_SAMPLES   (1 << 16) //!< Outputs are computed on several threads from this many.
+
+class PolyphaseResampler
+{
+  public:
+    PolyphaseResampler(uint64_t step, uint64_t denominator, uint32_t taps, double cutoff);
+
+    /**
+     * Approximate \p inputRate / \p outputRate by \p step / \p denominator, exact if both rates are integers and the
+     * reduced denominator is at most #RESAMPLER_MAX_DENOMINATOR.
+     */
+    static void toFraction(double inputRate, double outputRate, uint64_t& step, uint64_t& denominator);
+
+    /**
+     * Number of outputs at positions from \p position on, in steps of step() / denominator() samples, before \p limit.
+     */
+    uint64_t count(uint64_t position, uint64_t limit) const
+    {
+      const uint64_t end = limit * m_denominator;
+      return end > position ? (end - position + m_step - 1) / m_step : 0;
+    }
+
+    /**
+     * Compute \p count outputs, output k uses the window of length() samples of \p data that starts at index
+     * <tt>offset + (position + k * step) / denominator</tt>, samples outside the data are zero.
+     */
+    void run(const float* data, size_t size, int64_t offset, uint64_t position, uint64_t count, float* output) const;
+
+    uint64_t step() const
+    {
+      return m_step;
+    }
+
+    uint64_t denominator() const
+    {
+      return m_denominator;
+    }
+
+    size_t length() const
+    {
+      return m_length;
+    }
+
+  private:
+    void runRange(const float* data, size_t size, int64_t offset, uint64_t position, uint64_t begin, uint64_t end, float* output) const;
+    float sample(const float* window, uint64_t fraction) const;
+
+    uint64_t m_step; //!< Input samples per output sample, times m_denominator.
+    uint64_t m_denominator;
+    size_t m_length;
+    size_t m_phaseCount;
+    bool m_interpolate;
+    std::vector<float> m_table; //!< m_length coefficients per phase, one extra phase when interpolating.
+};
+
+/**
+ * Resampling state of a stream: the samples still needed and the position of the next output.
+ */
+struct ResamplerStream
+{
+  std::vector<float> buffer;
+  uint64_t position; //!< Start of the next window in the buffer, times the denominator.
+};
+
+class Resampler : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    Resampler(uint16_t channelCount, uint64_t step, uint64_t denominator, uint32_t taps, double cutoff);
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Resample);
+    static NAN_METHOD(Process);
+    static NAN_METHOD(Flush);
+    static NAN_METHOD(Reset);
+
+    friend class ResamplerWorker;
+
+    void resetStreams();
+    uint64_t streamLength(size_t ch, size_t length) const;
+    void stream(size_t ch, const float* input, size_t length, float* output);
+
+    PolyphaseResampler m_resampler;
+    std::vector<ResamplerStream> m_streams;
+    std::atomic<bool> m_busy; //!< Set while a worker processes streams, chunks must be processed in order.
+};
+
+#endif
@@ -0,0 +1,511 @@
+/**
+ * \file scopeconfig.cc
+ * \brief Apply and read back a complete oscilloscope configuration in one call.
+ */
+
+#include "scopeconfig.h"
+#include "capabilitycache.h"
+#include <cmath>
+
+/**
+ * Expected type of a configuration property, integers are range checked before they are narrowed.
+ */
+enum ConfigType
+{
+  CONFIG_BOOL,
+  CONFIG_NUMBER,
+  CONFIG_UINT8,
+  CONFIG_UINT32,
+  CONFIG_UINT64,
+  CONFIG_NUMBERS, //!< Array of numbers.
+  CONFIG_TRIGGER,
+  CONFIG_CHANNELS
+};
+
+struct ConfigKey
+{
+  const char* name;
+  ConfigType type;
+};
+
+static const ConfigKey triggerKeys[] = {
+  {"enabled", CONFIG_BOOL},
+  {"kind", CONFIG_UINT64},
+  {"levelMode", CONFIG_UINT32},
+  {"levels", CONFIG_NUMBERS},
+  {"hysteresis", CONFIG_NUMBERS},
+  {"condition", CONFIG_UINT32},
+  {"times", CONFIG_NUMBERS}
+};
+
+static const ConfigKey channelKeys[] = {
+  {"enabled", CONFIG_BOOL},
+  {"coupling", CONFIG_UINT64},
+  {"probeGain", CONFIG_NUMBER},
+  {"probeOffset", CONFIG_NUMBER},
+  {"autoRanging", CONFIG_BOOL},
+  {"range", CONFIG_NUMBER},
+  {"bandwidth", CONFIG_NUMBER},
+  {"trigger", CONFIG_TRIGGER}
+};
+
+static const ConfigKey scopeKeys[] = {
+  {"measureMode", CONFIG_UINT32},
+  {"resolution", CONFIG_UINT8},
+  {"autoResolutionMode", CONFIG_UINT32},
+  {"clockSource", CONFIG_UINT32},
+  {"sampleFrequency", CONFIG_NUMBER},
+  {"recordLength", CONFIG_UINT64},
+  {"preSampleRatio", CONFIG_NUMBER},
+  {"segmentCount", CONFIG_UINT32},
+  {"triggerTimeOut", CONFIG_NUMBER},
+  {"triggerDelay", CONFIG_NUMBER},
+  {"triggerHoldOffCount", CONFIG_UINT64},
+  {"channels", CONFIG_CHANNELS}
+};
+
+#define COUNT_OF(a) (sizeof(a) / sizeof(a[0]))
+
+static bool succeeded()
+{
+  return LibGetLastStatus() >= LIBTIEPIESTATUS_SUCCESS;
+}
+
+static bool getProperty(v8::Local<v8::Object> object, const char* name, v8::Local<v8::Value>& value)
+{
+  value = Nan::Get(object, Nan::New<v8::String>(name).ToLocalChecked()).ToLocalChecked();
+  return !value->IsUndefined();
+}
+
+template<class T>
+static T fromValue(v8::Local<v8::Value> value)
+{
+  return (T)Nan::To<double>(value).FromJust();
+}
+
+template<>
+bool fromValue<bool>(v8::Local<v8::Value> value)
+{
+  return Nan::To<bool>(value).FromJust();
+}
+
+static v8::Local<v8::Value> toValue(bool value)
+{
+  return Nan::New<v8::Boolean>(value);
+}
+
+template<class T>
+static v8::Local<v8::Value> toValue(T value)
+{
+  return Nan::New<v8::Number>((double)value);
+}
+
+/**
+ * Set a property when present and different from the current value.
+ */
+template<class T, class Get, class Set>
+static bool apply(v8::Local<v8::Object> object, const char* name, const std::string& path, Get get, Set set, std::string& error)
+{
+  v8::Local<v8::Value> value;
+  if(!getProperty(object, name, value))
+    return true;
+
+  const T requested = fromValue<T>(value);
+  const T current = get();
+  if(succeeded() && current == requested)
+    return true;
+
+  set(requested);
+  if(succeeded())
+    return true;
+
+  error = path + name + ": " + LibGetLastStatusStr();
+  return false;
+}
+
+/**
+ * Set the elements of an indexed property, up to the number of elements the device currently supports.
+ */
+template<class Get, class Set>
+static bool applyIndexed(v8::Local<v8::Object> object, const char* name, const std::string& path, uint32_t count, Get get, Set set, std::string& error)
+{
+  v8::Local<v8::Value> value;
+  if(!getProperty(object, name, value))
+    return true;
+  if(!value->IsArray())
+  {
+    error = path + name + ": Array expected";
+    return false;
+  }
+
+  v8::Local<v8::Array> array = value.As<v8::Array>();
+  for(uint32_t i = 0; i < count && i < array->Length(); ++i)
+  {
+    const double requested = fromValue<double>(Nan::Get(array, i).ToLocalChecked());
+    const double current = get(i);
+    if(succeeded() && current == requested)
+      continue;
+
+    set(i, requested);
+    if(!succeeded())
+    {
+      std::stringstream ss;
+      ss << path << name << "[" << i << "]: " << LibGetLastStatusStr();
+      error = ss.str();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template<class T, class Get>
+static void read(v8::Local<v8::Object> object, const char* name, Get get)
+{
+  const T value = get();
+  if(succeeded())
+    Nan::Set(object, Nan::New<v8::String>(name).ToLocalChecked(), toValue(value));
+}
+
+template<class Get>
+static void readIndexed(v8::Local<v8::Object> object, const char* name, uint32_t count, Get get)
+{
+  v8::Local<v8::Array> array = Nan::New<v8::Array>(count);
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    const double value = get(i);
+    if(!succeeded())
+      return;
+    Nan::Set(array, i, Nan::New<v8::Number>(value));
+  }
+  Nan::Set(object, Nan::New<v8::String>(name).ToLocalChecked(), array);
+}
+
+static bool applyChannelTrigger(LibTiePieHandle_t h, uint16_t ch, v8::Local<v8::Object> trigger, const std::string& path, std::string& error)
+{
+  // The kind determines the number of levels, hysteresis values and times:
+  return
+    apply<uint64_t>(trigger, "kind", path, [=]() { return ScpChTrGetKind(h, ch); }, [=](uint64_t v) { ScpChTrSetKind(h, ch, v); }, error) &&
+    apply<uint32_t>(trigger, "levelMode", path, [=]() { return ScpChTrGetLevelMode(h, ch); }, [=](uint32_t v) { ScpChTrSetLevelMode(h, ch, v); }, error) &&
+    applyIndexed(trigger, "levels", path, ScpChTrGetLevelCount(h, ch), [=](uint32_t i) { return ScpChTrGetLevel(h, ch, i); }, [=](uint32_t i, double v) { ScpChTrSetLevel(h, ch, i, v); }, error) &&
+    applyIndexed(trigger, "hysteresis", path, ScpChTrGetHysteresisCount(h, ch), [=](uint32_t i) { return ScpChTrGetHysteresis(h, ch, i); }, [=](uint32_t i, double v) { ScpChTrSetHysteresis(h, ch, i, v); }, error) &&
+    apply<uint32_t>(trigger, "condition", path, [=]() { return ScpChTrGetCondition(h, ch); }, [=](uint32_t v) { ScpChTrSetCondition(h, ch, v); }, error) &&
+    applyIndexed(trigger, "times", path, ScpChTrGetTimeCount(h, ch), [=](uint32_t i) { return ScpChTrGetTime(h, ch, i); }, [=](uint32_t i, double v) { ScpChTrSetTime(h, ch, i, v); }, error) &&
+    apply<bool>(trigger, "enabled", path, [=]() { return ScpChTrGetEnabled(h, ch) != BOOL8_FALSE; }, [=](bool v) { ScpChTrSetEnabled(h, ch, v ? BOOL8_TRUE : BOOL8_FALSE); }, error);
+}
+
+static bool getChannels(v8::Local<v8::Object> config, uint16_t channelCount, std::vector<v8::Local<v8::Object> >& channels, std::string& error)
+{
+  v8::Local<v8::Value> value;
+  if(!getProperty(config, "channels", value))
+    return true;
+  if(!value->IsArray())
+  {
+    error = "channels: Array expected";
+    return false;
+  }
+
+  v8::Local<v8::Array> array = value.As<v8::Array>();
+  if(array->Length() > channelCount)
+  {
+    error = "channels: More channels than available";
+    return false;
+  }
+
+  channels.resize(array->Length());
+  for(uint32_t i = 0; i < array->Length(); ++i)
+  {
+    v8::Local<v8::Value> item = Nan::Get(array, i).ToLocalChecked();
+    if(item->IsObject())
+      channels[i] = item.As<v8::Object>();
+    else if(!item->IsNullOrUndefined())
+    {
+      error = "channels: Object expected";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static std::string channelPath(uint16_t ch, const char* suffix = "")
+{
+  std::stringstream ss;
+  ss << "channels[" << ch << "]." << suffix;
+  return ss.str();
+}
+
+static bool validateObject(v8::Local<v8::Object> object, const ConfigKey* keys, size_t keyCount, const std::string& path, std::string& error);
+
+static bool validateValue(v8::Local<v8::Value> value, ConfigType type, const std::string& name, std::string& error)
+{
+  switch(type)
+  {
+    case CONFIG_BOOL:
+      if(value->IsBoolean())
+        return true;
+      error = name + ": Boolean expected";
+      return false;
+
+    case CONFIG_NUMBERS:
+    {
+      if(!value->IsArray())
+      {
+        error = name + ": Array expected";
+        return false;
+      }
+      v8::Local<v8::Array> array = value.As<v8::Array>();
+      for(uint32_t i = 0; i < array->Length(); ++i)
+      {
+        std::stringstream ss;
+        ss << name << "[" << i << "]";
+        if(!validateValue(Nan::Get(array, i).ToLocalChecked(), CONFIG_NUMBER, ss.str(), error))
+          return false;
+      }
+      return true;
+    }
+
+    case CONFIG_TRIGGER:
+      if(!value->IsObject())
+      {
+        error = name + ": Object expected";
+        return false;
+      }
+      return validateObject(value.As<v8::Object>(), triggerKeys, COUNT_OF(triggerKeys), name + ".", error);
+
+    case CONFIG_CHANNELS:
+    {
+      if(!value->IsArray())
+      {
+        error = name + ": Array expected";
+        return false;
+      }
+      v8::Local<v8::Array> array = value.As<v8::Array>();
+      for(uint32_t i = 0; i < array->Length(); ++i)
+      {
+        v8::Local<v8::Value> item = Nan::Get(array, i).ToLocalChecked();
+        if(item->IsNullOrUndefined())
+          continue;
+        if(!item->IsObject())
+        {
+          error = name + ": Object expected";
+          return false;
+        }
+        std::stringstream ss;
+        ss << name << "[" << i << "].";
+        if(!validateObject(item.As<v8::Object>(), channelKeys, COUNT_OF(channelKeys), ss.str(), error))
+          return false;
+      }
+      return true;
+    }
+
+    default:
+      break;
+  }
+
+  if(!value->IsNumber())
+  {
+    error = name + ": Number expected";
+    return false;
+  }
+
+  const double number = Nan::To<double>(value).FromJust();
+  bool valid = std::isfinite(number);
+  if(valid && type != CONFIG_NUMBER)
+  {
+    // 2^64 is the first double above the uint64_t range:
+    const double max = type == CONFIG_UINT8 ? std::numeric_limits<uint8_t>::max() : type == CONFIG_UINT32 ? std::numeric_limits<uint32_t>::max() : 18446744073709551615.0;
+    valid = number == std::floor(number) && number >= 0 && (type == CONFIG_UINT64 ? number < max : number <= max);
+  }
+  if(!valid)
+  {
+    error = name + ": Value out of range";
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Check that \p object only has known properties of the expected types, before any of them is applied.
+ */
+static bool validateObject(v8::Local<v8::Object> object, const ConfigKey* keys, size_t keyCount, const std::string& path, std::string& error)
+{
+  v8::Local<v8::Array> names = Nan::GetOwnPropertyNames(object).ToLocalChecked();
+  for(uint32_t i = 0; i < names->Length(); ++i)
+  {
+    v8::Local<v8::Value> name = Nan::Get(names, i).ToLocalChecked();
+    const std::string key = *Nan::Utf8String(name);
+
+    const ConfigKey* found = 0;
+    for(size_t j = 0; j < keyCount && !found; ++j)
+      if(key == keys[j].name)
+        found = &keys[j];
+
+    if(!found)
+    {
+      error = path + key + ": Unknown setting";
+      return false;
+    }
+
+    v8::Local<v8::Value> value = Nan::Get(object, name).ToLocalChecked();
+    if(!value->IsUndefined() && !validateValue(value, found->type, path + key, error))
+      return false;
+  }
+
+  return true;
+}
+
+bool validateScopeConfig(v8::Local<v8::Object> config, std::string& error)
+{
+  return validateObject(config, scopeKeys, COUNT_OF(scopeKeys), "", error);
+}
+
+bool applyScopeConfig(LibTiePieHandle_t h, v8::Local<v8::Object> config, std::string& error)
+{
+  const uint16_t channelCount = ScpGetChannelCount(h);
+  if(!succeeded())
+  {
+    error = LibGetLastStatusStr();
+    return false;
+  }
+
+  std::vector<v8::Local<v8::Object> > channels;
+  if(!getChannels(config, channelCount, channels, error))
+    return false;
+
+  // Measure mode, resolution and clock limit the channel ranges, sample frequency and record length:
+  if(!apply<uint32_t>(config, "measureMode", "", [=]() { return ScpGetMeasureMode(h); }, [=](uint32_t v) { ScpSetMeasureMode(h, v); }, error) ||
+     !apply<uint32_t>(config, "autoResolutionMode", "", [=]() { return ScpGetAutoResolutionMode(h); }, [=](uint32_t v) { ScpSetAutoResolutionMode(h, v); }, error) ||
+     !apply<uint8_t>(config, "resolution", "", [=]() { return ScpGetResolution(h); }, [=](uint8_t v) { ScpSetResolution(h, v); }, error) ||
+     !apply<uint32_t>(config, "clockSource", "", [=]() { return ScpGetClockSource(h); }, [=](uint32_t v) { ScpSetClockSource(h, v); }, error))
+    return false;
+
+  // Coupling and probe settings determine the available ranges:
+  for(uint16_t ch = 0; ch < channels.size(); ++ch)
+  {
+    if(channels[ch].IsEmpty())
+      continue;
+
+    const v8::Local<v8::Object> channel = channels[ch];
+    const std::string path = channelPath(ch);
+    if(!apply<uint64_t>(channel, "coupling", path, [=]() { return ScpChGetCoupling(h, ch); }, [=](uint64_t v) { ScpChSetCoupling(h, ch, v); }, error) ||
+       !apply<double>(channel, "probeGain", path, [=]() { return ScpChGetProbeGain(h, ch); }, [=](double v) { ScpChSetProbeGain(h, ch, v); }, error) ||
+       !apply<double>(channel, "probeOffset", path, [=]() { return ScpChGetProbeOffset(h, ch); }, [=](double v) { ScpChSetProbeOffset(h, ch, v); }, error) ||
+       !apply<bool>(channel, "enabled", path, [=]() { return ScpChGetEnabled(h, ch) != BOOL8_FALSE; }, [=](bool v) { ScpChSetEnabled(h, ch, v ? BOOL8_TRUE : BOOL8_FALSE); }, error) ||
+       !apply<bool>(channel, "autoRanging", path, [=]() { return ScpChGetAutoRanging(h, ch) != BOOL8_FALSE; }, [=](bool v) { ScpChSetAutoRanging(h, ch, v ? BOOL8_TRUE : BOOL8_FALSE); }, error) ||
+       !apply<double>(channel, "range", path, [=]() { return ScpChGetRange(h, ch); }, [=](double v) { ScpChSetRange(h, ch, v); }, error) ||
+       !apply<double>(channel, "bandwidth", path, [=]() { return ScpChGetBandwidth(h, ch); }, [=](double v) { ScpChSetBandwidth(h, ch, v); }, error))
+      return false;
+  }
+
+  // The record length depends on the sample frequency, the trigger times on both:
+  if(!apply<double>(config, "sampleFrequency", "", [=]() { return ScpGetSampleFrequency(h); }, [=](double v) { ScpSetSampleFrequency(h, v); }, error) ||
+     !apply<uint64_t>(config, "recordLength", "", [=]() { return ScpGetRecordLength(h); }, [=](uint64_t v) { ScpSetRecordLength(h, v); }, error) ||
+     !apply<double>(config, "preSampleRatio", "", [=]() { return ScpGetPreSampleRatio(h); }, [=](double v) { ScpSetPreSampleRatio(h, v); }, error) ||
+     !apply<uint32_t>(config, "segmentCount", "", [=]() { return ScpGetSegmentCount(h); }, [=](uint32_t v) { ScpSetSegmentCount(h, v); }, error))
+    return false;
+
+  for(uint16_t ch = 0; ch < channels.size(); ++ch)
+  {
+    v8::Local<v8::Value> trigger;
+    if(channels[ch].IsEmpty() || !getProperty(channels[ch], "trigger", trigger))
+      continue;
+    if(!trigger->IsObject())
+    {
+      error = channelPath(ch, "trigger: Object expected");
+      return false;
+    }
+    if(!applyChannelTrigger(h, ch, trigger.As<v8::Object>(), channelPath(ch, "trigger."), error))
+      return false;
+  }
+
+  return
+    apply<double>(config, "triggerTimeOut", "", [=]() { return ScpGetTriggerTimeOut(h); }, [=](double v) { ScpSetTriggerTimeOut(h, v); }, error) &&
+    apply<double>(config, "triggerDelay", "", [=]() { return ScpGetTriggerDelay(h); }, [=](double v) { ScpSetTriggerDelay(h, v); }, error) &&
+    apply<uint64_t>(config, "triggerHoldOffCount", "", [=]() { return ScpGetTriggerHoldOffCount(h); }, [=](uint64_t v) { ScpSetTriggerHoldOffCount(h, v); }, error);
+}
+
+v8::Local<v8::Object> readScopeConfig(LibTiePieHandle_t h)
+{
+  v8::Local<v8::Object> config = Nan::New<v8::Object>();
+
+  read<uint32_t>(config, "measureMode", [=]() { return ScpGetMeasureMode(h); });
+  read<uint32_t>(config, "autoResolutionMode", [=]() { return ScpGetAutoResolutionMode(h); });
+  read<uint8_t>(config, "resolution", [=]() { return ScpGetResolution(h); });
+  read<uint32_t>(config, "clockSource", [=]() { return ScpGetClockSource(h); });
+  read<double>(config, "sampleFrequency", [=]() { return ScpGetSampleFrequency(h); });
+  read<uint64_t>(config, "recordLength", [=]() { return ScpGetRecordLength(h); });
+  read<double>(config, "preSampleRatio", [=]() { return ScpGetPreSampleRatio(h); });
+  read<uint32_t>(config, "segmentCount", [=]() { return ScpGetSegmentCount(h); });
+  read<double>(config, "triggerTimeOut", [=]() { return ScpGetTriggerTimeOut(h); });
+  if(ScpHasTriggerDelay(h) != BOOL8_FALSE)
+    read<double>(config, "triggerDelay", [=]() { return ScpGetTriggerDelay(h); });
+  if(ScpHasTriggerHoldOff(h) != BOOL8_FALSE)
+    read<uint64_t>(config, "triggerHoldOffCount", [=]() { return ScpGetTriggerHoldOffCount(h); });
+
+  const uint16_t channelCount = ScpGetChannelCount(h);
+  v8::Local<v8::Array> channels = Nan::New<v8::Array>(channelCount);
+  for(uint16_t ch = 0; ch < channelCount; ++ch)
+  {
+    v8::Local<v8::Object> channel = Nan::New<v8::Object>();
+    read<bool>(channel, "enabled", [=]() { return ScpChGetEnabled(h, ch) != BOOL8_FALSE; });
+    read<uint64_t>(channel, "coupling", [=]() { return ScpChGetCoupling(h, ch); });
+    read<double>(channel, "probeGain", [=]() { return ScpChGetProbeGain(h, ch); });
+    read<double>(channel, "probeOffset", [=]() { return ScpChGetProbeOffset(h, ch); });
+    read<bool>(channel, "autoRanging", [=]() { return ScpChGetAutoRanging(h, ch) != BOOL8_FALSE; });
+    read<double>(channel, "range", [=]() { return ScpChGetRange(h, ch); });
+    if(ScpChGetBandwidths(h, ch, 0, 0) > 0)
+      read<double>(channel, "bandwidth", [=]() { return ScpChGetBandwidth(h, ch); });
+
+    if(ScpChHasTrigger(h, ch) != BOOL8_FALSE)
+    {
+      v8::Local<v8::Object> trigger = Nan::New<v8::Object>();
+      read<bool>(trigger, "enabled", [=]() { return ScpChTrGetEnabled(h, ch) != BOOL8_FALSE; });
+      read<uint64_t>(trigger, "kind", [=]() { return ScpChTrGetKind(h, ch); });
+      read<uint32_t>(trigger, "levelMode", [=]() { return ScpChTrGetLevelMode(h, ch); });
+      readIndexed(trigger, "levels", ScpChTrGetLevelCount(h, ch), [=](uint32_t i) { return ScpChTrGetLevel(h, ch, i); });
+      readIndexed(trigger, "hysteresis", ScpChTrGetHysteresisCount(h, ch), [=](uint32_t i) { return ScpChTrGetHysteresis(h, ch, i); });
+      if(ScpChTrGetConditions(h, ch) != 0)
+        read<uint32_t>(trigger, "condition", [=]() { return ScpChTrGetCondition(h, ch); });
+      readIndexed(trigger, "times", ScpChTrGetTimeCount(h, ch), [=](uint32_t i) { return ScpChTrGetTime(h, ch, i); });
+      Nan::Set(channel, Nan::New<v8::String>("trigger").ToLocalChecked(), trigger);
+    }
+
+    Nan::Set(channels, ch, channel);
+  }
+  Nan::Set(config, Nan::New<v8::String>("channels").ToLocalChecked(), channels);
+
+  return config;
+}
+
+NAN_METHOD(ScpApplyConfigWrapper)
+{
+  CHECK_PARAMETER_COUNT(2);
+  const LibTiePieHandle_t handle = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
+  if(!info[1]->IsObject())
+    return Nan::ThrowTypeError("Invalid config");
+
+  std::string error;
+  if(!validateScopeConfig(info[1].As<v8::Object>(), error))
+    return Nan::ThrowTypeError(error.c_str());
+
+  // Invalidated after applying, also when it failed halfway, so capabilities read meanwhile aren't kept:
+  const bool applied = applyScopeConfig(handle, info[1].As<v8::Object>(), error);
+  CapabilityCache::invalidate(handle);
+  if(!applied)
+    return Nan::ThrowError(error.c_str());
+
+  info.GetReturnValue().Set(readScopeConfig(handle));
+}
+
+NAN_METHOD(ScpReadConfigWrapper)
+{
+  CHECK_PARAMETER_COUNT(1);
+  const LibTiePieHandle_t handle = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
+
+  ScpGetChannelCount(handle);
+  CHECK_LAST_STATUS();
+
+  info.GetReturnValue().Set(readScopeConfig(handle));
+}
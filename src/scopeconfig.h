@@ -0,0 +1,43 @@
+/**
+ * \file scopeconfig.h
+ * \brief Apply and read back a complete oscilloscope configuration in one call.
+ *
+ * A configuration is a plain object, all properties are optional when applying:
+ *
+ *     {
+ *       measureMode, resolution, autoResolutionMode, clockSource, sampleFrequency, recordLength,
+ *       preSampleRatio, segmentCount, triggerTimeOut, triggerDelay, triggerHoldOffCount,
+ *       channels: [{
+ *         enabled, coupling, probeGain, probeOffset, autoRanging, range, bandwidth,
+ *         trigger: {enabled, kind, levelMode, levels: [], hysteresis: [], condition, times: []}
+ *       }]
+ *     }
+ */
+
+#ifndef _SCOPECONFIG_H_
+#define _SCOPECONFIG_H_
+
+#include "common.h"
+
+/**
+ * Check that \p config only has known settings, numbers where numbers are expected and integers in the range of the
+ * setting they are narrowed to, without accessing a device.
+ * \return \c false on failure, \p error names the setting that is invalid.
+ */
+bool validateScopeConfig(v8::Local<v8::Object> config, std::string& error);
+
+/**
+ * Apply the settings present in \p config in dependency order, settings that already have the requested value are skipped.
+ * \return \c false on failure, \p error names the setting that failed.
+ */
+bool applyScopeConfig(LibTiePieHandle_t device, v8::Local<v8::Object> config, std::string& error);
+
+/**
+ * Read the current configuration, settings the device does not support are left out.
+ */
+v8::Local<v8::Object> readScopeConfig(LibTiePieHandle_t device);
+
+NAN_METHOD(ScpApplyConfigWrapper);
+NAN_METHOD(ScpReadConfigWrapper);
+
+#endif
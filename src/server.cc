@@ -0,0 +1,88 @@
+/**
+ * \file server.cc
+ * \brief Object oriented server interface.
+ */
+
+#include "server.h"
+#include "capabilitycache.h"
+
+#define SERVER_STRING_GETTER(name, function) \
+  static NAN_METHOD(name) \
+  { \
+    OBJECT_HANDLE(Server); \
+    v8::Local<v8::String> result; \
+    if(!GetString([&](char* buffer, uint32_t length) { return function(handle, buffer, length); }, result)) \
+      CHECK_LAST_STATUS(); \
+    info.GetReturnValue().Set(result); \
+  }
+
+#define SERVER_INTERNED_STRING_GETTER(name, key, function) \
+  static NAN_METHOD(name) \
+  { \
+    OBJECT_HANDLE(Server); \
+    v8::Local<v8::String> result; \
+    if(!CapabilityCache::getString(handle, key, [&](char* buffer, uint32_t length) { return function(handle, buffer, length); }, result)) \
+      CHECK_LAST_STATUS(); \
+    info.GetReturnValue().Set(result); \
+  }
+
+SERVER_INTERNED_STRING_GETTER(GetURL, CAPABILITYCACHE_STRING_URL, SrvGetURL)
+SERVER_INTERNED_STRING_GETTER(GetID, CAPABILITYCACHE_STRING_ID, SrvGetID)
+SERVER_STRING_GETTER(GetName, SrvGetName)
+SERVER_STRING_GETTER(GetDescription, SrvGetDescription)
+SERVER_STRING_GETTER(GetVersionExtra, SrvGetVersionExtra)
+OBJECT_GETTER(Server, GetIPv4Address, uint32_t, SrvGetIPv4Address(handle))
+OBJECT_GETTER(Server, GetIPPort, uint32_t, SrvGetIPPort(handle))
+OBJECT_GETTER(Server, GetVersion, v8::Local<v8::String>, Nan::New(tpVersionToStr(SrvGetVersion(handle))).ToLocalChecked())
+OBJECT_GETTER(Server, GetStatus, uint32_t, SrvGetStatus(handle))
+OBJECT_GETTER(Server, GetLastError, uint32_t, SrvGetLastError(handle))
+
+#define SERVER_BOOL_METHOD(name, function) \
+  static NAN_METHOD(name) \
+  { \
+    OBJECT_HANDLE(Server); \
+    const bool value = info.Length() > 0 && Nan::To<bool>(info[0]).FromJust(); \
+    const bool8_t result = function(handle, value ? BOOL8_TRUE : BOOL8_FALSE); \
+    CHECK_LAST_STATUS(); \
+    info.GetReturnValue().Set(result != BOOL8_FALSE); \
+  }
+
+SERVER_BOOL_METHOD(Connect, SrvConnect)
+SERVER_BOOL_METHOD(Disconnect, SrvDisconnect)
+SERVER_BOOL_METHOD(Remove, SrvRemove)
+
+NAN_MODULE_INIT(Server::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("Server").ToLocalChecked());
+  LibTiePieObject::initPrototype(tpl);
+
+  Nan::SetPrototypeMethod(tpl, "connect", Connect);
+  Nan::SetPrototypeMethod(tpl, "disconnect", Disconnect);
+  Nan::SetPrototypeMethod(tpl, "remove", Remove);
+
+  setAccessor(tpl, "url", GetURL);
+  setAccessor(tpl, "id", GetID);
+  setAccessor(tpl, "ipv4Address", GetIPv4Address);
+  setAccessor(tpl, "ipPort", GetIPPort);
+  setAccessor(tpl, "name", GetName);
+  setAccessor(tpl, "description", GetDescription);
+  setAccessor(tpl, "version", GetVersion);
+  setAccessor(tpl, "versionExtra", GetVersionExtra);
+  setAccessor(tpl, "status", GetStatus);
+  setAccessor(tpl, "lastError", GetLastError);
+
+  Nan::Set(target, Nan::New<v8::String>("Server").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+NAN_METHOD(Server::New)
+{
+  LibTiePieHandle_t handle;
+  if(!getHandle(info, LIBTIEPIE_INTERFACE_SERVER, handle))
+    return;
+
+  Server* obj = new Server(handle);
+  obj->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
@@ -0,0 +1,27 @@
+/**
+ * \file server.h
+ * \brief Object oriented server interface.
+ *
+ * Server objects are created from handles returned by NetSrvAdd(), NetSrvGetByIndex(), NetSrvGetByURL() and LstDevGetServer().
+ */
+
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include "object.h"
+
+class Server : public LibTiePieObject
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    explicit Server(LibTiePieHandle_t handle) :
+      LibTiePieObject(handle)
+    {
+    }
+
+    static NAN_METHOD(New);
+};
+
+#endif
@@ -0,0 +1,330 @@
+/**
+ * \file simd.h
+ * \brief SIMD helpers, with scalar fallbacks when SSE2 is not available.
+ */
+
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+#include <cstddef>
+#include <stdint.h>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define USE_SSE2
+  #include <emmintrin.h>
+#endif
+
+/**
+ * Find the first sample in <tt>[begin, end)</tt> that is below \p low or at or above \p high.
+ * \return The index of the sample, or \p end if all samples are inside the band.
+ */
+inline size_t findFirstOutside(const float* data, size_t begin, size_t end, float low, float high)
+{
+  size_t i = begin;
+
+#ifdef USE_SSE2
+  const __m128 vlow = _mm_set1_ps(low);
+  const __m128 vhigh = _mm_set1_ps(high);
+  for(; i + 16 <= end; i += 16)
+  {
+    const __m128 a = _mm_loadu_ps(data + i);
+    const __m128 b = _mm_loadu_ps(data + i + 4);
+    const __m128 c = _mm_loadu_ps(data + i + 8);
+    const __m128 d = _mm_loadu_ps(data + i + 12);
+    const __m128 outside = _mm_or_ps(
+      _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(a, vlow), _mm_cmpge_ps(a, vhigh)), _mm_or_ps(_mm_cmplt_ps(b, vlow), _mm_cmpge_ps(b, vhigh))),
+      _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(c, vlow), _mm_cmpge_ps(c, vhigh)), _mm_or_ps(_mm_cmplt_ps(d, vlow), _mm_cmpge_ps(d, vhigh))));
+    if(_mm_movemask_ps(outside) != 0)
+      break;
+  }
+#endif
+
+  for(; i < end; ++i)
+    if(data[i] < low || data[i] >= high)
+      return i;
+
+  return end;
+}
+
+/**
+ * Find the first sample in <tt>[begin, end)</tt> that is below its limit in \p lower or above its limit in \p upper.
+ * \return The index of the sample, or \p end if all samples are inside their limits.
+ */
+inline size_t findFirstOutsideLimits(const float* data, const float* lower, const float* upper, size_t begin, size_t end)
+{
+  size_t i = begin;
+
+#ifdef USE_SSE2
+  for(; i + 8 <= end; i += 8)
+  {
+    const __m128 a = _mm_loadu_ps(data + i);
+    const __m128 b = _mm_loadu_ps(data + i + 4);
+    const __m128 outside = _mm_or_ps(
+      _mm_or_ps(_mm_cmplt_ps(a, _mm_loadu_ps(lower + i)), _mm_cmpgt_ps(a, _mm_loadu_ps(upper + i))),
+      _mm_or_ps(_mm_cmplt_ps(b, _mm_loadu_ps(lower + i + 4)), _mm_cmpgt_ps(b, _mm_loadu_ps(upper + i + 4))));
+    if(_mm_movemask_ps(outside) != 0)
+      break;
+  }
+#endif
+
+  for(; i < end; ++i)
+    if(data[i] < lower[i] || data[i] > upper[i])
+      return i;
+
+  return end;
+}
+
+/**
+ * Add \p length samples of \p data to the sums in \p sum.
+ */
+inline void accumulate(double* sum, const float* data, size_t length)
+{
+  size_t i = 0;
+
+#ifdef USE_SSE2
+  for(; i + 4 <= length; i += 4)
+  {
+    const __m128 a = _mm_loadu_ps(data + i);
+    _mm_storeu_pd(sum + i, _mm_add_pd(_mm_loadu_pd(sum + i), _mm_cvtps_pd(a)));
+    _mm_storeu_pd(sum + i + 2, _mm_add_pd(_mm_loadu_pd(sum + i + 2), _mm_cvtps_pd(_mm_movehl_ps(a, a))));
+  }
+#endif
+
+  for(; i < length; ++i)
+    sum[i] += data[i];
+}
+
+/**
+ * Move the averages in \p average towards \p data by \p weight: average += weight * (data - average).
+ */
+inline void accumulateExponential(double* average, const float* data, size_t length, double weight)
+{
+  size_t i = 0;
+
+#ifdef USE_SSE2
+  const __m128d vweight = _mm_set1_pd(weight);
+  for(; i + 4 <= length; i += 4)
+  {
+    const __m128 a = _mm_loadu_ps(data + i);
+    const __m128d lo = _mm_loadu_pd(average + i);
+    const __m128d hi = _mm_loadu_pd(average + i + 2);
+    _mm_storeu_pd(average + i, _mm_add_pd(lo, _mm_mul_pd(vweight, _mm_sub_pd(_mm_cvtps_pd(a), lo))));
+    _mm_storeu_pd(average + i + 2, _mm_add_pd(hi, _mm_mul_pd(vweight, _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(a, a)), hi))));
+  }
+#endif
+
+  for(; i < length; ++i)
+    average[i] += weight * (data[i] - average[i]);
+}
+
+/**
+ * Convert raw samples to values: output = raw * gain + offset.
+ */
+template<class T, class U>
+inline void scaleRaw(const T* raw, U* output, size_t length, double gain, double offset)
+{
+  for(size_t i = 0; i < length; ++i)
+    output[i] = (U)(raw[i] * gain + offset);
+}
+
+#ifdef USE_SSE2
+inline void scaleRawEpi32(__m128i a, float* output, __m128 gain, __m128 offset)
+{
+  _mm_storeu_ps(output, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(a), gain), offset));
+}
+
+template<>
+inline void scaleRaw<int16_t, float>(const int16_t* raw, float* output, size_t length, double gain, double offset)
+{
+  const __m128 vgain = _mm_set1_ps((float)gain);
+  const __m128 voffset = _mm_set1_ps((float)offset);
+  size_t i = 0;
+  for(; i + 8 <= length; i += 8)
+  {
+    const __m128i a = _mm_loadu_si128((const __m128i*)(raw + i));
+    scaleRawEpi32(_mm_srai_epi32(_mm_unpacklo_epi16(a, a), 16), output + i, vgain, voffset);
+    scaleRawEpi32(_mm_srai_epi32(_mm_unpackhi_epi16(a, a), 16), output + i + 4, vgain, voffset);
+  }
+  for(; i < length; ++i)
+    output[i] = (float)(raw[i] * gain + offset);
+}
+
+template<>
+inline void scaleRaw<uint16_t, float>(const uint16_t* raw, float* output, size_t length, double gain, double offset)
+{
+  const __m128 vgain = _mm_set1_ps((float)gain);
+  const __m128 voffset = _mm_set1_ps((float)offset);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for(; i + 8 <= length; i += 8)
+  {
+    const __m128i a = _mm_loadu_si128((const __m128i*)(raw + i));
+    scaleRawEpi32(_mm_unpacklo_epi16(a, zero), output + i, vgain, voffset);
+    scaleRawEpi32(_mm_unpackhi_epi16(a, zero), output + i + 4, vgain, voffset);
+  }
+  for(; i < length; ++i)
+    output[i] = (float)(raw[i] * gain + offset);
+}
+
+template<>
+inline void scaleRaw<int8_t, float>(const int8_t* raw, float* output, size_t length, double gain, double offset)
+{
+  const __m128 vgain = _mm_set1_ps((float)gain);
+  const __m128 voffset = _mm_set1_ps((float)offset);
+  size_t i = 0;
+  for(; i + 16 <= length; i += 16)
+  {
+    const __m128i a = _mm_loadu_si128((const __m128i*)(raw + i));
+    const __m128i lo = _mm_unpacklo_epi8(a, a);
+    const __m128i hi = _mm_unpackhi_epi8(a, a);
+    scaleRawEpi32(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 24), output + i, vgain, voffset);
+    scaleRawEpi32(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 24), output + i + 4, vgain, voffset);
+    scaleRawEpi32(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 24), output + i + 8, vgain, voffset);
+    scaleRawEpi32(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 24), output + i + 12, vgain, voffset);
+  }
+  for(; i < length; ++i)
+    output[i] = (float)(raw[i] * gain + offset);
+}
+
+template<>
+inline void scaleRaw<uint8_t, float>(const uint8_t* raw, float* output, size_t length, double gain, double offset)
+{
+  const __m128 vgain = _mm_set1_ps((float)gain);
+  const __m128 voffset = _mm_set1_ps((float)offset);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for(; i + 16 <= length; i += 16)
+  {
+    const __m128i a = _mm_loadu_si128((const __m128i*)(raw + i));
+    const __m128i lo = _mm_unpacklo_epi8(a, zero);
+    const __m128i hi = _mm_unpackhi_epi8(a, zero);
+    scaleRawEpi32(_mm_unpacklo_epi16(lo, zero), output + i, vgain, voffset);
+    scaleRawEpi32(_mm_unpackhi_epi16(lo, zero), output + i + 4, vgain, voffset);
+    scaleRawEpi32(_mm_unpacklo_epi16(hi, zero), output + i + 8, vgain, voffset);
+    scaleRawEpi32(_mm_unpackhi_epi16(hi, zero), output + i + 12, vgain, voffset);
+  }
+  for(; i < length; ++i)
+    output[i] = (float)(raw[i] * gain + offset);
+}
+#endif
+
+/**
+ * Find the minimum and maximum of \p length samples, \p length must be at least 1.
+ */
+template<class T>
+inline void minMax(const T* data, size_t length, T& min, T& max)
+{
+  T lo = data[0];
+  T hi = data[0];
+  for(size_t i = 1; i < length; ++i)
+  {
+    if(data[i] < lo)
+      lo = data[i];
+    if(data[i] > hi)
+      hi = data[i];
+  }
+  min = lo;
+  max = hi;
+}
+
+#ifdef USE_SSE2
+template<>
+inline void minMax<int16_t>(const int16_t* data, size_t length, int16_t& min, int16_t& max)
+{
+  size_t i = 0;
+  int16_t lo = data[0];
+  int16_t hi = data[0];
+  if(length >= 8)
+  {
+    __m128i vlo = _mm_loadu_si128((const __m128i*)data);
+    __m128i vhi = vlo;
+    for(i = 8; i + 8 <= length; i += 8)
+    {
+      const __m128i a = _mm_loadu_si128((const __m128i*)(data + i));
+      vlo = _mm_min_epi16(vlo, a);
+      vhi = _mm_max_epi16(vhi, a);
+    }
+    int16_t l[8];
+    int16_t h[8];
+    _mm_storeu_si128((__m128i*)l, vlo);
+    _mm_storeu_si128((__m128i*)h, vhi);
+    for(int j = 0; j < 8; ++j)
+    {
+      lo = std::min(lo, l[j]);
+      hi = std::max(hi, h[j]);
+    }
+  }
+  for(; i < length; ++i)
+  {
+    lo = std::min(lo, data[i]);
+    hi = std::max(hi, data[i]);
+  }
+  min = lo;
+  max = hi;
+}
+
+template<>
+inline void minMax<float>(const float* data, size_t length, float& min, float& max)
+{
+  size_t i = 0;
+  float lo = data[0];
+  float hi = data[0];
+  if(length >= 4)
+  {
+    __m128 vlo = _mm_loadu_ps(data);
+    __m128 vhi = vlo;
+    for(i = 4; i + 4 <= length; i += 4)
+    {
+      const __m128 a = _mm_loadu_ps(data + i);
+      vlo = _mm_min_ps(vlo, a);
+      vhi = _mm_max_ps(vhi, a);
+    }
+    float l[4];
+    float h[4];
+    _mm_storeu_ps(l, vlo);
+    _mm_storeu_ps(h, vhi);
+    for(int j = 0; j < 4; ++j)
+    {
+      lo = std::min(lo, l[j]);
+      hi = std::max(hi, h[j]);
+    }
+  }
+  for(; i < length; ++i)
+  {
+    lo = std::min(lo, data[i]);
+    hi = std::max(hi, data[i]);
+  }
+  min = lo;
+  max = hi;
+}
+#endif
+
+/**
+ * Sum of the products of \p length elements of \p a and \p b.
+ */
+inline float dotProduct(const float* a, const float* b, size_t length)
+{
+  size_t i = 0;
+  float sum = 0;
+
+#ifdef USE_SSE2
+  __m128 sum0 = _mm_setzero_ps();
+  __m128 sum1 = _mm_setzero_ps();
+  for(; i + 8 <= length; i += 8)
+  {
+    sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  float sums[4];
+  _mm_storeu_ps(sums, _mm_add_ps(sum0, sum1));
+  sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#endif
+
+  for(; i < length; ++i)
+    sum += a[i] * b[i];
+
+  return sum;
+}
+
+#endif
@@ -0,0 +1,233 @@
+/**
+ * \file spectrum.cc
+ * \brief Averaged amplitude spectrum of captured records.
+ */
+
+#include "spectrum.h"
+#include <cmath>
+
+#ifndef M_PI
+  #define M_PI 3.14159265358979323846
+#endif
+
+class SpectrumWorker : public Nan::AsyncWorker
+{
+  public:
+    SpectrumWorker(Nan::Callback* callback, Spectrum* spectrum, v8::Local<v8::Object> self, v8::Local<v8::Value> data) :
+      Nan::AsyncWorker(callback),
+      m_spectrum(spectrum),
+      m_count(0)
+    {
+      SaveToPersistent("self", self);
+      SaveToPersistent("data", data);
+      m_data.assign(data);
+    }
+
+    void Execute()
+    {
+      m_count = m_spectrum->process(m_data.data(), m_data.length());
+    }
+
+    void HandleOKCallback()
+    {
+      Nan::HandleScope scope;
+      v8::Local<v8::Value> argv[] = {Nan::Null(), Nan::New<v8::Uint32>(m_count)};
+      callback->Call(2, argv, async_resource);
+    }
+
+  private:
+    Spectrum* m_spectrum;
+    FloatArrayArgument m_data;
+    uint32_t m_count;
+};
+
+static void createWindow(uint32_t window, std::vector<double>& w)
+{
+  // Cosine sum coefficients, periodic windows:
+  static const double hann[] = {0.5, 0.5};
+  static const double blackmanHarris[] = {0.35875, 0.48829, 0.14128, 0.01168};
+  static const double flatTop[] = {0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368};
+
+  const double* a;
+  size_t count;
+  switch(window)
+  {
+    case SPECTRUM_WINDOW_HANN:
+      a = hann;
+      count = sizeof(hann) / sizeof(hann[0]);
+      break;
+    case SPECTRUM_WINDOW_BLACKMAN_HARRIS:
+      a = blackmanHarris;
+      count = sizeof(blackmanHarris) / sizeof(blackmanHarris[0]);
+      break;
+    case SPECTRUM_WINDOW_FLAT_TOP:
+      a = flatTop;
+      count = sizeof(flatTop) / sizeof(flatTop[0]);
+      break;
+    default:
+      w.assign(w.size(), 1.0);
+      return;
+  }
+
+  const size_t length = w.size();
+  for(size_t n = 0; n < length; ++n)
+  {
+    const double x = 2 * M_PI * (double)n / (double)length;
+    double value = a[0];
+    for(size_t i = 1; i < count; ++i)
+      value += ((i % 2) ? -a[i] : a[i]) * cos(i * x);
+    w[n] = value;
+  }
+}
+
+NAN_MODULE_INIT(Spectrum::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("Spectrum").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "process", Process);
+  Nan::SetPrototypeMethod(tpl, "getMagnitude", GetMagnitude);
+  Nan::SetPrototypeMethod(tpl, "getMagnitudeDb", GetMagnitudeDb);
+  Nan::SetPrototypeMethod(tpl, "getAverageCount", GetAverageCount);
+  Nan::SetPrototypeMethod(tpl, "reset", Reset);
+
+  v8::Local<v8::Function> constructor = Nan::GetFunction(tpl).ToLocalChecked();
+  Nan::DefineOwnProperty(constructor, Nan::New<v8::String>("WINDOW_RECTANGULAR").ToLocalChecked(), Nan::New<v8::Uint32>(SPECTRUM_WINDOW_RECTANGULAR), v8::ReadOnly);
+  Nan::DefineOwnProperty(constructor, Nan::New<v8::String>("WINDOW_HANN").ToLocalChecked(), Nan::New<v8::Uint32>(SPECTRUM_WINDOW_HANN), v8::ReadOnly);
+  Nan::DefineOwnProperty(constructor, Nan::New<v8::String>("WINDOW_BLACKMAN_HARRIS").ToLocalChecked(), Nan::New<v8::Uint32>(SPECTRUM_WINDOW_BLACKMAN_HARRIS), v8::ReadOnly);
+  Nan::DefineOwnProperty(constructor, Nan::New<v8::String>("WINDOW_FLAT_TOP").ToLocalChecked(), Nan::New<v8::Uint32>(SPECTRUM_WINDOW_FLAT_TOP), v8::ReadOnly);
+
+  Nan::Set(target, Nan::New<v8::String>("Spectrum").ToLocalChecked(), constructor);
+}
+
+Spectrum::Spectrum(size_t length, uint32_t window) :
+  m_plan(RealFFTPlan::get(length)),
+  m_window(length),
+  m_scale(0),
+  m_power(length / 2 + 1, 0.0),
+  m_count(0)
+{
+  createWindow(window, m_window);
+
+  // Amplitude correction, sum of the window equals the coherent gain times length:
+  double sum = 0;
+  for(size_t n = 0; n < length; ++n)
+    sum += m_window[n];
+  m_scale = 1.0 / sum;
+}
+
+uint32_t Spectrum::process(const float* data, size_t length)
+{
+  const size_t n = m_plan->length();
+  std::vector<float> padded;
+  if(length < n)
+  {
+    padded.assign(n, 0.0f);
+    std::copy(data, data + length, padded.begin());
+    data = &padded[0];
+  }
+
+  std::vector<Complex> bins(m_plan->binCount());
+  std::vector<Complex> work(m_plan->workSize());
+  m_plan->forward(data, &m_window[0], &bins[0], &work[0]);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for(size_t k = 0; k < bins.size(); ++k)
+    m_power[k] += std::norm(bins[k]);
+  return ++m_count;
+}
+
+void Spectrum::getMagnitude(double* magnitude, bool db)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const size_t n = m_plan->length();
+  const size_t count = m_power.size();
+  const double average = m_count ? 1.0 / m_count : 0.0;
+
+  for(size_t k = 0; k < count; ++k)
+  {
+    // Single sided, all bins except DC and Nyquist carry half the energy:
+    const double scale = (k == 0 || 2 * k == n) ? m_scale : 2 * m_scale;
+    const double power = m_power[k] * average * scale * scale;
+    magnitude[k] = db ? 10 * log10(power) : sqrt(power);
+  }
+}
+
+NAN_METHOD(Spectrum::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowTypeError("Spectrum must be called with new");
+
+  CHECK_PARAMETER_COUNT(2);
+  const uint32_t length = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(length, 2, std::numeric_limits<uint32_t>::max());
+  const uint32_t window = Nan::To<uint32_t>(info[1]).FromJust();
+  CHECK_RANGE(window, SPECTRUM_WINDOW_RECTANGULAR, SPECTRUM_WINDOW_FLAT_TOP);
+
+  Spectrum* spectrum = new Spectrum(length, window);
+  spectrum->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(Spectrum::Process)
+{
+  CHECK_PARAMETER_COUNT(2);
+  if(!info[0]->IsArray() && !info[0]->IsTypedArray())
+    return Nan::ThrowTypeError("Invalid data, expected an array");
+  if(!info[1]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+
+  Spectrum* spectrum = Nan::ObjectWrap::Unwrap<Spectrum>(info.Holder());
+  Nan::Callback* callback = new Nan::Callback(info[1].As<v8::Function>());
+
+  Nan::AsyncQueueWorker(new SpectrumWorker(callback, spectrum, info.Holder(), info[0]));
+
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(Spectrum::GetMagnitude)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Spectrum* spectrum = Nan::ObjectWrap::Unwrap<Spectrum>(info.Holder());
+
+  double* data;
+  v8::Local<v8::Float64Array> result = NewFloat64Array(spectrum->m_power.size(), data);
+  spectrum->getMagnitude(data, false);
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(Spectrum::GetMagnitudeDb)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Spectrum* spectrum = Nan::ObjectWrap::Unwrap<Spectrum>(info.Holder());
+
+  double* data;
+  v8::Local<v8::Float64Array> result = NewFloat64Array(spectrum->m_power.size(), data);
+  spectrum->getMagnitude(data, true);
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(Spectrum::GetAverageCount)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Spectrum* spectrum = Nan::ObjectWrap::Unwrap<Spectrum>(info.Holder());
+
+  std::lock_guard<std::mutex> lock(spectrum->m_mutex);
+  info.GetReturnValue().Set(spectrum->m_count);
+}
+
+NAN_METHOD(Spectrum::Reset)
+{
+  CHECK_PARAMETER_COUNT(0);
+  Spectrum* spectrum = Nan::ObjectWrap::Unwrap<Spectrum>(info.Holder());
+
+  std::lock_guard<std::mutex> lock(spectrum->m_mutex);
+  spectrum->m_power.assign(spectrum->m_power.size(), 0.0);
+  spectrum->m_count = 0;
+
+  info.GetReturnValue().SetUndefined();
+}
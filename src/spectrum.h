@@ -0,0 +1,50 @@
+/**
+ * \file spectrum.h
+ * \brief Averaged amplitude spectrum of captured records.
+ */
+
+#ifndef _SPECTRUM_H_
+#define _SPECTRUM_H_
+
+#include "common.h"
+#include "fft.h"
+#include <mutex>
+
+#define SPECTRUM_WINDOW_RECTANGULAR     0
+#define SPECTRUM_WINDOW_HANN            1
+#define SPECTRUM_WINDOW_BLACKMAN_HARRIS 2
+#define SPECTRUM_WINDOW_FLAT_TOP        3
+
+class Spectrum : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+    /**
+     * Add the power spectrum of \p data to the average, thread safe.
+     * Records shorter than the spectrum length are zero padded, longer ones are truncated.
+     */
+    uint32_t process(const float* data, size_t length);
+
+  private:
+    Spectrum(size_t length, uint32_t window);
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Process);
+    static NAN_METHOD(GetMagnitude);
+    static NAN_METHOD(GetMagnitudeDb);
+    static NAN_METHOD(GetAverageCount);
+    static NAN_METHOD(Reset);
+
+    void getMagnitude(double* magnitude, bool db);
+
+    std::shared_ptr<const RealFFTPlan> m_plan;
+    std::vector<double> m_window;
+    double m_scale;
+
+    std::mutex m_mutex;
+    std::vector<double> m_power;
+    uint32_t m_count;
+};
+
+#endif
@@ -0,0 +1,358 @@
+/**
+ * \file streamring.cc
+ * \brief Streams an oscilloscope into a SharedArrayBuffer ring read by any number of consumers.
+ */
+
+#include "streamring.h"
+#include <chrono>
+
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t), "Header fields are shared with JavaScript Atomics");
+
+NAN_MODULE_INIT(StreamRing::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("StreamRing").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "start", Start);
+  Nan::SetPrototypeMethod(tpl, "stop", Stop);
+  Nan::SetPrototypeMethod(tpl, "getStatus", GetStatus);
+  Nan::SetPrototypeMethod(tpl, "getBuffer", GetBuffer);
+
+  Nan::Set(target, Nan::New<v8::String>("StreamRing").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+StreamRing::StreamRing(LibTiePieHandle_t device, uint32_t chunkCount, uint32_t consumerCount) :
+  m_device(device),
+  m_chunkCount(chunkCount),
+  m_consumerCount(consumerCount),
+  m_deviceChannelCount(0),
+  m_chunkSampleCount(0),
+  m_data(0),
+  m_dataReady(false),
+  m_running(false),
+  m_stop(false),
+  m_finished(false),
+  m_async(0),
+  m_done(0),
+  m_resource(0)
+{
+}
+
+static uint32_t getOption(v8::Local<v8::Object> options, const char* name, uint32_t defaultValue)
+{
+  v8::Local<v8::Value> value = Nan::Get(options, Nan::New<v8::String>(name).ToLocalChecked()).ToLocalChecked();
+  return value->IsUndefined() ? defaultValue : Nan::To<uint32_t>(value).FromJust();
+}
+
+/**
+ * new StreamRing(handle[, options]), options: chunkCount (ring length in chunks) and consumerCount.
+ */
+NAN_METHOD(StreamRing::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowError("Use the new operator");
+  if(info.Length() < 1 || info.Length() > 2)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+
+  const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
+  uint32_t chunkCount = STREAMRING_DEFAULT_CHUNKCOUNT;
+  uint32_t consumerCount = STREAMRING_DEFAULT_CONSUMERCOUNT;
+  if(info.Length() > 1 && !info[1]->IsUndefined())
+  {
+    if(!info[1]->IsObject())
+      return Nan::ThrowTypeError("Invalid options");
+    v8::Local<v8::Object> options = info[1].As<v8::Object>();
+    chunkCount = getOption(options, "chunkCount", chunkCount);
+    consumerCount = getOption(options, "consumerCount", consumerCount);
+  }
+  CHECK_RANGE(chunkCount, 2, 1 << 20);
+  CHECK_RANGE(consumerCount, 1, 1024);
+
+  StreamRing* ring = new StreamRing(device, chunkCount, consumerCount);
+  ring->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+std::atomic<int32_t>& StreamRing::field(size_t index) const
+{
+  return reinterpret_cast<std::atomic<int32_t>*>(m_data)[index];
+}
+
+/**
+ * start(callback), allocates a new ring buffer, see getBuffer(). callback(err, status) is called when streaming stops.
+ */
+NAN_METHOD(StreamRing::Start)
+{
+  CHECK_PARAMETER_COUNT(1);
+  StreamRing* ring = Nan::ObjectWrap::Unwrap<StreamRing>(info.Holder());
+  if(!info[0]->IsFunction())
+    return Nan::ThrowTypeError("Invalid callback");
+  if(ring->m_running)
+    return Nan::ThrowError("StreamRing is running");
+
+  const LibTiePieHandle_t device = ring->m_device;
+  if(ScpGetMeasureMode(device) != MM_STREAM)
+  {
+    CHECK_LAST_STATUS();
+    return Nan::ThrowError("Oscilloscope is not in stream mode");
+  }
+  ring->m_deviceChannelCount = ScpGetChannelCount(device);
+  CHECK_LAST_STATUS();
+  ring->m_chunkSampleCount = ScpGetRecordLength(device);
+  CHECK_LAST_STATUS();
+  ring->m_channels.clear();
+  for(uint16_t ch = 0; ch < ring->m_deviceChannelCount; ++ch)
+  {
+    if(ScpChGetEnabled(device, ch) == BOOL8_TRUE)
+      ring->m_channels.push_back(ch);
+    CHECK_LAST_STATUS();
+  }
+  if(ring->m_channels.empty())
+    return Nan::ThrowError("No channels enabled");
+
+  const uint64_t headerSize = (STREAMRING_HEADERSIZE + STREAMRING_CONSUMERSIZE * ring->m_consumerCount + ring->m_channels.size()) * sizeof(int32_t);
+  const uint64_t dataOffset = (headerSize + 63) & ~(uint64_t)63;
+  const uint64_t chunkSize = ring->m_channels.size() * ring->m_chunkSampleCount * sizeof(float);
+  const uint64_t size = dataOffset + ring->m_chunkCount * chunkSize;
+  if(ring->m_chunkSampleCount > (uint64_t)std::numeric_limits<int32_t>::max() || size > (uint64_t)std::numeric_limits<int32_t>::max())
+    return Nan::ThrowRangeError("Ring buffer too large");
+
+  // Consumers may still hold a previous buffer, so every start gets a new one:
+  v8::Local<v8::SharedArrayBuffer> buffer = v8::SharedArrayBuffer::New(v8::Isolate::GetCurrent(), (size_t)size);
+  Nan::TypedArrayContents<uint8_t> contents(v8::Uint8Array::New(buffer, 0, (size_t)size));
+  ring->m_buffer.Reset(buffer);
+  ring->m_data = *contents;
+
+  ring->field(STREAMRING_CHUNKCOUNT) = (int32_t)ring->m_chunkCount;
+  ring->field(STREAMRING_CHUNKSAMPLECOUNT) = (int32_t)ring->m_chunkSampleCount;
+  ring->field(STREAMRING_CHANNELCOUNT) = (int32_t)ring->m_channels.size();
+  ring->field(STREAMRING_CONSUMERCOUNT) = (int32_t)ring->m_consumerCount;
+  ring->field(STREAMRING_DATAOFFSET) = (int32_t)dataOffset;
+  for(size_t i = 0; i < ring->m_channels.size(); ++i)
+    ring->field(STREAMRING_HEADERSIZE + STREAMRING_CONSUMERSIZE * ring->m_consumerCount + i) = ring->m_channels[i];
+  ring->field(STREAMRING_STATE) = 1;
+
+  ring->m_error.clear();
+  ring->m_dataReady = false;
+  ring->m_stop = false;
+  ring->m_finished = false;
+
+  ring->m_done = new Nan::Callback(info[0].As<v8::Function>());
+  ring->m_resource = new Nan::AsyncResource("libtiepie:StreamRing");
+  ring->m_async = new uv_async_t;
+  uv_async_init(Nan::GetCurrentEventLoop(), ring->m_async, onAsync);
+  ring->m_async->data = ring;
+
+  // Keep the object alive while streaming:
+  ring->Ref();
+  ring->m_running = true;
+  ring->m_thread = std::thread(&StreamRing::run, ring);
+
+  info.GetReturnValue().Set(buffer);
+}
+
+NAN_METHOD(StreamRing::Stop)
+{
+  CHECK_PARAMETER_COUNT(0);
+  StreamRing* ring = Nan::ObjectWrap::Unwrap<StreamRing>(info.Holder());
+  {
+    std::lock_guard<std::mutex> lock(ring->m_mutex);
+    ring->m_stop = true;
+  }
+  ring->m_condition.notify_all();
+  info.GetReturnValue().SetUndefined();
+}
+
+NAN_METHOD(StreamRing::GetStatus)
+{
+  CHECK_PARAMETER_COUNT(0);
+  StreamRing* ring = Nan::ObjectWrap::Unwrap<StreamRing>(info.Holder());
+  info.GetReturnValue().Set(ring->status());
+}
+
+NAN_METHOD(StreamRing::GetBuffer)
+{
+  CHECK_PARAMETER_COUNT(0);
+  StreamRing* ring = Nan::ObjectWrap::Unwrap<StreamRing>(info.Holder());
+  if(ring->m_buffer.IsEmpty())
+    info.GetReturnValue().SetNull();
+  else
+    info.GetReturnValue().Set(Nan::New(ring->m_buffer));
+}
+
+v8::Local<v8::Object> StreamRing::status() const
+{
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  Nan::Set(result, Nan::New<v8::String>("running").ToLocalChecked(), Nan::New<v8::Boolean>(m_running.load()));
+  if(!m_data)
+    return result;
+
+  const uint32_t head = (uint32_t)field(STREAMRING_HEAD).load();
+  Nan::Set(result, Nan::New<v8::String>("chunkCount").ToLocalChecked(), Nan::New<v8::Number>(head));
+  Nan::Set(result, Nan::New<v8::String>("overflowCount").ToLocalChecked(), Nan::New<v8::Number>(field(STREAMRING_OVERFLOWS).load()));
+
+  v8::Local<v8::Array> consumers = Nan::New<v8::Array>();
+  for(uint32_t i = 0; i < m_consumerCount; ++i)
+  {
+    const size_t base = STREAMRING_HEADERSIZE + STREAMRING_CONSUMERSIZE * i;
+    if(field(base + STREAMRING_CONSUMER_ACTIVE).load() == 0)
+      continue;
+
+    v8::Local<v8::Object> consumer = Nan::New<v8::Object>();
+    Nan::Set(consumer, Nan::New<v8::String>("index").ToLocalChecked(), Nan::New<v8::Number>(i));
+    Nan::Set(consumer, Nan::New<v8::String>("behind").ToLocalChecked(), Nan::New<v8::Number>(head - (uint32_t)field(base + STREAMRING_CONSUMER_TAIL).load()));
+    Nan::Set(consumer, Nan::New<v8::String>("lag").ToLocalChecked(), Nan::New<v8::Number>((uint32_t)field(base + STREAMRING_CONSUMER_LAG).load()));
+    Nan::Set(consumers, consumers->Length(), consumer);
+  }
+  Nan::Set(result, Nan::New<v8::String>("consumers").ToLocalChecked(), consumers);
+  return result;
+}
+
+void StreamRing::onDataReady(void* data)
+{
+  StreamRing* ring = (StreamRing*)data;
+  {
+    std::lock_guard<std::mutex> lock(ring->m_mutex);
+    ring->m_dataReady = true;
+  }
+  ring->m_condition.notify_all();
+}
+
+void StreamRing::onDataOverflow(void* data)
+{
+  ++((StreamRing*)data)->field(STREAMRING_OVERFLOWS);
+}
+
+void StreamRing::run()
+{
+  const uint64_t dataOffset = (uint64_t)field(STREAMRING_DATAOFFSET).load();
+  const uint64_t chunkSize = m_channels.size() * m_chunkSampleCount * sizeof(float);
+
+  ScpSetCallbackDataReady(m_device, onDataReady, this);
+  ScpSetCallbackDataOverflow(m_device, onDataOverflow, this);
+  ScpStart(m_device);
+  if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+    fail(LibGetLastStatusStr());
+
+  std::vector<float*> pointers(m_deviceChannelCount, (float*)0);
+  uint32_t head = 0;
+  uint64_t written = 0;
+  while(!m_stop)
+  {
+    if(ScpIsDataReady(m_device) == BOOL8_TRUE)
+    {
+      // The slot of chunk head - chunkCount is reused, consumers that haven't read it yet lose it:
+      if(written >= m_chunkCount)
+      {
+        const uint32_t reused = head - m_chunkCount;
+        for(uint32_t i = 0; i < m_consumerCount; ++i)
+        {
+          const size_t base = STREAMRING_HEADERSIZE + STREAMRING_CONSUMERSIZE * i;
+          if(field(base + STREAMRING_CONSUMER_ACTIVE).load() != 0 && (int32_t)(reused - (uint32_t)field(base + STREAMRING_CONSUMER_TAIL).load()) >= 0)
+            ++field(base + STREAMRING_CONSUMER_LAG);
+        }
+      }
+
+      float* chunk = (float*)(m_data + dataOffset + (head % m_chunkCount) * chunkSize);
+      for(size_t i = 0; i < m_channels.size(); ++i)
+        pointers[m_channels[i]] = chunk + i * m_chunkSampleCount;
+
+      ScpGetData(m_device, &pointers[0], m_deviceChannelCount, 0, m_chunkSampleCount);
+      if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+      {
+        fail(LibGetLastStatusStr());
+        break;
+      }
+
+      ++written;
+      field(STREAMRING_HEAD).store((int32_t)++head);
+      uv_async_send(m_async);
+    }
+    else if(ScpIsRunning(m_device) == BOOL8_FALSE)
+    {
+      // The measurement stops after a data overflow, resume it:
+      ScpStart(m_device);
+      if(LibGetLastStatus() < LIBTIEPIESTATUS_SUCCESS)
+        fail(LibGetLastStatusStr());
+    }
+    else
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if(!m_dataReady && !m_stop)
+        m_condition.wait_for(lock, std::chrono::milliseconds(100));
+      m_dataReady = false;
+    }
+  }
+
+  ScpStop(m_device);
+  ScpSetCallbackDataReady(m_device, 0, 0);
+  ScpSetCallbackDataOverflow(m_device, 0, 0);
+
+  field(STREAMRING_STATE).store(0);
+  m_finished = true;
+  uv_async_send(m_async);
+}
+
+void StreamRing::fail(const std::string& error)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_error.empty())
+      m_error = error;
+    m_stop = true;
+  }
+  m_condition.notify_all();
+}
+
+/**
+ * Wake consumers blocked in Atomics.wait() on the head, there is no way to do that from the streaming thread.
+ */
+static void notifyConsumers(v8::Local<v8::SharedArrayBuffer> buffer)
+{
+  v8::Local<v8::Object> global = Nan::GetCurrentContext()->Global();
+  v8::Local<v8::Value> atomics = Nan::Get(global, Nan::New<v8::String>("Atomics").ToLocalChecked()).ToLocalChecked();
+  if(!atomics->IsObject())
+    return;
+
+  v8::Local<v8::Value> notify = Nan::Get(atomics.As<v8::Object>(), Nan::New<v8::String>("notify").ToLocalChecked()).ToLocalChecked();
+  if(!notify->IsFunction())
+    notify = Nan::Get(atomics.As<v8::Object>(), Nan::New<v8::String>("wake").ToLocalChecked()).ToLocalChecked(); // Before V8 7.0
+  if(!notify->IsFunction())
+    return;
+
+  v8::Local<v8::Value> argv[] = {v8::Int32Array::New(buffer, 0, STREAMRING_HEADERSIZE), Nan::New<v8::Int32>(STREAMRING_HEAD)};
+  Nan::Call(notify.As<v8::Function>(), atomics.As<v8::Object>(), 2, argv);
+}
+
+void StreamRing::onAsync(uv_async_t* handle)
+{
+  Nan::HandleScope scope;
+  StreamRing* ring = (StreamRing*)handle->data;
+
+  notifyConsumers(Nan::New(ring->m_buffer));
+  if(!ring->m_finished)
+    return;
+
+  ring->m_thread.join();
+  ring->m_running = false;
+  uv_close((uv_handle_t*)handle, onClose);
+  ring->m_async = 0;
+
+  Nan::Callback* done = ring->m_done;
+  Nan::AsyncResource* resource = ring->m_resource;
+  ring->m_done = 0;
+  ring->m_resource = 0;
+
+  v8::Local<v8::Value> argv[] = {ring->m_error.empty() ? v8::Local<v8::Value>(Nan::Null()) : Nan::Error(ring->m_error.c_str()), ring->status()};
+  done->Call(2, argv, resource);
+
+  delete done;
+  delete resource;
+  ring->Unref();
+}
+
+void StreamRing::onClose(uv_handle_t* handle)
+{
+  delete (uv_async_t*)handle;
+}
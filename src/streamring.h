@@ -0,0 +1,93 @@
+/**
+ * \file streamring.h
+ * \brief Streams an oscilloscope into a SharedArrayBuffer ring read by any number of consumers.
+ *
+ * A background thread drains the streaming measurement into the ring, one chunk per record, and never waits for
+ * consumers: a consumer that falls more than the ring length behind loses chunks, which is counted in its lag counter.
+ * Consumers run in any thread that has the buffer, see lib/streamring.js.
+ *
+ * Buffer layout, all header fields are Int32 and are accessed atomically:
+ *
+ *     [0 .. 15]                          header, see STREAMRING_*
+ *     [16 + 4 * i .. 16 + 4 * i + 3]     consumer i: active, tail (next sequence number to read), lag, reserved
+ *     [16 + 4 * consumerCount ..]        channel number of every stored channel
+ *     data offset                        chunkCount chunks of channelCount * chunkSampleCount Float32 samples
+ *
+ * Sequence numbers count chunks and wrap around at 2^32, chunk n is stored in slot n % chunkCount.
+ */
+
+#ifndef _STREAMRING_H_
+#define _STREAMRING_H_
+
+#include "common.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#define STREAMRING_HEAD                0 //!< Sequence number of the next chunk to write.
+#define STREAMRING_STATE               1 //!< 1 while streaming, 0 when stopped.
+#define STREAMRING_OVERFLOWS           2 //!< Number of data overflows of the device.
+#define STREAMRING_CHUNKCOUNT          3
+#define STREAMRING_CHUNKSAMPLECOUNT    4
+#define STREAMRING_CHANNELCOUNT        5
+#define STREAMRING_CONSUMERCOUNT       6
+#define STREAMRING_DATAOFFSET          7 //!< Byte offset of the first chunk.
+#define STREAMRING_HEADERSIZE          16
+#define STREAMRING_CONSUMERSIZE        4
+#define STREAMRING_CONSUMER_ACTIVE     0
+#define STREAMRING_CONSUMER_TAIL       1
+#define STREAMRING_CONSUMER_LAG        2
+
+#define STREAMRING_DEFAULT_CHUNKCOUNT     64
+#define STREAMRING_DEFAULT_CONSUMERCOUNT  8
+
+class StreamRing : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    StreamRing(LibTiePieHandle_t device, uint32_t chunkCount, uint32_t consumerCount);
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Start);
+    static NAN_METHOD(Stop);
+    static NAN_METHOD(GetStatus);
+    static NAN_METHOD(GetBuffer);
+
+    static void onDataReady(void* data);
+    static void onDataOverflow(void* data);
+    static void onAsync(uv_async_t* handle);
+    static void onClose(uv_handle_t* handle);
+
+    std::atomic<int32_t>& field(size_t index) const;
+    void run();
+    void fail(const std::string& error);
+    v8::Local<v8::Object> status() const;
+
+    LibTiePieHandle_t m_device;
+    uint32_t m_chunkCount;
+    uint32_t m_consumerCount;
+    uint16_t m_deviceChannelCount;
+    std::vector<uint16_t> m_channels;
+    uint64_t m_chunkSampleCount;
+    uint8_t* m_data; //!< Contents of m_buffer, valid while it is referenced.
+    Nan::Global<v8::SharedArrayBuffer> m_buffer;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_dataReady;
+    std::string m_error;
+
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_stop;
+    std::atomic<bool> m_finished;
+
+    uv_async_t* m_async;
+    Nan::Callback* m_done;
+    Nan::AsyncResource* m_resource;
+};
+
+#endif
@@ -0,0 +1,359 @@
+/**
+ * \file virtualrecord.cc
+ * \brief Paged access to the record of a completed block measurement.
+ */
+
+#include "virtualrecord.h"
+
+NAN_MODULE_INIT(VirtualRecord::Init)
+{
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("VirtualRecord").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(tpl, "read", Read);
+  Nan::SetPrototypeMethod(tpl, "getStatus", GetStatus);
+
+  Nan::Set(target, Nan::New<v8::String>("VirtualRecord").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+VirtualRecord::VirtualRecord(const VirtualFetch& fetch, uint16_t channelCount, uint64_t sampleCount, uint32_t pageSize, uint32_t pageCount, uint32_t prefetch) :
+  m_fetch(fetch),
+  m_channelCount(channelCount),
+  m_sampleCount(sampleCount),
+  m_pageSize(pageSize),
+  m_pageCount(pageCount),
+  m_prefetch(prefetch),
+  m_stop(false),
+  m_lastChannel(0),
+  m_lastFirst(std::numeric_limits<uint64_t>::max()),
+  m_lastEnd(std::numeric_limits<uint64_t>::max()),
+  m_hits(0),
+  m_misses(0),
+  m_prefetchHits(0),
+  m_fetchedSamples(0)
+{
+  if(m_prefetch > 0)
+    m_thread = std::thread(&VirtualRecord::run, this);
+}
+
+VirtualRecord::~VirtualRecord()
+{
+  if(m_thread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+  }
+}
+
+static uint32_t getOption(v8::Local<v8::Object> options, const char* name, uint32_t defaultValue)
+{
+  v8::Local<v8::Value> value = Nan::Get(options, Nan::New<v8::String>(name).ToLocalChecked()).ToLocalChecked();
+  return value->IsUndefined() ? defaultValue : Nan::To<uint32_t>(value).FromJust();
+}
+
+/**
+ * new VirtualRecord(handle[, options]), options: pageSize (samples), pageCount (pages kept) and prefetch (pages
+ * fetched ahead on sequential reads, 0 disables prefetching). The record must stay valid while the object is used,
+ * so don't start a new measurement.
+ *
+ * Instead of a handle an array with a Float32Array per channel can be paged through, the arrays must not change.
+ */
+NAN_METHOD(VirtualRecord::New)
+{
+  if(!info.IsConstructCall())
+    return Nan::ThrowError("Use the new operator");
+  if(info.Length() < 1 || info.Length() > 2)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+
+  uint32_t pageSize = VIRTUALRECORD_DEFAULT_PAGESIZE;
+  uint32_t pageCount = VIRTUALRECORD_DEFAULT_PAGECOUNT;
+  uint32_t prefetch = VIRTUALRECORD_DEFAULT_PREFETCH;
+  if(info.Length() > 1 && !info[1]->IsUndefined())
+  {
+    if(!info[1]->IsObject())
+      return Nan::ThrowTypeError("Invalid options");
+    v8::Local<v8::Object> options = info[1].As<v8::Object>();
+    pageSize = getOption(options, "pageSize", pageSize);
+    pageCount = getOption(options, "pageCount", pageCount);
+    prefetch = getOption(options, "prefetch", prefetch);
+  }
+  CHECK_RANGE(pageSize, 1024, 1 << 28);
+  CHECK_RANGE(pageCount, 1, 1 << 16);
+  CHECK_RANGE(prefetch, 0, pageCount - 1);
+
+  VirtualFetch fetch;
+  uint16_t channelCount;
+  uint64_t sampleCount;
+  if(info[0]->IsArray())
+  {
+    v8::Local<v8::Array> arrays = info[0].As<v8::Array>();
+    std::vector<float*> pointers;
+    if(!FloatArrayList(arrays, pointers, sampleCount) || pointers.empty() || pointers.size() > std::numeric_limits<uint16_t>::max() || std::find(pointers.begin(), pointers.end(), (float*)0) != pointers.end())
+      return Nan::ThrowTypeError("Invalid data, expected an array of Float32Arrays");
+    channelCount = (uint16_t)pointers.size();
+    fetch = [pointers](uint16_t ch, uint64_t start, std::vector<float>& data)
+      {
+        std::copy(pointers[ch] + start, pointers[ch] + start + data.size(), data.begin());
+        return true;
+      };
+  }
+  else
+  {
+    const LibTiePieHandle_t device = Nan::To<LibTiePieHandle_t>(info[0]).FromJust();
+    if(ScpGetMeasureMode(device) != MM_BLOCK)
+    {
+      CHECK_LAST_STATUS();
+      return Nan::ThrowError("Oscilloscope is not in block mode");
+    }
+    channelCount = ScpGetChannelCount(device);
+    CHECK_LAST_STATUS();
+    sampleCount = ScpGetRecordLength(device);
+    CHECK_LAST_STATUS();
+    fetch = [device, channelCount](uint16_t ch, uint64_t start, std::vector<float>& data)
+      {
+        std::vector<float*> pointers(channelCount, (float*)0);
+        pointers[ch] = &data[0];
+        ScpGetData(device, &pointers[0], channelCount, start, data.size());
+        return LibGetLastStatus() >= LIBTIEPIESTATUS_SUCCESS;
+      };
+  }
+
+  VirtualRecord* record = new VirtualRecord(fetch, channelCount, sampleCount, pageSize, pageCount, prefetch);
+  if(info[0]->IsArray())
+    record->m_arrays.Reset(info[0].As<v8::Array>());
+  record->Wrap(info.This());
+  Nan::DefineOwnProperty(info.This(), Nan::New<v8::String>("sampleCount").ToLocalChecked(), Nan::New<v8::Number>((double)sampleCount), v8::ReadOnly);
+
+  info.GetReturnValue().Set(info.This());
+}
+
+/**
+ * Drop the least recently used ready page. Unread prefetched pages are only dropped when no other page is ready,
+ * otherwise fetching ahead would drop the pages fetched just before. Must be called with m_mutex locked.
+ */
+void VirtualRecord::evict()
+{
+  for(int pass = 0; pass < 2; ++pass)
+    for(std::list<VirtualPage>::iterator it = m_pages.end(); it != m_pages.begin();)
+    {
+      --it;
+      if(it->ready && (pass == 1 || !it->prefetched))
+      {
+        m_index.erase(it->key);
+        m_pages.erase(it);
+        return;
+      }
+    }
+}
+
+/**
+ * Add a page that isn't ready yet, dropping a page when the cache is full. A read page becomes the most recently
+ * used, a prefetched one goes just behind it. Must be called with m_mutex locked.
+ */
+std::list<VirtualPage>::iterator VirtualRecord::insert(const VirtualPageKey& key, bool prefetched)
+{
+  if(m_pages.size() >= m_pageCount)
+    evict();
+
+  std::list<VirtualPage>::iterator position = m_pages.begin();
+  if(prefetched && position != m_pages.end())
+    ++position;
+  std::list<VirtualPage>::iterator page = m_pages.insert(position, VirtualPage());
+  page->key = key;
+  page->ready = false;
+  page->prefetched = prefetched;
+  m_index[key] = page;
+  return page;
+}
+
+bool VirtualRecord::fetch(const VirtualPageKey& key, std::vector<float>& data)
+{
+  const uint64_t start = key.second * m_pageSize;
+  data.resize((size_t)std::min<uint64_t>(m_pageSize, m_sampleCount - start));
+
+  std::lock_guard<std::mutex> lock(m_fetchMutex);
+  return m_fetch(key.first, start, data);
+}
+
+/**
+ * Get a page, fetching it when needed. Must be called with m_mutex locked, it is unlocked while fetching and locked
+ * again on return.
+ */
+bool VirtualRecord::page(const VirtualPageKey& key, std::list<VirtualPage>::iterator& result)
+{
+  std::unique_lock<std::mutex> lock(m_mutex, std::adopt_lock);
+  std::map<VirtualPageKey, std::list<VirtualPage>::iterator>::iterator it = m_index.find(key);
+  if(it != m_index.end())
+  {
+    result = it->second;
+    while(!result->ready)
+    {
+      m_condition.wait(lock);
+
+      // A failed prefetch drops the page:
+      it = m_index.find(key);
+      if(it == m_index.end())
+        break;
+      result = it->second;
+    }
+  }
+
+  if(it != m_index.end())
+  {
+    m_hits++;
+    if(result->prefetched)
+    {
+      m_prefetchHits++;
+      result->prefetched = false;
+    }
+    m_pages.splice(m_pages.begin(), m_pages, result);
+    lock.release();
+    return true;
+  }
+
+  // A queued prefetch of this page is no longer needed:
+  m_queue.erase(std::remove(m_queue.begin(), m_queue.end(), key), m_queue.end());
+
+  m_misses++;
+  result = insert(key, false);
+  std::vector<float> data;
+  lock.unlock();
+  const bool ok = fetch(key, data);
+  lock.lock();
+
+  if(!ok)
+  {
+    m_index.erase(key);
+    m_pages.erase(result);
+  }
+  else
+  {
+    result->data.swap(data);
+    result->ready = true;
+    m_fetchedSamples += result->data.size();
+  }
+  m_condition.notify_all();
+  lock.release();
+  return ok;
+}
+
+/**
+ * Queue pages \p first up to \p last for the prefetch thread. Must be called with m_mutex locked.
+ */
+void VirtualRecord::prefetch(uint16_t ch, uint64_t first, uint64_t last)
+{
+  const uint64_t pageTotal = (m_sampleCount + m_pageSize - 1) / m_pageSize;
+  for(uint64_t index = first; index < last && index < pageTotal; ++index)
+  {
+    const VirtualPageKey key(ch, index);
+    if(m_index.find(key) == m_index.end() && std::find(m_queue.begin(), m_queue.end(), key) == m_queue.end())
+      m_queue.push_back(key);
+  }
+  m_condition.notify_all();
+}
+
+void VirtualRecord::run()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while(!m_stop)
+  {
+    if(m_queue.empty())
+    {
+      m_condition.wait(lock);
+      continue;
+    }
+
+    const VirtualPageKey key = m_queue.front();
+    m_queue.pop_front();
+    if(m_index.find(key) != m_index.end())
+      continue;
+
+    std::list<VirtualPage>::iterator page = insert(key, true);
+    std::vector<float> data;
+    lock.unlock();
+    const bool ok = fetch(key, data);
+    lock.lock();
+
+    if(!ok)
+    {
+      m_index.erase(key);
+      m_pages.erase(page);
+    }
+    else
+    {
+      page->data.swap(data);
+      page->ready = true;
+      m_fetchedSamples += page->data.size();
+    }
+    m_condition.notify_all();
+  }
+}
+
+/**
+ * read(channel[, start[, end]]), returns samples start up to end of a channel as a Float32Array.
+ */
+NAN_METHOD(VirtualRecord::Read)
+{
+  if(info.Length() < 1 || info.Length() > 3)
+    return Nan::ThrowSyntaxError("Invalid parameter count");
+  VirtualRecord* record = Nan::ObjectWrap::Unwrap<VirtualRecord>(info.Holder());
+  const uint32_t ch = Nan::To<uint32_t>(info[0]).FromJust();
+  CHECK_RANGE(ch, 0, record->m_channelCount - 1u);
+  const uint64_t start = std::min(record->m_sampleCount, (info.Length() > 1 && !info[1]->IsUndefined()) ? (uint64_t)Nan::To<double>(info[1]).FromJust() : 0);
+  const uint64_t end = std::min(record->m_sampleCount, (info.Length() > 2 && !info[2]->IsUndefined()) ? (uint64_t)Nan::To<double>(info[2]).FromJust() : record->m_sampleCount);
+  const size_t length = end > start ? (size_t)(end - start) : 0;
+
+  float* data;
+  v8::Local<v8::Float32Array> result = NewFloat32Array(length, data);
+  if(length == 0)
+    return info.GetReturnValue().Set(result);
+
+  const uint64_t firstPage = start / record->m_pageSize;
+  const uint64_t endPage = (end - 1) / record->m_pageSize + 1;
+
+  record->m_mutex.lock();
+  // Reads that continue where the previous one ended fetch ahead:
+  if(record->m_prefetch > 0 && ch == record->m_lastChannel && firstPage >= record->m_lastFirst && firstPage <= record->m_lastEnd)
+    record->prefetch((uint16_t)ch, endPage, endPage + record->m_prefetch);
+  record->m_lastChannel = (uint16_t)ch;
+  record->m_lastFirst = firstPage;
+  record->m_lastEnd = endPage;
+
+  for(uint64_t i = start; i < end;)
+  {
+    std::list<VirtualPage>::iterator page;
+    if(!record->page(VirtualPageKey((uint16_t)ch, i / record->m_pageSize), page))
+    {
+      record->m_mutex.unlock();
+      return Nan::ThrowError(LibGetLastStatusStr());
+    }
+    const size_t offset = (size_t)(i % record->m_pageSize);
+    const size_t count = (size_t)std::min<uint64_t>(page->data.size() - offset, end - i);
+    memcpy(data + (i - start), &page->data[offset], count * sizeof(float));
+    i += count;
+  }
+  record->m_mutex.unlock();
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(VirtualRecord::GetStatus)
+{
+  CHECK_PARAMETER_COUNT(0);
+  VirtualRecord* record = Nan::ObjectWrap::Unwrap<VirtualRecord>(info.Holder());
+
+  std::lock_guard<std::mutex> lock(record->m_mutex);
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  Nan::Set(result, Nan::New<v8::String>("pageCount").ToLocalChecked(), Nan::New<v8::Number>((double)record->m_pages.size()));
+  Nan::Set(result, Nan::New<v8::String>("queued").ToLocalChecked(), Nan::New<v8::Number>((double)record->m_queue.size()));
+  Nan::Set(result, Nan::New<v8::String>("hits").ToLocalChecked(), Nan::New<v8::Number>((double)record->m_hits));
+  Nan::Set(result, Nan::New<v8::String>("misses").ToLocalChecked(), Nan::New<v8::Number>((double)record->m_misses));
+  Nan::Set(result, Nan::New<v8::String>("prefetchHits").ToLocalChecked(), Nan::New<v8::Number>((double)record->m_prefetchHits));
+  Nan::Set(result, Nan::New<v8::String>("fetchedSamples").ToLocalChecked(), Nan::New<v8::Number>((double)record->m_fetchedSamples));
+  info.GetReturnValue().Set(result);
+}
@@ -0,0 +1,87 @@
+/**
+ * \file virtualrecord.h
+ * \brief Paged access to the record of a completed block measurement.
+ *
+ * Deep records don't fit host memory, so read() fetches fixed size pages of a channel with ScpGetData() and keeps the
+ * most recently used ones. When reads walk forward through a channel, a background thread fetches the next pages
+ * before they are asked for. Prefetched pages are kept until they are read, unless nothing else can be dropped.
+ *
+ * Pages are fetched through a callback, so the cache can also page through arrays in memory.
+ */
+
+#ifndef _VIRTUALRECORD_H_
+#define _VIRTUALRECORD_H_
+
+#include "common.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <deque>
+#include <functional>
+
+#define VIRTUALRECORD_DEFAULT_PAGESIZE   (1 << 20)
+#define VIRTUALRECORD_DEFAULT_PAGECOUNT  16
+#define VIRTUALRECORD_DEFAULT_PREFETCH   2
+
+typedef std::pair<uint16_t, uint64_t> VirtualPageKey; //!< Channel and page index.
+typedef std::function<bool(uint16_t ch, uint64_t start, std::vector<float>& data)> VirtualFetch; //!< Fills data, which is sized by the caller.
+
+struct VirtualPage
+{
+  VirtualPageKey key;
+  bool ready; //!< False while the page is being fetched.
+  bool prefetched; //!< Fetched ahead and not read yet.
+  std::vector<float> data;
+};
+
+class VirtualRecord : public Nan::ObjectWrap
+{
+  public:
+    static NAN_MODULE_INIT(Init);
+
+  private:
+    VirtualRecord(const VirtualFetch& fetch, uint16_t channelCount, uint64_t sampleCount, uint32_t pageSize, uint32_t pageCount, uint32_t prefetch);
+    ~VirtualRecord();
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Read);
+    static NAN_METHOD(GetStatus);
+
+    std::list<VirtualPage>::iterator insert(const VirtualPageKey& key, bool prefetched);
+    void evict();
+    bool fetch(const VirtualPageKey& key, std::vector<float>& data);
+    bool page(const VirtualPageKey& key, std::list<VirtualPage>::iterator& result);
+    void prefetch(uint16_t ch, uint64_t first, uint64_t last);
+    void run();
+
+    VirtualFetch m_fetch;
+    Nan::Global<v8::Array> m_arrays; //!< Keeps the arrays alive when paging through memory.
+    uint16_t m_channelCount;
+    uint64_t m_sampleCount;
+    uint32_t m_pageSize;
+    uint32_t m_pageCount;
+    uint32_t m_prefetch;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition; //!< Signals queued prefetches and fetched pages.
+    std::mutex m_fetchMutex; //!< Serializes m_fetch calls.
+    std::list<VirtualPage> m_pages; //!< Most recently used first.
+    std::map<VirtualPageKey, std::list<VirtualPage>::iterator> m_index;
+    std::deque<VirtualPageKey> m_queue;
+    std::thread m_thread;
+    bool m_stop;
+
+    // Last read, to detect sequential access:
+    uint16_t m_lastChannel;
+    uint64_t m_lastFirst;
+    uint64_t m_lastEnd;
+
+    uint64_t m_hits;
+    uint64_t m_misses;
+    uint64_t m_prefetchHits;
+    uint64_t m_fetchedSamples;
+};
+
+#endif
@@ -0,0 +1,44 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('averager', function(t)
+{
+  t.plan(12);
+
+  const length = 10;
+  const a = new Float32Array(length).fill(1);
+  const b = new Float32Array(length + 5).fill(3);
+
+  t.throws(function() { new libtiepie.Averager(1, length, NaN); });
+
+  const averager = new libtiepie.Averager(2, length);
+  t.throws(function() { averager.process([new Float32Array(length - 1)], function() {}); });
+
+  // The timeout is checked before the device is accessed:
+  t.throws(function() { averager.acquire(0, 1, 0, function() {}); }, RangeError);
+  t.throws(function() { averager.acquire(0, 1, NaN, function() {}); }, RangeError);
+  t.throws(function() { averager.acquire(0, 1, 1, 2, function() {}); }, SyntaxError);
+  averager.process([a, null], function(err, count)
+  {
+    t.error(err);
+    averager.process([b, null], function(err, count)
+    {
+      t.error(err);
+      t.equal(count, 2);
+
+      const mean = averager.getMean();
+      t.equal(mean[0].length, length);
+      t.same(Array.from(mean[0]), new Array(length).fill(2));
+      t.equal(mean[1], null);
+
+      const exponential = new libtiepie.Averager(1, length, 0.25);
+      exponential.process([a], function()
+      {
+        exponential.process([b], function()
+        {
+          t.same(Array.from(exponential.getMean()[0]), new Array(length).fill(1.5));
+        });
+      });
+    });
+  });
+})
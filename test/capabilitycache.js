@@ -0,0 +1,40 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('CapabilityCache', function(t)
+{
+  t.plan(5);
+
+  libtiepie.CapabilityCache.clear();
+  t.same(libtiepie.CapabilityCache.getStats(), {handles: 0, hits: 0, misses: 0, invalidations: 0});
+
+  // Failed reads are not cached:
+  t.throws(function() { libtiepie.api.ScpGetResolutions(0); });
+  t.throws(function() { libtiepie.api.ScpGetResolutions(0); });
+  const stats = libtiepie.CapabilityCache.getStats();
+  t.equal(stats.handles, 0);
+  t.equal(stats.misses, 2);
+});
+
+test('LibGetConfig', function(t)
+{
+  t.plan(4);
+
+  const config = libtiepie.api.LibGetConfig();
+  t.ok(config instanceof Uint8Array);
+  t.equal(libtiepie.api.LibGetConfig(), config);
+
+  // A modified array isn't handed out again:
+  if(config.length > 0)
+  {
+    config[0] ^= 0xff;
+    const fresh = libtiepie.api.LibGetConfig();
+    t.notEqual(fresh, config);
+    t.equal(fresh[0], config[0] ^ 0xff);
+  }
+  else
+  {
+    t.pass();
+    t.pass();
+  }
+});
@@ -0,0 +1,55 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+const os = require('os')
+const path = require('path')
+const fs = require('fs')
+
+test('capturefile', function(t)
+{
+  t.plan(11);
+
+  const filename = path.join(os.tmpdir(), 'node-libtiepie-capturefile-test.bin');
+  const raw = new Int16Array(1000);
+  const volts = new Float32Array(1000);
+  for(let i = 0; i < raw.length; i++)
+  {
+    raw[i] = i - 500;
+    volts[i] = raw[i] / 500;
+  }
+
+  const capture = {
+    sampleFrequency: 1e6,
+    triggerIndex: 100,
+    resolution: 12,
+    channels: [
+      {number: 0, range: 4, dataValueMin: -4, dataValueMax: 4, rawValueMin: -2048, rawValueZero: 0, rawValueMax: 2047, data: raw},
+      {number: 1, range: 2, dataValueMin: -2, dataValueMax: 2, data: volts}
+    ]
+  };
+
+  libtiepie.CaptureFile.write(filename, capture, function(err)
+  {
+    t.error(err);
+
+    const result = libtiepie.CaptureFile.read(filename);
+    t.equal(result.sampleFrequency, 1e6);
+    t.equal(result.sampleCount, 1000);
+    t.equal(result.triggerIndex, 100);
+    t.equal(result.resolution, 12);
+    t.equal(result.channels.length, 2);
+    t.equal(result.channels[0].rawValueMin, -2048);
+    t.ok(result.channels[0].data instanceof Int16Array);
+    t.same(Array.from(result.channels[0].data), Array.from(raw));
+    t.ok(result.channels[1].data instanceof Float32Array);
+    t.same(Array.from(result.channels[1].data), Array.from(volts));
+
+    // Windows refuses to delete a file while it is mapped:
+    try
+    {
+      fs.unlinkSync(filename);
+    }
+    catch(e)
+    {
+    }
+  });
+});
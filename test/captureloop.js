@@ -0,0 +1,17 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('CaptureLoop', function(t)
+{
+  t.plan(6);
+
+  t.type(libtiepie.CaptureLoop, 'function');
+  t.throws(function() { libtiepie.CaptureLoop(0); });
+  t.throws(function() { new libtiepie.CaptureLoop(); });
+  t.throws(function() { new libtiepie.CaptureLoop(0, 0); });
+
+  const loop = new libtiepie.CaptureLoop(0, 4);
+  t.equal(loop.read(), null);
+  const status = loop.getStatus();
+  t.same([status.running, status.captureCount, status.droppedCount, status.queued], [false, 0, 0, 0]);
+});
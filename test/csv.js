@@ -0,0 +1,50 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+const os = require('os')
+const path = require('path')
+const fs = require('fs')
+
+test('csv format', function(t)
+{
+  t.plan(5);
+
+  const a = new Float32Array([0.1, -1.5, 1e-7, 3e38, NaN, 0]);
+  const b = new Int16Array([1, -2, 3]);
+
+  t.equal(libtiepie.Csv.format([a, b], {eol: '\n'}), '0.1;1\n-1.5;-2\n1e-7;3\n3e+38;\nNaN;\n0;\n');
+  t.equal(libtiepie.Csv.format([a.subarray(0, 2)], {eol: '\r\n', precision: 3, index: true, header: ['Sample', 'Ch1']}), 'Sample;Ch1\r\n0;0.100\r\n1;-1.500\r\n');
+  t.equal(libtiepie.Csv.format([b], {separator: ',', eol: '\n', header: ['a,b', 'c"d']}), '"a,b","c""d"\n1\n-2\n3\n');
+
+  // Large values at the highest precision take the longest text:
+  const large = new Float64Array([1e11, -1e20, 123.5]);
+  t.equal(libtiepie.Csv.format([large, large], {eol: '\n', precision: 20}), Array.from(large, function(x) { return x.toFixed(20) + ';' + x.toFixed(20) + '\n'; }).join(''));
+
+  // Shortest representation reads back as the same float:
+  const random = new Float32Array(10000);
+  for(let i = 0; i < random.length; i++)
+    random[i] = (Math.random() - 0.5) * Math.pow(10, Math.floor(Math.random() * 20 - 10));
+  const lines = libtiepie.Csv.format([random], {eol: '\n'}).split('\n');
+  let ok = true;
+  for(let i = 0; i < random.length; i++)
+    ok = ok && Math.fround(parseFloat(lines[i])) === random[i];
+  t.ok(ok);
+});
+
+test('csv write', function(t)
+{
+  t.plan(3);
+
+  const filename = path.join(os.tmpdir(), 'node-libtiepie-csv-test.csv');
+  const data = new Float32Array(100000);
+  for(let i = 0; i < data.length; i++)
+    data[i] = Math.sin(i / 100);
+
+  libtiepie.Csv.write(filename, [data, data], {eol: '\n', threads: 3}, function(err, bytesWritten)
+  {
+    t.error(err);
+    const text = fs.readFileSync(filename, 'utf8');
+    t.equal(bytesWritten, text.length);
+    t.equal(text, libtiepie.Csv.format([data, data], {eol: '\n'}));
+    fs.unlinkSync(filename);
+  });
+});
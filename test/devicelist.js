@@ -0,0 +1,88 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+const mandatory = {
+  serialNumber: 'number',
+  productId: 'number',
+  vendorId: 'number',
+  name: 'string',
+  nameShort: 'string',
+  nameShortest: 'string',
+  types: 'number',
+  canOpen: 'number',
+  hasServer: 'boolean'
+};
+
+// Optional keys and the getter that fails when they are unavailable:
+const optional = {
+  driverVersion: ['string', 'LstDevGetDriverVersion'],
+  recommendedDriverVersion: ['string', 'LstDevGetRecommendedDriverVersion'],
+  firmwareVersion: ['string', 'LstDevGetFirmwareVersion'],
+  recommendedFirmwareVersion: ['string', 'LstDevGetRecommendedFirmwareVersion'],
+  calibrationDate: ['number', 'LstDevGetCalibrationDate'],
+  ipv4Address: ['number', 'LstDevGetIPv4Address'],
+  ipPort: ['number', 'LstDevGetIPPort']
+};
+
+const itemAssertCount = 2 + Object.keys(optional).length;
+
+function checkItem(t, item, index)
+{
+  let valid = Array.isArray(item.containedSerialNumbers);
+  for(const key in mandatory)
+  {
+    valid = valid && typeof item[key] === mandatory[key];
+  }
+  t.ok(valid, 'mandatory keys of item ' + index);
+
+  let known = true;
+  for(const key of Object.keys(item))
+  {
+    known = known && (key in mandatory || key === 'containedSerialNumbers' || (key in optional && typeof item[key] === optional[key][0]));
+  }
+  t.ok(known, 'known keys of item ' + index);
+
+  for(const key in optional)
+  {
+    let available = true;
+    try
+    {
+      libtiepie.api[optional[key][1]](libtiepie.const.IDKIND_INDEX, index);
+    }
+    catch(e)
+    {
+      available = false;
+    }
+    t.equal(key in item, available, key + ' of item ' + index);
+  }
+}
+
+test('LstUpdateAsync', function(t)
+{
+  libtiepie.api.LstUpdateAsync().then(function(list)
+  {
+    t.plan(2 + itemAssertCount * list.length);
+    t.ok(Array.isArray(list));
+    t.equal(list.length, libtiepie.api.LstGetCount());
+    for(let i = 0; i < list.length; i++)
+    {
+      checkItem(t, list[i], i);
+    }
+  }, function(err)
+  {
+    t.plan(1);
+    t.error(err);
+  });
+});
+
+test('LstGetSnapshot', function(t)
+{
+  const list = libtiepie.api.LstGetSnapshot();
+  t.plan(2 + itemAssertCount * list.length);
+  t.ok(Array.isArray(list));
+  t.equal(list.length, libtiepie.api.LstGetCount());
+  for(let i = 0; i < list.length; i++)
+  {
+    checkItem(t, list[i], i);
+  }
+});
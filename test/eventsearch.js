@@ -0,0 +1,34 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('eventsearch', function(t)
+{
+  t.plan(6);
+
+  // Square wave with a 2 sample glitch:
+  const data = new Float32Array(1000);
+  for(let i = 0; i < data.length; i++)
+    data[i] = (Math.floor(i / 100) % 2) ? 1 : -1;
+  data[250] = data[251] = 1;
+
+  const search = new libtiepie.EventSearch(libtiepie.const.TK_PULSEWIDTHPOSITIVE);
+  search.setSampleFrequency(1e6);
+  search.setDataValueRange(-1, 1);
+  search.setCondition(libtiepie.const.TC_SMALLER);
+  search.setTime(0, 10e-6);
+  search.setWindow(4, 8);
+
+  search.process(data.subarray(0, 251), function(err, events)
+  {
+    t.error(err);
+    t.equal(events.length, 0);
+
+    search.process(data.subarray(251), function(err, events)
+    {
+      t.error(err);
+      t.equal(events.length, 1);
+      t.equal(events[0].index, 252);
+      t.equal(events[0].data.length, 12);
+    });
+  });
+})
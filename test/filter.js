@@ -0,0 +1,79 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('Filter', function(t)
+{
+  t.plan(11);
+
+  t.throws(function() { libtiepie.Filter(1, {type: 'fir', coefficients: [1]}); });
+  t.throws(function() { new libtiepie.Filter(1, {type: 'fft'}); });
+  t.throws(function() { new libtiepie.Filter(1, {type: 'cic', decimation: 1}); });
+  t.throws(function() { new libtiepie.Filter(1, {type: 'cic', decimation: 65536, order: 8}); });
+
+  const fir = new libtiepie.Filter(1, {type: 'fir', coefficients: [1, 2, 3]});
+  t.same(Array.from(fir.process([[1, 0, 0, 0, 0]])[0]), [1, 2, 3, 0, 0]);
+
+  // The state is kept across chunks, also when decimating:
+  const stages = [
+    {type: 'fir', coefficients: [0.25, 0.25, 0.25, 0.25], decimation: 2},
+    {type: 'biquad', sections: [[0.25, 0.5, 0.25, 1, -0.5, 0.25]]},
+    {type: 'cic', decimation: 4, order: 2}
+  ];
+  const whole = new libtiepie.Filter(2, stages);
+  const chunked = new libtiepie.Filter(2, stages);
+  t.equal(whole.decimation, 8);
+
+  const input = new Float32Array(1000);
+  for(let i = 0; i < input.length; i++)
+  {
+    input[i] = Math.sin(i / 10);
+  }
+  const expected = whole.process([input, null]);
+  t.equal(expected[0].length, 125);
+  t.equal(expected[1], null);
+
+  let output = [];
+  for(let i = 0; i < input.length; i += 77)
+  {
+    output = output.concat(Array.from(chunked.process([input.subarray(i, i + 77)])[0]));
+  }
+  t.same(output, Array.from(expected[0]));
+
+  const cic = new libtiepie.Filter(1, {type: 'cic', decimation: 16, order: 4});
+  cic.process([new Float32Array(1000).fill(0.5)], function(err, result)
+  {
+    t.error(err);
+    t.equal(result[0][result[0].length - 1], 0.5);
+  });
+});
+
+test('Filter biquad response', function(t)
+{
+  t.plan(3);
+
+  // Second order Butterworth low-pass at 1e-4 of the sample rate, poles very close to z = 1:
+  const k = Math.tan(Math.PI * 1e-4);
+  const norm = 1 / (1 + Math.SQRT2 * k + k * k);
+  const b0 = k * k * norm;
+  const a1 = 2 * (k * k - 1) * norm;
+  const a2 = (1 - Math.SQRT2 * k + k * k) * norm;
+  const filter = new libtiepie.Filter(1, {type: 'biquad', sections: [new Float64Array([b0, 2 * b0, b0, 1, a1, a2])]});
+
+  const input = new Float32Array(200000).fill(1);
+  const output = filter.process([input])[0];
+
+  // Reference in double precision:
+  let s1 = 0;
+  let s2 = 0;
+  let error = 0;
+  for(let i = 0; i < input.length; i++)
+  {
+    const y = b0 * input[i] + s1;
+    s1 = 2 * b0 * input[i] - a1 * y + s2;
+    s2 = b0 * input[i] - a2 * y;
+    error = Math.max(error, Math.abs(output[i] - y));
+  }
+  t.ok(error < 1e-6, 'matches the reference');
+  t.ok(Math.abs(output[output.length - 1] - 1) < 1e-4, 'unity gain at DC');
+  t.throws(function() { new libtiepie.Filter(1, {type: 'biquad', sections: [[1, 0, 0, 0, 0, 0]]}); });
+});
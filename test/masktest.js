@@ -0,0 +1,31 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('masktest', function(t)
+{
+  t.plan(9);
+
+  const mask = new libtiepie.MaskTest(2);
+  t.throws(function() { mask.setLimits(0, new Float32Array(10), new Float32Array(11)); });
+  t.throws(function() { mask.setLimitLines(1, [[1, 0], [0, 0]], null); });
+
+  mask.setLimits(0, new Float32Array(20).fill(-1), new Float32Array(20).fill(1));
+  mask.setLimitLines(1, null, [[0, 0], [1, 1]]);
+
+  const a = new Float32Array(20);
+  a[3] = 1.5;
+  a[7] = -3;
+  const b = new Float32Array(20).fill(0.5);
+  mask.process([a, b], function(err, result)
+  {
+    t.error(err);
+    t.equal(result.recordCount, 1);
+    t.equal(result.passed, false);
+    t.equal(result.channels[0].violationCount, 2);
+    t.same(result.channels[0].first, {record: 0, index: 3});
+    t.same(result.channels[0].worst, {record: 0, index: 7, excess: 2});
+
+    // The upper line rises from 0 to 1, so the first half of b is above it:
+    t.equal(result.channels[1].violationCount, 10);
+  });
+})
@@ -0,0 +1,23 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('Object classes', function(t)
+{
+  t.plan(10);
+
+  ['Oscilloscope', 'Generator', 'I2CHost', 'Server'].forEach(function(name)
+  {
+    t.type(libtiepie[name], 'function');
+  });
+  t.type(libtiepie.Oscilloscope.open, 'function');
+
+  // Constructors require new and a valid handle:
+  t.throws(function() { libtiepie.Oscilloscope(0); });
+  t.throws(function() { new libtiepie.Oscilloscope(); });
+  t.throws(function() { new libtiepie.Oscilloscope(0); });
+  t.throws(function() { new libtiepie.Server(0); });
+
+  // Accessors live on the prototype and reject other receivers:
+  const descriptor = Object.getOwnPropertyDescriptor(libtiepie.Oscilloscope.prototype, 'recordLength');
+  t.throws(function() { descriptor.get.call({}); });
+});
@@ -0,0 +1,21 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('persistence', function(t)
+{
+  t.plan(5);
+
+  const persistence = new libtiepie.Persistence(2, 4, 2);
+  t.throws(function() { persistence.setDataValueRange(2, -1, 1); });
+  t.throws(function() { persistence.setDataValueRange(0, 1, -1); });
+
+  const data = new Float32Array([0.5, 0.5, -0.5, -0.5, 0.9, 0.9, -0.9, 2]);
+  persistence.process([data, null], function(err, count)
+  {
+    t.error(err);
+    t.equal(count, 1);
+
+    // Two samples per column, row 0 holds the positive half and the out of range sample is dropped:
+    t.same(Array.from(persistence.getImage(0)), [2, 0, 2, 0, 0, 2, 0, 1]);
+  });
+})
@@ -0,0 +1,69 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+const os = require('os')
+const path = require('path')
+const fs = require('fs')
+
+test('pyramid', function(t)
+{
+  t.plan(10);
+
+  const filename = path.join(os.tmpdir(), 'node-libtiepie-pyramid-test.bin');
+  const raw = new Int16Array(5000);
+  const volts = new Float32Array(5000);
+  for(let i = 0; i < raw.length; i++)
+  {
+    raw[i] = (i % 100) - 50;
+    volts[i] = i / 1000;
+  }
+
+  const capture = {
+    sampleFrequency: 1e6,
+    channels: [
+      {number: 0, range: 4, dataValueMin: -4, dataValueMax: 4, rawValueMin: -2048, rawValueZero: 0, rawValueMax: 2048, data: raw},
+      {number: 1, range: 8, dataValueMin: -8, dataValueMax: 8, data: volts}
+    ]
+  };
+
+  t.throws(function() { libtiepie.Pyramid.build(filename, 3, function() {}); });
+
+  libtiepie.CaptureFile.write(filename, capture, function(err)
+  {
+    t.error(err);
+
+    libtiepie.Pyramid.build(filename, 16, function(err)
+    {
+      t.error(err);
+
+      const pyramid = new libtiepie.Pyramid(filename);
+      t.equal(pyramid.sampleCount, 5000);
+      t.equal(pyramid.bucketSize, 16);
+
+      // Zoomed out, every pixel spans a full period:
+      const overview = pyramid.getMinMax(0, 0, 5000, 10);
+      t.same(Array.from(overview.min), new Array(10).fill(-50 / 512));
+      t.same(Array.from(overview.max), new Array(10).fill(49 / 512));
+
+      // Zoomed in below the bucket size, read from the capture file:
+      const detail = pyramid.getMinMax(1, 1000, 1004, 4);
+      t.equal(detail.bucketSize, 1);
+      t.same(Array.from(detail.max), Array.from(volts.subarray(1000, 1004)));
+
+      // Levels that would shift the sample count by 64 bits or more are rejected:
+      const corrupt = fs.readFileSync(filename + '.pyramid');
+      corrupt.writeUInt32LE(40, 24);
+      corrupt.writeUInt32LE(64, 28);
+      fs.writeFileSync(filename + '.pyramid', corrupt);
+      t.throws(function() { new libtiepie.Pyramid(filename); }, {message: 'Invalid pyramid file'});
+
+      try
+      {
+        fs.unlinkSync(filename);
+        fs.unlinkSync(filename + '.pyramid');
+      }
+      catch(e)
+      {
+      }
+    });
+  });
+});
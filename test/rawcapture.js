@@ -0,0 +1,29 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('rawcapture', function(t)
+{
+  t.plan(9);
+
+  t.throws(function() { new libtiepie.RawCapture([{data: [1, 2, 3], gain: 1, offset: 0}]); });
+
+  const length = 200000;
+  const raw = new Int16Array(length);
+  for(let i = 0; i < length; i++)
+    raw[i] = (i % 2000) - 1000;
+
+  const capture = new libtiepie.RawCapture([{number: 2, data: raw, gain: 0.001, offset: 0.5}]);
+  t.same(capture.channels, [2]);
+  t.equal(capture.sampleCount, length);
+  t.throws(function() { capture.slice(0); });
+
+  // A slice that crosses a tile boundary:
+  const slice = capture.slice(2, 65530, 65540);
+  t.equal(slice.length, 10);
+  t.ok(slice.every(function(v, i) { return Math.abs(v - (raw[65530 + i] * 0.001 + 0.5)) < 1e-6; }));
+
+  capture.setCacheSize(1);
+  t.equal(capture.slice(2).length, length);
+  t.equal(capture.slice(2, length - 1, length + 10)[0], Math.fround(raw[length - 1] * 0.001 + 0.5));
+  t.same(capture.getRaw(2), raw);
+});
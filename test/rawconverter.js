@@ -0,0 +1,32 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('rawconverter', function(t)
+{
+  t.plan(7);
+
+  t.throws(function() { new libtiepie.RawConverter([]); });
+
+  const converter = new libtiepie.RawConverter([
+    {rawValueMin: -32768, rawValueMax: 32767, dataValueMin: -32768 / 8192, dataValueMax: 32767 / 8192},
+    {gain: 2, offset: 1}
+  ]);
+  t.same(converter.getCoefficients()[0], {gain: 1 / 8192, offset: 0});
+
+  const raw = new Int16Array(100);
+  for(let i = 0; i < raw.length; i++)
+    raw[i] = (i - 50) * 100;
+  const volts = new Float32Array(raw.length);
+  t.equal(converter.convert(0, raw, volts), raw.length);
+  t.ok(volts.every(function(v, i) { return Math.abs(v - raw[i] / 8192) < 1e-6; }));
+
+  converter.setCalibration(1, 0.5, -1);
+  t.same(converter.getCoefficients()[1], {gain: 1, offset: -0.5});
+
+  const output = new Float64Array(raw.length);
+  converter.convert(1, new Uint8Array([0, 1, 255]), output, function(err, count)
+  {
+    t.error(err);
+    t.same(Array.from(output.subarray(0, count)), [-0.5, 0.5, 254.5]);
+  });
+})
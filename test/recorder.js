@@ -0,0 +1,95 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+const os = require('os')
+const path = require('path')
+const fs = require('fs')
+
+test('Recorder', function(t)
+{
+  t.plan(8);
+
+  t.throws(function() { libtiepie.Recorder(0); });
+  t.throws(function() { new libtiepie.Recorder(); });
+
+  // Arguments are checked before the device is accessed:
+  const recorder = new libtiepie.Recorder(0);
+  const filename = path.join(os.tmpdir(), 'node-libtiepie-recorder-test.bin');
+  t.throws(function() { recorder.start(filename, null); }, SyntaxError);
+  t.throws(function() { recorder.start(filename, 5, function() {}); }, {message: 'Invalid progress callback'});
+  t.throws(function() { recorder.start(filename, null, null); }, {message: 'Invalid callback'});
+
+  // An invalid handle fails before anything is allocated or started:
+  t.throws(function() { recorder.start(filename, null, function() {}); });
+  t.same(recorder.getStatus(), {running: false, chunkCount: 0, sampleCount: 0, bytesWritten: 0, overflowCount: 0});
+  t.notOk(fs.existsSync(filename));
+});
+
+test('Recorder file layout', function(t)
+{
+  t.plan(9);
+
+  // A recording as the recorder writes it: a zero padded header block, followed by chunks of both channels, each
+  // channel aligned to 4096 bytes:
+  const chunkSampleCount = 1000;
+  const chunkCount = 3;
+  const stride = 4096 + 4096;
+  const file = Buffer.alloc(4096 + chunkCount * stride);
+  file.write('TPCAPT', 0, 'latin1');
+  file.writeUInt32LE(1, 8);
+  file.writeUInt32LE(2, 12);
+  file.writeDoubleLE(1e6, 16);
+  file.writeUInt32LE(chunkCount * chunkSampleCount, 24);
+  file.writeUInt32LE(libtiepie.const.MM_STREAM, 48);
+  file.writeUInt32LE(12, 52);
+  file.writeUInt32LE(chunkSampleCount, 56);
+
+  const channels = [
+    {number: 0, dataType: libtiepie.const.DATARAWTYPE_INT16, offset: 4096},
+    {number: 2, dataType: libtiepie.const.DATARAWTYPE_FLOAT32, offset: 8192}
+  ];
+  channels.forEach(function(channel, i)
+  {
+    const p = 64 + 64 * i;
+    file.writeUInt16LE(channel.number, p);
+    file.writeUInt32LE(channel.dataType, p + 4);
+    file.writeDoubleLE(4, p + 8);
+    file.writeDoubleLE(-4, p + 16);
+    file.writeDoubleLE(4, p + 24);
+    file.writeUInt32LE(channel.offset, p + 56);
+  });
+  for(let chunk = 0; chunk < chunkCount; chunk++)
+  {
+    for(let i = 0; i < chunkSampleCount; i++)
+    {
+      file.writeInt16LE(chunk * 100 + i % 100, 4096 + chunk * stride + 2 * i);
+      file.writeFloatLE(chunk + i / 1000, 8192 + chunk * stride + 4 * i);
+    }
+  }
+
+  const filename = path.join(os.tmpdir(), 'node-libtiepie-recorder-layout-test.bin');
+  fs.writeFileSync(filename, file);
+  const result = libtiepie.CaptureFile.read(filename);
+  t.equal(result.measureMode, libtiepie.const.MM_STREAM);
+  t.equal(result.sampleCount, chunkCount * chunkSampleCount);
+  t.equal(result.chunkSampleCount, chunkSampleCount);
+  t.equal(result.channels[1].number, 2);
+  t.equal(result.channels[0].data.length, chunkCount);
+  t.ok(result.channels[0].data[2] instanceof Int16Array);
+  t.equal(result.channels[0].data[2][5], 205);
+  t.equal(result.channels[1].data[1][500], Math.fround(1.5));
+
+  // A recording that ends in the middle of its last chunk is rejected:
+  const truncated = filename + '.truncated';
+  fs.writeFileSync(truncated, file.subarray(0, 8192 + (chunkCount - 1) * stride + 4 * chunkSampleCount - 1));
+  t.throws(function() { libtiepie.CaptureFile.read(truncated); }, {message: 'Truncated capture file'});
+
+  // Windows refuses to delete a file while it is mapped:
+  try
+  {
+    fs.unlinkSync(filename);
+    fs.unlinkSync(truncated);
+  }
+  catch(e)
+  {
+  }
+});
@@ -0,0 +1,50 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('Resampler', function(t)
+{
+  t.plan(11);
+
+  t.throws(function() { libtiepie.Resampler(1e6, 1e6); });
+  t.throws(function() { new libtiepie.Resampler(0, 1e6); });
+  t.throws(function() { new libtiepie.Resampler(1e9, 1e6); });
+  t.throws(function() { new libtiepie.Resampler(1e6, 1e6, {cutoff: 2}); });
+
+  const resampler = new libtiepie.Resampler(48000, 44100, {channelCount: 2});
+  t.equal(resampler.outputRate, 44100);
+
+  const input = new Float32Array(4800);
+  for(let i = 0; i < input.length; i++)
+  {
+    input[i] = 0.5 + 0.25 * Math.sin(2 * Math.PI * 1000 * i / 48000);
+  }
+  const record = resampler.resample(input);
+  t.equal(record.length, 4410);
+
+  // Away from the edges the output follows the input signal:
+  let error = 0;
+  for(let k = 100; k < record.length - 100; k++)
+  {
+    error = Math.max(error, Math.abs(record[k] - (0.5 + 0.25 * Math.sin(2 * Math.PI * 1000 * k / 44100))));
+  }
+  t.ok(error < 1e-3);
+
+  // A stream gives the same samples as the record, whatever the chunk sizes:
+  let output = [];
+  let skipped = true;
+  for(let i = 0, length = 1; i < input.length; i += length, length = length * 3 % 997 + 1)
+  {
+    const result = resampler.process([null, input.subarray(i, i + length)]);
+    skipped = skipped && result[0] === null;
+    output = output.concat(Array.from(result[1]));
+  }
+  output = output.concat(Array.from(resampler.flush()[1]));
+  t.ok(skipped);
+  t.same(output, Array.from(record));
+
+  resampler.resample(input, function(err, result)
+  {
+    t.error(err);
+    t.same(Array.from(result), Array.from(record));
+  });
+});
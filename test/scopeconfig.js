@@ -0,0 +1,29 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('ScpApplyConfig', function(t)
+{
+  t.plan(10);
+
+  // The config is validated before the device is accessed:
+  const api = libtiepie.api;
+  t.throws(function() { api.ScpApplyConfig(0, null); }, {message: 'Invalid config'});
+  t.throws(function() { api.ScpApplyConfig(0, {resolutions: 12}); }, {message: 'resolutions: Unknown setting'});
+  t.throws(function() { api.ScpApplyConfig(0, {resolution: 264}); }, {message: 'resolution: Value out of range'});
+  t.throws(function() { api.ScpApplyConfig(0, {resolution: 12.5}); }, {message: 'resolution: Value out of range'});
+  t.throws(function() { api.ScpApplyConfig(0, {recordLength: -1}); }, {message: 'recordLength: Value out of range'});
+  t.throws(function() { api.ScpApplyConfig(0, {sampleFrequency: '1e6'}); }, {message: 'sampleFrequency: Number expected'});
+  t.throws(function() { api.ScpApplyConfig(0, {channels: [null, {enabled: 1}]}); }, {message: 'channels[1].enabled: Boolean expected'});
+  t.throws(function() { api.ScpApplyConfig(0, {channels: [{trigger: {levels: [0.5, NaN]}}]}); }, {message: 'channels[0].trigger.levels[1]: Value out of range'});
+  t.throws(function() { api.ScpApplyConfig(0, {channels: [{trigger: {level: 0.5}}]}); }, {message: 'channels[0].trigger.level: Unknown setting'});
+
+  // A valid config gets as far as the invalid handle:
+  try
+  {
+    api.ScpApplyConfig(0, {resolution: 12, recordLength: 5000, channels: [{enabled: true, range: 8, trigger: {levels: [0.5]}}]});
+  }
+  catch(e)
+  {
+    t.notMatch(e.message, /Unknown setting|expected|Value out of range/);
+  }
+});
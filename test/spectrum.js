@@ -0,0 +1,24 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('spectrum', function(t)
+{
+  t.plan(5);
+
+  const length = 1000;
+  const data = new Float32Array(length);
+  for(let i = 0; i < length; i++)
+    data[i] = 2 * Math.sin(2 * Math.PI * 50 * i / length);
+
+  const spectrum = new libtiepie.Spectrum(length, libtiepie.Spectrum.WINDOW_RECTANGULAR);
+  spectrum.process(data, function(err, count)
+  {
+    t.error(err);
+    t.equal(count, 1);
+
+    const magnitude = spectrum.getMagnitude();
+    t.equal(magnitude.length, length / 2 + 1);
+    t.ok(Math.abs(magnitude[50] - 2) < 1e-4);
+    t.ok(magnitude[49] < 1e-4 && magnitude[51] < 1e-4);
+  });
+})
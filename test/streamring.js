@@ -0,0 +1,73 @@
+const test = require('tap').test
+const StreamRingReader = require('../lib/streamring.js')
+
+// Builds a ring as StreamRing does, see src/streamring.h:
+function createRing(chunkCount, chunkSampleCount, channels, consumerCount)
+{
+  const headerSize = (16 + 4 * consumerCount + channels.length) * 4;
+  const dataOffset = Math.ceil(headerSize / 64) * 64;
+  const buffer = new SharedArrayBuffer(dataOffset + chunkCount * channels.length * chunkSampleCount * 4);
+  const header = new Int32Array(buffer);
+  header[1] = 1;
+  header[3] = chunkCount;
+  header[4] = chunkSampleCount;
+  header[5] = channels.length;
+  header[6] = consumerCount;
+  header[7] = dataOffset;
+  channels.forEach(function(ch, i) { header[16 + 4 * consumerCount + i] = ch; });
+
+  return {
+    buffer: buffer,
+    write: function(value)
+    {
+      const head = Atomics.load(header, 0);
+      const chunk = new Float32Array(buffer, dataOffset + (head % chunkCount) * channels.length * chunkSampleCount * 4, channels.length * chunkSampleCount);
+      chunk.fill(value);
+      Atomics.store(header, 0, head + 1);
+    }
+  };
+}
+
+test('StreamRingReader', function(t)
+{
+  const ring = createRing(4, 3, [0, 2], 2);
+  const a = new StreamRingReader(ring.buffer);
+  const b = new StreamRingReader(ring.buffer);
+  t.equal(a.index, 0);
+  t.equal(b.index, 1);
+  t.same(a.channels, [0, 2]);
+  t.throws(function() { new StreamRingReader(ring.buffer); });
+
+  t.equal(a.next(0), null);
+  ring.write(1);
+  ring.write(2);
+  t.equal(a.available, 2);
+
+  // Every reader gets every chunk, without copies:
+  let chunk = a.next(0);
+  t.equal(chunk.sequence, 0);
+  t.equal(chunk.data.length, 2);
+  t.same(Array.from(chunk.data[1]), [1, 1, 1]);
+  t.ok(chunk.data[0].buffer === ring.buffer);
+  t.ok(a.release());
+  t.equal(b.next(0).sequence, 0);
+  t.ok(b.release());
+
+  // A reader that falls behind skips to the oldest chunk that can't be overwritten:
+  for(let i = 3; i <= 8; i++)
+    ring.write(i);
+  chunk = a.next(0);
+  t.equal(chunk.sequence, 5);
+  t.equal(chunk.data[0][0], 6);
+  t.ok(a.release());
+
+  // A chunk overwritten while it is processed is reported by release():
+  chunk = b.next(0);
+  ring.write(9);
+  ring.write(10);
+  t.notOk(b.release());
+
+  a.close();
+  t.doesNotThrow(function() { new StreamRingReader(ring.buffer).close(); });
+  t.end();
+});
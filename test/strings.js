@@ -0,0 +1,25 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('String getters', function(t)
+{
+  const api = libtiepie.api;
+  const IDKIND_INDEX = libtiepie.const.IDKIND_INDEX;
+  const list = api.LstGetSnapshot();
+  t.plan(4 + 3 * list.length);
+
+  // Device list names are read into a stack buffer, the full name is returned:
+  for(let i = 0; i < list.length; i++)
+  {
+    t.equal(api.LstDevGetName(IDKIND_INDEX, i), list[i].name);
+    t.equal(api.LstDevGetNameShort(IDKIND_INDEX, i), list[i].nameShort);
+    t.equal(api.LstDevGetNameShortest(IDKIND_INDEX, i), list[i].nameShortest);
+  }
+  t.throws(function() { api.LstDevGetName(IDKIND_INDEX, list.length); });
+
+  // Names of an invalid handle fail and are not interned:
+  libtiepie.CapabilityCache.clear();
+  t.throws(function() { api.DevGetName(0); });
+  t.throws(function() { api.DevGetName(0); });
+  t.same(libtiepie.CapabilityCache.getStats(), {handles: 0, hits: 0, misses: 2, invalidations: 0});
+});
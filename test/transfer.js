@@ -0,0 +1,28 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('transferList', function(t)
+{
+  t.plan(4);
+
+  const a = new Float32Array(4);
+  const b = new Float32Array(a.buffer, 8, 2);
+  const c = new Float32Array(4);
+  t.same(libtiepie.transferList([a, null, b, c]), [a.buffer, c.buffer]);
+  t.same(libtiepie.transferList({data: [a], extra: c.buffer}), [a.buffer, c.buffer]);
+  t.same(libtiepie.transferList(null), []);
+
+  if(typeof SharedArrayBuffer === 'function')
+    t.same(libtiepie.transferList([new Float32Array(new SharedArrayBuffer(16))]), []);
+  else
+    t.pass();
+});
+
+test('ScpGetDataInto', function(t)
+{
+  t.plan(3);
+
+  t.throws(function() { libtiepie.api.ScpGetDataInto(0, new Float32Array(4), 0); }, TypeError);
+  t.throws(function() { libtiepie.api.ScpGetDataInto(0, [[1, 2]], 0); }, TypeError);
+  t.throws(function() { libtiepie.api.ScpGetDataInto(0, [new Float32Array(4)], 0); });
+});
@@ -0,0 +1,52 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+test('VirtualRecord', function(t)
+{
+  t.plan(6);
+
+  t.type(libtiepie.VirtualRecord, 'function');
+  t.throws(function() { libtiepie.VirtualRecord(0); });
+  t.throws(function() { new libtiepie.VirtualRecord(0, {pageSize: 0}); });
+  t.throws(function() { new libtiepie.VirtualRecord(0, {pageCount: 2, prefetch: 2}); });
+  t.throws(function() { new libtiepie.VirtualRecord([new Float64Array(10)]); });
+
+  // Options are valid, the handle isn't:
+  t.throws(function() { new libtiepie.VirtualRecord(0); });
+});
+
+test('VirtualRecord sequential scan', function(t)
+{
+  const pageSize = 1024;
+  const pageTotal = 200;
+  const data = new Float32Array(pageSize * pageTotal);
+  for(let i = 0; i < data.length; i++)
+    data[i] = i;
+
+  const record = new libtiepie.VirtualRecord([new Float32Array(16), data.subarray(0, 16)], {pageSize: pageSize});
+  t.equal(record.sampleCount, 16);
+
+  const scan = new libtiepie.VirtualRecord([data], {pageSize: pageSize, pageCount: 16, prefetch: 2});
+  t.equal(scan.sampleCount, data.length);
+
+  // One page per read, giving the prefetch thread time in between:
+  let page = 0;
+  let ok = true;
+  function next()
+  {
+    const result = scan.read(0, page * pageSize, (page + 1) * pageSize);
+    ok = ok && result.length === pageSize && result[0] === page * pageSize && result[pageSize - 1] === (page + 1) * pageSize - 1;
+    if(++page < pageTotal)
+      return setTimeout(next, 1);
+
+    t.ok(ok, 'data');
+    const status = scan.getStatus();
+    t.equal(status.hits + status.misses, pageTotal);
+    t.ok(status.misses < 10, 'prefetched pages are kept until read');
+    t.ok(status.prefetchHits > pageTotal - 10);
+    t.ok(status.fetchedSamples <= (pageTotal + 2) * pageSize, 'no page fetched twice');
+    t.ok(status.pageCount <= 16);
+    t.end();
+  }
+  next();
+});
@@ -0,0 +1,32 @@
+const test = require('tap').test
+const libtiepie = require('../lib/index.js')
+
+let worker_threads;
+try
+{
+  worker_threads = require('worker_threads');
+}
+catch(e)
+{
+}
+
+test('Worker threads', {skip: !worker_threads && 'worker_threads not available'}, function(t)
+{
+  t.plan(3);
+
+  const worker = new worker_threads.Worker(
+    'const libtiepie = require(' + JSON.stringify(require.resolve('../lib/index.js')) + ');' +
+    'require("worker_threads").parentPort.postMessage(libtiepie.api.LibGetVersion());',
+    {eval: true});
+  worker.on('message', function(version)
+  {
+    t.equal(version, libtiepie.api.LibGetVersion());
+  });
+  worker.on('exit', function(code)
+  {
+    t.equal(code, 0);
+
+    // LibTiePie must still be initialized for the main thread after the worker's instance is torn down:
+    t.doesNotThrow(function() { libtiepie.api.LstGetCount(); });
+  });
+});